@@ -57,7 +57,10 @@
  * implementation does shared-communication for operations on shared windows, MPI
  * standard doesn’t require it. Some implementation may use network even for
  * shared targets for shorter CPU occupancy. However, we do not have knowledge of
- * such low-level information. */
+ * such low-level information.
+ *
+ * Instead, PUT/GET to intra-node targets are done by load/store when the epoch
+ * does not require lock permission on the target (see csp_shm_direct.c). */
 
 #ifdef CSP_ENABLE_GRANT_LOCK_HIDDEN_BYTE
 #define CSP_GRANT_LOCK_DATATYPE char
@@ -101,7 +104,8 @@ typedef enum {
     CSP_LOAD_OPT_STATIC,
     CSP_LOAD_OPT_RANDOM,
     CSP_LOAD_OPT_COUNTING,
-    CSP_LOAD_BYTE_COUNTING
+    CSP_LOAD_BYTE_COUNTING,
+    CSP_LOAD_OPT_FEEDBACK
 } CSP_load_opt_t;
 
 typedef enum {
@@ -127,6 +131,11 @@ typedef enum {
 
 #define CSP_DEFAULT_NG 1
 
+/* Default maximum sleep time in microseconds of an idle ghost progress loop.
+ * 0 disables the idle backoff, thus the ghost always spins.
+ * Also see ghost_idle_sleep in CSP_env_param_t struct. */
+#define CSP_DEFAULT_GHOST_IDLE_SLEEP 0
+
 typedef enum {
     CSP_ASYNC_MODE_RMA = 1,
     CSP_ASYNC_MODE_PT2PT = 2,
@@ -136,6 +145,9 @@ typedef struct CSP_env_param {
     int num_g;
     CSP_load_opt_t load_opt;    /* runtime load balancing options */
     CSP_load_lock_t load_lock;  /* how to grant locks for runtime load balancing */
+    MPI_Aint load_acc_stripe;   /* size in bytes of the address stripes used to bind
+                                 * accumulates to ghosts. 0 (default) disables striping,
+                                 * thus accumulates always go to the main ghost. */
     int async_modes;            /* specify asynchronous progress enabled MPI communication modes
                                  * (e.g., RMA|P2P, RMA is always enabled) */
 
@@ -152,6 +164,24 @@ typedef struct CSP_env_param {
 #endif
     int offload_shmq_ncells;    /* number of free cells pre-allocated for offload shared queue.
                                  * 8192 by default.*/
+    int offload_node_ncells;    /* number of free cells in the node-wide pool shared by all
+                                 * local users. 0 (default) disables the pool. */
+    MPI_Aint offload_eager_msgsz;       /* maximum size in bytes of messages sent by eager
+                                         * offload, which copies the payload to shared memory.
+                                         * 0 (default) disables eager offload. */
+    MPI_Aint offload_pipeline_chunksz;  /* size in bytes of the chunks of pipelined messages.
+                                         * 0 (default) disables pipelining. */
+    int offload_req_pool_size;  /* number of request handles pre-allocated for offloaded calls.
+                                 * 0 (default) disables the pool, thus every offloaded call
+                                 * uses a generalized request. */
+    MPI_Aint dyn_pool_size;     /* size in bytes of the shared memory pool segment on every user
+                                 * process, used for the memory attached to dynamic windows.
+                                 * 0 (default) disables asynchronous progress on dynamic windows. */
+    int win_create_remap;       /* remap the user buffer of MPI_Win_create to shared memory, thus
+                                 * enabling asynchronous progress on such windows.
+                                 * 0 (default) disables it. */
+    int ghost_idle_sleep;       /* maximum sleep time in microseconds of an idle ghost progress
+                                 * loop. 0 (default) disables idle backoff. */
 } CSP_env_param_t;
 
 
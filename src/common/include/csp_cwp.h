@@ -7,28 +7,14 @@
 #define CSP_CWP_H_INCLUDED
 
 #include "csp.h"
-#include "csp_mlock.h"
 #include "csp_comm.h"
+#include "opa_primitives.h"
 
 /* ======================================================================
- * Command wire protocol (CWP) common definition (packet, tags).
+ * Command wire protocol (CWP) common definition (packet, ring, tags).
  * ====================================================================== */
 
-#define CSP_CWP_TAG 9890        /* tag for command */
 #define CSP_CWP_PARAM_TAG 9891  /* tag for any later command parameters */
-#define CSP_CWP_MLOCK_DEFAULT_SYNC_TAG 9892     /* default tag for mlock synchronization.
-                                                 * To ensure multiple threads can receive
-                                                 * the correct sync packet from ghost, we
-                                                 * use (TAG + seqno) in threaded case.
-                                                 * Both ghost and user code should always call
-                                                 * wrapper macro CSP_CWP_MLOCK_SYNC_TAG to get
-                                                 * the correct sync_tag. */
-
-#if defined(CSP_ENABLE_THREAD_SAFE)
-#define CSP_CWP_MLOCK_SYNC_TAG(gid) (CSP_CWP_MLOCK_DEFAULT_SYNC_TAG + gid.seqno)
-#else
-#define CSP_CWP_MLOCK_SYNC_TAG(gid) (CSP_CWP_MLOCK_DEFAULT_SYNC_TAG)
-#endif
 
 typedef enum {
     CSP_CWP_UNSET = 0,
@@ -38,11 +24,9 @@ typedef enum {
     CSP_CWP_FNC_UGCOMM_FREE,
     CSP_CWP_FNC_SHMBUF_REGIST,
     CSP_CWP_FNC_SHMBUF_FREE,
+    CSP_CWP_FNC_DATATYPE_REGIST,
+    CSP_CWP_FNC_DATATYPE_FREE,
     CSP_CWP_FNC_FINALIZE,
-    CSP_MLOCK_ACQUIRE,
-    CSP_MLOCK_DISCARD,
-    CSP_MLOCK_RELEASE,
-    CSP_MLOCK_STATUS_SYNC,
     CSP_CWP_MAX
 } CSP_cwp_t;
 
@@ -53,6 +37,10 @@ typedef struct CSP_cwp_winalloc_pkt {
     int epochs_used;
     int is_u_world;
     int info_npairs;
+    int ugcomm_id;              /* id of cached ug communicators, 0 if not cached. */
+    int is_ugcomm_cached;       /* whether the communicators are created by previous window. */
+    int is_dynamic;             /* created by MPI_Win_create_dynamic. */
+    int is_remapped;            /* created by MPI_Win_create on remapped user buffers. */
 } CSP_cwp_fnc_winalloc_pkt_t;
 
 typedef struct CSP_cwp_winfree_pkt {
@@ -67,6 +55,17 @@ typedef struct CSP_cwp_shmbuf_free_pkt {
     int user_local_root;
 } CSP_cwp_shmbuf_free_pkt_t;
 
+typedef struct CSP_cwp_datatype_regist_pkt {
+    int user_local_rank;
+    int g_lrank;                /* local rank of the ghost committing the datatype. */
+    int nelems;                 /* number of MPI_Aint elements in serialized datatype. */
+} CSP_cwp_datatype_regist_pkt_t;
+
+typedef struct CSP_cwp_datatype_free_pkt {
+    int g_lrank;
+    MPI_Datatype g_handle;      /* datatype handle on the ghost. */
+} CSP_cwp_datatype_free_pkt_t;
+
 typedef struct CSP_cwp_ugcomm_create_pkt {
     CSP_comm_type_t type;
     int user_local_root;
@@ -82,30 +81,21 @@ typedef struct CSP_cwp_ugcomm_free_pkt {
     MPI_Aint g_comm_handle;
 } CSP_cwp_fnc_ugcomm_free_pkt_t;
 
-typedef struct CSP_cwp_mlock_acquire_pkt {
-    CSP_mlock_gid_t group_id;   /* global unique id of user group. */
-} CSP_cwp_mlock_acquire_pkt_t;
-
-typedef CSP_cwp_mlock_acquire_pkt_t CSP_cwp_mlock_discard_pkt_t;
-typedef CSP_cwp_mlock_acquire_pkt_t CSP_cwp_mlock_release_pkt_t;
-
-typedef struct CSP_cwp_mlock_status_sync_pkt {
-    CSP_mlock_status_t status;
-} CSP_cwp_mlock_status_sync_pkt_t;
-
 typedef struct CSP_cwp_pkt {
     CSP_cwp_t cmd_type;
+    /* Parameter of the reading ghost carried in the ring slot, set at dequeue
+     * (see CSP_cwp_ring_slot_t). */
+    int has_g_param;
+    MPI_Aint g_param;
     union {
         CSP_cwp_fnc_winalloc_pkt_t fnc_winalloc;
         CSP_cwp_fnc_winfree_pkt_t fnc_winfree;
         CSP_cwp_shmbuf_regist_pkt_t fnc_shmbuf_regist;
         CSP_cwp_shmbuf_free_pkt_t fnc_shmbuf_free;
+        CSP_cwp_datatype_regist_pkt_t fnc_datatype_regist;
+        CSP_cwp_datatype_free_pkt_t fnc_datatype_free;
         CSP_cwp_fnc_ugcomm_create_pkt_t fnc_ugcomm_create;
         CSP_cwp_fnc_ugcomm_free_pkt_t fnc_ugcomm_free;
-        CSP_cwp_mlock_acquire_pkt_t lock_acquire;
-        CSP_cwp_mlock_discard_pkt_t lock_discard;
-        CSP_cwp_mlock_release_pkt_t lock_release;
-        CSP_cwp_mlock_status_sync_pkt_t lock_status_sync;
     } u;
 } CSP_cwp_pkt_t;
 
@@ -115,4 +105,119 @@ static inline void CSP_cwp_init_pkt(CSP_cwp_t cmd_type, CSP_cwp_pkt_t * pkt)
     pkt->cmd_type = cmd_type;
 }
 
+/* Shared-memory command ring.
+ * A single ring per node is allocated by the first local ghost. Local users
+ * issue commands into it as multiple producers; every local ghost reads all
+ * commands in the same order by its own cursor, thus commands are serialized
+ * on all ghosts without any root ghost forwarding. A slot is released for the
+ * next round once all ghosts have copied out the command, before handling it.
+ * A small parameter for every ghost (e.g., the handle of a ghost object) is
+ * carried in the slot; other command parameters are still exchanged by
+ * messages with CSP_CWP_PARAM_TAG.
+ *
+ * Tickets and sequence numbers are compared as unsigned integers, thus they
+ * can wrap around. The number of slots must be a power of two, thus the slot
+ * index stays continuous at wraparound. */
+
+#define CSP_CWP_RING_NSLOTS 64
+#define CSP_CWP_RING_MAX_G_PARAMS 16    /* Max number of ghosts with parameter in slot. */
+#define CSP_CWP_RING_CACHE_LINE_LEN 64
+
+typedef struct CSP_cwp_ring_slot {
+    OPA_int_t seqno;            /* Equals to ticket if free for the producer holding that
+                                 * ticket, set to (ticket + 1) once the command is written. */
+    OPA_int_t nacks;            /* Number of ghosts already copied out the command. */
+    int user_local_rank;        /* Local rank of the issuing user process. */
+    int ng_params;              /* Number of valid g_params, 0 if none. */
+    MPI_Aint g_params[CSP_CWP_RING_MAX_G_PARAMS];       /* Indexed by ghost local rank. */
+    CSP_cwp_pkt_t pkt;
+} CSP_cwp_ring_slot_t;
+
+typedef struct CSP_cwp_ring {
+    OPA_int_t tail;             /* Next ticket, incremented by the producer taking it. */
+    char padding[CSP_CWP_RING_CACHE_LINE_LEN - sizeof(OPA_int_t)];
+    CSP_cwp_ring_slot_t slots[CSP_CWP_RING_NSLOTS];
+} CSP_cwp_ring_t;
+
+static inline void CSP_cwp_ring_init(CSP_cwp_ring_t * ring)
+{
+    int i;
+
+    memset(ring, 0, sizeof(CSP_cwp_ring_t));
+    OPA_store_int(&ring->tail, 0);
+    for (i = 0; i < CSP_CWP_RING_NSLOTS; i++) {
+        OPA_store_int(&ring->slots[i].seqno, i);
+        OPA_store_int(&ring->slots[i].nacks, 0);
+    }
+    OPA_write_barrier();
+}
+
+/* Try to write a command into the ring (multiple producers). g_params holds
+ * ng_params parameters indexed by ghost local rank, or NULL. Return 0 without
+ * taking a ticket if the ring is full (i.e., the slot is still not read by all
+ * ghosts in previous round), thus the caller never holds a ticket while waiting. */
+static inline int CSP_cwp_ring_try_enqueue(CSP_cwp_ring_t * ring, CSP_cwp_pkt_t * pkt,
+                                           MPI_Aint * g_params, int ng_params,
+                                           int user_local_rank)
+{
+    CSP_cwp_ring_slot_t *slot = NULL;
+    unsigned int ticket, seqno;
+    int diff;
+
+    do {
+        ticket = (unsigned int) OPA_load_int(&ring->tail);
+        slot = &ring->slots[ticket % CSP_CWP_RING_NSLOTS];
+        seqno = (unsigned int) OPA_load_int(&slot->seqno);
+
+        /* Negative if not released in previous round, positive if the ticket
+         * is already taken by another producer. */
+        diff = (int) (seqno - ticket);
+        if (diff < 0)
+            return 0;
+    } while (diff > 0 || (unsigned int) OPA_cas_int(&ring->tail, (int) ticket,
+                                                    (int) (ticket + 1)) != ticket);
+
+    memcpy(&slot->pkt, pkt, sizeof(CSP_cwp_pkt_t));
+    slot->user_local_rank = user_local_rank;
+    slot->ng_params = 0;
+    if (g_params && ng_params <= CSP_CWP_RING_MAX_G_PARAMS) {
+        memcpy(slot->g_params, g_params, sizeof(MPI_Aint) * ng_params);
+        slot->ng_params = ng_params;
+    }
+    OPA_store_int(&slot->nacks, 0);
+
+    /* Command must be visible before published. */
+    OPA_write_barrier();
+    OPA_store_int(&slot->seqno, (int) (ticket + 1));
+    return 1;
+}
+
+/* Copy out the command at the cursor of a ghost (one of nghosts consumers),
+ * with the parameter of the ghost with local rank g_lrank if any.
+ * Return 1 and move the cursor if a command is ready, otherwise return 0. */
+static inline int CSP_cwp_ring_dequeue(CSP_cwp_ring_t * ring, unsigned int *cursor, int nghosts,
+                                       int g_lrank, CSP_cwp_pkt_t * pkt, int *user_local_rank)
+{
+    unsigned int ticket = (*cursor);
+    CSP_cwp_ring_slot_t *slot = &ring->slots[ticket % CSP_CWP_RING_NSLOTS];
+
+    if ((unsigned int) OPA_load_int(&slot->seqno) != ticket + 1)
+        return 0;
+
+    OPA_read_barrier();
+    memcpy(pkt, &slot->pkt, sizeof(CSP_cwp_pkt_t));
+    (*user_local_rank) = slot->user_local_rank;
+    pkt->has_g_param = (g_lrank < slot->ng_params);
+    if (pkt->has_g_param)
+        pkt->g_param = slot->g_params[g_lrank];
+
+    /* Finish reading before the last ghost releases the slot to producers. */
+    OPA_read_write_barrier();
+    if (OPA_fetch_and_incr_int(&slot->nacks) == nghosts - 1)
+        OPA_store_int(&slot->seqno, (int) (ticket + CSP_CWP_RING_NSLOTS));
+
+    (*cursor) = ticket + 1;
+    return 1;
+}
+
 #endif /* CSP_CWP_H_INCLUDED */
@@ -231,4 +231,14 @@ static inline void CSP_datatype_fill_predefined_table(MPI_Datatype * table)
     table[CSP_DATATYPE_MPI_COMPLEX32] = MPI_COMPLEX32;
 #endif
 }
+
+/* Derived datatypes are serialized by the user into an MPI_Aint array and
+ * rebuilt on the ghost process. Every datatype is encoded as either
+ *   [id]: predefined datatype (CSP_DATATYPE_*), or
+ *   [CSP_DATATYPE_SERIAL_DERIVED, combiner, nints, naddrs, ndtypes, ints..., addrs...,
+ *    datatypes...]: derived datatype with the arguments returned by
+ *    MPI_Type_get_contents, every inner datatype is encoded recursively. */
+#define CSP_DATATYPE_SERIAL_DERIVED (-1)
+#define CSP_DATATYPE_SERIAL_HDR_LEN 5
+
 #endif /* CSP_DATATYPE_H_ */
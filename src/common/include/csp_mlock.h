@@ -7,6 +7,8 @@
 #define CSP_MLOCK_H_INCLUDED
 
 #include <stdio.h>
+#include <string.h>
+#include "opa_primitives.h"
 
 /* ======================================================================
  * Multi-objects lock (MLOCK) common definition.
@@ -39,4 +41,99 @@ static inline void CSP_mlock_gid_to_str(CSP_mlock_gid_t gid, char *str)
 #endif
 }
 
+/* return positive value if gid1 > gid2.*/
+static inline int CSP_mlock_gid_compare(CSP_mlock_gid_t gid1, CSP_mlock_gid_t gid2)
+{
+    int diff = 0;
+
+    diff = gid1.rank - gid2.rank;
+
+#if defined(CSP_ENABLE_THREAD_SAFE)
+    /* if same rank, compare seqno. */
+    if (diff == 0)
+        diff = gid1.seqno - gid2.seqno;
+#endif
+    return diff;
+}
+
+/* ======================================================================
+ * Shared-memory lock object.
+ * One lock per node, allocated on the first local ghost and accessed by all
+ * local processes through a spinlock. It is granted to one group at a time.
+ * Other requests are suspended, and the one with the smallest group id gets
+ * the lock at release. The status of a suspended request is high priority if
+ * its group id is smaller than the granted one, otherwise low priority.
+ * ====================================================================== */
+
+#if defined(CSP_ENABLE_THREAD_SAFE)
+#define CSP_MLOCK_SHM_NREQS_PER_USER 64 /* any threads of a user may acquire. */
+#else
+#define CSP_MLOCK_SHM_NREQS_PER_USER 1  /* only the user root acquires. */
+#endif
+
+typedef struct CSP_mlock_shm_req {
+    int used;                   /* 0|1 */
+    CSP_mlock_gid_t group_id;
+} CSP_mlock_shm_req_t;
+
+typedef struct CSP_mlock_shm {
+    OPA_int_t spin;             /* 0|1, protects all following fields. */
+    int is_granted;             /* 0|1 */
+    CSP_mlock_gid_t granted_gid;
+    int max_nreqs;
+    CSP_mlock_shm_req_t reqs[]; /* Suspended requests, unsorted. */
+} CSP_mlock_shm_t;
+
+#define CSP_MLOCK_SHM_SIZE(max_nreqs) \
+    (sizeof(CSP_mlock_shm_t) + (max_nreqs) * sizeof(CSP_mlock_shm_req_t))
+
+static inline void CSP_mlock_shm_init(CSP_mlock_shm_t * shm, int max_nreqs)
+{
+    memset(shm, 0, CSP_MLOCK_SHM_SIZE(max_nreqs));
+    shm->max_nreqs = max_nreqs;
+    OPA_store_int(&shm->spin, 0);
+    OPA_write_barrier();
+}
+
+static inline void CSP_mlock_shm_enter(CSP_mlock_shm_t * shm)
+{
+    while (OPA_cas_int(&shm->spin, 0, 1) != 0)
+        OPA_busy_wait();
+    OPA_read_write_barrier();
+}
+
+static inline void CSP_mlock_shm_exit(CSP_mlock_shm_t * shm)
+{
+    OPA_read_write_barrier();
+    OPA_store_int(&shm->spin, 0);
+}
+
+/* Grant the lock to the suspended request with the smallest group id.
+ * It must be called in the spinlock when the lock is not granted. */
+static inline void CSP_mlock_shm_grant_next(CSP_mlock_shm_t * shm)
+{
+    int i, next = -1;
+
+    for (i = 0; i < shm->max_nreqs; i++) {
+        if (shm->reqs[i].used && (next < 0 ||
+                                  CSP_mlock_gid_compare(shm->reqs[i].group_id,
+                                                        shm->reqs[next].group_id) < 0))
+            next = i;
+    }
+
+    if (next >= 0) {
+        shm->is_granted = 1;
+        shm->granted_gid = shm->reqs[next].group_id;
+        shm->reqs[next].used = 0;
+    }
+}
+
+/* Release the granted lock, and grant it to the next suspended request.
+ * It must be called in the spinlock. */
+static inline void CSP_mlock_shm_release(CSP_mlock_shm_t * shm)
+{
+    shm->is_granted = 0;
+    CSP_mlock_shm_grant_next(shm);
+}
+
 #endif /* CSP_MLOCK_H_INCLUDED */
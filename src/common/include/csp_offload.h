@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 #include <mpi.h>
 #include <casperconf.h>
 #include "csp_util.h"
@@ -50,9 +51,36 @@ typedef struct CSP_offload_tag_trans {
 #define CSP_OFFLOAD_SHMQ_MEMSZ(ncells) (ncells * sizeof(CSP_offload_cell_t))
 #define CSP_OFFLOAD_CACHE_LINE_LEN 64
 
+/* Default number of cells in the node-wide pool, which is shared by all local
+ * users. A user borrows cells from the pool only when all its own cells are
+ * outstanding. 0 disables the pool.
+ * Also see offload_node_ncells in CSP_env_param_t struct. */
+#define CSP_DEFAULT_OFFLOAD_NODE_NCELLS 0
+
 /* Default message size threshold for enabling offload. */
 #define CSP_DEFAULT_OFFLOAD_MIN_MSGSZ 8192
 
+/* Default maximum message size of eager send, whose payload is copied into
+ * shared memory thus completes locally at issue. 0 disables eager send.
+ * Also see offload_eager_msgsz in CSP_env_param_t struct. */
+#define CSP_DEFAULT_OFFLOAD_EAGER_MSGSZ 0
+
+/* Default chunk size of pipelined message, which is sent as multiple chunks so
+ * that the ghost sends copied chunks while the user copies following ones into
+ * bounce buffers. 0 disables pipelining.
+ * Also see offload_pipeline_chunksz in CSP_env_param_t struct. */
+#define CSP_DEFAULT_OFFLOAD_PIPELINE_CHUNKSZ 0
+#define CSP_OFFLOAD_PIPELINE_NBUFS 4    /* number of bounce buffers on each user process. */
+#define CSP_OFFLOAD_BOUNCE_NULL (-1)
+
+/* Default number of pre-allocated request handles on each user process.
+ * An offloaded call takes a generalized request only if all handles are used.
+ * Disabled by default because a pooled request cannot be passed to MPI calls
+ * other than MPI_Test, MPI_Wait and MPI_Waitall.
+ * Also see offload_req_pool_size in CSP_env_param_t struct. */
+#define CSP_DEFAULT_OFFLOAD_REQ_POOL_SIZE 0
+#define CSP_OFFLOAD_REQ_SLOT_NULL (-1)
+
 typedef enum {
     CSP_OFFLOAD_ISEND = 0,
     CSP_OFFLOAD_IRECV,
@@ -80,8 +108,16 @@ typedef struct CSP_offload_pkt {
         CSP_offload_isend_pkt_t isend;
         CSP_offload_irecv_pkt_t irecv;
     };
-    OPA_int_t complet_flag;     /* 0|1. Ghost sets to 1 after issued call is locally
-                                 * completed.*/
+    int packed;                 /* 0|1. Set to 1 if the payload is copied into the channel
+                                 * region (eager slot or bounce buffer). isend.g_bufaddr
+                                 * is then the offset of the copy in the region, and
+                                 * isend.count is the size in bytes (MPI_PACKED). */
+    MPI_Aint chunksz;           /* Size in bytes of the chunks of a pipelined receive, or 0.
+                                 * The ghost receives the chunks in order into the buffer
+                                 * till the sender's shorter last chunk arrives. */
+    OPA_int_t complet_flag;     /* 0|1. User sets to 1 after dequeued the cell from
+                                 * the completion queue, that is, the ghost has
+                                 * locally completed the issued call.*/
     MPI_Status stat;            /* Set by ghost and read by user process.
                                  * User accesses it only when complet_flag is 1,
                                  * so do not need atomic access to it.*/
@@ -91,8 +127,27 @@ typedef struct CSP_offload_pkt {
      * putting in the shared region.*/
     MPI_Request req;            /* Only accessed by user process. Complete the request
                                  * when complet_flag = 1.*/
+    int req_slot;               /* Only accessed by user process. Index of the pooled
+                                 * request, or CSP_OFFLOAD_REQ_SLOT_NULL if req is a
+                                 * generalized request. */
+    int waitall_idx;            /* Only accessed by user process. 1 + index of the request
+                                 * in the array of the ongoing MPI_Waitall, or 0. */
+    int eager;                  /* Only accessed by user process. 0|1. Set to 1 for eager
+                                 * send, whose request completes at issue. */
+    void *pipe;                 /* Only accessed by user process. The pipelined message
+                                 * this cell is a chunk of, or NULL. */
+    void *ddt;                  /* Only accessed by user process. The derived datatype
+                                 * committed on ghost that this cell refers to, or NULL. */
+    int bounce_idx;             /* Only accessed by user process. The bounce buffer holding
+                                 * the chunk, or CSP_OFFLOAD_BOUNCE_NULL. */
     MPI_Request g_req;          /* Only accessed by ghost process. Once the request is
-                                 * completed, set complet_flag = 1.*/
+                                 * completed, enqueue the cell to completion queue.*/
+    int g_ch_idx;               /* Only accessed by ghost process. The channel from which
+                                 * the cell is received. */
+    MPI_Aint g_chunk_off;       /* Only accessed by ghost process. Offset in bytes of the
+                                 * current chunk of pipelined receive. */
+    struct CSP_offload_pkt *g_next;     /* Only accessed by ghost process. Next packet in the
+                                         * list of pipelined or deferred receives. */
     MPI_Aint ug_comm_handle;    /* Address of user ug_comm object. */
 } CSP_offload_pkt_t;
 
@@ -126,6 +181,10 @@ typedef struct CSP_offload_cell {
     /* Hash structure for request->cell mapping on user process. */
     UT_hash_handle hh;
     MPI_Request key;
+
+    /* Local copy of the eager payload in pending cell on user process. It is
+     * copied into the eager slot when the cell is moved to shared queue. */
+    void *eager_buf;
 } CSP_offload_cell_t;
 
 #define CSP_OFFLOAD_ABS_PT_DECL(pointer) pt.abs.pointer
@@ -151,6 +210,53 @@ typedef struct {
     char padding2[CSP_OFFLOAD_CACHE_LINE_LEN - sizeof(CSP_offload_cell_rl_ptr_t)];
 } CSP_offload_shmqueue_t;
 
+/* Completion queue of a channel. The ghost process enqueues a cell when its
+ * issued call is locally completed, and the user process dequeues it, thus a
+ * waiting user only touches the completed cells. Every shared cell is
+ * outstanding at most once, thus (ncells + 1) entries never overflow. */
+typedef struct {
+    OPA_int_t tail;             /* Next entry to be written, updated by producer. */
+    char padding1[CSP_OFFLOAD_CACHE_LINE_LEN - sizeof(OPA_int_t)];
+
+    OPA_int_t head;             /* Next entry to be read, updated by consumer. */
+    int size;                   /* Number of entries. */
+    char padding2[CSP_OFFLOAD_CACHE_LINE_LEN - sizeof(OPA_int_t) - sizeof(int)];
+
+    CSP_offload_cell_rl_ptr_t ents[];   /* Relative offset of completed cells. */
+} CSP_offload_cmplq_t;
+
+/* Node-wide pool of free cells. It is a lock-free stack of cell indexes, whose
+ * top is tagged with a counter incremented at every update to avoid ABA problem.
+ * Index is stored as (index + 1) in the low half of the top, 0 means empty. */
+typedef struct {
+    OPA_ptr_t top;
+    char padding1[CSP_OFFLOAD_CACHE_LINE_LEN - sizeof(OPA_ptr_t)];
+
+    int ncells;
+    int next[];                 /* (index + 1) of the next free cell, written only by
+                                 * the process that holds the cell. */
+} CSP_offload_pool_t;
+
+#define CSP_OFFLOAD_POOL_IDX_NBITS (sizeof(void *) * 4)
+#define CSP_OFFLOAD_POOL_IDX_MASK (((uintptr_t) 1 << CSP_OFFLOAD_POOL_IDX_NBITS) - 1)
+
+/* Layout of the shared region of each user process:
+ * [shm_recvq | cmplq | cells | eager slots | bounce buffers]. Each part is aligned
+ * by cache line. The eager slots exist only if eager send is enabled, one for
+ * every cell. The bounce buffers exist only if pipelining is enabled.
+ * The region of the first local user is followed by the node-wide pool
+ * [pool | cells | eager slots] if it is enabled. The shared window is contiguous,
+ * thus a pool cell can be addressed by its offset to the region of any user. */
+#define CSP_OFFLOAD_SHMQ_ALIGN_SZ                                              \
+    CSP_ALIGN(sizeof(CSP_offload_shmqueue_t), CSP_OFFLOAD_CACHE_LINE_LEN)
+#define CSP_OFFLOAD_CMPLQ_ALIGN_SZ(ncells)                                     \
+    CSP_ALIGN(sizeof(CSP_offload_cmplq_t) +                                    \
+              ((ncells) + 1) * sizeof(CSP_offload_cell_rl_ptr_t), CSP_OFFLOAD_CACHE_LINE_LEN)
+#define CSP_OFFLOAD_POOL_ALIGN_SZ(ncells)                                      \
+    CSP_ALIGN(sizeof(CSP_offload_pool_t) + (ncells) * sizeof(int), CSP_OFFLOAD_CACHE_LINE_LEN)
+#define CSP_OFFLOAD_EAGER_SLOT_ALIGN_SZ(msgsz) CSP_ALIGN(msgsz, CSP_OFFLOAD_CACHE_LINE_LEN)
+#define CSP_OFFLOAD_BOUNCE_ALIGN_SZ(chunksz) CSP_ALIGN(chunksz, CSP_OFFLOAD_CACHE_LINE_LEN)
+
 /* ======================================================================
  * Queue routines for cells offloaded from user process to ghost process.
  *
@@ -334,5 +440,102 @@ static inline void CSP_offload_recvq_dequeue(MPI_Aint base, CSP_offload_shmqueue
     *cell_ptr = old_head;
 }
 
+/* ======================================================================
+ * Completion queue routines for cells completed by ghost process.
+ * Single-Producer (ghost) Single-Consumer (user) ring.
+ * ====================================================================== */
+
+static inline void CSP_offload_cmplq_init(CSP_offload_cmplq_t * q, int ncells)
+{
+    OPA_store_int(&q->tail, 0);
+    OPA_store_int(&q->head, 0);
+    q->size = ncells + 1;
+}
+
+/* Empty queried only by consumer. */
+static inline int CSP_offload_cmplq_empty(CSP_offload_cmplq_t * q)
+{
+    return OPA_load_int(&q->head) == OPA_load_int(&q->tail);
+}
+
+static inline void CSP_offload_cmplq_enqueue(MPI_Aint base, CSP_offload_cmplq_t * q,
+                                             CSP_offload_cell_t * cell)
+{
+    int tail = OPA_load_int(&q->tail);
+
+    CSP_DBG_ASSERT((tail + 1) % q->size != OPA_load_int(&q->head));
+    q->ents[tail] = CSP_offload_cell_abs2rl(base, cell);
+
+    /* Orders the entry and the payload (e.g., status) w.r.t. updating the tail. */
+    OPA_write_barrier();
+    OPA_store_int(&q->tail, (tail + 1) % q->size);
+}
+
+/* Return 0 if queue is empty, otherwise return 1 and the completed cell. */
+static inline int CSP_offload_cmplq_dequeue(MPI_Aint base, CSP_offload_cmplq_t * q,
+                                            CSP_offload_cell_t ** cell_ptr)
+{
+    int head = OPA_load_int(&q->head);
+
+    if (head == OPA_load_int(&q->tail))
+        return 0;
+
+    /* Orders the load of tail w.r.t. the entry and payload reads by the caller. */
+    OPA_read_barrier();
+    *cell_ptr = CSP_offload_cell_rl2abs(base, q->ents[head]);
+
+    OPA_store_int(&q->head, (head + 1) % q->size);
+    return 1;
+}
+
+/* ======================================================================
+ * Node-wide pool routines. Multiple-Producer-Multiple-Consumer stack.
+ * ====================================================================== */
+
+static inline void CSP_offload_pool_init(CSP_offload_pool_t * pool, int ncells)
+{
+    int i;
+
+    pool->ncells = ncells;
+    for (i = 0; i < ncells; i++)
+        pool->next[i] = (i + 1 < ncells) ? i + 2 : 0;
+    OPA_store_ptr(&pool->top, (void *) (uintptr_t) (ncells > 0 ? 1 : 0));
+}
+
+/* Return the index of a free cell, or -1 if the pool is empty. */
+static inline int CSP_offload_pool_pop(CSP_offload_pool_t * pool)
+{
+    uintptr_t old_top, new_top, tag;
+    int idx;
+
+    do {
+        old_top = (uintptr_t) OPA_load_ptr(&pool->top);
+        if ((old_top & CSP_OFFLOAD_POOL_IDX_MASK) == 0)
+            return -1;
+
+        /* The next may be stale if another process popped the cell concurrently,
+         * but then the tag is changed and the CAS fails. */
+        idx = (int) (old_top & CSP_OFFLOAD_POOL_IDX_MASK) - 1;
+        tag = (old_top >> CSP_OFFLOAD_POOL_IDX_NBITS) + 1;
+        new_top = (tag << CSP_OFFLOAD_POOL_IDX_NBITS) | (uintptr_t) pool->next[idx];
+    } while ((uintptr_t) OPA_cas_ptr(&pool->top, (void *) old_top, (void *) new_top) != old_top);
+
+    return idx;
+}
+
+static inline void CSP_offload_pool_push(CSP_offload_pool_t * pool, int idx)
+{
+    uintptr_t old_top, new_top, tag;
+
+    do {
+        old_top = (uintptr_t) OPA_load_ptr(&pool->top);
+        pool->next[idx] = (int) (old_top & CSP_OFFLOAD_POOL_IDX_MASK);
+        tag = (old_top >> CSP_OFFLOAD_POOL_IDX_NBITS) + 1;
+        new_top = (tag << CSP_OFFLOAD_POOL_IDX_NBITS) | (uintptr_t) (idx + 1);
+
+        /* Orders the next and the reset cell w.r.t. updating the top. */
+        OPA_write_barrier();
+    } while ((uintptr_t) OPA_cas_ptr(&pool->top, (void *) old_top, (void *) new_top) != old_top);
+}
 
 #endif /* CSP_OFFLOAD_H_INCLUDED */
@@ -224,6 +224,87 @@ static int initialize_env(void)
         return CSP_get_error_code(CSP_ERR_ENV);
     }
 
+    CSP_ENV.offload_node_ncells = CSP_DEFAULT_OFFLOAD_NODE_NCELLS;
+    val = getenv("CSP_OFFLOAD_NODE_NCELLS");
+    if (val && strlen(val)) {
+        CSP_ENV.offload_node_ncells = atoi(val);
+    }
+    if (CSP_ENV.offload_node_ncells < 0 ||
+        (uintptr_t) CSP_ENV.offload_node_ncells >= CSP_OFFLOAD_POOL_IDX_MASK) {
+        CSP_msg_print(CSP_MSG_ERROR, "Wrong CSP_OFFLOAD_NODE_NCELLS %d\n",
+                      CSP_ENV.offload_node_ncells);
+        return CSP_get_error_code(CSP_ERR_ENV);
+    }
+
+    CSP_ENV.offload_eager_msgsz = CSP_DEFAULT_OFFLOAD_EAGER_MSGSZ;
+    val = getenv("CSP_OFFLOAD_EAGER_MSGSZ");
+    if (val && strlen(val)) {
+        CSP_ENV.offload_eager_msgsz = (MPI_Aint) atol(val);
+    }
+    if (CSP_ENV.offload_eager_msgsz < 0) {
+        CSP_msg_print(CSP_MSG_ERROR, "Wrong CSP_OFFLOAD_EAGER_MSGSZ %ld\n",
+                      CSP_ENV.offload_eager_msgsz);
+        return CSP_get_error_code(CSP_ERR_ENV);
+    }
+
+    CSP_ENV.offload_pipeline_chunksz = CSP_DEFAULT_OFFLOAD_PIPELINE_CHUNKSZ;
+    val = getenv("CSP_OFFLOAD_PIPELINE_CHUNKSZ");
+    if (val && strlen(val)) {
+        CSP_ENV.offload_pipeline_chunksz = (MPI_Aint) atol(val);
+    }
+    if (CSP_ENV.offload_pipeline_chunksz < 0) {
+        CSP_msg_print(CSP_MSG_ERROR, "Wrong CSP_OFFLOAD_PIPELINE_CHUNKSZ %ld\n",
+                      CSP_ENV.offload_pipeline_chunksz);
+        return CSP_get_error_code(CSP_ERR_ENV);
+    }
+
+    CSP_ENV.offload_req_pool_size = CSP_DEFAULT_OFFLOAD_REQ_POOL_SIZE;
+    val = getenv("CSP_OFFLOAD_REQ_POOL_SIZE");
+    if (val && strlen(val)) {
+        CSP_ENV.offload_req_pool_size = atoi(val);
+    }
+    if (CSP_ENV.offload_req_pool_size < 0) {
+        CSP_msg_print(CSP_MSG_ERROR, "Wrong CSP_OFFLOAD_REQ_POOL_SIZE %d\n",
+                      CSP_ENV.offload_req_pool_size);
+        return CSP_get_error_code(CSP_ERR_ENV);
+    }
+
+    CSP_ENV.dyn_pool_size = 0;
+    val = getenv("CSP_DYNAMIC_POOL_SIZE");
+    if (val && strlen(val)) {
+        CSP_ENV.dyn_pool_size = (MPI_Aint) atol(val);
+    }
+    if (CSP_ENV.dyn_pool_size < 0) {
+        CSP_msg_print(CSP_MSG_ERROR, "Wrong CSP_DYNAMIC_POOL_SIZE %ld\n", CSP_ENV.dyn_pool_size);
+        return CSP_get_error_code(CSP_ERR_ENV);
+    }
+
+    CSP_ENV.win_create_remap = 0;
+    val = getenv("CSP_WIN_CREATE_REMAP");
+    if (val && strlen(val)) {
+        if (!strncmp(val, "on", strlen("on"))) {
+            CSP_ENV.win_create_remap = 1;
+        }
+        else if (!strncmp(val, "off", strlen("off"))) {
+            CSP_ENV.win_create_remap = 0;
+        }
+        else {
+            CSP_msg_print(CSP_MSG_ERROR, "Unknown CSP_WIN_CREATE_REMAP %s\n", val);
+            return CSP_get_error_code(CSP_ERR_ENV);
+        }
+    }
+
+    CSP_ENV.ghost_idle_sleep = CSP_DEFAULT_GHOST_IDLE_SLEEP;
+    val = getenv("CSP_GHOST_IDLE_SLEEP");
+    if (val && strlen(val)) {
+        CSP_ENV.ghost_idle_sleep = atoi(val);
+    }
+    if (CSP_ENV.ghost_idle_sleep < 0) {
+        CSP_msg_print(CSP_MSG_ERROR, "Wrong CSP_GHOST_IDLE_SLEEP %d\n",
+                      CSP_ENV.ghost_idle_sleep);
+        return CSP_get_error_code(CSP_ERR_ENV);
+    }
+
 #if defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
     CSP_ENV.load_opt = CSP_LOAD_OPT_RANDOM;
 
@@ -238,6 +319,9 @@ static int initialize_env(void)
         else if (!strncmp(val, "byte", strlen("byte"))) {
             CSP_ENV.load_opt = CSP_LOAD_BYTE_COUNTING;
         }
+        else if (!strncmp(val, "feedback", strlen("feedback"))) {
+            CSP_ENV.load_opt = CSP_LOAD_OPT_FEEDBACK;
+        }
         else {
             CSP_msg_print(CSP_MSG_ERROR, "Unknown CSP_RUMTIME_LOAD_OPT %s\n", val);
             return CSP_get_error_code(CSP_ERR_ENV);
@@ -258,9 +342,21 @@ static int initialize_env(void)
             return CSP_get_error_code(CSP_ERR_ENV);
         }
     }
+
+    CSP_ENV.load_acc_stripe = 0;
+    val = getenv("CSP_RUNTIME_LOAD_ACC_STRIPE");
+    if (val && strlen(val)) {
+        CSP_ENV.load_acc_stripe = (MPI_Aint) atol(val);
+    }
+    if (CSP_ENV.load_acc_stripe < 0) {
+        CSP_msg_print(CSP_MSG_ERROR, "Wrong CSP_RUNTIME_LOAD_ACC_STRIPE %ld\n",
+                      CSP_ENV.load_acc_stripe);
+        return CSP_get_error_code(CSP_ERR_ENV);
+    }
 #else
     CSP_ENV.load_opt = CSP_LOAD_OPT_STATIC;
     CSP_ENV.load_lock = CSP_LOAD_LOCK_NATURE;
+    CSP_ENV.load_acc_stripe = 0;
 #endif
 
     if (CSP_PROC.wrank == 0 && (CSP_ENV.verbose & CSP_MSG_CONFIG_GLOBAL)) {
@@ -322,32 +418,57 @@ static int initialize_env(void)
 #ifdef CSP_ENABLE_TOPO_OPT
                       "    CSP_TOPO         = %s\n"
 #endif
-                      "    CSP_ASYNC_MODE   = %s\n",
+                      "    CSP_ASYNC_MODE   = %s\n"
+                      "    CSP_GHOST_IDLE_SLEEP = %d us%s\n",
                       verb_joined_str, CSP_ENV.num_g,
                       (CSP_ENV.async_config == CSP_ASYNC_CONFIG_ON) ? "on" : "off",
 #ifdef CSP_ENABLE_TOPO_OPT
                       topo_str,
 #endif
-                      async_joined_str);
+                      async_joined_str, CSP_ENV.ghost_idle_sleep,
+                      CSP_ENV.ghost_idle_sleep > 0 ? "" : " (disabled)");
 
         if (CSP_ENV.async_modes & CSP_ASYNC_MODE_PT2PT) {
             CSP_msg_print(CSP_MSG_CONFIG_GLOBAL, "PT2PT Offloading Options:\n"
                           "    CSP_OFFLOAD_MIN_MSGSZ   = %d bytes\n"
                           "    CSP_OFFLOAD_SHMQ_NCELLS = %d (total %ld Kbytes)\n"
-                          "                              cell size = %ld bytes, cell size(aligned) = %ld bytes\n",
+                          "                              cell size = %ld bytes, cell size(aligned) = %ld bytes\n"
+                          "    CSP_OFFLOAD_NODE_NCELLS = %d%s\n"
+                          "    CSP_OFFLOAD_REQ_POOL_SIZE = %d%s\n"
+                          "    CSP_OFFLOAD_EAGER_MSGSZ = %ld bytes%s\n"
+                          "    CSP_OFFLOAD_PIPELINE_CHUNKSZ = %ld bytes%s\n",
                           CSP_ENV.offload_min_msgsz, CSP_ENV.offload_shmq_ncells,
                           CSP_OFFLOAD_SHMQ_MEMSZ(CSP_ENV.offload_shmq_ncells) / 1024,
                           sizeof(CSP_offload_cell_t), CSP_ALIGN(sizeof(CSP_offload_cell_t),
-                                                                CSP_OFFLOAD_CACHE_LINE_LEN));
+                                                                CSP_OFFLOAD_CACHE_LINE_LEN),
+                          CSP_ENV.offload_node_ncells,
+                          CSP_ENV.offload_node_ncells > 0 ? "" : " (disabled)",
+                          CSP_ENV.offload_req_pool_size,
+                          CSP_ENV.offload_req_pool_size > 0 ? "" : " (disabled)",
+                          CSP_ENV.offload_eager_msgsz,
+                          CSP_ENV.offload_eager_msgsz > 0 ? "" : " (disabled)",
+                          CSP_ENV.offload_pipeline_chunksz,
+                          CSP_ENV.offload_pipeline_chunksz > 0 ? "" : " (disabled)");
+        }
+
+        if (CSP_ENV.async_modes & CSP_ASYNC_MODE_RMA) {
+            CSP_msg_print(CSP_MSG_CONFIG_GLOBAL, "RMA Options:\n"
+                          "    CSP_DYNAMIC_POOL_SIZE   = %ld bytes%s\n"
+                          "    CSP_WIN_CREATE_REMAP    = %s\n",
+                          CSP_ENV.dyn_pool_size, CSP_ENV.dyn_pool_size > 0 ? "" : " (disabled)",
+                          CSP_ENV.win_create_remap ? "on" : "off");
         }
 
 #if defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
         CSP_msg_print(CSP_MSG_CONFIG_GLOBAL, "Runtime Load Balancing Options:\n"
                       "    CSP_RUMTIME_LOAD_OPT = %s \n"
-                      "    CSP_RUNTIME_LOAD_LOCK = %s \n",
+                      "    CSP_RUNTIME_LOAD_LOCK = %s \n"
+                      "    CSP_RUNTIME_LOAD_ACC_STRIPE = %ld bytes%s\n",
                       (CSP_ENV.load_opt == CSP_LOAD_OPT_RANDOM) ? "random" :
-                      ((CSP_ENV.load_opt == CSP_LOAD_OPT_COUNTING) ? "op" : "byte"),
-                      (CSP_ENV.load_lock == CSP_LOAD_LOCK_NATURE) ? "nature" : "force");
+                      ((CSP_ENV.load_opt == CSP_LOAD_OPT_COUNTING) ? "op" :
+                       ((CSP_ENV.load_opt == CSP_LOAD_BYTE_COUNTING) ? "byte" : "feedback")),
+                      (CSP_ENV.load_lock == CSP_LOAD_LOCK_NATURE) ? "nature" : "force",
+                      CSP_ENV.load_acc_stripe, CSP_ENV.load_acc_stripe > 0 ? "" : " (disabled)");
 #endif
         CSP_msg_print(CSP_MSG_CONFIG_GLOBAL, "\n");
     }
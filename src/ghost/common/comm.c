@@ -121,15 +121,16 @@ static int ugcomm_create_impl(CSP_cwp_fnc_ugcomm_create_pkt_t * ugcomm_create_pk
     goto fn_exit;
 }
 
-static int ugcomm_free_impl(CSP_cwp_fnc_ugcomm_free_pkt_t * ugcomm_free_pkt)
+static int ugcomm_free_impl(CSP_cwp_pkt_t * pkt)
 {
     int mpi_errno = MPI_SUCCESS;
+    CSP_cwp_fnc_ugcomm_free_pkt_t *ugcomm_free_pkt = &pkt->u.fnc_ugcomm_free;
     MPI_Aint cspg_comm_handle = 0;
     CSPG_comm_t *cspg_comm = NULL;
 
-    /* Receive the handle of my ug_comm from user root */
-    CSP_CALLMPI(NOSTMT, PMPI_Recv(&cspg_comm_handle, 1, MPI_AINT, ugcomm_free_pkt->user_local_root,
-                                  CSP_CWP_PARAM_TAG, CSP_PROC.local_comm, MPI_STATUS_IGNORE));
+    /* Get the handle of my ug_comm issued by user root */
+    mpi_errno = CSPG_cwp_get_g_param(pkt, &cspg_comm_handle, ugcomm_free_pkt->user_local_root);
+    CSP_CHKMPIFAIL_RETURN(mpi_errno);
 
     cspg_comm = (CSPG_comm_t *) cspg_comm_handle;
     CSPG_DBG_PRINT("COMM: free cspg_comm %p\n", cspg_comm);
@@ -142,16 +143,8 @@ int CSPG_ugcomm_free_cwp_root_handler(CSP_cwp_pkt_t * pkt,
                                       int user_local_rank CSP_ATTRIBUTE((unused)))
 {
     int mpi_errno = MPI_SUCCESS;
-    MPI_Request ibcast_req = MPI_REQUEST_NULL;
-    CSP_cwp_fnc_ugcomm_free_pkt_t *ugcomm_free_pkt = &pkt->u.fnc_ugcomm_free;
-
-    /* broadcast to other local ghosts */
-    mpi_errno = CSPG_cwp_try_bcast(pkt, &ibcast_req);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-    CSP_CALLMPI(JUMP, PMPI_Wait(&ibcast_req, MPI_STATUS_IGNORE));
 
-    mpi_errno = ugcomm_free_impl(ugcomm_free_pkt);
+    mpi_errno = ugcomm_free_impl(pkt);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
   fn_exit:
@@ -167,9 +160,8 @@ int CSPG_ugcomm_free_cwp_root_handler(CSP_cwp_pkt_t * pkt,
 int CSPG_ugcomm_free_cwp_handler(CSP_cwp_pkt_t * pkt)
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_cwp_fnc_ugcomm_free_pkt_t *ugcomm_free_pkt = &pkt->u.fnc_ugcomm_free;
 
-    mpi_errno = ugcomm_free_impl(ugcomm_free_pkt);
+    mpi_errno = ugcomm_free_impl(pkt);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
   fn_exit:
@@ -184,15 +176,8 @@ int CSPG_ugcomm_create_cwp_root_handler(CSP_cwp_pkt_t * pkt,
                                         int user_local_rank CSP_ATTRIBUTE((unused)))
 {
     int mpi_errno = MPI_SUCCESS;
-    MPI_Request ibcast_req = MPI_REQUEST_NULL;
     CSP_cwp_fnc_ugcomm_create_pkt_t *ugcomm_create_pkt = &pkt->u.fnc_ugcomm_create;
 
-    /* broadcast to other local ghosts */
-    mpi_errno = CSPG_cwp_try_bcast(pkt, &ibcast_req);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-    CSP_CALLMPI(JUMP, PMPI_Wait(&ibcast_req, MPI_STATUS_IGNORE));
-
     mpi_errno = ugcomm_create_impl(ugcomm_create_pkt);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
@@ -7,6 +7,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sched.h>
 #include "cspg.h"
 
 /* Command wire protocol (CWP) component on ghost processes */
@@ -25,66 +27,111 @@ static const char *cwp_cmd_name[CSP_CWP_MAX] = {
     "ugcomm_free",
     "shmbuf_regist",
     "shmbuf_free",
-    "finalize",
-    "lock_acquire",
-    "lock_discard",
-    "lock_release",
-    "lock_status_sync"
+    "datatype_regist",
+    "datatype_free",
+    "finalize"
 };
 #else
 #define CSPG_CWP_DBG_PRINT(str,...) do { } while (0)
 #endif
 
 /* Command handlers on root ghosts.
- * The handler is called when received a command from the user process.*/
+ * The handler is called when the root ghost read a command from the ring. If no
+ * root handler is registered for a command, the common handler is called. */
 static CSPG_cwp_root_handler_t cwp_root_handlers[CSP_CWP_MAX] = { NULL };
 
-/* Command handlers on other ghosts.
- * The handler is called when received a command broadcasted from the root ghost. */
+/* Command handlers on all ghosts.
+ * The handler is called when any ghost read a command from the ring. Commands
+ * with only a root handler are skipped on other ghosts. */
 static CSPG_cwp_handler_t cwp_handlers[CSP_CWP_MAX] = { NULL };
 
+/* Shared command ring (see CSP_cwp_ring_t). Every ghost reads all commands in
+ * the ring by its local cursor. */
+static struct {
+    MPI_Win shm_win;
+    CSP_cwp_ring_t *ring;
+    unsigned int cursor;
+    int local_gp_rank;          /* My rank in CSP_PROC.ghost.g_local_comm. */
+} cwp_ring = { MPI_WIN_NULL, NULL, 0, -1 };
+
 /* Internal flag to notify the ghost process to exit from CWP progress engine.
  * The finalize handler calls `CSPG_cwp_terminate` to set it to 1 after all local
  * users have sent finalize command. The progress engine checks this flag to exit
  * from loop.*/
 static int cwp_terminate_flag = 0;
 
-static inline int cwp_root_pkt_handle(CSP_cwp_pkt_t * pkt_ptr, int src_rank)
+/* Idle backoff of the progress engine (enabled by CSP_GHOST_IDLE_SLEEP).
+ * An idle ghost keeps spinning for CWP_IDLE_SPIN_ITERS iterations, then yields
+ * the core for CWP_IDLE_YIELD_ITERS iterations, and then sleeps between
+ * iterations with exponentially increasing time up to CSP_GHOST_IDLE_SLEEP
+ * microseconds. Any received command or offloaded call resets it to spin.
+ * Note that RMA operations are progressed by MPI in every iteration, thus
+ * their latency may increase by up to one sleep time on an idle ghost. */
+#define CWP_IDLE_SPIN_ITERS 1024
+#define CWP_IDLE_YIELD_ITERS 1024
+#define CWP_IDLE_SLEEP_MIN 1    /* us */
+
+static struct {
+    int niters;                 /* number of idle iterations */
+    int sleep_us;               /* next sleep time */
+    int last_offload_nissued;
+} cwp_idle;
+
+static inline void cwp_idle_reset(void)
 {
-    int mpi_errno = MPI_SUCCESS;
-    /* skip undefined command */
-    if (pkt_ptr->cmd_type <= CSP_CWP_UNSET || pkt_ptr->cmd_type >= CSP_CWP_MAX ||
-        !cwp_root_handlers[pkt_ptr->cmd_type]) {
-        CSPG_CWP_DBG_PRINT(" Received undefined CMD %d\n", (int) (pkt_ptr->cmd_type));
-        goto fn_exit;
+    cwp_idle.niters = 0;
+    cwp_idle.sleep_us = CWP_IDLE_SLEEP_MIN;
+}
+
+static inline void cwp_idle_backoff(int active)
+{
+    struct timespec ts;
+
+    if (CSP_ENV.ghost_idle_sleep == 0)
+        return;
+
+    if (active) {
+        cwp_idle_reset();
+        return;
     }
 
-    CSPG_CWP_DBG_PRINT(" ghost 0 received CMD %d [%s] from %d\n",
-                       (int) (pkt_ptr->cmd_type), cwp_cmd_name[pkt_ptr->cmd_type], src_rank);
-    mpi_errno = cwp_root_handlers[pkt_ptr->cmd_type] (pkt_ptr, src_rank);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    cwp_idle.niters++;
+    if (cwp_idle.niters <= CWP_IDLE_SPIN_ITERS)
+        return;
 
-  fn_exit:
-    return mpi_errno;
-  fn_fail:
-    goto fn_exit;
+    if (cwp_idle.niters <= CWP_IDLE_SPIN_ITERS + CWP_IDLE_YIELD_ITERS) {
+        sched_yield();
+        return;
+    }
+
+    ts.tv_sec = cwp_idle.sleep_us / 1000000;
+    ts.tv_nsec = (cwp_idle.sleep_us % 1000000) * 1000;
+    nanosleep(&ts, NULL);
+    cwp_idle.sleep_us = CSP_MIN(cwp_idle.sleep_us * 2, CSP_ENV.ghost_idle_sleep);
 }
 
-static inline int cwp_pkt_handle(CSP_cwp_pkt_t * pkt_ptr)
+static inline int cwp_pkt_handle(CSP_cwp_pkt_t * pkt_ptr, int user_local_rank)
 {
     int mpi_errno = MPI_SUCCESS;
 
-    /* skip undefined internal command */
-    if (pkt_ptr->cmd_type <= CSP_CWP_UNSET || pkt_ptr->cmd_type >= CSP_CWP_MAX ||
-        !cwp_handlers[pkt_ptr->cmd_type]) {
+    /* skip undefined command */
+    if (pkt_ptr->cmd_type <= CSP_CWP_UNSET || pkt_ptr->cmd_type >= CSP_CWP_MAX) {
         CSPG_CWP_DBG_PRINT(" Received undefined CMD %d\n", (int) (pkt_ptr->cmd_type));
         goto fn_exit;
     }
 
-    CSPG_CWP_DBG_PRINT(" all ghosts received CMD %d [%s]\n", (int) pkt_ptr->cmd_type,
-                       cwp_cmd_name[pkt_ptr->cmd_type]);
-    mpi_errno = cwp_handlers[pkt_ptr->cmd_type] (pkt_ptr);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    CSPG_CWP_DBG_PRINT(" ghost %d received CMD %d [%s] from %d\n", cwp_ring.local_gp_rank,
+                       (int) (pkt_ptr->cmd_type), cwp_cmd_name[pkt_ptr->cmd_type],
+                       user_local_rank);
+
+    if (cwp_ring.local_gp_rank == 0 && cwp_root_handlers[pkt_ptr->cmd_type]) {
+        mpi_errno = cwp_root_handlers[pkt_ptr->cmd_type] (pkt_ptr, user_local_rank);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+    else if (cwp_handlers[pkt_ptr->cmd_type]) {
+        mpi_errno = cwp_handlers[pkt_ptr->cmd_type] (pkt_ptr);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
 
   fn_exit:
     return mpi_errno;
@@ -103,7 +150,7 @@ void CSPG_cwp_register_root_handler(CSP_cwp_t cmd_type, CSPG_cwp_root_handler_t
     }
 }
 
-/* Register handler functions for root broadcasted commands. */
+/* Register handler functions for commands handled on all ghosts. */
 void CSPG_cwp_register_handler(CSP_cwp_t cmd_type, CSPG_cwp_handler_t handler_fnc)
 {
     if (cmd_type <= CSP_CWP_UNSET || cmd_type >= CSP_CWP_MAX) {
@@ -114,59 +161,36 @@ void CSPG_cwp_register_handler(CSP_cwp_t cmd_type, CSPG_cwp_handler_t handler_fn
     }
 }
 
-/* Receive command from any local user process (blocking call),
+/* Read commands issued by any local user process from the shared ring,
  * and process it in the corresponding command handler.
  * Only return when finalize command is done on all ghost processes. */
 int CSPG_cwp_do_progress(void)
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_cwp_pkt_t pkt;
-    MPI_Request irecv_req, ibcast_req;
-    MPI_Status irecv_stat;
-    int first_flag = 1, irecv_flag = 0, ibcast_flag = 0;
-    int local_gp_rank = -1;
 
-    CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.ghost.g_local_comm, &local_gp_rank));
+    cwp_idle_reset();
 
     while (1) {
+        int active = 0;
+        CSP_cwp_pkt_t pkt;
+        int user_local_rank = -1;
+
         /* Polls offload channel */
         if (CSP_IS_MODE_ENABLED(PT2PT)) {
             mpi_errno = CSPG_offload_poll_progress();
             CSP_CHKMPIFAIL_JUMP(mpi_errno);
-        }
 
-        /* Only the first local ghost (root) receives commands from any local user process.
-         * Otherwise deadlock may happen if multiple user roots send request to
-         * ghosts concurrently and some ghosts are locked in different communicator creation. */
-        if (local_gp_rank == 0) {
-            if (first_flag || irecv_flag == 1) {
-                mpi_errno = CSPG_cwp_root_try_recv(&pkt, &irecv_req);
-                CSP_CHKMPIFAIL_JUMP(mpi_errno);
-            }
-
-            CSP_CALLMPI(JUMP, PMPI_Test(&irecv_req, &irecv_flag, &irecv_stat));
-
-            /* Received command */
-            if (irecv_flag == 1) {
-                mpi_errno = cwp_root_pkt_handle(&pkt, irecv_stat.MPI_SOURCE);
-                CSP_CHKMPIFAIL_JUMP(mpi_errno);
-            }
+            active = !CSPG_offload_check_idle(&cwp_idle.last_offload_nissued);
         }
-        else {
-            /* All other ghosts wait on internal commands broadcasted by the root,
-             * which is issued in root's command handler. */
-            if (first_flag || ibcast_flag == 1) {
-                mpi_errno = CSPG_cwp_try_bcast(&pkt, &ibcast_req);
-                CSP_CHKMPIFAIL_JUMP(mpi_errno);
-            }
-
-            CSP_CALLMPI(JUMP, PMPI_Test(&ibcast_req, &ibcast_flag, MPI_STATUS_IGNORE));
-
-            /* Received command */
-            if (ibcast_flag == 1) {
-                mpi_errno = cwp_pkt_handle(&pkt);
-                CSP_CHKMPIFAIL_JUMP(mpi_errno);
-            }
+
+        /* All ghosts read commands in the same order from the shared ring. Thus
+         * no deadlock happens even if multiple user roots issue commands concurrently
+         * and the ghosts are locked in different communicator creation. */
+        if (CSP_cwp_ring_dequeue(cwp_ring.ring, &cwp_ring.cursor, CSP_ENV.num_g,
+                                 cwp_ring.local_gp_rank, &pkt, &user_local_rank)) {
+            mpi_errno = cwp_pkt_handle(&pkt, user_local_rank);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+            active = 1;
         }
 
         /* Terminate after received notification from finalize handler. */
@@ -175,8 +199,63 @@ int CSPG_cwp_do_progress(void)
             goto fn_exit;
         }
 
-        first_flag = 0;
+        cwp_idle_backoff(active);
+    }
+
+  fn_exit:
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Allocate the shared command ring on the first local ghost, and initialize it
+ * before any local user can issue command. Collective call with local users
+ * (see CSPU_cwp_init). */
+int CSPG_cwp_init(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    void *baseptr = NULL;
+    int r_disp_unit;
+    MPI_Aint r_size;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.ghost.g_local_comm, &cwp_ring.local_gp_rank));
+
+    /* The first local ghost is always rank 0 on local communicator. */
+    r_size = (cwp_ring.local_gp_rank == 0) ? sizeof(CSP_cwp_ring_t) : 0;
+    CSP_CALLMPI(JUMP, PMPI_Win_allocate_shared(r_size, sizeof(char), MPI_INFO_NULL,
+                                               CSP_PROC.local_comm, &baseptr,
+                                               &cwp_ring.shm_win));
+    CSP_CALLMPI(JUMP, PMPI_Win_shared_query(cwp_ring.shm_win, 0, &r_size, &r_disp_unit,
+                                            &baseptr));
+    cwp_ring.ring = (CSP_cwp_ring_t *) baseptr;
+    cwp_ring.cursor = 0;
+
+    if (cwp_ring.local_gp_rank == 0)
+        CSP_cwp_ring_init(cwp_ring.ring);
+
+    /* Ensure no one issues command before initialized the ring. */
+    CSP_CALLMPI(JUMP, PMPI_Barrier(CSP_PROC.local_comm));
+
+    CSPG_CWP_DBG_PRINT(" allocated command ring %p, %d slots\n", cwp_ring.ring,
+                       CSP_CWP_RING_NSLOTS);
+
+  fn_exit:
+    return mpi_errno;
+  fn_fail:
+    /* Free global objects in main function. */
+    goto fn_exit;
+}
+
+/* Free the shared command ring. Collective call with local users. */
+int CSPG_cwp_destroy(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+
+    if (cwp_ring.shm_win != MPI_WIN_NULL) {
+        CSP_CALLMPI(JUMP, PMPI_Win_free(&cwp_ring.shm_win));
+        cwp_ring.shm_win = MPI_WIN_NULL;
     }
+    cwp_ring.ring = NULL;
 
   fn_exit:
     return mpi_errno;
@@ -22,6 +22,7 @@ typedef struct CSPG_datatype_db {
 } CSPG_datatype_db_t;
 
 CSPG_datatype_db_t datatype_db;
+static MPI_Datatype local_predefined_table[CSP_DATATYPE_MAX];
 
 static void datatype_regist_ddts_init(void)
 {
@@ -30,6 +31,43 @@ static void datatype_regist_ddts_init(void)
     datatype_db.regist_ddt_list.count = 0;
 }
 
+static void datatype_regist_ddts_append(MPI_Datatype handle)
+{
+    datatype_ddt_elem_t *elem = CSP_calloc(1, sizeof(datatype_ddt_elem_t));
+
+    elem->handle = handle;
+    if (datatype_db.regist_ddt_list.tail)
+        datatype_db.regist_ddt_list.tail->next = elem;
+    else
+        datatype_db.regist_ddt_list.head = elem;
+    datatype_db.regist_ddt_list.tail = elem;
+    datatype_db.regist_ddt_list.count++;
+}
+
+/* Remove a registered derived datatype from the list, return 0 if not found. */
+static int datatype_regist_ddts_remove(MPI_Datatype handle)
+{
+    datatype_ddt_elem_t *elem = datatype_db.regist_ddt_list.head, *prev_elem = NULL;
+
+    while (elem != NULL && elem->handle != handle) {
+        prev_elem = elem;
+        elem = elem->next;
+    }
+    if (elem == NULL)
+        return 0;
+
+    if (prev_elem)
+        prev_elem->next = elem->next;
+    else
+        datatype_db.regist_ddt_list.head = elem->next;
+    if (datatype_db.regist_ddt_list.tail == elem)
+        datatype_db.regist_ddt_list.tail = prev_elem;
+    datatype_db.regist_ddt_list.count--;
+    free(elem);
+
+    return 1;
+}
+
 static int datatype_regist_ddts_destroy(void)
 {
     int mpi_errno = MPI_SUCCESS;
@@ -63,6 +101,228 @@ static int datatype_regist_ddts_destroy(void)
     goto fn_exit;
 }
 
+/* Rebuild a datatype serialized by user (see csp_datatype.h). The returned
+ * derived datatype is not committed. */
+static int datatype_deserialize(const MPI_Aint * elems, int nelems, int *pos,
+                                MPI_Datatype * datatype, int *is_named)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int combiner = 0, nints = 0, naddrs = 0, ndtypes = 0, i, n;
+    int *ints = NULL, *dtypes_named = NULL;
+    const MPI_Aint *addrs = NULL;
+    MPI_Datatype *dtypes = NULL;
+
+    (*datatype) = MPI_DATATYPE_NULL;
+    (*is_named) = 0;
+
+    if ((*pos) >= nelems)
+        goto fn_fail;
+
+    /* Predefined datatype. */
+    if (elems[*pos] != CSP_DATATYPE_SERIAL_DERIVED) {
+        if (elems[*pos] < 0 || elems[*pos] >= CSP_DATATYPE_MAX)
+            goto fn_fail;
+        (*datatype) = local_predefined_table[elems[(*pos)++]];
+        (*is_named) = 1;
+        goto fn_exit;
+    }
+
+    if ((*pos) + CSP_DATATYPE_SERIAL_HDR_LEN > nelems)
+        goto fn_fail;
+    combiner = (int) elems[(*pos) + 1];
+    nints = (int) elems[(*pos) + 2];
+    naddrs = (int) elems[(*pos) + 3];
+    ndtypes = (int) elems[(*pos) + 4];
+    (*pos) += CSP_DATATYPE_SERIAL_HDR_LEN;
+
+    if ((*pos) + nints + naddrs > nelems)
+        goto fn_fail;
+    ints = CSP_calloc(nints + 1, sizeof(int));
+    for (i = 0; i < nints; i++)
+        ints[i] = (int) elems[(*pos)++];
+    addrs = &elems[*pos];
+    (*pos) += naddrs;
+
+    dtypes = CSP_calloc(ndtypes + 1, sizeof(MPI_Datatype));
+    dtypes_named = CSP_calloc(ndtypes + 1, sizeof(int));
+    for (i = 0; i < ndtypes; i++) {
+        dtypes_named[i] = 1;
+        mpi_errno = datatype_deserialize(elems, nelems, pos, &dtypes[i], &dtypes_named[i]);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
+    switch (combiner) {
+    case MPI_COMBINER_DUP:
+        CSP_CALLMPI(JUMP, PMPI_Type_dup(dtypes[0], datatype));
+        break;
+    case MPI_COMBINER_CONTIGUOUS:
+        CSP_CALLMPI(JUMP, PMPI_Type_contiguous(ints[0], dtypes[0], datatype));
+        break;
+    case MPI_COMBINER_VECTOR:
+        CSP_CALLMPI(JUMP, PMPI_Type_vector(ints[0], ints[1], ints[2], dtypes[0], datatype));
+        break;
+    case MPI_COMBINER_HVECTOR:
+        CSP_CALLMPI(JUMP, PMPI_Type_create_hvector(ints[0], ints[1], addrs[0], dtypes[0],
+                                                   datatype));
+        break;
+    case MPI_COMBINER_INDEXED:
+        n = ints[0];
+        CSP_CALLMPI(JUMP, PMPI_Type_indexed(n, &ints[1], &ints[n + 1], dtypes[0], datatype));
+        break;
+    case MPI_COMBINER_HINDEXED:
+        CSP_CALLMPI(JUMP, PMPI_Type_create_hindexed(ints[0], &ints[1], (MPI_Aint *) addrs,
+                                                    dtypes[0], datatype));
+        break;
+    case MPI_COMBINER_INDEXED_BLOCK:
+        CSP_CALLMPI(JUMP, PMPI_Type_create_indexed_block(ints[0], ints[1], &ints[2],
+                                                         dtypes[0], datatype));
+        break;
+    case MPI_COMBINER_HINDEXED_BLOCK:
+        CSP_CALLMPI(JUMP, PMPI_Type_create_hindexed_block(ints[0], ints[1], (MPI_Aint *) addrs,
+                                                          dtypes[0], datatype));
+        break;
+    case MPI_COMBINER_STRUCT:
+        CSP_CALLMPI(JUMP, PMPI_Type_create_struct(ints[0], &ints[1], (MPI_Aint *) addrs,
+                                                  dtypes, datatype));
+        break;
+    case MPI_COMBINER_SUBARRAY:
+        n = ints[0];
+        CSP_CALLMPI(JUMP, PMPI_Type_create_subarray(n, &ints[1], &ints[n + 1], &ints[2 * n + 1],
+                                                    ints[3 * n + 1], dtypes[0], datatype));
+        break;
+    case MPI_COMBINER_DARRAY:
+        n = ints[2];
+        CSP_CALLMPI(JUMP, PMPI_Type_create_darray(ints[0], ints[1], n, &ints[3], &ints[n + 3],
+                                                  &ints[2 * n + 3], &ints[3 * n + 3],
+                                                  ints[4 * n + 3], dtypes[0], datatype));
+        break;
+    case MPI_COMBINER_RESIZED:
+        CSP_CALLMPI(JUMP, PMPI_Type_create_resized(dtypes[0], addrs[0], addrs[1], datatype));
+        break;
+    default:
+        goto fn_fail;
+    }
+
+  fn_exit:
+    /* Inner derived datatypes are referred by the new datatype. */
+    for (i = 0; dtypes && i < ndtypes; i++) {
+        if (!dtypes_named[i] && dtypes[i] != MPI_DATATYPE_NULL)
+            CSP_CALLMPI_EXIT(PMPI_Type_free(&dtypes[i]));
+    }
+    if (ints)
+        free(ints);
+    if (dtypes)
+        free(dtypes);
+    if (dtypes_named)
+        free(dtypes_named);
+    return mpi_errno;
+
+  fn_fail:
+    CSPG_DBG_PRINT("DATATYPE: failed to deserialize at %d/%d, combiner %d\n",
+                   (*pos), nelems, combiner);
+    if (mpi_errno == MPI_SUCCESS)
+        mpi_errno = CSP_get_error_code(CSP_ERR_INTERN);
+    goto fn_exit;
+}
+
+static int datatype_regist_impl(CSP_cwp_datatype_regist_pkt_t * regist_pkt)
+{
+    int mpi_errno = MPI_SUCCESS;
+    MPI_Aint *elems = NULL;
+    MPI_Datatype g_handle = MPI_DATATYPE_NULL;
+    int pos = 0, is_named = 0;
+
+    /* Receive the serialized datatype from user. */
+    elems = CSP_calloc(regist_pkt->nelems, sizeof(MPI_Aint));
+    CSP_CALLMPI(JUMP, PMPI_Recv(elems, regist_pkt->nelems, MPI_AINT, regist_pkt->user_local_rank,
+                                CSP_CWP_PARAM_TAG, CSP_PROC.local_comm, MPI_STATUS_IGNORE));
+
+    /* Do not return before replying, otherwise user hangs. User reports error
+     * if received DATATYPE_NULL. */
+    mpi_errno = datatype_deserialize(elems, regist_pkt->nelems, &pos, &g_handle, &is_named);
+    if (mpi_errno == MPI_SUCCESS && !is_named) {
+        mpi_errno = PMPI_Type_commit(&g_handle);
+        if (mpi_errno == MPI_SUCCESS)
+            datatype_regist_ddts_append(g_handle);
+    }
+    if (mpi_errno != MPI_SUCCESS || is_named) {
+        if (g_handle != MPI_DATATYPE_NULL && !is_named)
+            CSP_CALLMPI_EXIT(PMPI_Type_free(&g_handle));
+        g_handle = MPI_DATATYPE_NULL;
+    }
+
+    CSP_CALLMPI(JUMP, PMPI_Send(&g_handle, sizeof(MPI_Datatype), MPI_CHAR,
+                                regist_pkt->user_local_rank, CSP_CWP_PARAM_TAG,
+                                CSP_PROC.local_comm));
+
+    CSPG_DBG_PRINT("DATATYPE: regist ddt 0x%x for user %d, nelems %d, count=%d\n",
+                   g_handle, regist_pkt->user_local_rank, regist_pkt->nelems,
+                   datatype_db.regist_ddt_list.count);
+
+  fn_exit:
+    if (elems)
+        free(elems);
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
+static int datatype_free_impl(CSP_cwp_datatype_free_pkt_t * free_pkt)
+{
+    int mpi_errno = MPI_SUCCESS;
+    MPI_Datatype g_handle = free_pkt->g_handle;
+
+    /* Ignore unknown handle, it might be already freed. */
+    if (datatype_regist_ddts_remove(g_handle)) {
+        CSPG_DBG_PRINT("DATATYPE: free regist ddt 0x%x, count=%d\n", g_handle,
+                       datatype_db.regist_ddt_list.count);
+        CSP_CALLMPI(RETURN, PMPI_Type_free(&g_handle));
+    }
+    return mpi_errno;
+}
+
+/* The datatype is committed only on the specified ghost. Every ghost reads
+ * the command, only the target ghost handles it. */
+int CSPG_datatype_regist_cwp_handler(CSP_cwp_pkt_t * pkt)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int local_rank = 0;
+    CSP_cwp_datatype_regist_pkt_t *regist_pkt = &pkt->u.fnc_datatype_regist;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &local_rank));
+    if (regist_pkt->g_lrank == local_rank) {
+        mpi_errno = datatype_regist_impl(regist_pkt);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    /* Error is handled in CSPG_main. */
+    goto fn_exit;
+}
+
+int CSPG_datatype_free_cwp_handler(CSP_cwp_pkt_t * pkt)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int local_rank = 0;
+    CSP_cwp_datatype_free_pkt_t *free_pkt = &pkt->u.fnc_datatype_free;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &local_rank));
+    if (free_pkt->g_lrank == local_rank) {
+        mpi_errno = datatype_free_impl(free_pkt);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    /* Error is handled in CSPG_main. */
+    goto fn_exit;
+}
+
 int CSPG_datatype_destory(void)
 {
     /* Terminate ensures all local users have been finalizing. */
@@ -76,7 +336,7 @@ int CSPG_datatype_init(void)
     int mpi_errno = MPI_SUCCESS;
     MPI_Request *reqs = NULL;
     int i, local_rank = 0;
-    MPI_Datatype local_predefined_table[CSP_DATATYPE_MAX], temp_buf[CSP_DATATYPE_MAX];
+    MPI_Datatype temp_buf[CSP_DATATYPE_MAX];
 
     CSP_datatype_fill_predefined_table(local_predefined_table);
     memset(&datatype_db, 0, sizeof(CSPG_datatype_db_t));
@@ -14,13 +14,14 @@ CSPG_offload_server_t CSPG_offload_server;
 #define OFFLOAD_LRANK_TO_CH_IDX(local_rank) (local_rank - CSP_ENV.num_g)
 #define OFFLOAD_CH_IDX_TO_LRANK(idx) (idx + CSP_ENV.num_g)
 
-/* Statically bind local user processes.
+/* Statically bind local user processes. Users are evenly partitioned into
+ * contiguous ranges, the first (num_user % num_g) ghosts take one more user.
  * See CSPU_offload_bind_ghost on user side.*/
 static inline int offload_bind_users(int *user_local_rank_sta, int *user_local_rank_end)
 {
     int mpi_errno = MPI_SUCCESS;
     int local_rank, local_size;
-    int np_per_ghost = 0;
+    int np_per_ghost = 0, np_rest = 0;
     int num_user = 0;
 
     CSP_CALLMPI(RETURN, PMPI_Comm_rank(CSP_PROC.local_comm, &local_rank));
@@ -41,13 +42,11 @@ static inline int offload_bind_users(int *user_local_rank_sta, int *user_local_r
     }
     else {
         np_per_ghost = num_user / CSP_ENV.num_g;
-        (*user_local_rank_sta) = CSP_ENV.num_g + np_per_ghost * local_rank;
-        if (local_rank == CSP_ENV.num_g - 1) {
-            (*user_local_rank_end) = local_size - 1;
-        }
-        else {
-            (*user_local_rank_end) = (*user_local_rank_sta) + np_per_ghost - 1;
-        }
+        np_rest = num_user % CSP_ENV.num_g;
+        (*user_local_rank_sta) = CSP_ENV.num_g + np_per_ghost * local_rank +
+            CSP_MIN(local_rank, np_rest);
+        (*user_local_rank_end) = (*user_local_rank_sta) + np_per_ghost - 1 +
+            (local_rank < np_rest ? 1 : 0);
     }
 
 
@@ -84,11 +83,79 @@ static inline void register_offload_handlers(void)
     CSPG_offload_server.cmpl_handlers[CSP_OFFLOAD_IRECV] = CSPG_irecv_cmpl_handler;
 }
 
-static inline void initialize_issued_list(void)
+static inline void offload_reset_stat(MPI_Status * stat)
+{
+    /* MPI may not update status if it is not a wildcard receive message,
+     * and updates ERROR only when multiple completion (e.g., Testsome) returns
+     * MPI_ERR_IN_STATUS. Thus every status is reset before passed to MPI. */
+    memset(stat, 0, sizeof(MPI_Status));
+    stat->MPI_ERROR = MPI_SUCCESS;
+}
+
+/* Double the capacity of local issued list. */
+int CSPG_offload_issued_list_grow(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i, capacity = CSPG_offload_server.issued_list.capacity;
+    CSP_offload_cell_t **cells = NULL;
+    MPI_Request *reqs = NULL;
+    int *indices = NULL;
+    MPI_Status *stats = NULL;
+
+    capacity = (capacity > 0) ? capacity * 2 : CSPG_OFFLOAD_ISSUED_LIST_INIT_CAPACITY;
+
+    cells = realloc(CSPG_offload_server.issued_list.cells, sizeof(CSP_offload_cell_t *) * capacity);
+    if (cells != NULL)
+        CSPG_offload_server.issued_list.cells = cells;
+    reqs = realloc(CSPG_offload_server.issued_list.reqs, sizeof(MPI_Request) * capacity);
+    if (reqs != NULL)
+        CSPG_offload_server.issued_list.reqs = reqs;
+    indices = realloc(CSPG_offload_server.issued_list.indices, sizeof(int) * capacity);
+    if (indices != NULL)
+        CSPG_offload_server.issued_list.indices = indices;
+    stats = realloc(CSPG_offload_server.issued_list.stats, sizeof(MPI_Status) * capacity);
+    if (stats != NULL)
+        CSPG_offload_server.issued_list.stats = stats;
+
+    /* Keep old capacity if any of them fails, the grown ones are freed at destroy. */
+    if (cells == NULL || reqs == NULL || indices == NULL || stats == NULL) {
+        mpi_errno = MPI_ERR_NO_MEM;
+        goto fn_fail;
+    }
+
+    for (i = CSPG_offload_server.issued_list.capacity; i < capacity; i++)
+        offload_reset_stat(&stats[i]);
+    CSPG_offload_server.issued_list.capacity = capacity;
+
+    CSPG_DBG_PRINT("OFFLOAD: grow issued list to %d\n", capacity);
+
+  fn_exit:
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
+static inline int initialize_issued_list(void)
 {
-    CSPG_offload_server.issued_list.head = NULL;
+    CSPG_offload_server.issued_list.cells = NULL;
+    CSPG_offload_server.issued_list.reqs = NULL;
+    CSPG_offload_server.issued_list.indices = NULL;
+    CSPG_offload_server.issued_list.stats = NULL;
+    CSPG_offload_server.issued_list.capacity = 0;
     CSPG_offload_server.issued_list.nissued = 0;
     CSPG_offload_server.issued_list.noutstanding = 0;
+    CSPG_offload_server.issued_list.max_noutstanding = 0;
+
+    return CSPG_offload_issued_list_grow();
+}
+
+static inline void destroy_issued_list(void)
+{
+    free(CSPG_offload_server.issued_list.cells);
+    free(CSPG_offload_server.issued_list.reqs);
+    free(CSPG_offload_server.issued_list.indices);
+    free(CSPG_offload_server.issued_list.stats);
+    memset(&CSPG_offload_server.issued_list, 0, sizeof(CSPG_offload_server.issued_list));
 }
 
 static inline int initialize_channels(void)
@@ -103,7 +170,7 @@ static inline int initialize_channels(void)
         CSP_calloc(local_size - CSP_ENV.num_g, sizeof(CSPG_offload_channel_t));
 
     /* Create shared memory region for pt2pt/collectives offload channel */
-    /* [shm_recvq + 64 cells] per user process */
+    /* [shm_recvq + cmplq + 64 cells] per user process */
     CSP_CALLMPI(JUMP, PMPI_Win_allocate_shared(0, sizeof(char), MPI_INFO_NULL,
                                                CSP_PROC.local_comm, &baseptr,
                                                &CSPG_offload_server.shm_win));
@@ -123,10 +190,14 @@ static inline int initialize_channels(void)
                                                 &CSPG_offload_server.channels[idx].shm_base));
         CSPG_offload_server.channels[idx].shm_recvq_ptr =
             (CSP_offload_shmqueue_t *) (CSPG_offload_server.channels[idx].shm_base);
-
-        CSPG_DBG_PRINT("OFFLOAD: channels[%d] local_rank=%d, shm_base=0x%lx, shm_recvq_ptr=%p\n",
-                       idx, dst, CSPG_offload_server.channels[idx].shm_base,
-                       CSPG_offload_server.channels[idx].shm_recvq_ptr);
+        CSPG_offload_server.channels[idx].shm_cmplq_ptr =
+            (CSP_offload_cmplq_t *) (CSPG_offload_server.channels[idx].shm_base +
+                                     CSP_OFFLOAD_SHMQ_ALIGN_SZ);
+
+        CSPG_DBG_PRINT("OFFLOAD: channels[%d] local_rank=%d, shm_base=0x%lx, shm_recvq_ptr=%p, "
+                       "shm_cmplq_ptr=%p\n", idx, dst, CSPG_offload_server.channels[idx].shm_base,
+                       CSPG_offload_server.channels[idx].shm_recvq_ptr,
+                       CSPG_offload_server.channels[idx].shm_cmplq_ptr);
     }
 
     /* Ensure no one access the queue before each user initializes. */
@@ -139,37 +210,64 @@ static inline int initialize_channels(void)
     goto fn_exit;
 }
 
-static inline void offload_reset_stat(MPI_Status * stat)
+static int offload_cmp_index_desc(const void *a, const void *b)
 {
-    /* MPI may not update status if it is not a wildcard receive message.
-     * We never call multiple completion (e.g., Testall) on ghost, so
-     * ERROR will never be updated in that case. */
-    memset(stat, 0, sizeof(MPI_Status));
-    stat->MPI_ERROR = MPI_SUCCESS;
+    return (*(const int *) b) - (*(const int *) a);
 }
 
+/* Test all issued requests by a single PMPI_Testsome, then compact the local
+ * issued list by moving the tail cells into the slots of completed ones. The
+ * cost of compaction is only proportional to the number of completed cells. */
 static inline int offload_poll_completion(void)
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_offload_cell_t *cell = NULL, *tmp = NULL;
+    int i, outcount = 0, nremove = 0;
+    int *indices = CSPG_offload_server.issued_list.indices;
+    MPI_Status *stats = CSPG_offload_server.issued_list.stats;
+
+    if (CSPG_offload_issued_list_empty())
+        goto fn_exit;
+
+    mpi_errno = PMPI_Testsome(CSPG_offload_server.issued_list.noutstanding,
+                              CSPG_offload_server.issued_list.reqs, &outcount, indices, stats);
+    /* Error of each request is returned in its status and then delivered
+     * to user by the completion handler. */
+    if (mpi_errno != MPI_SUCCESS && mpi_errno != MPI_ERR_IN_STATUS)
+        goto fn_fail;
+    mpi_errno = MPI_SUCCESS;
 
-    DL_FOREACH_SAFE2(CSPG_offload_server.issued_list.head, cell, tmp, CSP_OFFLOAD_ABS_PT_DECL(next)) {
-        int flag;
-        MPI_Status stat;
+    if (outcount == MPI_UNDEFINED || outcount == 0)
+        goto fn_exit;
+
+    for (i = 0; i < outcount; i++) {
+        CSP_offload_cell_t *cell = CSPG_offload_server.issued_list.cells[indices[i]];
         CSP_offload_pkt_t *pkt_ptr = &cell->pkt;
 
-        offload_reset_stat(&stat);
-        CSP_CALLMPI(JUMP, PMPI_Test(&pkt_ptr->g_req, &flag, &stat));
-        if (flag) {
-            /* Remove from local issued list. */
-            CSPG_offload_issued_list_remove(&cell);
-
-            /* Set completion on user.
-             * The cell will be recycled by user. */
-            CSP_DBG_ASSERT(cell->pkt.type < CSP_OFFLOAD_MAX &&
-                           CSPG_offload_server.cmpl_handlers[cell->pkt.type]);
-            CSPG_offload_server.cmpl_handlers[cell->pkt.type] (pkt_ptr, stat);
-        }
+        /* Testsome only freed the copy in local issued list. */
+        pkt_ptr->g_req = MPI_REQUEST_NULL;
+
+        /* Set completion on user.
+         * The cell will be recycled by user. */
+        CSP_DBG_ASSERT(cell->pkt.type < CSP_OFFLOAD_MAX &&
+                       CSPG_offload_server.cmpl_handlers[cell->pkt.type]);
+        if (CSPG_offload_server.cmpl_handlers[cell->pkt.type] (pkt_ptr, stats[i]))
+            CSPG_offload_server.issued_list.reqs[indices[i]] = pkt_ptr->g_req;
+        else
+            indices[nremove++] = indices[i];
+        offload_reset_stat(&stats[i]);
+    }
+
+    /* Remove from local issued list in descending order of indices, thus
+     * the tail cell moved into a hole is always an incomplete one. */
+    if (nremove > 1)
+        qsort(indices, nremove, sizeof(int), offload_cmp_index_desc);
+    for (i = 0; i < nremove; i++)
+        CSPG_offload_issued_list_remove(indices[i]);
+
+    /* Issue the receives deferred by completed pipelined receives. */
+    if (CSPG_offload_server.pipe_recvs.deferred != NULL) {
+        mpi_errno = CSPG_irecv_issue_deferred();
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
 
   fn_exit:
@@ -179,9 +277,10 @@ static inline int offload_poll_completion(void)
     goto fn_exit;
 }
 
-static inline int offload_poll_channel(CSPG_offload_channel_t * channel)
+static inline int offload_poll_channel(int idx)
 {
     int mpi_errno = MPI_SUCCESS;
+    CSPG_offload_channel_t *channel = &CSPG_offload_server.channels[idx];
     CSP_offload_shmqueue_t *recvq_ptr = channel->shm_recvq_ptr;
     MPI_Aint shm_base = channel->shm_base;
 
@@ -194,6 +293,7 @@ static inline int offload_poll_channel(CSPG_offload_channel_t * channel)
 
         CSP_offload_recvq_dequeue(shm_base, recvq_ptr, &cell);
         pkt_ptr = &cell->pkt;
+        pkt_ptr->g_ch_idx = idx;
 
         /* Handles packet */
         CSP_DBG_ASSERT(cell->pkt.type < CSP_OFFLOAD_MAX &&
@@ -202,9 +302,13 @@ static inline int offload_poll_channel(CSPG_offload_channel_t * channel)
         mpi_errno = CSPG_offload_server.pkt_handlers[cell->pkt.type] (pkt_ptr);
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
+        /* Deferred receive is appended once issued. */
+        if (pkt_ptr->g_req == MPI_REQUEST_NULL)
+            continue;
+
         /* Append into local polling list. */
-        CSPG_offload_issued_list_reset_cellpt(cell);
-        CSPG_offload_issued_list_append(cell);
+        mpi_errno = CSPG_offload_issued_list_append(cell);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
 
   fn_exit:
@@ -231,7 +335,7 @@ int CSPG_offload_poll_progress(void)
 
     /* Check each receive queue on bound user processes. */
     for (idx = idx_sta; idx <= idx_end; idx++) {
-        mpi_errno = offload_poll_channel(&CSPG_offload_server.channels[idx]);
+        mpi_errno = offload_poll_channel(idx);
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
 
@@ -244,9 +348,52 @@ int CSPG_offload_poll_progress(void)
     goto fn_exit;
 }
 
+/* Report the number of bound users, handled cells and the peak of
+ * outstanding cells on every local ghost, thus show the load balance
+ * among ghosts (collective on local ghosts). */
+static inline int offload_report_balance(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int g_lrank = 0, i;
+    int stat[3], *stats = NULL;
+
+    if (!(CSP_ENV.verbose & CSP_MSG_INFO))
+        return mpi_errno;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.ghost.g_local_comm, &g_lrank));
+    if (g_lrank == 0)
+        stats = CSP_calloc(CSP_ENV.num_g * 3, sizeof(int));
+
+    stat[0] = CSPG_offload_server.urange.lrank_end - CSPG_offload_server.urange.lrank_sta + 1;
+    if (OFFLOAD_LRANK_TO_CH_IDX(CSPG_offload_server.urange.lrank_sta) < 0)
+        stat[0] = 0;    /* do not bound to any user */
+    stat[1] = CSPG_offload_server.issued_list.nissued;
+    stat[2] = CSPG_offload_server.issued_list.max_noutstanding;
+
+    CSP_CALLMPI(JUMP, PMPI_Gather(stat, 3, MPI_INT, stats, 3, MPI_INT, 0,
+                                  CSP_PROC.ghost.g_local_comm));
+
+    for (i = 0; g_lrank == 0 && i < CSP_ENV.num_g; i++) {
+        CSP_msg_print(CSP_MSG_INFO, "OFFLOAD node %d ghost %d: %d users, handled %d cells, "
+                      "max outstanding %d\n", CSP_PROC.node_id, i, stats[i * 3],
+                      stats[i * 3 + 1], stats[i * 3 + 2]);
+    }
+
+  fn_exit:
+    if (stats)
+        free(stats);
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
 int CSPG_offload_destroy(void)
 {
     int mpi_errno = MPI_SUCCESS;
+
+    mpi_errno = offload_report_balance();
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     if (CSPG_offload_server.channels != NULL)
         free(CSPG_offload_server.channels);
     CSPG_offload_server.channels = NULL;
@@ -255,8 +402,11 @@ int CSPG_offload_destroy(void)
      * It is safe to free shared memory region now. */
 
     CSP_ASSERT(CSPG_offload_server.issued_list.noutstanding == 0);
+    CSP_ASSERT(CSPG_offload_server.pipe_recvs.active == NULL &&
+               CSPG_offload_server.pipe_recvs.deferred == NULL);
 
     CSPG_DBG_PRINT("OFFLOAD destroy: issued %d\n", CSPG_offload_server.issued_list.nissued);
+    destroy_issued_list();
     CSPG_DBG_PRINT("OFFLOAD destroy: free shm_win 0x%x\n", CSPG_offload_server.shm_win);
 
     CSP_CALLMPI(JUMP, PMPI_Win_free(&CSPG_offload_server.shm_win));
@@ -278,7 +428,8 @@ int CSPG_offload_init(void)
     mpi_errno = initialize_channels();
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    initialize_issued_list();
+    mpi_errno = initialize_issued_list();
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     mpi_errno = offload_bind_users(&CSPG_offload_server.urange.lrank_sta,
                                    &CSPG_offload_server.urange.lrank_end);
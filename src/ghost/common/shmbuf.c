@@ -8,8 +8,9 @@
 #include <stdlib.h>
 #include "cspg.h"
 
-static int shmbuf_regist_impl(CSP_cwp_shmbuf_regist_pkt_t * shmbuf_regist_pkt)
+static int shmbuf_regist_impl(CSP_cwp_pkt_t * pkt)
 {
+    CSP_cwp_shmbuf_regist_pkt_t *shmbuf_regist_pkt = &pkt->u.fnc_shmbuf_regist;
     int mpi_errno = MPI_SUCCESS;
     MPI_Aint ugcomm_handle = 0;
     MPI_Comm ug_comm = MPI_COMM_NULL;
@@ -24,8 +25,7 @@ static int shmbuf_regist_impl(CSP_cwp_shmbuf_regist_pkt_t * shmbuf_regist_pkt)
     CSPG_comm_t *cspg_comm = NULL;
 
     /* Receive my ug_comm handle */
-    mpi_errno = CSPG_cwp_recv_param(&ugcomm_handle, sizeof(MPI_Aint),
-                                    shmbuf_regist_pkt->user_local_root);
+    mpi_errno = CSPG_cwp_get_g_param(pkt, &ugcomm_handle, shmbuf_regist_pkt->user_local_root);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     cspg_comm = (CSPG_comm_t *) ugcomm_handle;
@@ -103,15 +103,16 @@ static int shmbuf_regist_impl(CSP_cwp_shmbuf_regist_pkt_t * shmbuf_regist_pkt)
     goto fn_exit;
 }
 
-static int shmbuf_free_impl(CSP_cwp_shmbuf_free_pkt_t * shmbuf_free_pkt)
+static int shmbuf_free_impl(CSP_cwp_pkt_t * pkt)
 {
+    CSP_cwp_shmbuf_free_pkt_t *shmbuf_free_pkt = &pkt->u.fnc_shmbuf_free;
     int mpi_errno = MPI_SUCCESS;
     MPI_Aint shmbufwin_handle = 0;
     MPI_Win shmbuf_win = MPI_WIN_NULL;
 
-    /* Receive the handle of my ug_comm from user root */
-    CSP_CALLMPI(NOSTMT, PMPI_Recv(&shmbufwin_handle, 1, MPI_AINT, shmbuf_free_pkt->user_local_root,
-                                  CSP_CWP_PARAM_TAG, CSP_PROC.local_comm, MPI_STATUS_IGNORE));
+    /* Get the handle of my shmbuf window from user root */
+    mpi_errno = CSPG_cwp_get_g_param(pkt, &shmbufwin_handle, shmbuf_free_pkt->user_local_root);
+    CSP_CHKMPIFAIL_RETURN(mpi_errno);
 
     shmbuf_win = (MPI_Win) shmbufwin_handle;
     CSPG_DBG_PRINT("SHMBUF: free shmbuf_win 0x%x\n", shmbuf_win);
@@ -120,61 +121,11 @@ static int shmbuf_free_impl(CSP_cwp_shmbuf_free_pkt_t * shmbuf_free_pkt)
     return mpi_errno;
 }
 
-int CSPG_shmbuf_free_cwp_root_handler(CSP_cwp_pkt_t * pkt,
-                                      int user_local_rank CSP_ATTRIBUTE((unused)))
-{
-    int mpi_errno = MPI_SUCCESS;
-    MPI_Request ibcast_req = MPI_REQUEST_NULL;
-    CSP_cwp_shmbuf_free_pkt_t *shmbuf_free_pkt = &pkt->u.fnc_shmbuf_free;
-
-    /* broadcast to other local ghosts */
-    mpi_errno = CSPG_cwp_try_bcast(pkt, &ibcast_req);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-    CSP_CALLMPI(JUMP, PMPI_Wait(&ibcast_req, MPI_STATUS_IGNORE));
-
-    mpi_errno = shmbuf_free_impl(shmbuf_free_pkt);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-  fn_exit:
-    return mpi_errno;
-
-  fn_fail:
-    /* Error is handled in CSPG_main. */
-    goto fn_exit;
-}
-
-
 int CSPG_shmbuf_free_cwp_handler(CSP_cwp_pkt_t * pkt)
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_cwp_shmbuf_free_pkt_t *shmbuf_free_pkt = &pkt->u.fnc_shmbuf_free;
 
-    mpi_errno = shmbuf_free_impl(shmbuf_free_pkt);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-  fn_exit:
-    return mpi_errno;
-
-  fn_fail:
-    /* Error is handled in CSPG_main. */
-    goto fn_exit;
-}
-
-int CSPG_shmbuf_regist_cwp_root_handler(CSP_cwp_pkt_t * pkt,
-                                        int user_local_rank CSP_ATTRIBUTE((unused)))
-{
-    int mpi_errno = MPI_SUCCESS;
-    MPI_Request ibcast_req = MPI_REQUEST_NULL;
-    CSP_cwp_shmbuf_regist_pkt_t *shmbuf_regist_pkt = &pkt->u.fnc_shmbuf_regist;
-
-    /* broadcast to other local ghosts */
-    mpi_errno = CSPG_cwp_try_bcast(pkt, &ibcast_req);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-    CSP_CALLMPI(JUMP, PMPI_Wait(&ibcast_req, MPI_STATUS_IGNORE));
-
-    mpi_errno = shmbuf_regist_impl(shmbuf_regist_pkt);
+    mpi_errno = shmbuf_free_impl(pkt);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
   fn_exit:
@@ -188,9 +139,8 @@ int CSPG_shmbuf_regist_cwp_root_handler(CSP_cwp_pkt_t * pkt,
 int CSPG_shmbuf_regist_cwp_handler(CSP_cwp_pkt_t * pkt)
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_cwp_shmbuf_regist_pkt_t *shmbuf_regist_pkt = &pkt->u.fnc_shmbuf_regist;
 
-    mpi_errno = shmbuf_regist_impl(shmbuf_regist_pkt);
+    mpi_errno = shmbuf_regist_impl(pkt);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
   fn_exit:
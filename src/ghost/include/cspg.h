@@ -39,6 +39,17 @@ typedef struct CSPG_win_info_args {
     int epochs_used;
 } CSPG_win_info_args_t;
 
+/* Communicators shared by the windows allocated on the same user group.
+ * Indexed by the local user root and the id agreed on user processes. */
+typedef struct CSPG_ugcomm {
+    int user_local_root;
+    int id;
+    int ref_count;
+    MPI_Comm ug_comm;
+    MPI_Comm local_ug_comm;
+    struct CSPG_ugcomm *next;
+} CSPG_ugcomm_t;
+
 typedef struct CSPG_win {
     MPI_Comm local_ug_comm;     /* including local user and ghost processes */
     MPI_Win local_ug_win;
@@ -49,8 +60,15 @@ typedef struct CSPG_win {
     int user_local_root;        /* rank of local user root in comm_local. */
 
     int is_u_world;             /* whether user communicator is equal to USER WORLD. */
+    int is_dynamic;             /* created by MPI_Win_create_dynamic. */
+    int is_remapped;            /* created by MPI_Win_create on remapped user buffers. */
+    int num_remaps;             /* number of processes in local_ug_comm. */
+    void **remap_bases;         /* num_remaps, mapping of every local user buffer,
+                                 * NULL for ghosts and empty buffers. */
+    MPI_Aint *remap_sizes;      /* num_remaps */
 
     MPI_Comm ug_comm;           /* including all user and ghosts processes */
+    CSPG_ugcomm_t *ugcomm;      /* cached communicators, NULL if not cached. */
 
     void *base;
     MPI_Win *ug_wins;
@@ -63,6 +81,30 @@ typedef struct CSPG_win {
 } CSPG_win_t;
 
 
+extern CSPG_ugcomm_t *CSPG_ugcomm_cache_find(int user_local_root, int id);
+extern void CSPG_ugcomm_cache_store(int id, CSPG_win_t * win);
+extern int CSPG_ugcomm_cache_release(CSPG_win_t * win);
+
+/* Node-wide shared memory pool for dynamic windows (see win_dyn_pool.c). */
+typedef struct CSPG_dyn_pool {
+    MPI_Win win;                /* shared window on local_comm. */
+    int local_nprocs;
+    void **bases;               /* local_nprocs, address of every segment, NULL for ghosts. */
+    MPI_Aint *sizes;            /* local_nprocs */
+} CSPG_dyn_pool_t;
+
+extern int CSPG_dyn_pool_init(void);
+extern int CSPG_dyn_pool_destroy(void);
+extern int CSPG_dyn_pool_attach(MPI_Win win);
+extern int CSPG_dyn_pool_detach(MPI_Win win);
+
+/* Remapped user buffers of MPI_Win_create (see win_remap.c). */
+extern int CSPG_win_remap_init(void);
+extern int CSPG_win_remap_map(CSPG_win_t * win);
+extern int CSPG_win_remap_unmap(CSPG_win_t * win);
+extern int CSPG_win_remap_attach(CSPG_win_t * win, MPI_Win ug_win);
+extern int CSPG_win_remap_detach(CSPG_win_t * win, MPI_Win ug_win);
+
 /* ======================================================================
  * Communicator related definitions.
  * ====================================================================== */
@@ -89,30 +131,32 @@ typedef int (*CSPG_cwp_handler_t) (CSP_cwp_pkt_t * pkt);
 
 extern void CSPG_cwp_register_root_handler(CSP_cwp_t cmd_type, CSPG_cwp_root_handler_t handler_fnc);
 extern void CSPG_cwp_register_handler(CSP_cwp_t cmd_type, CSPG_cwp_handler_t handler_fnc);
+extern int CSPG_cwp_init(void);
+extern int CSPG_cwp_destroy(void);
 extern int CSPG_cwp_do_progress(void);
 extern void CSPG_cwp_terminate(void);
 
-static inline int CSPG_cwp_try_bcast(CSP_cwp_pkt_t * pkt, MPI_Request * ibcast_req)
+/* Receive parameters from user root via local communicator (blocking call). */
+static inline int CSPG_cwp_recv_param(void *params, size_t size, int user_local_root)
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_CALLMPI(NOSTMT, PMPI_Ibcast((char *) pkt, sizeof(CSP_cwp_pkt_t), MPI_CHAR, 0,
-                                    CSP_PROC.ghost.g_local_comm, ibcast_req));
+    CSP_CALLMPI(NOSTMT, PMPI_Recv(params, size, MPI_CHAR, user_local_root,
+                                  CSP_CWP_PARAM_TAG, CSP_PROC.local_comm, MPI_STATUS_IGNORE));
     return mpi_errno;
 }
 
-static inline int CSPG_cwp_root_try_recv(CSP_cwp_pkt_t * pkt, MPI_Request * irecv_req)
+/* Get my parameter issued with the command, carried in the ring slot or
+ * received from user root if the slot cannot hold it (blocking call). */
+static inline int CSPG_cwp_get_g_param(CSP_cwp_pkt_t * pkt, MPI_Aint * param, int user_local_root)
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_CALLMPI(NOSTMT, PMPI_Irecv((char *) pkt, sizeof(CSP_cwp_pkt_t), MPI_CHAR,
-                                   MPI_ANY_SOURCE, CSP_CWP_TAG, CSP_PROC.local_comm, irecv_req));
-    return mpi_errno;
-}
 
-/* Receive parameters from user root via local communicator (blocking call). */
-static inline int CSPG_cwp_recv_param(void *params, size_t size, int user_local_root)
-{
-    int mpi_errno = MPI_SUCCESS;
-    CSP_CALLMPI(NOSTMT, PMPI_Recv(params, size, MPI_CHAR, user_local_root,
+    if (pkt->has_g_param) {
+        (*param) = pkt->g_param;
+        return mpi_errno;
+    }
+
+    CSP_CALLMPI(NOSTMT, PMPI_Recv(param, 1, MPI_AINT, user_local_root,
                                   CSP_CWP_PARAM_TAG, CSP_PROC.local_comm, MPI_STATUS_IGNORE));
     return mpi_errno;
 }
@@ -133,7 +177,6 @@ static inline int CSPG_cwp_try_send_param(void *params, size_t size, int user_lo
 
 extern int CSPG_win_allocate_cwp_root_handler(CSP_cwp_pkt_t * pkt, int user_local_rank);
 extern int CSPG_win_free_cwp_root_handler(CSP_cwp_pkt_t * pkt, int user_local_rank);
-extern int CSPG_finalize_cwp_root_handler(CSP_cwp_pkt_t * pkt, int user_local_rank);
 
 extern int CSPG_win_allocate_cwp_handler(CSP_cwp_pkt_t * pkt);
 extern int CSPG_win_free_cwp_handler(CSP_cwp_pkt_t * pkt);
@@ -144,17 +187,18 @@ extern int CSPG_ugcomm_create_cwp_handler(CSP_cwp_pkt_t * pkt);
 extern int CSPG_ugcomm_free_cwp_root_handler(CSP_cwp_pkt_t * pkt, int user_local_rank);
 extern int CSPG_ugcomm_free_cwp_handler(CSP_cwp_pkt_t * pkt);
 
-extern int CSPG_shmbuf_regist_cwp_root_handler(CSP_cwp_pkt_t * pkt, int user_local_rank);
 extern int CSPG_shmbuf_regist_cwp_handler(CSP_cwp_pkt_t * pkt);
-extern int CSPG_shmbuf_free_cwp_root_handler(CSP_cwp_pkt_t * pkt, int user_local_rank);
 extern int CSPG_shmbuf_free_cwp_handler(CSP_cwp_pkt_t * pkt);
 
+extern int CSPG_datatype_regist_cwp_handler(CSP_cwp_pkt_t * pkt);
+extern int CSPG_datatype_free_cwp_handler(CSP_cwp_pkt_t * pkt);
+
 /* ======================================================================
  * MLOCK related definition (ghost side).
  * ====================================================================== */
 
-extern void CSPG_mlock_init(void);
-extern void CSPG_mlock_destory(void);
+extern int CSPG_mlock_init(void);
+extern int CSPG_mlock_destory(void);
 extern int CSPG_mlock_release(void);
 
 /* ======================================================================
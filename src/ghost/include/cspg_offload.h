@@ -8,13 +8,14 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <mpi.h>
 #include "cspg.h"
 #include "csp_util.h"
 #include "csp_offload.h"
 
 typedef int (*CSPG_offload_handler_t) (CSP_offload_pkt_t * cell);
-typedef void (*CSPG_offload_cmpl_handler_t) (CSP_offload_pkt_t * pkt, MPI_Status g_stat);
+typedef int (*CSPG_offload_cmpl_handler_t) (CSP_offload_pkt_t * pkt, MPI_Status g_stat);
 
 /* Ghost offload channel connecting to single each user */
 typedef struct CSPG_offload_channel {
@@ -23,6 +24,9 @@ typedef struct CSPG_offload_channel {
     /* shm recvq, enqueued by local user and dequeued by a ghost */
     CSP_offload_shmqueue_t *shm_recvq_ptr;
     int shm_recved_cnt;         /* DEBUG only */
+
+    /* shm completion queue, enqueued by the ghost and dequeued by local user */
+    CSP_offload_cmplq_t *shm_cmplq_ptr;
 } CSPG_offload_channel_t;
 
 typedef struct CSPG_offload_server {
@@ -40,57 +44,113 @@ typedef struct CSPG_offload_server {
         int lrank_end;
     } urange;
 
-    /* local issued queue, holding issued but incompleted cells. */
+    /* Local issued list, holding issued but incompleted cells. The requests
+     * of the cells are stored in a contiguous array thus can be tested by a
+     * single PMPI_Testsome. Both arrays are compacted after completion. */
     struct {
-        CSP_offload_cell_t *head;
-        int nissued;            /* DEBUG only */
+        CSP_offload_cell_t **cells;
+        MPI_Request *reqs;
+        int *indices;           /* Output of PMPI_Testsome. */
+        MPI_Status *stats;      /* Output of PMPI_Testsome. */
+        int capacity;
+        int nissued;
         int noutstanding;
+        int max_noutstanding;
     } issued_list;
 
+    /* Pipelined receives in progress, and the receives deferred by them. A
+     * receive matching an ongoing pipelined one (the same communicator, receiver,
+     * source and tag) is issued only after it completes, thus it never takes
+     * a chunk of the pipelined message. Both lists are linked in issue order. */
+    struct {
+        CSP_offload_pkt_t *active;
+        CSP_offload_pkt_t *deferred;
+    } pipe_recvs;
+
     /* Offload packet handlers on ghost.
      * The handler is called when polled a offload cell from a user channel. */
     CSPG_offload_handler_t pkt_handlers[CSP_OFFLOAD_MAX];
 
     /* Completion handlers on ghost.
-     * The handler is called when an issued packet is completed on ghost.*/
+     * The handler is called when an issued packet is completed on ghost. It
+     * returns 1 if the packet is issued again (i.e., the next chunk of
+     * pipelined receive), thus it stays in the local issued list. */
     CSPG_offload_cmpl_handler_t cmpl_handlers[CSP_OFFLOAD_MAX];
 } CSPG_offload_server_t;
 
 extern CSPG_offload_server_t CSPG_offload_server;
 
 /* ======================================================================
- * Double-linked list routines for holding issued but incomplete cells on
- * ghost process. Each cell is the same instance as dequeued from shm_recvq.
+ * Routines for holding issued but incomplete cells on ghost process. Each
+ * cell is the same instance as dequeued from shm_recvq.
  * TODO: These routines are not thread safe. Need fix for multithreaded program.
  * ====================================================================== */
 
-/* Should always reset the cell before moving from the shared queue. */
-static inline void CSPG_offload_issued_list_reset_cellpt(CSP_offload_cell_t * cell)
-{
-    CSP_offload_cell_reset_abs(cell);
-}
+#define CSPG_OFFLOAD_ISSUED_LIST_INIT_CAPACITY 64
 
 static inline int CSPG_offload_issued_list_empty(void)
 {
-    return (CSPG_offload_server.issued_list.head == NULL);
+    return (CSPG_offload_server.issued_list.noutstanding == 0);
 }
 
-static inline void CSPG_offload_issued_list_remove(CSP_offload_cell_t ** cell_ptr)
+/* Remove the idx-th cell by moving the last one into its slot. */
+static inline void CSPG_offload_issued_list_remove(int idx)
 {
-    CSP_ASSERT(CSPG_offload_server.issued_list.head != NULL);
+    int last = --CSPG_offload_server.issued_list.noutstanding;
 
-    DL_DELETE2(CSPG_offload_server.issued_list.head, *cell_ptr, CSP_OFFLOAD_ABS_PT_DECL(prev),
-               CSP_OFFLOAD_ABS_PT_DECL(next));
-    CSPG_offload_server.issued_list.noutstanding--;
+    CSP_ASSERT(idx <= last);
+    CSPG_offload_server.issued_list.cells[idx] = CSPG_offload_server.issued_list.cells[last];
+    CSPG_offload_server.issued_list.reqs[idx] = CSPG_offload_server.issued_list.reqs[last];
 }
 
-static inline void CSPG_offload_issued_list_append(CSP_offload_cell_t * cell_ptr)
+extern int CSPG_offload_issued_list_grow(void);
+
+static inline int CSPG_offload_issued_list_append(CSP_offload_cell_t * cell_ptr)
 {
-    /* tail is internally stored at head->prev. */
-    DL_APPEND2(CSPG_offload_server.issued_list.head, cell_ptr, CSP_OFFLOAD_ABS_PT_DECL(prev),
-               CSP_OFFLOAD_ABS_PT_DECL(next));
+    int mpi_errno = MPI_SUCCESS;
+    int idx = CSPG_offload_server.issued_list.noutstanding;
+
+    if (idx == CSPG_offload_server.issued_list.capacity) {
+        mpi_errno = CSPG_offload_issued_list_grow();
+        if (mpi_errno != MPI_SUCCESS)
+            return mpi_errno;
+    }
+
+    CSPG_offload_server.issued_list.cells[idx] = cell_ptr;
+    CSPG_offload_server.issued_list.reqs[idx] = cell_ptr->pkt.g_req;
     CSPG_offload_server.issued_list.nissued++;
     CSPG_offload_server.issued_list.noutstanding++;
+    CSPG_offload_server.issued_list.max_noutstanding =
+        CSP_MAX(CSPG_offload_server.issued_list.max_noutstanding,
+                CSPG_offload_server.issued_list.noutstanding);
+    return mpi_errno;
+}
+
+static inline CSP_offload_cell_t *CSPG_offload_pkt_to_cell(CSP_offload_pkt_t * pkt)
+{
+    return (CSP_offload_cell_t *) ((char *) pkt - offsetof(CSP_offload_cell_t, pkt));
+}
+
+/* Notify the user that the issued call of the packet is locally completed.
+ * Completion handlers call it after updated the payload. */
+static inline void CSPG_offload_set_complete(CSP_offload_pkt_t * pkt)
+{
+    CSPG_offload_channel_t *channel = &CSPG_offload_server.channels[pkt->g_ch_idx];
+    CSP_offload_cell_t *cell = CSPG_offload_pkt_to_cell(pkt);
+
+    CSP_offload_cmplq_enqueue(channel->shm_base, channel->shm_cmplq_ptr, cell);
+}
+
+/* Whether the ghost is idle on offloading since the last check, that is, no
+ * cell is received and no issued call is outstanding. last_nissued stores the
+ * number of received cells at the last check. */
+static inline int CSPG_offload_check_idle(int *last_nissued)
+{
+    int idle = (CSPG_offload_server.issued_list.noutstanding == 0 &&
+                CSPG_offload_server.issued_list.nissued == (*last_nissued));
+
+    (*last_nissued) = CSPG_offload_server.issued_list.nissued;
+    return idle;
 }
 
 /* ======================================================================
@@ -101,10 +161,11 @@ extern int CSPG_offload_destroy(void);
 extern int CSPG_offload_poll_progress(void);
 
 extern int CSPG_isend_offload_handler(CSP_offload_pkt_t * pkt);
-extern void CSPG_isend_cmpl_handler(CSP_offload_pkt_t * pkt, MPI_Status g_stat);
+extern int CSPG_isend_cmpl_handler(CSP_offload_pkt_t * pkt, MPI_Status g_stat);
 
 extern int CSPG_irecv_offload_handler(CSP_offload_pkt_t * pkt);
-extern void CSPG_irecv_cmpl_handler(CSP_offload_pkt_t * pkt, MPI_Status g_stat);
+extern int CSPG_irecv_cmpl_handler(CSP_offload_pkt_t * pkt, MPI_Status g_stat);
+extern int CSPG_irecv_issue_deferred(void);
 
 #define CSPG_TRANS_TAG(tag, off) (tag + (off << CSPG_offload_server.tag_trans.user_tag_nbits))
 #define CSPG_TRANS_TAG_UTAG(tag) (tag & CSPG_offload_server.tag_trans.user_tag_mask)
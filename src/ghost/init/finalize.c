@@ -73,7 +73,8 @@ int CSPG_global_finalize(void)
 {
     int mpi_errno = MPI_SUCCESS;
 
-    CSPG_mlock_destory();
+    mpi_errno = CSPG_mlock_destory();
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     if (CSP_IS_MODE_ENABLED(PT2PT)) {
         mpi_errno = CSPG_datatype_destory();
@@ -83,6 +84,14 @@ int CSPG_global_finalize(void)
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
 
+    if (CSP_IS_MODE_ENABLED(RMA)) {
+        mpi_errno = CSPG_dyn_pool_destroy();
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
+    mpi_errno = CSPG_cwp_destroy();
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     mpi_errno = destroy_proc();
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
@@ -92,11 +101,12 @@ int CSPG_global_finalize(void)
     goto fn_exit;
 }
 
-int CSPG_finalize_cwp_root_handler(CSP_cwp_pkt_t * pkt, int user_local_rank CSP_ATTRIBUTE((unused)))
+/* Every ghost reads the finalize command issued by each local user,
+ * and finalizes after all local users arrived. */
+int CSPG_finalize_cwp_handler(CSP_cwp_pkt_t * pkt CSP_ATTRIBUTE((unused)))
 {
     int mpi_errno = MPI_SUCCESS;
     int local_nprocs, local_user_nprocs;
-    MPI_Request ibcast_req = MPI_REQUEST_NULL;
 
     finalize_cnt++;
     CSP_CALLMPI(JUMP, PMPI_Comm_size(CSP_PROC.local_comm, &local_nprocs));
@@ -110,27 +120,6 @@ int CSPG_finalize_cwp_root_handler(CSP_cwp_pkt_t * pkt, int user_local_rank CSP_
     if (finalize_cnt < local_user_nprocs)
         goto fn_exit;
 
-    /* broadcast to all local ghost */
-    mpi_errno = CSPG_cwp_try_bcast(pkt, &ibcast_req);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-    CSP_CALLMPI(JUMP, PMPI_Wait(&ibcast_req, MPI_STATUS_IGNORE));
-
-    mpi_errno = finalize_impl();
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-  fn_exit:
-    return mpi_errno;
-
-  fn_fail:
-    /* Error is handled in CSPG_main. */
-    goto fn_exit;
-}
-
-int CSPG_finalize_cwp_handler(CSP_cwp_pkt_t * pkt CSP_ATTRIBUTE((unused)))
-{
-    int mpi_errno = MPI_SUCCESS;
-
     mpi_errno = finalize_impl();
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
@@ -43,15 +43,15 @@ static void setup_proc(void)
 #endif
 }
 
+/* Root handlers are called only on the first local ghost, which also performs
+ * the root-only work of a command (e.g., release mlock). Other commands are
+ * handled by the common handlers on all ghosts. */
 static void register_cwp_handlers(void)
 {
     CSPG_cwp_register_root_handler(CSP_CWP_FNC_WIN_ALLOCATE, CSPG_win_allocate_cwp_root_handler);
     CSPG_cwp_register_root_handler(CSP_CWP_FNC_WIN_FREE, CSPG_win_free_cwp_root_handler);
     CSPG_cwp_register_root_handler(CSP_CWP_FNC_UGCOMM_CREATE, CSPG_ugcomm_create_cwp_root_handler);
     CSPG_cwp_register_root_handler(CSP_CWP_FNC_UGCOMM_FREE, CSPG_ugcomm_free_cwp_root_handler);
-    CSPG_cwp_register_root_handler(CSP_CWP_FNC_SHMBUF_REGIST, CSPG_shmbuf_regist_cwp_root_handler);
-    CSPG_cwp_register_root_handler(CSP_CWP_FNC_SHMBUF_FREE, CSPG_shmbuf_free_cwp_root_handler);
-    CSPG_cwp_register_root_handler(CSP_CWP_FNC_FINALIZE, CSPG_finalize_cwp_root_handler);
 
     CSPG_cwp_register_handler(CSP_CWP_FNC_WIN_ALLOCATE, CSPG_win_allocate_cwp_handler);
     CSPG_cwp_register_handler(CSP_CWP_FNC_WIN_FREE, CSPG_win_free_cwp_handler);
@@ -59,6 +59,8 @@ static void register_cwp_handlers(void)
     CSPG_cwp_register_handler(CSP_CWP_FNC_UGCOMM_FREE, CSPG_ugcomm_free_cwp_handler);
     CSPG_cwp_register_handler(CSP_CWP_FNC_SHMBUF_REGIST, CSPG_shmbuf_regist_cwp_handler);
     CSPG_cwp_register_handler(CSP_CWP_FNC_SHMBUF_FREE, CSPG_shmbuf_free_cwp_handler);
+    CSPG_cwp_register_handler(CSP_CWP_FNC_DATATYPE_REGIST, CSPG_datatype_regist_cwp_handler);
+    CSPG_cwp_register_handler(CSP_CWP_FNC_DATATYPE_FREE, CSPG_datatype_free_cwp_handler);
     CSPG_cwp_register_handler(CSP_CWP_FNC_FINALIZE, CSPG_finalize_cwp_handler);
 }
 
@@ -69,6 +71,10 @@ int CSPG_global_init(void)
     /* Initialization */
     setup_proc();
 
+    /* Collective call with local users. */
+    mpi_errno = CSPG_cwp_init();
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     if (CSP_IS_MODE_ENABLED(PT2PT)) {
         mpi_errno = CSPG_offload_init();
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
@@ -77,8 +83,20 @@ int CSPG_global_init(void)
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
 
+    if (CSP_IS_MODE_ENABLED(RMA)) {
+        /* Collective call with local users. */
+        mpi_errno = CSPG_dyn_pool_init();
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+        mpi_errno = CSPG_win_remap_init();
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
     register_cwp_handlers();
-    CSPG_mlock_init();
+
+    /* Collective call with local users. */
+    mpi_errno = CSPG_mlock_init();
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     /* Disable MPI automatic error messages. */
     CSP_CALLMPI(JUMP, PMPI_Comm_set_errhandler(MPI_COMM_WORLD, MPI_ERRORS_RETURN));
@@ -8,38 +8,32 @@
 #include <stdlib.h>
 #include "cspg.h"
 
-void CSPG_irecv_cmpl_handler(CSP_offload_pkt_t * pkt, MPI_Status g_stat)
+static inline int irecv_pkt_match(CSP_offload_pkt_t * pkt1, CSP_offload_pkt_t * pkt2)
 {
-    MPI_Status *u_stat_ptr = &pkt->stat;
-    CSP_offload_irecv_pkt_t *irecv_pkt = &pkt->irecv;
-    CSPG_comm_t *cspg_comm = NULL;
-
-    cspg_comm = (CSPG_comm_t *) irecv_pkt->g_ugcomm_handle;
+    return pkt1->irecv.g_ugcomm_handle == pkt2->irecv.g_ugcomm_handle &&
+        pkt1->irecv.ugrank == pkt2->irecv.ugrank && pkt1->irecv.tag == pkt2->irecv.tag &&
+        pkt1->irecv.peer_rank == pkt2->irecv.peer_rank;
+}
 
-    u_stat_ptr->MPI_SOURCE = pkt->irecv.peer_rank;
-    u_stat_ptr->MPI_TAG = pkt->irecv.tag;
-    u_stat_ptr->MPI_ERROR = g_stat.MPI_ERROR;
+/* Whether the receive matches an ongoing pipelined receive, or a deferred one
+ * before stop_pkt (the whole list if NULL) in the deferred list. */
+static inline int irecv_check_blocked(CSP_offload_pkt_t * pkt, CSP_offload_pkt_t * stop_pkt)
+{
+    CSP_offload_pkt_t *p = NULL;
 
-    if (cspg_comm->type == CSP_COMM_ASYNC_DUP) {
-        /* Translate source and tag.
-         * Note that MPI_SOURCE is ugrank, need translation on user process.*/
-        if (irecv_pkt->peer_rank == MPI_ANY_SOURCE)
-            u_stat_ptr->MPI_SOURCE = CSPG_UGCOMM_OFF2RANK(g_stat.MPI_SOURCE,
-                                                          CSPG_TRANS_TAG_OFF(g_stat.MPI_TAG));
-        if (pkt->irecv.tag == MPI_ANY_TAG)
-            u_stat_ptr->MPI_TAG = CSPG_TRANS_TAG_UTAG(g_stat.MPI_TAG);
+    LL_FOREACH2(CSPG_offload_server.pipe_recvs.active, p, g_next) {
+        if (irecv_pkt_match(p, pkt))
+            return 1;
     }
-
-    /* Set completion */
-    OPA_store_int(&pkt->complet_flag, 1);
-
-    CSPG_DBG_PRINT
-        ("OFFLOAD, irecv cmpl: pkt=%p; gstat.SOURCE %d, TAG 0x%x; stat.SOURCE %d, TAG %d, ERROR %d\n",
-         pkt, g_stat.MPI_SOURCE, g_stat.MPI_TAG, u_stat_ptr->MPI_SOURCE, u_stat_ptr->MPI_TAG,
-         u_stat_ptr->MPI_ERROR);
+    for (p = CSPG_offload_server.pipe_recvs.deferred; p != stop_pkt; p = p->g_next) {
+        if (irecv_pkt_match(p, pkt))
+            return 1;
+    }
+    return 0;
 }
 
-int CSPG_irecv_offload_handler(CSP_offload_pkt_t * pkt)
+/* Issue the receive, or the current chunk of pipelined receive. */
+static int irecv_issue(CSP_offload_pkt_t * pkt)
 {
     int mpi_errno = MPI_SUCCESS;
     CSP_offload_irecv_pkt_t *irecv_pkt = &pkt->irecv;
@@ -47,6 +41,9 @@ int CSPG_irecv_offload_handler(CSP_offload_pkt_t * pkt)
     MPI_Comm ug_comm = MPI_COMM_NULL;
     int tag, peer_g_rank, recv_offset;
     int g_rank = 0;
+    void *g_buf = (void *) irecv_pkt->g_bufaddr;
+    int count = irecv_pkt->count;
+    MPI_Datatype g_datatype = irecv_pkt->g_datatype;
 
     cspg_comm = (CSPG_comm_t *) irecv_pkt->g_ugcomm_handle;
     CSP_DBG_ASSERT(cspg_comm->type >= CSP_COMM_ASYNC_DUP);
@@ -73,16 +70,127 @@ int CSPG_irecv_offload_handler(CSP_offload_pkt_t * pkt)
             tag = MPI_ANY_TAG;
     }
 
+    /* Receive the chunk as bytes into the rest of the buffer. Once the buffer
+     * is full, an empty receive matches the sender's empty last chunk, or
+     * reports truncation if the sender has more data. */
+    if (pkt->chunksz > 0) {
+        int type_size = 0;
+
+        CSP_CALLMPI(JUMP, PMPI_Type_size(g_datatype, &type_size));
+        g_buf = (void *) (irecv_pkt->g_bufaddr + pkt->g_chunk_off);
+        count = (int) CSP_MIN(pkt->chunksz, (MPI_Aint) irecv_pkt->count * type_size -
+                              pkt->g_chunk_off);
+        g_datatype = MPI_BYTE;
+    }
+
     /* We trust user always passes the valid buffer address. */
-    CSP_CALLMPI(JUMP, PMPI_Irecv((void *) irecv_pkt->g_bufaddr, irecv_pkt->count,
-                                 irecv_pkt->g_datatype, peer_g_rank, tag, ug_comm, &pkt->g_req));
+    CSP_CALLMPI(JUMP, PMPI_Irecv(g_buf, count, g_datatype, peer_g_rank, tag, ug_comm,
+                                 &pkt->g_req));
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_comm, &g_rank));
-    CSPG_DBG_PRINT("OFFLOAD (%s), irecv pkt=%p, req=0x%x, buf 0x%lx, count %d, g_datatype 0x%x,"
-                   "me %d/%d (g %d), peer %d (g %d), tag %d->0x%x, g_ugcomm 0x%x (roff %d)\n",
-                   CSP_ug_comm_type_name[cspg_comm->type], pkt, pkt->g_req, irecv_pkt->g_bufaddr,
-                   irecv_pkt->count, irecv_pkt->g_datatype, irecv_pkt->rank, irecv_pkt->ugrank,
+    CSPG_DBG_PRINT("OFFLOAD (%s), irecv pkt=%p, req=0x%x, buf %p, count %d, g_datatype 0x%x,"
+                   "me %d/%d (g %d), peer %d (g %d), tag %d->0x%x, g_ugcomm 0x%x (roff %d), "
+                   "chunk_off %ld\n", CSP_ug_comm_type_name[cspg_comm->type], pkt, pkt->g_req,
+                   g_buf, count, g_datatype, irecv_pkt->rank, irecv_pkt->ugrank,
                    g_rank, irecv_pkt->peer_rank, peer_g_rank, irecv_pkt->tag, tag, ug_comm,
-                   recv_offset);
+                   recv_offset, pkt->g_chunk_off);
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int CSPG_irecv_cmpl_handler(CSP_offload_pkt_t * pkt, MPI_Status g_stat)
+{
+    MPI_Status *u_stat_ptr = &pkt->stat;
+    CSP_offload_irecv_pkt_t *irecv_pkt = &pkt->irecv;
+    CSPG_comm_t *cspg_comm = NULL;
+
+    /* A full chunk is followed by at least one (maybe empty) chunk. */
+    if (pkt->chunksz > 0) {
+        int nbytes = 0;
+
+        if (g_stat.MPI_ERROR == MPI_SUCCESS)
+            g_stat.MPI_ERROR = PMPI_Get_count(&g_stat, MPI_BYTE, &nbytes);
+        if (g_stat.MPI_ERROR == MPI_SUCCESS && nbytes == pkt->chunksz) {
+            pkt->g_chunk_off += nbytes;
+            g_stat.MPI_ERROR = irecv_issue(pkt);
+            if (g_stat.MPI_ERROR == MPI_SUCCESS)
+                return 1;
+        }
+        LL_DELETE2(CSPG_offload_server.pipe_recvs.active, pkt, g_next);
+    }
+
+    cspg_comm = (CSPG_comm_t *) irecv_pkt->g_ugcomm_handle;
+
+    u_stat_ptr->MPI_SOURCE = pkt->irecv.peer_rank;
+    u_stat_ptr->MPI_TAG = pkt->irecv.tag;
+    u_stat_ptr->MPI_ERROR = g_stat.MPI_ERROR;
+
+    if (cspg_comm->type == CSP_COMM_ASYNC_DUP) {
+        /* Translate source and tag.
+         * Note that MPI_SOURCE is ugrank, need translation on user process.*/
+        if (irecv_pkt->peer_rank == MPI_ANY_SOURCE)
+            u_stat_ptr->MPI_SOURCE = CSPG_UGCOMM_OFF2RANK(g_stat.MPI_SOURCE,
+                                                          CSPG_TRANS_TAG_OFF(g_stat.MPI_TAG));
+        if (pkt->irecv.tag == MPI_ANY_TAG)
+            u_stat_ptr->MPI_TAG = CSPG_TRANS_TAG_UTAG(g_stat.MPI_TAG);
+    }
+
+    /* Set completion */
+    CSPG_offload_set_complete(pkt);
+
+    CSPG_DBG_PRINT
+        ("OFFLOAD, irecv cmpl: pkt=%p; gstat.SOURCE %d, TAG 0x%x; stat.SOURCE %d, TAG %d, ERROR %d\n",
+         pkt, g_stat.MPI_SOURCE, g_stat.MPI_TAG, u_stat_ptr->MPI_SOURCE, u_stat_ptr->MPI_TAG,
+         u_stat_ptr->MPI_ERROR);
+    return 0;
+}
+
+/* The sender splits a pipelined message into chunks of chunksz bytes followed
+ * by a shorter (possibly empty) last chunk, see CSPU_offload_check_pipeline.
+ * Thus the ghost receives the chunks one by one, and the message ends at the
+ * first chunk shorter than chunksz regardless of the receive count. Because
+ * the next chunk is not yet posted, any later receive with the same matching
+ * arguments is deferred till the pipelined receive completes. The packet is
+ * not issued (g_req is MPI_REQUEST_NULL) if deferred. */
+int CSPG_irecv_offload_handler(CSP_offload_pkt_t * pkt)
+{
+    pkt->g_req = MPI_REQUEST_NULL;
+    pkt->g_chunk_off = 0;
+
+    if (irecv_check_blocked(pkt, NULL)) {
+        LL_APPEND2(CSPG_offload_server.pipe_recvs.deferred, pkt, g_next);
+        CSPG_DBG_PRINT("OFFLOAD, irecv pkt=%p deferred by pipelined receive\n", pkt);
+        return MPI_SUCCESS;
+    }
+
+    if (pkt->chunksz > 0)
+        LL_APPEND2(CSPG_offload_server.pipe_recvs.active, pkt, g_next);
+    return irecv_issue(pkt);
+}
+
+/* Issue every deferred receive that is no longer blocked, in issue order. */
+int CSPG_irecv_issue_deferred(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSP_offload_pkt_t *pkt = NULL, *tmp = NULL;
+
+    LL_FOREACH_SAFE2(CSPG_offload_server.pipe_recvs.deferred, pkt, tmp, g_next) {
+        if (irecv_check_blocked(pkt, pkt))
+            continue;
+
+        LL_DELETE2(CSPG_offload_server.pipe_recvs.deferred, pkt, g_next);
+        if (pkt->chunksz > 0)
+            LL_APPEND2(CSPG_offload_server.pipe_recvs.active, pkt, g_next);
+
+        mpi_errno = irecv_issue(pkt);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+        mpi_errno = CSPG_offload_issued_list_append(CSPG_offload_pkt_to_cell(pkt));
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
 
   fn_exit:
     return mpi_errno;
@@ -9,14 +9,15 @@
 #include <string.h>
 #include "cspg.h"
 
-void CSPG_isend_cmpl_handler(CSP_offload_pkt_t * pkt, MPI_Status g_stat)
+int CSPG_isend_cmpl_handler(CSP_offload_pkt_t * pkt, MPI_Status g_stat)
 {
     /* Do not set status for send message. */
 
     /* Set completion */
-    OPA_store_int(&pkt->complet_flag, 1);
+    CSPG_offload_set_complete(pkt);
 
     CSPG_DBG_PRINT("OFFLOAD, isend cmpl: pkt=%p\n", pkt);
+    return 0;
 }
 
 
@@ -28,6 +29,8 @@ int CSPG_isend_offload_handler(CSP_offload_pkt_t * pkt)
     MPI_Comm ug_comm = MPI_COMM_NULL;
     int tag, peer_g_rank, recv_offset, send_offset;
     int g_rank;
+    const void *g_buf = (const void *) isend_pkt->g_bufaddr;
+    MPI_Datatype g_datatype = isend_pkt->g_datatype;
 
     cspg_comm = (CSPG_comm_t *) isend_pkt->g_ugcomm_handle;
     CSP_DBG_ASSERT(cspg_comm->type >= CSP_COMM_ASYNC_DUP);
@@ -54,15 +57,22 @@ int CSPG_isend_offload_handler(CSP_offload_pkt_t * pkt)
         }
     }
 
+    /* Eager message or staged chunk is copied in the shared region of the channel. */
+    if (pkt->packed) {
+        g_buf = (const void *) (CSPG_offload_server.channels[pkt->g_ch_idx].shm_base +
+                                isend_pkt->g_bufaddr);
+        g_datatype = MPI_PACKED;
+    }
+
     /* We trust user always passes the valid buffer address. */
-    CSP_CALLMPI(JUMP, PMPI_Isend((const void *) isend_pkt->g_bufaddr, isend_pkt->count,
-                                 isend_pkt->g_datatype, peer_g_rank, tag, ug_comm, &pkt->g_req));
+    CSP_CALLMPI(JUMP, PMPI_Isend(g_buf, isend_pkt->count, g_datatype, peer_g_rank, tag,
+                                 ug_comm, &pkt->g_req));
 
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_comm, &g_rank));
-    CSPG_DBG_PRINT("OFFLOAD (%s), isend pkt=%p, req=0x%x, buf 0x%lx, count %d, g_datatype 0x%x,"
+    CSPG_DBG_PRINT("OFFLOAD (%s), isend pkt=%p, req=0x%x, buf %p, count %d, g_datatype 0x%x,"
                    "me %d/%d (g %d), peer %d/%d (g %d), tag %d->0x%x, g_ugcomm 0x%x(soff %d, roff %d)\n",
-                   CSP_ug_comm_type_name[cspg_comm->type], pkt, pkt->g_req, isend_pkt->g_bufaddr,
-                   isend_pkt->count, isend_pkt->g_datatype, isend_pkt->rank, isend_pkt->ugrank,
+                   CSP_ug_comm_type_name[cspg_comm->type], pkt, pkt->g_req, g_buf,
+                   isend_pkt->count, g_datatype, isend_pkt->rank, isend_pkt->ugrank,
                    g_rank, isend_pkt->peer_rank, isend_pkt->peer_ugrank, peer_g_rank,
                    isend_pkt->tag, tag, ug_comm, send_offset, recv_offset);
 
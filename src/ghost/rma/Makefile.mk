@@ -3,4 +3,7 @@
 #
 
 libcasper_la_SOURCES += src/ghost/rma/win_allocate.c \
-                        src/ghost/rma/win_free.c
\ No newline at end of file
+                        src/ghost/rma/win_free.c \
+                        src/ghost/rma/win_ugcomm_cache.c \
+                        src/ghost/rma/win_dyn_pool.c \
+                        src/ghost/rma/win_remap.c
\ No newline at end of file
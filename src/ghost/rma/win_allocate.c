@@ -37,14 +37,17 @@ static int init_ghost_win(CSP_cwp_fnc_winalloc_pkt_t * winalloc_pkt, CSPG_win_t
     win->max_local_user_nprocs = winalloc_pkt->max_local_user_nprocs;
     win->info_args.epochs_used = winalloc_pkt->epochs_used;
     win->is_u_world = winalloc_pkt->is_u_world;
+    win->is_dynamic = winalloc_pkt->is_dynamic;
+    win->is_remapped = winalloc_pkt->is_remapped;
     win->user_nprocs = winalloc_pkt->user_nprocs;
     win->user_local_root = winalloc_pkt->user_local_root;
     info_npairs = winalloc_pkt->info_npairs;
 
     CSPG_DBG_PRINT(" Received command from %d: max_local_user_nprocs = %d, epochs_used=%d, "
-                   "is_u_world=%d, user_nprocs=%d, info npairs=%d\n", win->user_local_root,
-                   win->max_local_user_nprocs, win->info_args.epochs_used, win->is_u_world,
-                   win->user_nprocs, info_npairs);
+                   "is_u_world=%d, user_nprocs=%d, info npairs=%d, ugcomm_id=%d, cached=%d\n",
+                   win->user_local_root, win->max_local_user_nprocs, win->info_args.epochs_used,
+                   win->is_u_world, win->user_nprocs, info_npairs, winalloc_pkt->ugcomm_id,
+                   winalloc_pkt->is_ugcomm_cached);
 
     /* Receive window info */
     if (info_npairs > 0) {
@@ -117,12 +120,27 @@ static int create_ug_comm(int user_nprocs, int *user_ranks_in_world, int num_gho
     goto fn_exit;
 }
 
-static int create_communicators(CSPG_win_t * win)
+static int create_communicators(CSP_cwp_fnc_winalloc_pkt_t * winalloc_pkt, CSPG_win_t * win)
 {
     int mpi_errno = MPI_SUCCESS;
     int *cmd_params = NULL;
 
-    if (win->is_u_world) {
+    if (winalloc_pkt->is_ugcomm_cached) {
+        /* Reuse communicators created by a previous window on the same user
+         * group. User processes skip the parameters as well. */
+        win->ugcomm = CSPG_ugcomm_cache_find(win->user_local_root, winalloc_pkt->ugcomm_id);
+        if (win->ugcomm == NULL) {
+            CSP_msg_print(CSP_MSG_ERROR, " Cached ug communicators (root %d, id %d) not exist\n",
+                          win->user_local_root, winalloc_pkt->ugcomm_id);
+            mpi_errno = CSP_get_error_code(CSP_ERR_INTERN);
+            goto fn_fail;
+        }
+        win->ugcomm->ref_count++;
+        win->ug_comm = win->ugcomm->ug_comm;
+        win->local_ug_comm = win->ugcomm->local_ug_comm;
+        CSPG_DBG_PRINT(" Reuse cached ug communicators (id %d)\n", winalloc_pkt->ugcomm_id);
+    }
+    else if (win->is_u_world) {
         /* Fast path of communicator creation for window with user world communicator.
          *  local_ug_comm: including local USER and Ghost processes
          *  ug_comm: including all USER and Ghost processes
@@ -176,6 +194,9 @@ static int create_communicators(CSPG_win_t * win)
             CSPG_DBG_PRINT("created local_ug_comm, my rank %d/%d\n", ug_rank, ug_nprocs);
         }
 #endif
+
+        if (winalloc_pkt->ugcomm_id > 0)
+            CSPG_ugcomm_cache_store(winalloc_pkt->ugcomm_id, win);
     }
 
   fn_exit:
@@ -274,6 +295,37 @@ static int alloc_shared_window(MPI_Info user_info, MPI_Aint * size, CSPG_win_t *
     goto fn_exit;
 }
 
+/* Create an internal window including all User and Ghost processes.
+ * For dynamic window, the window exposes the segments of local users in the
+ * dynamic pool, and users address them by the ghost-side addresses. The
+ * remapped user buffers of MPI_Win_create are exposed in the same way. */
+static int create_ug_window(MPI_Aint size, MPI_Info user_info, CSPG_win_t * win,
+                            MPI_Win * ug_win_ptr)
+{
+    int mpi_errno = MPI_SUCCESS;
+
+    if (win->is_dynamic) {
+        CSP_CALLMPI(JUMP, PMPI_Win_create_dynamic(user_info, win->ug_comm, ug_win_ptr));
+        mpi_errno = CSPG_dyn_pool_attach(*ug_win_ptr);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+    else if (win->is_remapped) {
+        CSP_CALLMPI(JUMP, PMPI_Win_create_dynamic(user_info, win->ug_comm, ug_win_ptr));
+        mpi_errno = CSPG_win_remap_attach(win, *ug_win_ptr);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+    else {
+        CSP_CALLMPI(JUMP, PMPI_Win_create(win->base, size, 1, user_info,
+                                          win->ug_comm, ug_win_ptr));
+    }
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
 static int create_lock_windows(MPI_Aint size, MPI_Info user_info, CSPG_win_t * win)
 {
     int mpi_errno = MPI_SUCCESS;
@@ -283,8 +335,8 @@ static int create_lock_windows(MPI_Aint size, MPI_Info user_info, CSPG_win_t * w
     win->num_ug_wins = win->max_local_user_nprocs;
     win->ug_wins = CSP_calloc(win->num_ug_wins, sizeof(MPI_Win));
     for (i = 0; i < win->num_ug_wins; i++) {
-        CSP_CALLMPI(JUMP, PMPI_Win_create(win->base, size, 1, user_info,
-                                          win->ug_comm, &win->ug_wins[i]));
+        mpi_errno = create_ug_window(size, user_info, win, &win->ug_wins[i]);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
         CSPG_DBG_PRINT(" Created ug windows[%d] 0x%x\n", i, win->ug_wins[i]);
     }
@@ -316,7 +368,8 @@ static int win_allocate_impl(CSP_cwp_fnc_winalloc_pkt_t * winalloc_pkt)
      *  ug_comm: including all USER and Ghost processes
      *  local_ug_comm: including local USER and Ghost processes
      */
-    create_communicators(win);
+    mpi_errno = create_communicators(winalloc_pkt, win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(win->local_ug_comm, &local_ug_rank));
     CSP_CALLMPI(JUMP, PMPI_Comm_size(win->local_ug_comm, &local_ug_nprocs));
@@ -329,6 +382,12 @@ static int win_allocate_impl(CSP_cwp_fnc_winalloc_pkt_t * winalloc_pkt)
     mpi_errno = alloc_shared_window(user_info, &size, win);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
+    /* Map the remapped buffers of local users. */
+    if (win->is_remapped) {
+        mpi_errno = CSPG_win_remap_map(win);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
     /* Create ug windows including all User and Ghost processes.
      * Every User process has a window used for permission check and accessing Ghosts.
      * User processes in different nodes can share a window.
@@ -347,8 +406,8 @@ static int win_allocate_impl(CSP_cwp_fnc_winalloc_pkt_t * winalloc_pkt)
     if ((win->info_args.epochs_used & CSP_EPOCH_FENCE) ||
         (win->info_args.epochs_used & CSP_EPOCH_PSCW) ||
         (win->info_args.epochs_used == CSP_EPOCH_LOCK_ALL)) {
-        CSP_CALLMPI(JUMP, PMPI_Win_create(win->base, size, 1, user_info,
-                                          win->ug_comm, &win->global_win));
+        mpi_errno = create_ug_window(size, user_info, win, &win->global_win);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
         CSPG_DBG_PRINT(" Created global windows 0x%x\n", win->global_win);
     }
 
@@ -377,15 +436,8 @@ int CSPG_win_allocate_cwp_root_handler(CSP_cwp_pkt_t * pkt,
                                        int user_local_rank CSP_ATTRIBUTE((unused)))
 {
     int mpi_errno = MPI_SUCCESS;
-    MPI_Request ibcast_req = MPI_REQUEST_NULL;
     CSP_cwp_fnc_winalloc_pkt_t *winalloc_pkt = &pkt->u.fnc_winalloc;
 
-    /* broadcast to other local ghosts */
-    mpi_errno = CSPG_cwp_try_bcast(pkt, &ibcast_req);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-    CSP_CALLMPI(JUMP, PMPI_Wait(&ibcast_req, MPI_STATUS_IGNORE));
-
     mpi_errno = win_allocate_impl(winalloc_pkt);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
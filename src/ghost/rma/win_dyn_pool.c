@@ -0,0 +1,118 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspg.h"
+
+/* Shared memory pool for dynamic windows (see csp_dyn_pool.c on user side).
+ * Ghost does not own any segment, it only maps the segments of local users
+ * and attaches them to the internal windows of every dynamic window. */
+
+static CSPG_dyn_pool_t dyn_pool;
+
+int CSPG_dyn_pool_init(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int r_disp_unit = 0, i;
+    void *base = NULL;
+    MPI_Aint *addrs = NULL, *u_addrs = NULL;
+
+    if (CSP_ENV.dyn_pool_size == 0)
+        goto fn_exit;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_size(CSP_PROC.local_comm, &dyn_pool.local_nprocs));
+    CSP_CALLMPI(JUMP, PMPI_Win_allocate_shared(0, 1, MPI_INFO_NULL, CSP_PROC.local_comm,
+                                               &base, &dyn_pool.win));
+
+    dyn_pool.bases = CSP_calloc(dyn_pool.local_nprocs, sizeof(void *));
+    dyn_pool.sizes = CSP_calloc(dyn_pool.local_nprocs, sizeof(MPI_Aint));
+    addrs = CSP_calloc(dyn_pool.local_nprocs, sizeof(MPI_Aint));
+    u_addrs = CSP_calloc(dyn_pool.local_nprocs, sizeof(MPI_Aint));
+
+    for (i = 0; i < dyn_pool.local_nprocs; i++) {
+        CSP_CALLMPI(JUMP, PMPI_Win_shared_query(dyn_pool.win, i, &dyn_pool.sizes[i],
+                                                &r_disp_unit, &dyn_pool.bases[i]));
+        if (dyn_pool.sizes[i] > 0)
+            CSP_CALLMPI(JUMP, PMPI_Get_address(dyn_pool.bases[i], &addrs[i]));
+
+        CSPG_DBG_PRINT(" dyn_pool: segment[%d] %p, size %ld\n", i, dyn_pool.bases[i],
+                       dyn_pool.sizes[i]);
+    }
+
+    /* Send the address of every user segment to its owner. */
+    CSP_CALLMPI(JUMP, PMPI_Alltoall(addrs, 1, MPI_AINT, u_addrs, 1, MPI_AINT,
+                                    CSP_PROC.local_comm));
+
+  fn_exit:
+    if (addrs)
+        free(addrs);
+    if (u_addrs)
+        free(u_addrs);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int CSPG_dyn_pool_destroy(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+
+    if (CSP_ENV.dyn_pool_size == 0)
+        goto fn_exit;
+
+    if (dyn_pool.bases)
+        free(dyn_pool.bases);
+    if (dyn_pool.sizes)
+        free(dyn_pool.sizes);
+    dyn_pool.bases = NULL;
+    dyn_pool.sizes = NULL;
+
+    if (dyn_pool.win && dyn_pool.win != MPI_WIN_NULL)
+        CSP_CALLMPI(JUMP, PMPI_Win_free(&dyn_pool.win));
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Attach all local user segments to an internal dynamic window. */
+int CSPG_dyn_pool_attach(MPI_Win win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i;
+
+    for (i = 0; i < dyn_pool.local_nprocs; i++) {
+        if (dyn_pool.sizes[i] > 0)
+            CSP_CALLMPI(JUMP, PMPI_Win_attach(win, dyn_pool.bases[i], dyn_pool.sizes[i]));
+    }
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int CSPG_dyn_pool_detach(MPI_Win win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i;
+
+    for (i = 0; i < dyn_pool.local_nprocs; i++) {
+        if (dyn_pool.sizes[i] > 0)
+            CSP_CALLMPI(JUMP, PMPI_Win_detach(win, dyn_pool.bases[i]));
+    }
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
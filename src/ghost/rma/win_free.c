@@ -9,17 +9,19 @@
 #include "cspg.h"
 
 /* Common internal implementation of win_free handlers.*/
-static int win_free_impl(CSP_cwp_fnc_winfree_pkt_t * winfree_pkt)
+static int win_free_impl(CSP_cwp_pkt_t * pkt)
 {
     int mpi_errno = MPI_SUCCESS;
+    CSP_cwp_fnc_winfree_pkt_t *winfree_pkt = &pkt->u.fnc_winfree;
     CSPG_win_t *win = NULL;
     unsigned long csp_g_win_handle = 0UL;
+    MPI_Aint g_param = 0;
     int i;
 
-    /* Receive the handle of ghost win from local user root. */
-    CSP_CALLMPI(JUMP, PMPI_Recv(&csp_g_win_handle, 1, MPI_UNSIGNED_LONG,
-                                winfree_pkt->user_local_root, CSP_CWP_PARAM_TAG,
-                                CSP_PROC.local_comm, MPI_STATUS_IGNORE));
+    /* Get the handle of ghost win issued by local user root. */
+    mpi_errno = CSPG_cwp_get_g_param(pkt, &g_param, winfree_pkt->user_local_root);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    csp_g_win_handle = (unsigned long) g_param;
     CSPG_DBG_PRINT(" Received window handler 0x%lx\n", csp_g_win_handle);
 
     win = (CSPG_win_t *) csp_g_win_handle;
@@ -48,6 +50,14 @@ static int win_free_impl(CSP_cwp_fnc_winfree_pkt_t * winfree_pkt)
             CSPG_DBG_PRINT(" free ug windows\n");
             for (i = 0; i < win->num_ug_wins; i++) {
                 if (win->ug_wins[i]) {
+                    if (win->is_dynamic) {
+                        mpi_errno = CSPG_dyn_pool_detach(win->ug_wins[i]);
+                        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+                    }
+                    else if (win->is_remapped) {
+                        mpi_errno = CSPG_win_remap_detach(win, win->ug_wins[i]);
+                        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+                    }
                     CSP_CALLMPI(JUMP, PMPI_Win_free(&win->ug_wins[i]));
                 }
             }
@@ -55,6 +65,14 @@ static int win_free_impl(CSP_cwp_fnc_winfree_pkt_t * winfree_pkt)
 
         if (win->global_win) {
             CSPG_DBG_PRINT(" free global window\n");
+            if (win->is_dynamic) {
+                mpi_errno = CSPG_dyn_pool_detach(win->global_win);
+                CSP_CHKMPIFAIL_JUMP(mpi_errno);
+            }
+            else if (win->is_remapped) {
+                mpi_errno = CSPG_win_remap_detach(win, win->global_win);
+                CSP_CHKMPIFAIL_JUMP(mpi_errno);
+            }
             CSP_CALLMPI(JUMP, PMPI_Win_free(&win->global_win));
         }
 
@@ -63,12 +81,23 @@ static int win_free_impl(CSP_cwp_fnc_winfree_pkt_t * winfree_pkt)
             CSP_CALLMPI(JUMP, PMPI_Win_free(&win->local_ug_win));
         }
 
-        if (win->local_ug_comm && win->local_ug_comm != CSP_PROC.local_comm) {
+        if (win->is_remapped) {
+            mpi_errno = CSPG_win_remap_unmap(win);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        }
+
+        /* Release cached communicators, they are freed only by the last window
+         * using them. */
+        mpi_errno = CSPG_ugcomm_cache_release(win);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+        if (win->local_ug_comm && win->local_ug_comm != MPI_COMM_NULL
+            && win->local_ug_comm != CSP_PROC.local_comm) {
             CSPG_DBG_PRINT(" free shared communicator\n");
             CSP_CALLMPI(JUMP, PMPI_Comm_free(&win->local_ug_comm));
         }
 
-        if (win->ug_comm && win->ug_comm != CSP_PROC.wcomm) {
+        if (win->ug_comm && win->ug_comm != MPI_COMM_NULL && win->ug_comm != CSP_PROC.wcomm) {
             CSPG_DBG_PRINT(" free ug communicator\n");
             CSP_CALLMPI(JUMP, PMPI_Comm_free(&win->ug_comm));
         }
@@ -94,16 +123,8 @@ static int win_free_impl(CSP_cwp_fnc_winfree_pkt_t * winfree_pkt)
 int CSPG_win_free_cwp_root_handler(CSP_cwp_pkt_t * pkt, int user_local_rank CSP_ATTRIBUTE((unused)))
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_cwp_fnc_winfree_pkt_t *winfree_pkt = &pkt->u.fnc_winfree;
-    MPI_Request ibcast_req = MPI_REQUEST_NULL;
-
-    /* broadcast to other local ghosts */
-    mpi_errno = CSPG_cwp_try_bcast(pkt, &ibcast_req);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-    CSP_CALLMPI(JUMP, PMPI_Wait(&ibcast_req, MPI_STATUS_IGNORE));
 
-    mpi_errno = win_free_impl(winfree_pkt);
+    mpi_errno = win_free_impl(pkt);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
   fn_exit:
@@ -119,9 +140,8 @@ int CSPG_win_free_cwp_root_handler(CSP_cwp_pkt_t * pkt, int user_local_rank CSP_
 int CSPG_win_free_cwp_handler(CSP_cwp_pkt_t * pkt)
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_cwp_fnc_winfree_pkt_t *winfree_pkt = &pkt->u.fnc_winfree;
 
-    mpi_errno = win_free_impl(winfree_pkt);
+    mpi_errno = win_free_impl(pkt);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
   fn_exit:
@@ -0,0 +1,202 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "cspg.h"
+
+/* Remapped user buffers of MPI_Win_create (see csp_win_remap.c on user side).
+ * Ghost opens the memory file of every local user through /proc, maps it and
+ * attaches it to the internal dynamic windows. Ghost also attaches its own
+ * segment in the local shared window, which is used as the address of users
+ * with empty buffer (e.g., for granting lock). */
+
+#define CSPG_PROC_FD_PATH_LEN 64
+
+static int open_user_fd(MPI_Aint pid, MPI_Aint fd)
+{
+    char path[CSPG_PROC_FD_PATH_LEN];
+    snprintf(path, CSPG_PROC_FD_PATH_LEN, "/proc/%ld/fd/%ld", (long) pid, (long) fd);
+    return open(path, O_RDWR);
+}
+
+/* Probe whether I can open the memory file of every local user
+ * (collective call with local users). */
+int CSPG_win_remap_init(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int local_nprocs = 0, is_ok = 1, is_all_ok = 0, i, fd;
+    MPI_Aint probe[2];
+    MPI_Aint *probes = NULL;
+
+    if (!CSP_ENV.win_create_remap)
+        goto fn_exit;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_size(CSP_PROC.local_comm, &local_nprocs));
+    probes = CSP_calloc(local_nprocs * 2, sizeof(MPI_Aint));
+    probe[0] = (MPI_Aint) getpid();
+    probe[1] = -1;
+    CSP_CALLMPI(JUMP, PMPI_Allgather(probe, 2, MPI_AINT, probes, 2, MPI_AINT,
+                                     CSP_PROC.local_comm));
+
+    for (i = 0; i < local_nprocs; i++) {
+        if (probes[2 * i + 1] < 0)
+            continue;   /* ghost or user without memory file */
+
+        fd = open_user_fd(probes[2 * i], probes[2 * i + 1]);
+        if (fd < 0) {
+            CSP_msg_print(CSP_MSG_WARN, "cannot open memory file of local process %d (pid %ld), "
+                          "%s\n", i, (long) probes[2 * i], strerror(errno));
+            is_ok = 0;
+            break;
+        }
+        close(fd);
+    }
+
+    CSP_CALLMPI(JUMP, PMPI_Allreduce(&is_ok, &is_all_ok, 1, MPI_INT, MPI_MIN, CSP_PROC.wcomm));
+    CSPG_DBG_PRINT(" win_remap: probe %s\n", is_all_ok ? "succeeded" : "failed");
+
+  fn_exit:
+    if (probes)
+        free(probes);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Map the buffers of local users and send back their addresses
+ * (collective call on local_ug_comm). */
+int CSPG_win_remap_map(CSPG_win_t * win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int local_ug_nprocs = 0, i, fd;
+    MPI_Aint map_info[4] = { 0, -1, 0, 0 };
+    MPI_Aint *map_infos = NULL, *addrs = NULL, *u_addrs = NULL;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_size(win->local_ug_comm, &local_ug_nprocs));
+
+    /* [0]: pid, [1]: fd, [2]: size of mapped pages, [3]: offset of the buffer. */
+    map_infos = CSP_calloc(local_ug_nprocs * 4, sizeof(MPI_Aint));
+    CSP_CALLMPI(JUMP, PMPI_Allgather(map_info, 4, MPI_AINT, map_infos, 4, MPI_AINT,
+                                     win->local_ug_comm));
+
+    win->num_remaps = local_ug_nprocs;
+    win->remap_bases = CSP_calloc(local_ug_nprocs, sizeof(void *));
+    win->remap_sizes = CSP_calloc(local_ug_nprocs, sizeof(MPI_Aint));
+    addrs = CSP_calloc(local_ug_nprocs, sizeof(MPI_Aint));
+    u_addrs = CSP_calloc(local_ug_nprocs, sizeof(MPI_Aint));
+
+    for (i = 0; i < local_ug_nprocs; i++) {
+        void *map = MAP_FAILED;
+
+        /* Ghost itself or user with empty buffer. */
+        if (map_infos[4 * i + 2] == 0) {
+            addrs[i] = (MPI_Aint) win->base;
+            continue;
+        }
+
+        /* Do not return before the alltoall, otherwise users hang. */
+        fd = open_user_fd(map_infos[4 * i], map_infos[4 * i + 1]);
+        if (fd >= 0) {
+            map = mmap(NULL, map_infos[4 * i + 2], PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+        }
+        if (map == MAP_FAILED) {
+            CSP_msg_print(CSP_MSG_ERROR, "cannot map buffer of local process %d (pid %ld), %s\n",
+                          i, (long) map_infos[4 * i], strerror(errno));
+            mpi_errno = CSP_get_error_code(CSP_ERR_INTERN);
+            addrs[i] = (MPI_Aint) win->base;
+            continue;
+        }
+
+        win->remap_bases[i] = map;
+        win->remap_sizes[i] = map_infos[4 * i + 2];
+        addrs[i] = (MPI_Aint) map + map_infos[4 * i + 3];
+
+        CSPG_DBG_PRINT(" win_remap: buffer of %d mapped at %p, size %ld, offset %ld\n",
+                       i, map, win->remap_sizes[i], map_infos[4 * i + 3]);
+    }
+
+    CSP_CALLMPI(JUMP, PMPI_Alltoall(addrs, 1, MPI_AINT, u_addrs, 1, MPI_AINT,
+                                    win->local_ug_comm));
+
+  fn_exit:
+    if (map_infos)
+        free(map_infos);
+    if (addrs)
+        free(addrs);
+    if (u_addrs)
+        free(u_addrs);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int CSPG_win_remap_unmap(CSPG_win_t * win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i;
+
+    for (i = 0; i < win->num_remaps; i++) {
+        if (win->remap_bases[i])
+            munmap(win->remap_bases[i], win->remap_sizes[i]);
+    }
+
+    if (win->remap_bases)
+        free(win->remap_bases);
+    if (win->remap_sizes)
+        free(win->remap_sizes);
+    win->remap_bases = NULL;
+    win->remap_sizes = NULL;
+    win->num_remaps = 0;
+
+    return mpi_errno;
+}
+
+/* Attach my segment and the buffers of local users to an internal dynamic
+ * window. */
+int CSPG_win_remap_attach(CSPG_win_t * win, MPI_Win ug_win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i;
+
+    CSP_CALLMPI(JUMP, PMPI_Win_attach(ug_win, win->base, CSP_GP_SHARED_SG_SIZE));
+    for (i = 0; i < win->num_remaps; i++) {
+        if (win->remap_bases[i])
+            CSP_CALLMPI(JUMP, PMPI_Win_attach(ug_win, win->remap_bases[i], win->remap_sizes[i]));
+    }
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int CSPG_win_remap_detach(CSPG_win_t * win, MPI_Win ug_win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i;
+
+    CSP_CALLMPI(JUMP, PMPI_Win_detach(ug_win, win->base));
+    for (i = 0; i < win->num_remaps; i++) {
+        if (win->remap_bases[i])
+            CSP_CALLMPI(JUMP, PMPI_Win_detach(ug_win, win->remap_bases[i]));
+    }
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
@@ -0,0 +1,74 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspg.h"
+
+/* Cache of ug communicators shared by the windows allocated on the same group
+ * of user processes (see csp_ugcomm_cache.c on user side). The decision of
+ * reuse is made by user processes and passed in the win_allocate command, thus
+ * ghost only needs to find the entry by the local user root and the id. */
+
+static CSPG_ugcomm_t *ugcomm_list = NULL;
+
+CSPG_ugcomm_t *CSPG_ugcomm_cache_find(int user_local_root, int id)
+{
+    CSPG_ugcomm_t *ugcomm = NULL;
+
+    LL_FOREACH(ugcomm_list, ugcomm) {
+        if (ugcomm->user_local_root == user_local_root && ugcomm->id == id)
+            break;
+    }
+    return ugcomm;
+}
+
+/* Store the communicators of a newly created window. */
+void CSPG_ugcomm_cache_store(int id, CSPG_win_t * win)
+{
+    CSPG_ugcomm_t *ugcomm = CSP_calloc(1, sizeof(CSPG_ugcomm_t));
+
+    ugcomm->user_local_root = win->user_local_root;
+    ugcomm->id = id;
+    ugcomm->ref_count = 1;
+    ugcomm->ug_comm = win->ug_comm;
+    ugcomm->local_ug_comm = win->local_ug_comm;
+    LL_PREPEND(ugcomm_list, ugcomm);
+
+    win->ugcomm = ugcomm;
+}
+
+/* Release the cached communicators used by the window, and free them if it
+ * is the last window. */
+int CSPG_ugcomm_cache_release(CSPG_win_t * win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPG_ugcomm_t *ugcomm = win->ugcomm;
+
+    if (ugcomm == NULL)
+        return mpi_errno;
+
+    win->ug_comm = MPI_COMM_NULL;
+    win->local_ug_comm = MPI_COMM_NULL;
+    win->ugcomm = NULL;
+
+    ugcomm->ref_count--;
+    if (ugcomm->ref_count > 0)
+        return mpi_errno;
+
+    CSPG_DBG_PRINT(" free cached ug communicators (root %d, id %d)\n",
+                   ugcomm->user_local_root, ugcomm->id);
+    LL_DELETE(ugcomm_list, ugcomm);
+    CSP_CALLMPI(JUMP, PMPI_Comm_free(&ugcomm->local_ug_comm));
+    CSP_CALLMPI(JUMP, PMPI_Comm_free(&ugcomm->ug_comm));
+
+  fn_exit:
+    free(ugcomm);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
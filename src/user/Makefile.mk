@@ -23,3 +23,4 @@ include $(top_srcdir)/src/user/topo/Makefile.mk
 include $(top_srcdir)/src/user/spawn/Makefile.mk
 include $(top_srcdir)/src/user/pt2pt/Makefile.mk
 include $(top_srcdir)/src/user/attr/Makefile.mk
+include $(top_srcdir)/src/user/datatype/Makefile.mk
@@ -3,7 +3,8 @@
 #
 
 
-libcasper_la_SOURCES += src/user/common/mlock.c        \
+libcasper_la_SOURCES += src/user/common/cwp.c          \
+                        src/user/common/mlock.c        \
                         src/user/common/errhan.c       \
                         src/user/common/comm_errhan.c  \
                         src/user/common/win_errhan.c   \
@@ -131,10 +131,8 @@ static int ugcomm_issue_ghost_cmd(CSPU_comm_t * ug_comm)
     int mpi_errno = MPI_SUCCESS;
     CSP_cwp_pkt_t pkt;
     CSP_cwp_fnc_ugcomm_free_pkt_t *ugcomm_free_pkt = &pkt.u.fnc_ugcomm_free;
-    MPI_Request *reqs = NULL;
-    int i, local_rank = 0;
+    int local_rank = 0;
 
-    reqs = CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Request));
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &local_rank));
 
     /* Ensure all user roots have arrived before start lock. */
@@ -144,25 +142,15 @@ static int ugcomm_issue_ghost_cmd(CSPU_comm_t * ug_comm)
     mpi_errno = CSPU_mlock_acquire(ug_comm->user_root_comm);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    /* Send command to root ghost. */
+    /* Issue command to local ghosts. */
     CSP_cwp_init_pkt(CSP_CWP_FNC_UGCOMM_FREE, &pkt);
     ugcomm_free_pkt->user_local_root = local_rank;
 
-    mpi_errno = CSPU_cwp_issue(&pkt);
+    /* Send the handle of ug_comm to each ghost with the command. */
+    mpi_errno = CSPU_cwp_issue_g_params(&pkt, ug_comm->g_ugcomm_handles);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    /* Send the handle of ug_comm to each ghost. */
-    for (i = 0; i < CSP_ENV.num_g; i++) {
-        CSP_CALLMPI(JUMP, PMPI_Isend(&ug_comm->g_ugcomm_handles[i], 1, MPI_AINT,
-                                     CSP_PROC.user.g_lranks[i], CSP_CWP_PARAM_TAG,
-                                     CSP_PROC.local_comm, &reqs[i]));
-    }
-
-    CSP_CALLMPI(JUMP, PMPI_Waitall(CSP_ENV.num_g, reqs, MPI_STATUS_IGNORE));
-
   fn_exit:
-    if (reqs)
-        free(reqs);
     return mpi_errno;
 
   fn_fail:
@@ -335,7 +323,7 @@ static int ugcomm_create_comm(CSPU_comm_t * ug_newcomm)
 
         CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &lrank));
 
-        /* First send start packet to root ghost. */
+        /* First issue start packet to local ghosts. */
         CSP_cwp_init_pkt(CSP_CWP_FNC_UGCOMM_CREATE, &pkt);
         ugcomm_create_pkt->type = ug_newcomm->type;
         ugcomm_create_pkt->user_nproc = user_newnproc;
@@ -531,6 +519,9 @@ int CSPU_ugcomm_free(MPI_Comm comm)
 
     CSPU_fetch_ug_comm_from_cache(comm, &ug_comm);
     if (ug_comm) {
+        /* Ghost may still be sending eager messages whose requests were completed. */
+        if (ug_comm->type >= CSP_COMM_ASYNC_DUP)
+            CSPU_offload_wait_eager();
 
         /* NOTE: reference ugcomm does not have ghost-included structure. */
         if (ug_comm->type > CSP_COMM_REFER) {
@@ -581,8 +572,10 @@ int CSPU_ugcomm_create(MPI_Comm comm, MPI_Info info, MPI_Comm user_newcomm)
         ug_newcomm->type = CSP_COMM_SHMBUF;
     }
 
-    /* Only enable async when user only uses predefined datatype. */
-    if (ug_newcomm->info_args.datatype_used == CSP_COMM_INFO_DT_PREDEFINED) {
+    /* Enable async when user specifies the used datatypes. Derived datatypes
+     * are committed on the bound ghost at first offloading. */
+    if (ug_newcomm->info_args.datatype_used == CSP_COMM_INFO_DT_PREDEFINED ||
+        ug_newcomm->info_args.datatype_used == CSP_COMM_INFO_DT_DERIVED) {
         /* Enable async progress if ignore status or no ANY_SRC + specific TAG. */
         if (!(ug_newcomm->info_args.wildcard_used & CSP_COMM_INFO_WD_ANYSRC) ||
             (ug_newcomm->info_args.wildcard_used & CSP_COMM_INFO_WD_ANYTAG_NOTAG) ||
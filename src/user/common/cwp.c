@@ -0,0 +1,196 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include "cspu.h"
+
+/* Command wire protocol (CWP) component on user processes */
+
+CSPU_cwp_channel_t CSPU_cwp_ch = {
+    MPI_WIN_NULL, NULL, -1, NULL
+};
+
+/* Attach to the shared command ring allocated by the first local ghost.
+ * Collective call with local ghosts (see CSPG_cwp_init). */
+int CSPU_cwp_init(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    void *baseptr = NULL;
+    int r_disp_unit;
+    MPI_Aint r_size;
+
+    CSPU_THREAD_INIT_OBJ_CS(&CSPU_cwp_ch);
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &CSPU_cwp_ch.local_rank));
+    CSP_CALLMPI(JUMP, PMPI_Win_allocate_shared(0, sizeof(char), MPI_INFO_NULL,
+                                               CSP_PROC.local_comm, &baseptr,
+                                               &CSPU_cwp_ch.shm_win));
+    CSP_CALLMPI(JUMP, PMPI_Win_shared_query(CSPU_cwp_ch.shm_win, 0 /* first local ghost */ ,
+                                            &r_size, &r_disp_unit, &baseptr));
+    CSPU_cwp_ch.ring = (CSP_cwp_ring_t *) baseptr;
+
+    /* Ensure no one issues command before the ghost initialized the ring. */
+    CSP_CALLMPI(JUMP, PMPI_Barrier(CSP_PROC.local_comm));
+
+    CSPU_CWP_DBG_PRINT(" attached command ring %p\n", CSPU_cwp_ch.ring);
+
+  fn_exit:
+    return mpi_errno;
+  fn_fail:
+    /* Free global objects in main function. */
+    goto fn_exit;
+}
+
+/* Free the shared command ring.
+ * This must be called after sent cwp finalize to ghost.  */
+int CSPU_cwp_destroy(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_cwp_deferred_cmd_t *cmd = NULL, *tmp = NULL;
+
+    /* Every deferred command should have been written by finalize. */
+    LL_FOREACH_SAFE(CSPU_cwp_ch.deferred_q, cmd, tmp) {
+        LL_DELETE(CSPU_cwp_ch.deferred_q, cmd);
+        free(cmd);
+    }
+    CSPU_THREAD_DESTROY_OBJ_CS(&CSPU_cwp_ch);
+
+    if (CSPU_cwp_ch.shm_win && CSPU_cwp_ch.shm_win != MPI_WIN_NULL) {
+        CSP_CALLMPI(JUMP, PMPI_Win_free(&CSPU_cwp_ch.shm_win));
+        CSPU_cwp_ch.shm_win = MPI_WIN_NULL;
+    }
+    CSPU_cwp_ch.ring = NULL;
+
+  fn_exit:
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Poke MPI progress and give up the processor while the ring is full.
+ * The ghosts drain the ring by themselves, but the parameters of earlier
+ * commands may still be sent from this process. */
+static int cwp_wait_ring(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int flag = 0;
+
+    CSP_CALLMPI(RETURN, PMPI_Iprobe(MPI_ANY_SOURCE, CSP_CWP_PARAM_TAG, CSP_PROC.local_comm,
+                                    &flag, MPI_STATUS_IGNORE));
+    sched_yield();
+    return mpi_errno;
+}
+
+/* Write the deferred commands into the ring in order until the ring is full.
+ * Caller must hold the channel critical section. */
+static void cwp_flush_deferred(void)
+{
+    CSPU_cwp_deferred_cmd_t *cmd = NULL;
+
+    while (CSPU_cwp_ch.deferred_q) {
+        cmd = CSPU_cwp_ch.deferred_q;
+        if (!CSP_cwp_ring_try_enqueue(CSPU_cwp_ch.ring, &cmd->pkt, NULL, 0,
+                                      CSPU_cwp_ch.local_rank))
+            break;
+
+        CSPU_CWP_DBG_PRINT(" issued deferred CMD %d to local ghosts\n", cmd->pkt.cmd_type);
+        LL_DELETE(CSPU_cwp_ch.deferred_q, cmd);
+        free(cmd);
+    }
+}
+
+/* Try to write the command into the ring. Deferred commands are always
+ * written before any later command. Caller must hold the channel critical
+ * section. */
+static int cwp_try_issue(CSP_cwp_pkt_t * pkt, MPI_Aint * g_params, int ng_params)
+{
+    cwp_flush_deferred();
+    if (CSPU_cwp_ch.deferred_q)
+        return 0;
+    return CSP_cwp_ring_try_enqueue(CSPU_cwp_ch.ring, pkt, g_params, ng_params,
+                                    CSPU_cwp_ch.local_rank);
+}
+
+static int cwp_issue_impl(CSP_cwp_pkt_t * pkt, MPI_Aint * g_params, int ng_params)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    CSPU_CWP_DBG_PRINT(" issue CMD %d to local ghosts\n", pkt->cmd_type);
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_cwp_ch);
+    while (!cwp_try_issue(pkt, g_params, ng_params)) {
+        /* Let other threads issue commands while waiting. */
+        CSPU_THREAD_EXIT_OBJ_CS(&CSPU_cwp_ch);
+        mpi_errno = cwp_wait_ring();
+        CSPU_THREAD_ENTER_OBJ_CS(&CSPU_cwp_ch);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
+  fn_exit:
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_cwp_ch);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int CSPU_cwp_issue(CSP_cwp_pkt_t * pkt)
+{
+    return cwp_issue_impl(pkt, NULL, 0);
+}
+
+int CSPU_cwp_issue_g_params(CSP_cwp_pkt_t * pkt, MPI_Aint * g_params)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i;
+    MPI_Request *reqs = NULL;
+
+    if (CSP_ENV.num_g <= CSP_CWP_RING_MAX_G_PARAMS)
+        return cwp_issue_impl(pkt, g_params, CSP_ENV.num_g);
+
+    mpi_errno = cwp_issue_impl(pkt, NULL, 0);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    reqs = (MPI_Request *) CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Request));
+
+    for (i = 0; i < CSP_ENV.num_g; i++) {
+        CSP_CALLMPI(JUMP, PMPI_Isend(&g_params[i], 1, MPI_AINT, CSP_PROC.user.g_lranks[i],
+                                     CSP_CWP_PARAM_TAG, CSP_PROC.local_comm, &reqs[i]));
+    }
+    CSP_CALLMPI(JUMP, PMPI_Waitall(CSP_ENV.num_g, reqs, MPI_STATUS_IGNORE));
+
+  fn_exit:
+    if (reqs)
+        free(reqs);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int CSPU_cwp_issue_async(CSP_cwp_pkt_t * pkt)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_cwp_deferred_cmd_t *cmd = NULL;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    CSPU_CWP_DBG_PRINT(" issue async CMD %d to local ghosts\n", pkt->cmd_type);
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_cwp_ch);
+    if (!cwp_try_issue(pkt, NULL, 0)) {
+        cmd = CSP_calloc(1, sizeof(CSPU_cwp_deferred_cmd_t));
+        memcpy(&cmd->pkt, pkt, sizeof(CSP_cwp_pkt_t));
+        LL_APPEND(CSPU_cwp_ch.deferred_q, cmd);
+        CSPU_CWP_DBG_PRINT(" deferred CMD %d, ring is full\n", pkt->cmd_type);
+    }
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_cwp_ch);
+
+    return mpi_errno;
+}
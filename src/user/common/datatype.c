@@ -12,6 +12,241 @@
 CSPU_datatype_db_t CSPU_datatype_db;
 static MPI_Datatype local_predefined_table[CSP_DATATYPE_MAX] = { 0 };
 
+/* Buffer of serialized derived datatype (see csp_datatype.h). */
+typedef struct datatype_serial_buf {
+    MPI_Aint *elems;
+    int nelems;
+    int capacity;
+} datatype_serial_buf_t;
+
+static void datatype_serial_buf_append(datatype_serial_buf_t * buf, const MPI_Aint * vals, int n)
+{
+    if (buf->nelems + n > buf->capacity) {
+        buf->capacity = CSP_MAX(buf->capacity * 2, buf->nelems + n);
+        buf->elems = realloc(buf->elems, buf->capacity * sizeof(MPI_Aint));
+        CSP_ASSERT(buf->elems != NULL);
+    }
+    memcpy(&buf->elems[buf->nelems], vals, n * sizeof(MPI_Aint));
+    buf->nelems += n;
+}
+
+static int datatype_get_predefined_id(MPI_Datatype datatype)
+{
+    int dt;
+    for (dt = 0; dt < CSP_DATATYPE_MAX; dt++) {
+        if (local_predefined_table[dt] == datatype)
+            return dt;
+    }
+    return -1;
+}
+
+static int datatype_check_combiner(int combiner)
+{
+    switch (combiner) {
+    case MPI_COMBINER_DUP:
+    case MPI_COMBINER_CONTIGUOUS:
+    case MPI_COMBINER_VECTOR:
+    case MPI_COMBINER_HVECTOR:
+    case MPI_COMBINER_INDEXED:
+    case MPI_COMBINER_HINDEXED:
+    case MPI_COMBINER_INDEXED_BLOCK:
+    case MPI_COMBINER_HINDEXED_BLOCK:
+    case MPI_COMBINER_STRUCT:
+    case MPI_COMBINER_SUBARRAY:
+    case MPI_COMBINER_DARRAY:
+    case MPI_COMBINER_RESIZED:
+        return 1;
+    default:
+        /* Fortran parameterized and deprecated integer combiners. */
+        return 0;
+    }
+}
+
+/* Serialize datatype and all inner datatypes recursively (local call). */
+static int datatype_serialize(MPI_Datatype datatype, datatype_serial_buf_t * buf)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int nints = 0, naddrs = 0, ndtypes = 0, combiner = 0, i;
+    int *ints = NULL;
+    MPI_Aint *addrs = NULL, hdr[CSP_DATATYPE_SERIAL_HDR_LEN];
+    MPI_Datatype *dtypes = NULL;
+
+    CSP_CALLMPI(JUMP, PMPI_Type_get_envelope(datatype, &nints, &naddrs, &ndtypes, &combiner));
+
+    if (combiner == MPI_COMBINER_NAMED) {
+        MPI_Aint id = (MPI_Aint) datatype_get_predefined_id(datatype);
+        if (id < 0) {
+            CSP_msg_print(CSP_MSG_WARN, "Have unknown predefined datatype 0x%lx "
+                          "in pt2pt message offloading\n", (unsigned long) datatype);
+            mpi_errno = MPI_ERR_TYPE;
+            goto fn_fail;
+        }
+        datatype_serial_buf_append(buf, &id, 1);
+        goto fn_exit;
+    }
+
+    if (!datatype_check_combiner(combiner)) {
+        CSP_msg_print(CSP_MSG_WARN, "Have not supported datatype 0x%lx (combiner %d) "
+                      "in pt2pt message offloading\n", (unsigned long) datatype, combiner);
+        mpi_errno = MPI_ERR_TYPE;
+        goto fn_fail;
+    }
+
+    ints = CSP_calloc(nints + 1, sizeof(int));
+    addrs = CSP_calloc(naddrs + 1, sizeof(MPI_Aint));
+    dtypes = CSP_calloc(ndtypes + 1, sizeof(MPI_Datatype));
+    CSP_CALLMPI(JUMP, PMPI_Type_get_contents(datatype, nints, naddrs, ndtypes,
+                                             ints, addrs, dtypes));
+
+    hdr[0] = CSP_DATATYPE_SERIAL_DERIVED;
+    hdr[1] = combiner;
+    hdr[2] = nints;
+    hdr[3] = naddrs;
+    hdr[4] = ndtypes;
+    datatype_serial_buf_append(buf, hdr, CSP_DATATYPE_SERIAL_HDR_LEN);
+    for (i = 0; i < nints; i++) {
+        MPI_Aint val = ints[i];
+        datatype_serial_buf_append(buf, &val, 1);
+    }
+    datatype_serial_buf_append(buf, addrs, naddrs);
+
+    for (i = 0; i < ndtypes; i++) {
+        mpi_errno = datatype_serialize(dtypes[i], buf);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
+  fn_exit:
+    /* Derived datatypes returned by get_contents are new objects. */
+    for (i = 0; dtypes && i < ndtypes; i++) {
+        int inints, inaddrs, indtypes, icombiner;
+        CSP_CALLMPI_EXIT(PMPI_Type_get_envelope(dtypes[i], &inints, &inaddrs, &indtypes,
+                                                &icombiner));
+        if (icombiner != MPI_COMBINER_NAMED)
+            CSP_CALLMPI_EXIT(PMPI_Type_free(&dtypes[i]));
+    }
+    if (ints)
+        free(ints);
+    if (addrs)
+        free(addrs);
+    if (dtypes)
+        free(dtypes);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Free a derived datatype on the ghost, once the user has freed it and no
+ * offloaded call using it is outstanding, thus the ghost has completed every
+ * call using it (local call). */
+void CSPU_datatype_ddt_free(CSPU_datatype_ddt_t * ddt)
+{
+    CSP_cwp_pkt_t pkt;
+    CSP_cwp_datatype_free_pkt_t *free_pkt = &pkt.u.fnc_datatype_free;
+
+    CSP_DBG_ASSERT(ddt->ref_count == 0 && ddt->is_released);
+
+    CSP_cwp_init_pkt(CSP_CWP_FNC_DATATYPE_FREE, &pkt);
+    free_pkt->g_lrank = ddt->g_lrank;
+    free_pkt->g_handle = ddt->g_handle;
+
+    /* The ghost has no response, thus it never waits for a full ring
+     * (deferred instead) and never fails. */
+    CSPU_cwp_issue_async(&pkt);
+
+    CSP_DDT_DBG_PRINT("DATATYPE: free g_handle 0x%x on ghost %d\n", ddt->g_handle, ddt->g_lrank);
+    free(ddt);
+}
+
+/* Commit a derived datatype on the ghost process and cache the handle
+ * (blocking call with the ghost). */
+int CSPU_datatype_regist_ddt(MPI_Datatype datatype, int ghost_lrank, MPI_Datatype * g_handle_ptr)
+{
+    int mpi_errno = MPI_SUCCESS;
+    datatype_serial_buf_t buf;
+    CSP_cwp_pkt_t pkt;
+    CSP_cwp_datatype_regist_pkt_t *regist_pkt = &pkt.u.fnc_datatype_regist;
+    MPI_Datatype g_handle = MPI_DATATYPE_NULL;
+    CSPU_datatype_g_hash_record_t *record = NULL;
+    int lrank = 0;
+
+    memset(&buf, 0, sizeof(buf));
+
+    mpi_errno = datatype_serialize(datatype, &buf);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &lrank));
+
+    /* Issue command to local ghosts, then send the datatype to the ghost committing it. */
+    CSP_cwp_init_pkt(CSP_CWP_FNC_DATATYPE_REGIST, &pkt);
+    regist_pkt->user_local_rank = lrank;
+    regist_pkt->g_lrank = ghost_lrank;
+    regist_pkt->nelems = buf.nelems;
+
+    mpi_errno = CSPU_cwp_issue(&pkt);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    CSP_CALLMPI(JUMP, PMPI_Send(buf.elems, buf.nelems, MPI_AINT, ghost_lrank,
+                                CSP_CWP_PARAM_TAG, CSP_PROC.local_comm));
+
+    mpi_errno = CSPU_cwp_recv_params(&g_handle, sizeof(MPI_Datatype), ghost_lrank);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    if (g_handle == MPI_DATATYPE_NULL) {
+        CSP_msg_print(CSP_MSG_WARN, "Failed to commit datatype 0x%lx on ghost %d "
+                      "in pt2pt message offloading\n", (unsigned long) datatype, ghost_lrank);
+        mpi_errno = MPI_ERR_TYPE;
+        goto fn_fail;
+    }
+
+    CSPU_datatype_g_hash_add(&CSPU_datatype_db.g_derived_hashs[ghost_lrank], datatype, g_handle);
+    record = CSPU_datatype_g_hash_find(CSPU_datatype_db.g_derived_hashs[ghost_lrank], datatype);
+    record->ddt = CSP_calloc(1, sizeof(CSPU_datatype_ddt_t));
+    record->ddt->g_lrank = ghost_lrank;
+    record->ddt->g_handle = g_handle;
+    (*g_handle_ptr) = g_handle;
+
+    CSP_DDT_DBG_PRINT("DATATYPE: regist ddt 0x%x on ghost %d, g_handle 0x%x, nelems %d\n",
+                      datatype, ghost_lrank, g_handle, buf.nelems);
+
+  fn_exit:
+    if (buf.elems)
+        free(buf.elems);
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Invalidate the cached ghost handles of a derived datatype freed by user
+ * (local call). The handle can be reused by a new datatype after free. The
+ * ghost copy is freed when the last offloaded call using it is completed. */
+int CSPU_datatype_free_ddt(MPI_Datatype datatype)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i;
+
+    if (CSPU_datatype_db.g_derived_hashs == NULL)
+        return mpi_errno;
+
+    for (i = 0; i < CSP_ENV.num_g; i++) {
+        CSPU_datatype_g_hash_record_t *record = NULL;
+        CSPU_datatype_ddt_t *ddt = NULL;
+
+        record = CSPU_datatype_g_hash_find(CSPU_datatype_db.g_derived_hashs[i], datatype);
+        if (record == NULL)
+            continue;
+
+        ddt = record->ddt;
+        CSPU_datatype_g_hash_remove(&CSPU_datatype_db.g_derived_hashs[i], datatype);
+
+        ddt->is_released = 1;
+        if (ddt->ref_count == 0)
+            CSPU_datatype_ddt_free(ddt);
+    }
+
+    return mpi_errno;
+}
+
 /* Destroy datatype database.
  * This must be called after sent cwp finalize to ghost.  */
 int CSPU_datatype_destroy(void)
@@ -31,6 +266,20 @@ int CSPU_datatype_destroy(void)
         CSPU_datatype_db.g_predefined_hashs = NULL;
     }
 
+    /* Registered derived datatypes are freed by ghosts at finalize. */
+    if (CSPU_datatype_db.g_derived_hashs) {
+        for (i = 0; i < CSP_ENV.num_g; i++) {
+            CSPU_datatype_g_hash_record_t *record = NULL, *tmp = NULL;
+            HASH_ITER(hh, CSPU_datatype_db.g_derived_hashs[i].record, record, tmp) {
+                HASH_DEL(CSPU_datatype_db.g_derived_hashs[i].record, record);
+                free(record->ddt);
+                free(record);
+            }
+        }
+        free(CSPU_datatype_db.g_derived_hashs);
+        CSPU_datatype_db.g_derived_hashs = NULL;
+    }
+
     return mpi_errno;
 }
 
@@ -45,6 +294,7 @@ int CSPU_datatype_init(void)
     CSP_datatype_fill_predefined_table(local_predefined_table);
 
     CSPU_datatype_db.g_predefined_hashs = CSP_calloc(CSP_ENV.num_g, sizeof(CSPU_datatype_g_hash_t));
+    CSPU_datatype_db.g_derived_hashs = CSP_calloc(CSP_ENV.num_g, sizeof(CSPU_datatype_g_hash_t));
 
     g_predefined_tables = CSP_calloc(CSP_ENV.num_g, CSP_DATATYPE_MAX * sizeof(MPI_Datatype));
     memset(g_predefined_tables, 0, CSP_ENV.num_g * CSP_DATATYPE_MAX * sizeof(MPI_Datatype));
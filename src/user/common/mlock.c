@@ -15,7 +15,7 @@
     fprintf(stdout, "[CSPU-MLOCK][%d]"str, CSP_PROC.wrank, ## __VA_ARGS__); \
     fflush(stdout); \
     } while (0)
-static const char *cwp_lock_status_name[CSP_MLOCK_STATUS_MAX] = {
+static const char *mlock_status_name[CSP_MLOCK_STATUS_MAX] = {
     "unset",
     "suspended_l",
     "suspended_h",
@@ -41,69 +41,127 @@ typedef struct CSPU_mlock_seqno_gen {
 static CSPU_mlock_seqno_gen_t mlock_seqno_gen;
 #endif
 
-static inline int mlock_sync_status(CSP_mlock_gid_t group_id, CSP_mlock_status_t * lock_status)
-{
-    int mpi_errno = MPI_SUCCESS;
-    CSP_cwp_pkt_t pkt;
-    CSP_cwp_mlock_status_sync_pkt_t *locksync_pkt = &pkt.u.lock_status_sync;
-    char gidstr[CSP_MLOCK_GID_MAXLEN] CSP_ATTRIBUTE((unused));
-
-    CSP_CALLMPI(RETURN, PMPI_Recv((char *) &pkt, sizeof(CSP_cwp_pkt_t),
-                                  MPI_CHAR, CSP_PROC.user.g_lranks[0],
-                                  CSP_CWP_MLOCK_SYNC_TAG(group_id), CSP_PROC.local_comm,
-                                  MPI_STATUS_IGNORE));
-
-    CSPU_MLOCK_DBG_GID_TO_STR(group_id, gidstr);
-    CSPU_MLOCK_DBG_PRINT(" \t sync LOCK STAT (%d -> %d[%s], gid %s)\n", (*lock_status),
-                         locksync_pkt->status, cwp_lock_status_name[locksync_pkt->status], gidstr);
+static struct {
+    MPI_Win shm_win;
+    CSP_mlock_shm_t *shm;       /* Allocated on the first local ghost. */
+} mlock = { MPI_WIN_NULL, NULL };
 
-    (*lock_status) = locksync_pkt->status;
-    return mpi_errno;
+/* Get current status of my lock request from the shared lock object.
+ * Must be called in the spinlock. */
+static inline CSP_mlock_status_t mlock_get_status(CSP_mlock_gid_t group_id)
+{
+    int i;
+
+    if (mlock.shm->is_granted && CSP_mlock_gid_compare(mlock.shm->granted_gid, group_id) == 0)
+        return CSP_MLOCK_STATUS_ACQUIRED;
+
+    for (i = 0; i < mlock.shm->max_nreqs; i++) {
+        if (mlock.shm->reqs[i].used &&
+            CSP_mlock_gid_compare(mlock.shm->reqs[i].group_id, group_id) == 0) {
+            /* Always granted if any request is suspended. */
+            CSP_DBG_ASSERT(mlock.shm->is_granted);
+            return (CSP_mlock_gid_compare(mlock.shm->granted_gid, group_id) > 0) ?
+                CSP_MLOCK_STATUS_SUSPENDED_H : CSP_MLOCK_STATUS_SUSPENDED_L;
+        }
+    }
+    return CSP_MLOCK_STATUS_UNSET;
 }
 
-static inline int mlock_issue_acquire_req(CSP_mlock_gid_t group_id)
+/* Wait till the status of my lock request changes.
+ * The status of a suspended request changes only when the lock is granted to
+ * another request (high priority is degraded to low) or to me. */
+static inline void mlock_sync_status(CSP_mlock_gid_t group_id, CSP_mlock_status_t * lock_status)
 {
-    CSP_cwp_pkt_t pkt;
-    CSP_cwp_mlock_acquire_pkt_t *lockacq_pkt = &pkt.u.lock_acquire;
+    CSP_mlock_status_t new_status = CSP_MLOCK_STATUS_UNSET;
     char gidstr[CSP_MLOCK_GID_MAXLEN] CSP_ATTRIBUTE((unused));
 
-    pkt.cmd_type = CSP_MLOCK_ACQUIRE;
-    lockacq_pkt->group_id = group_id;
+    do {
+        CSP_mlock_shm_enter(mlock.shm);
+        new_status = mlock_get_status(group_id);
+        CSP_mlock_shm_exit(mlock.shm);
+
+        if (new_status == (*lock_status))
+            OPA_busy_wait();
+    } while (new_status == (*lock_status));
 
     CSPU_MLOCK_DBG_GID_TO_STR(group_id, gidstr);
-    CSPU_MLOCK_DBG_PRINT(" \t send LOCK CMD %d (acquire, gid %s)\n", pkt.cmd_type, gidstr);
+    CSPU_MLOCK_DBG_PRINT(" \t sync LOCK STAT (%d -> %d[%s], gid %s)\n", (*lock_status),
+                         new_status, mlock_status_name[new_status], gidstr);
 
-    return CSPU_cwp_issue(&pkt);
+    (*lock_status) = new_status;
 }
 
-static inline int mlock_issue_discard_req(CSP_mlock_gid_t group_id)
+/* Acquire the lock, or suspend the request if it is already granted. */
+static inline int mlock_acquire_req(CSP_mlock_gid_t group_id, CSP_mlock_status_t * lock_status)
 {
-    CSP_cwp_pkt_t pkt;
-    CSP_cwp_mlock_discard_pkt_t *lockdcd_pkt = &pkt.u.lock_discard;
+    int mpi_errno = MPI_SUCCESS;
+    int i;
     char gidstr[CSP_MLOCK_GID_MAXLEN] CSP_ATTRIBUTE((unused));
 
-    pkt.cmd_type = CSP_MLOCK_DISCARD;
-    lockdcd_pkt->group_id = group_id;
+    CSP_mlock_shm_enter(mlock.shm);
+
+    if (!mlock.shm->is_granted) {
+        mlock.shm->is_granted = 1;
+        mlock.shm->granted_gid = group_id;
+    }
+    else {
+        for (i = 0; i < mlock.shm->max_nreqs; i++) {
+            if (!mlock.shm->reqs[i].used)
+                break;
+        }
+        if (i == mlock.shm->max_nreqs) {
+            mpi_errno = MPI_ERR_INTERN;
+            goto fn_fail;
+        }
+
+        mlock.shm->reqs[i].used = 1;
+        mlock.shm->reqs[i].group_id = group_id;
+    }
+    (*lock_status) = mlock_get_status(group_id);
 
     CSPU_MLOCK_DBG_GID_TO_STR(group_id, gidstr);
-    CSPU_MLOCK_DBG_PRINT(" \t send LOCK CMD %d (discard, gid %s)\n", pkt.cmd_type, gidstr);
+    CSPU_MLOCK_DBG_PRINT(" \t acquire LOCK (gid %s): %d[%s]\n", gidstr, (*lock_status),
+                         mlock_status_name[(*lock_status)]);
 
-    return CSPU_cwp_issue(&pkt);
+  fn_exit:
+    CSP_mlock_shm_exit(mlock.shm);
+    return mpi_errno;
+  fn_fail:
+    CSP_msg_print(CSP_MSG_ERROR, "Too many concurrent mlock requests on node, max %d\n",
+                  mlock.shm->max_nreqs);
+    goto fn_exit;
 }
 
-static inline int mlock_issue_release_req(CSP_mlock_gid_t group_id)
+/* Give up my suspended request, or release the lock if already granted
+ * (also when it is just granted after the status was synchronized). */
+static inline void mlock_discard_req(CSP_mlock_gid_t group_id, CSP_mlock_status_t * lock_status)
 {
-    CSP_cwp_pkt_t pkt;
-    CSP_cwp_mlock_release_pkt_t *lockrls_pkt = &pkt.u.lock_release;
+    int i;
     char gidstr[CSP_MLOCK_GID_MAXLEN] CSP_ATTRIBUTE((unused));
 
-    pkt.cmd_type = CSP_MLOCK_RELEASE;
-    lockrls_pkt->group_id = group_id;
+    CSP_mlock_shm_enter(mlock.shm);
+
+    if (mlock.shm->is_granted && CSP_mlock_gid_compare(mlock.shm->granted_gid, group_id) == 0) {
+        CSP_mlock_shm_release(mlock.shm);
+    }
+    else {
+        for (i = 0; i < mlock.shm->max_nreqs; i++) {
+            if (mlock.shm->reqs[i].used &&
+                CSP_mlock_gid_compare(mlock.shm->reqs[i].group_id, group_id) == 0) {
+                mlock.shm->reqs[i].used = 0;
+                break;
+            }
+        }
+        CSP_DBG_ASSERT(i < mlock.shm->max_nreqs);
+    }
+
+    CSP_mlock_shm_exit(mlock.shm);
 
     CSPU_MLOCK_DBG_GID_TO_STR(group_id, gidstr);
-    CSPU_MLOCK_DBG_PRINT(" \t send LOCK CMD %d (release, gid %s)\n", pkt.cmd_type, gidstr);
+    CSPU_MLOCK_DBG_PRINT(" \t discard LOCK (gid %s, old status %d[%s])\n", gidstr,
+                         (*lock_status), mlock_status_name[(*lock_status)]);
 
-    return CSPU_cwp_issue(&pkt);
+    (*lock_status) = CSP_MLOCK_STATUS_UNSET;
 }
 
 static int mlock_generate_gid(MPI_Comm user_root_comm, CSP_mlock_gid_t * group_id)
@@ -128,19 +186,32 @@ static int mlock_generate_gid(MPI_Comm user_root_comm, CSP_mlock_gid_t * group_i
     return mpi_errno;
 }
 
+/* Attach to the shared lock object allocated by the first local ghost.
+ * Collective call with local ghosts (see CSPG_mlock_init). */
 int CSPU_mlock_init(void)
 {
     int mpi_errno = MPI_SUCCESS;
+    void *baseptr = NULL;
+    int r_disp_unit;
+    MPI_Aint r_size;
 
 #if defined(CSP_ENABLE_THREAD_SAFE)
     mlock_seqno_gen.no = 0;
     CSPU_THREAD_INIT_OBJ_CS(&mlock_seqno_gen);
 #endif
 
+    CSP_CALLMPI(JUMP, PMPI_Win_allocate_shared(0, sizeof(char), MPI_INFO_NULL,
+                                               CSP_PROC.local_comm, &baseptr, &mlock.shm_win));
+    CSP_CALLMPI(JUMP, PMPI_Win_shared_query(mlock.shm_win, 0 /* first local ghost */ ,
+                                            &r_size, &r_disp_unit, &baseptr));
+    mlock.shm = (CSP_mlock_shm_t *) baseptr;
+
+    /* Ensure no one acquires before the ghost initialized the lock. */
+    CSP_CALLMPI(JUMP, PMPI_Barrier(CSP_PROC.local_comm));
+
   fn_exit:
     return mpi_errno;
   fn_fail:
-    CSP_ATTRIBUTE((unused));
     goto fn_exit;
 }
 
@@ -152,10 +223,15 @@ int CSPU_mlock_destroy(void)
     CSPU_THREAD_DESTROY_OBJ_CS(&mlock_seqno_gen);
 #endif
 
+    if (mlock.shm_win != MPI_WIN_NULL) {
+        CSP_CALLMPI(JUMP, PMPI_Win_free(&mlock.shm_win));
+        mlock.shm_win = MPI_WIN_NULL;
+    }
+    mlock.shm = NULL;
+
   fn_exit:
     return mpi_errno;
   fn_fail:
-    CSP_ATTRIBUTE((unused));
     goto fn_exit;
 }
 
@@ -191,15 +267,14 @@ int CSPU_mlock_acquire(MPI_Comm user_root_comm)
         int my_lock_stats[2];
 
         if (lock_status == CSP_MLOCK_STATUS_UNSET) {
-            /* only initial, discarded, released locks need issue lock request. */
-            mpi_errno = mlock_issue_acquire_req(group_id);
+            /* only initial, discarded, released locks need issue lock request.
+             * new state can be acquired, suspended_l, suspended_h. */
+            mpi_errno = mlock_acquire_req(group_id, &lock_status);
             CSP_CHKMPIFAIL_JUMP(mpi_errno);
         }
-
-        if (lock_status != CSP_MLOCK_STATUS_ACQUIRED) {
-            /* new state can be acquired, suspended_l, suspended_h. */
-            mpi_errno = mlock_sync_status(group_id, &lock_status);
-            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        else if (lock_status != CSP_MLOCK_STATUS_ACQUIRED) {
+            /* suspended_h may be granted or degraded to suspended_l. */
+            mlock_sync_status(group_id, &lock_status);
         }
 
         my_lock_stats[0] = lock_status; /* suspended_l < suspended_h < acquired */
@@ -207,7 +282,7 @@ int CSPU_mlock_acquire(MPI_Comm user_root_comm)
         CSP_CALLMPI(JUMP, PMPI_Allreduce(my_lock_stats, min_lock_stats, 1, MPI_2INT, MPI_MINLOC,
                                          user_root_comm));
         CSPU_MLOCK_DBG_PRINT(" \t all-reduced LOCK status min(stat %d [%s], root %d, gid %s)\n",
-                             min_lock_stats[0], cwp_lock_status_name[min_lock_stats[0]],
+                             min_lock_stats[0], mlock_status_name[min_lock_stats[0]],
                              min_lock_stats[1], gidstr);
 
         /* when the smallest group_id is equal to group_id + np, all other roots got its lock. */
@@ -222,26 +297,12 @@ int CSPU_mlock_acquire(MPI_Comm user_root_comm)
                 if (user_root_rank == lowest_p_root) {
                     /* my lock is suspended with low priority now,
                      * wait till all higher priority groups finished work. */
-                    do {
-                        mpi_errno = mlock_sync_status(group_id, &lock_status);
-                        CSP_CHKMPIFAIL_JUMP(mpi_errno);
-                    } while (lock_status != CSP_MLOCK_STATUS_ACQUIRED);
+                    while (lock_status != CSP_MLOCK_STATUS_ACQUIRED)
+                        mlock_sync_status(group_id, &lock_status);
                 }
                 /* all other roots give up its lock and wait for the first root */
                 else {
-                    if (lock_status == CSP_MLOCK_STATUS_ACQUIRED) {
-                        mpi_errno = mlock_issue_release_req(group_id);
-                    }
-                    else {
-                        mpi_errno = mlock_issue_discard_req(group_id);
-                    }
-                    CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-                    /* drop any SYNC received before the discarded ACK (none). */
-                    do {
-                        mpi_errno = mlock_sync_status(group_id, &lock_status);
-                        CSP_CHKMPIFAIL_JUMP(mpi_errno);
-                    } while (lock_status != CSP_MLOCK_STATUS_UNSET);
+                    mlock_discard_req(group_id, &lock_status);
                 }
 
                 /* wait till the first root got lock */
@@ -23,6 +23,52 @@ static inline void offload_pending_q_init(void)
     CSPU_offload_ch.pending_q.noutstanding = 0;
 }
 
+static inline void offload_pending_arena_init(void)
+{
+    CSPU_offload_ch.pending_arena.slabs = NULL;
+    CSPU_offload_ch.pending_arena.free = NULL;
+    CSPU_offload_ch.pending_arena.nslabs = 0;
+}
+
+static void offload_pending_arena_destroy(void)
+{
+    CSPU_offload_pending_slab_t *slab = CSPU_offload_ch.pending_arena.slabs, *next = NULL;
+    int i;
+
+    while (slab) {
+        next = slab->next;
+        for (i = 0; i < CSPU_OFFLOAD_PENDING_SLAB_NCELLS; i++) {
+            if (slab->cells[i].eager_buf)
+                free(slab->cells[i].eager_buf);
+        }
+        free(slab);
+        slab = next;
+    }
+    offload_pending_arena_init();
+}
+
+/* Allocate a slab of pending cells and push them to the free list. */
+void CSPU_offload_pending_arena_grow(void)
+{
+    CSPU_offload_pending_slab_t *slab = NULL;
+    int i;
+
+    slab = CSP_calloc(1, sizeof(CSPU_offload_pending_slab_t));
+    CSP_ASSERT(slab != NULL);
+
+    slab->next = CSPU_offload_ch.pending_arena.slabs;
+    CSPU_offload_ch.pending_arena.slabs = slab;
+    CSPU_offload_ch.pending_arena.nslabs++;
+
+    for (i = CSPU_OFFLOAD_PENDING_SLAB_NCELLS - 1; i >= 0; i--) {
+        CSP_OFFLOAD_CELL_ABS_PT(&slab->cells[i]).next = CSPU_offload_ch.pending_arena.free;
+        CSPU_offload_ch.pending_arena.free = &slab->cells[i];
+    }
+
+    CSP_DBG_PRINT("OFFLOAD: pending arena grows to %d slabs\n",
+                  CSPU_offload_ch.pending_arena.nslabs);
+}
+
 static inline void offload_shm_recvq_init(void)
 {
     CSP_OFFLOAD_SET_RL_NULL(CSPU_offload_ch.shm_recvq.q_ptr->head);
@@ -33,6 +79,54 @@ static inline void offload_shm_recvq_init(void)
     CSPU_offload_ch.shm_recvq.noutstanding = 0;
 }
 
+/* Locate the node-wide pool following the region of the first local user, who
+ * also initializes the pool. It must be called before the barrier that publishes
+ * the channels to ghosts. */
+static int offload_pool_init(MPI_Aint region_size, MPI_Aint align_cell_size,
+                             MPI_Aint align_slot_size)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int ncells = CSP_ENV.offload_node_ncells;
+    int local_rank = 0, r_disp_unit = 0, i;
+    MPI_Aint r_size = 0, base = 0;
+
+    CSPU_offload_ch.pool.ptr = NULL;
+    CSPU_offload_ch.pool.nborrowed = 0;
+    CSPU_offload_ch.pool.nissued = 0;
+    if (ncells == 0)
+        goto fn_exit;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &local_rank));
+    CSP_CALLMPI(JUMP, PMPI_Win_shared_query(CSPU_offload_ch.shm_win,
+                                            CSP_ENV.num_g /* first local user rank */ ,
+                                            &r_size, &r_disp_unit, &base));
+
+    CSPU_offload_ch.pool.ptr = (CSP_offload_pool_t *) (base + region_size);
+    CSPU_offload_ch.pool.cells_base = (MPI_Aint) CSPU_offload_ch.pool.ptr +
+        CSP_OFFLOAD_POOL_ALIGN_SZ(ncells);
+    CSPU_offload_ch.pool.cells_end = CSPU_offload_ch.pool.cells_base + ncells * align_cell_size;
+    CSPU_offload_ch.pool.slots_base = (char *) CSPU_offload_ch.pool.ptr +
+        CSP_OFFLOAD_POOL_ALIGN_SZ(ncells) + ncells * align_cell_size;
+
+    if (local_rank == CSP_ENV.num_g) {
+        for (i = 0; i < ncells; i++) {
+            CSP_offload_cell_t *cell = (CSP_offload_cell_t *) (CSPU_offload_ch.pool.cells_base +
+                                                               i * align_cell_size);
+            CSP_offload_freestk_reset_cell(cell);
+        }
+        CSP_offload_pool_init(CSPU_offload_ch.pool.ptr, ncells);
+    }
+
+    CSP_DBG_PRINT("OFFLOAD: node pool %p, %d cells at 0x%lx, slots at %p\n",
+                  CSPU_offload_ch.pool.ptr, ncells, CSPU_offload_ch.pool.cells_base,
+                  CSPU_offload_ch.pool.slots_base);
+
+  fn_exit:
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
 static inline int offload_set_tag_ub(void)
 {
     int mpi_errno = MPI_SUCCESS;
@@ -123,29 +217,76 @@ static inline int offload_ghost_binding_init(void)
     goto fn_exit;
 }
 
-/* NOTE : this is triggered only after explicitly completed the request.
- * See standard about MPI_Grequest_complete. */
-static int CSPU_offload_req_query_fn(void *extra_state, MPI_Status * status)
+static inline void offload_req_pool_init(void)
+{
+    CSPU_offload_ch.req_pool.slots = NULL;
+    CSPU_offload_ch.req_pool.free_slots = NULL;
+    CSPU_offload_ch.req_pool.nfree = 0;
+    CSPU_offload_ch.req_pool.size = 0;
+    CSPU_offload_ch.req_pool.nissued = 0;
+}
+
+/* Reserve request handles for offloaded calls. Every handle is an inactive
+ * persistent send to MPI_PROC_NULL, which is never started. Thus it is a valid
+ * handle in the user program but cannot be matched with any message. */
+static int offload_req_pool_create(void)
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_offload_cell_t *assign_cell = (CSP_offload_cell_t *) extra_state;
-    CSP_offload_cell_t *cell = NULL;
-    MPI_Request req = assign_cell->pkt.req;
+    int i, size = CSP_ENV.offload_req_pool_size;
 
-    /* Note that the status of a send message is not updated by MPI.  */
-    if (assign_cell->pkt.type == CSP_OFFLOAD_ISEND)
-        return mpi_errno;
+    if (size == 0)
+        goto fn_exit;
 
-    /* If the assigned cell is a pending one, we get the latest cell from hash. */
-    if (assign_cell->type == CSP_OFFLOAD_CELL_PENDING) {
-        CSPU_offload_req_hash_get(req, &cell);
-        CSP_ASSERT(cell && cell->type == CSP_OFFLOAD_CELL_SHM && CSPU_offload_check_complete(cell));
-    }
-    else {
-        cell = assign_cell;
-        CSP_DBG_ASSERT(CSPU_offload_check_complete(cell));
+    CSPU_offload_ch.req_pool.slots = CSP_calloc(size, sizeof(CSPU_offload_req_slot_t));
+    CSPU_offload_ch.req_pool.free_slots = CSP_calloc(size, sizeof(int));
+
+    for (i = 0; i < size; i++) {
+        CSP_CALLMPI(JUMP, PMPI_Send_init(NULL, 0, MPI_BYTE, MPI_PROC_NULL, 0,
+                                         CSP_PROC.user.u_local_comm,
+                                         &CSPU_offload_ch.req_pool.slots[i].req));
+        CSPU_offload_ch.req_pool.size++;
+
+        /* Pop from low index. */
+        CSPU_offload_ch.req_pool.free_slots[size - 1 - i] = i;
+        CSPU_offload_ch.req_pool.nfree++;
     }
 
+    CSP_DBG_PRINT("OFFLOAD: created request pool, size %d\n", size);
+
+  fn_exit:
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
+static int offload_req_pool_destroy(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i;
+
+    /* User should complete every offloaded call before finalize. */
+    CSP_ASSERT(CSPU_offload_ch.req_pool.nfree == CSPU_offload_ch.req_pool.size);
+
+    for (i = 0; i < CSPU_offload_ch.req_pool.size; i++)
+        CSP_CALLMPI(JUMP, PMPI_Request_free(&CSPU_offload_ch.req_pool.slots[i].req));
+
+  fn_exit:
+    if (CSPU_offload_ch.req_pool.slots)
+        free(CSPU_offload_ch.req_pool.slots);
+    if (CSPU_offload_ch.req_pool.free_slots)
+        free(CSPU_offload_ch.req_pool.free_slots);
+    offload_req_pool_init();
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Copy the status of a completed offloaded receive from its shared cell.
+ * Return the error code of the call. */
+static int offload_req_fill_status(CSP_offload_cell_t * cell, MPI_Status * status)
+{
+    int mpi_errno = MPI_SUCCESS;
+
     /* Always send just one int */
     MPI_Status_set_elements(status, MPI_INT, 1);
     /* Can never cancel so always true */
@@ -164,28 +305,36 @@ static int CSPU_offload_req_query_fn(void *extra_state, MPI_Status * status)
                                                ug_comm->group, &status->MPI_SOURCE));
     }
 
-    CSP_DBG_PRINT("OFFLOAD req_query: req=0x%x, cell=%p, assign_cell=%p, "
-                  "stat.src=%d, tag=%d, err=%d\n", req, cell,
-                  assign_cell, status->MPI_SOURCE, status->MPI_TAG, status->MPI_ERROR);
-
     return status->MPI_ERROR;
 }
 
-/* NOTE: free_fn is invoked after the call to query_fn for the same request.
- * MPI will free the grequest object after this call. */
-static int CSPU_offload_req_free_fn(void *extra_state)
+/* Release the cells of a completed offload request.
+ * Return the latest (shared) cell to freestk. */
+static void offload_req_release(CSP_offload_cell_t * assign_cell, MPI_Request req)
 {
-    CSP_offload_cell_t *assign_cell = (CSP_offload_cell_t *) extra_state;
     CSP_offload_cell_t *cell = NULL;
-    MPI_Request req = assign_cell->pkt.req;
 
     /* Remove shared cell from request -> cell hash. */
     CSPU_offload_req_hash_remove(req, &cell);
+
+    /* Eager send may complete before the ghost completes it (or even before it is
+     * moved to shared queue). Detach the cell from the request, it is released
+     * when dequeued from the completion queue. */
+    if (cell->pkt.eager && !OPA_load_int(&cell->pkt.complet_flag)) {
+        cell->pkt.req = MPI_REQUEST_NULL;
+        CSPU_offload_ch.eager.ndetached++;
+        /* Pending cell not yet moved is released at moving. */
+        if (assign_cell->type == CSP_OFFLOAD_CELL_PENDING && assign_cell != cell)
+            CSP_offload_release_pending_cell(&assign_cell);
+        CSP_DBG_PRINT("OFFLOAD req_free: detach eager cell %p(%s)\n", cell,
+                      (cell->type == CSP_OFFLOAD_CELL_SHM ? "shm" : "pending"));
+        return;
+    }
     CSP_DBG_ASSERT(cell->type == CSP_OFFLOAD_CELL_SHM);
 
-    /* The cell is actually already completed a while, but it is reused only after
-     * put back to freestk. So it is OK to decrement counter here.*/
-    CSPU_offload_ch.shm_recvq.noutstanding--;
+    /* Other chunks are already released at completion. */
+    if (cell->pkt.pipe)
+        free(cell->pkt.pipe);
 
     /* A local pending cell may be assigned at request creation. Free it too. */
     if (assign_cell->type == CSP_OFFLOAD_CELL_PENDING) {
@@ -193,11 +342,50 @@ static int CSPU_offload_req_free_fn(void *extra_state)
         CSP_offload_release_pending_cell(&assign_cell);
     }
 
-    CSP_offload_freestk_reset_cell(cell);
-    CSP_offload_freestk_push(cell);
+    CSPU_offload_free_shm_cell(cell);
 
     CSP_DBG_PRINT("OFFLOAD req_free: free assign_cell %p cell %p\n", assign_cell, cell);
+}
 
+/* NOTE : this is triggered only after explicitly completed the request.
+ * See standard about MPI_Grequest_complete. */
+static int CSPU_offload_req_query_fn(void *extra_state, MPI_Status * status)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSP_offload_cell_t *assign_cell = (CSP_offload_cell_t *) extra_state;
+    CSP_offload_cell_t *cell = NULL;
+    MPI_Request req = assign_cell->pkt.req;
+
+    /* Note that the status of a send message is not updated by MPI.  */
+    if (assign_cell->pkt.type == CSP_OFFLOAD_ISEND)
+        return mpi_errno;
+
+    /* If the assigned cell is a pending one, we get the latest cell from hash. */
+    if (assign_cell->type == CSP_OFFLOAD_CELL_PENDING) {
+        CSPU_offload_req_hash_get(req, &cell);
+        CSP_ASSERT(cell && cell->type == CSP_OFFLOAD_CELL_SHM && CSPU_offload_check_complete(cell));
+    }
+    else {
+        cell = assign_cell;
+        CSP_DBG_ASSERT(CSPU_offload_check_complete(cell));
+    }
+
+    mpi_errno = offload_req_fill_status(cell, status);
+
+    CSP_DBG_PRINT("OFFLOAD req_query: req=0x%x, cell=%p, assign_cell=%p, "
+                  "stat.src=%d, tag=%d, err=%d\n", req, cell,
+                  assign_cell, status->MPI_SOURCE, status->MPI_TAG, status->MPI_ERROR);
+
+    return mpi_errno;
+}
+
+/* NOTE: free_fn is invoked after the call to query_fn for the same request.
+ * MPI will free the grequest object after this call. */
+static int CSPU_offload_req_free_fn(void *extra_state)
+{
+    CSP_offload_cell_t *assign_cell = (CSP_offload_cell_t *) extra_state;
+
+    offload_req_release(assign_cell, assign_cell->pkt.req);
     return MPI_SUCCESS;
 }
 
@@ -214,13 +402,305 @@ static int CSPU_offload_req_cancel_fn(void *extra_state, int complete)
 
 int CSPU_offload_create_req(CSP_offload_cell_t * cell, MPI_Request * req_ptr)
 {
+    CSPU_offload_req_slot_t *slot = NULL;
+    int idx;
+
     /* Because the request may be first generated for a local pending cell,
      * we use external hash to maintain request -> latest cell mapping. The
      * input cell is used to pass the generated request handle. */
+
+    /* Take a pre-allocated handle if any is free. */
+    if (CSPU_offload_ch.req_pool.nfree > 0) {
+        idx = CSPU_offload_ch.req_pool.free_slots[--CSPU_offload_ch.req_pool.nfree];
+        slot = &CSPU_offload_ch.req_pool.slots[idx];
+        slot->assign_cell = cell;
+
+        cell->pkt.req_slot = idx;
+        (*req_ptr) = slot->req;
+        CSPU_PROF_EXT_COUNTER_INC(CSPU_offload_ch.req_pool.nissued);
+        return MPI_SUCCESS;
+    }
+
+    cell->pkt.req_slot = CSP_OFFLOAD_REQ_SLOT_NULL;
     return PMPI_Grequest_start(CSPU_offload_req_query_fn, CSPU_offload_req_free_fn,
                                CSPU_offload_req_cancel_fn, (void *) cell, req_ptr);
 }
 
+/* Complete a pooled request whose shared cell is already completed, as
+ * the query_fn and free_fn do for a generalized request. The handle is
+ * returned to the pool and the user handle is set to MPI_REQUEST_NULL.
+ * Return the error code of the offloaded call. */
+int CSPU_offload_complete_pooled_req(CSP_offload_cell_t * cell, MPI_Request * req_ptr,
+                                     MPI_Status * status)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int idx = cell->pkt.req_slot;
+    CSPU_offload_req_slot_t *slot = &CSPU_offload_ch.req_pool.slots[idx];
+
+    CSP_DBG_ASSERT(cell->type == CSP_OFFLOAD_CELL_SHM && CSPU_offload_check_complete(cell));
+    CSP_DBG_ASSERT(slot->req == (*req_ptr));
+
+    /* Note that the status of a send message is not updated by MPI.  */
+    if (cell->pkt.type == CSP_OFFLOAD_IRECV) {
+        if (status != MPI_STATUS_IGNORE)
+            mpi_errno = offload_req_fill_status(cell, status);
+        else
+            mpi_errno = cell->pkt.stat.MPI_ERROR;
+    }
+
+    CSP_DBG_PRINT("OFFLOAD pooled req complete: req=0x%x, slot %d, cell=%p, "
+                  "assign_cell=%p\n", (*req_ptr), idx, cell, slot->assign_cell);
+
+    /* The cell is reset at release, thus do not access it after this point. */
+    offload_req_release(slot->assign_cell, slot->req);
+    slot->assign_cell = NULL;
+    CSPU_offload_ch.req_pool.free_slots[CSPU_offload_ch.req_pool.nfree++] = idx;
+
+    (*req_ptr) = MPI_REQUEST_NULL;
+    return mpi_errno;
+}
+
+/* Test an offload request. Return 0 in is_offload if it is an original request,
+ * which is tested by the caller without holding the channel critical section. */
+int CSPU_offload_req_test(MPI_Request * request, int *flag, MPI_Status * status, int *is_offload)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSP_offload_cell_t *cell = NULL;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+
+    CSPU_offload_poll_completion();
+    CSPU_offload_poll_progress();
+
+    CSPU_offload_req_hash_get(*request, &cell);
+
+    *is_offload = (cell != NULL);
+    if (!cell)
+        goto fn_exit;
+
+    /* Pooled request is tested locally without calling MPI. */
+    if (CSPU_offload_req_is_pooled(cell)) {
+        *flag = 0;
+        if (cell->type == CSP_OFFLOAD_CELL_SHM && CSPU_offload_check_complete(cell)) {
+            CSP_DBG_PRINT("test: completed pooled offload cell=%p, req=0x%x\n", cell, *request);
+            mpi_errno = CSPU_offload_complete_pooled_req(cell, request, status);
+            *flag = 1;
+        }
+        goto fn_exit;
+    }
+
+    /* Complete offload request. */
+    if (cell->type == CSP_OFFLOAD_CELL_SHM && CSPU_offload_check_complete(cell)) {
+        CSP_CALLMPI(JUMP, PMPI_Grequest_complete(*request));
+        CSP_DBG_PRINT("test: completed offload cell=%p, req=0x%x\n", cell, *request);
+    }
+
+    /* The callback functions are triggered after completion :
+     * query_fn get the corresponding cell instance and generates correct status.
+     * free_fn cleans up the cell instance, thus must be called in critical section. */
+    CSP_CALLMPI(JUMP, PMPI_Test(request, flag, status));
+
+  fn_exit:
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Check the completion of an offload request without freeing it, as
+ * MPI_Request_get_status does. Return 0 in is_offload if it is an original
+ * request. */
+int CSPU_offload_req_get_status(MPI_Request request, int *flag, MPI_Status * status,
+                                int *is_offload)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSP_offload_cell_t *cell = NULL;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+
+    CSPU_offload_poll_completion();
+    CSPU_offload_poll_progress();
+
+    CSPU_offload_req_hash_get(request, &cell);
+
+    *is_offload = (cell != NULL);
+    if (!cell)
+        goto fn_exit;
+
+    *flag = (cell->type == CSP_OFFLOAD_CELL_SHM && CSPU_offload_check_complete(cell));
+
+    /* Note that the status of a send message is not updated by MPI.  */
+    if (*flag && cell->pkt.type == CSP_OFFLOAD_IRECV && status != MPI_STATUS_IGNORE)
+        mpi_errno = offload_req_fill_status(cell, status);
+
+  fn_exit:
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+    return mpi_errno;
+}
+
+/* Copy the requests into orig_reqs, replacing every offload request with
+ * MPI_REQUEST_NULL, thus the original requests can be passed to MPI in place
+ * of the user array. Return the number of offload requests. */
+int CSPU_offload_req_split(int count, MPI_Request array_of_requests[], MPI_Request orig_reqs[])
+{
+    CSP_offload_cell_t *cell = NULL;
+    int i, noffload = 0;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+
+    for (i = 0; i < count; i++) {
+        orig_reqs[i] = array_of_requests[i];
+        if (array_of_requests[i] == MPI_REQUEST_NULL)
+            continue;
+
+        CSPU_offload_req_hash_get(array_of_requests[i], &cell);
+        if (cell != NULL) {
+            orig_reqs[i] = MPI_REQUEST_NULL;
+            noffload++;
+        }
+    }
+
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+    return noffload;
+}
+
+/* Pack the payload of an eager send into the eager slot of the shared cell,
+ * or into a local buffer if it is a pending cell. The cell is not issued yet,
+ * thus it is called out of the channel critical section. */
+int CSPU_offload_eager_copy(CSP_offload_cell_t * cell, const void *buf, int count,
+                            MPI_Datatype datatype, MPI_Comm comm)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int position = 0;
+    void *pack_buf = NULL;
+
+    if (cell->type == CSP_OFFLOAD_CELL_SHM) {
+        pack_buf = CSPU_offload_eager_slot(cell);
+    }
+    else {
+        /* Recycled pending cell may already have one. */
+        if (cell->eager_buf == NULL) {
+            cell->eager_buf = CSP_calloc(1, CSPU_offload_ch.eager.slot_size);
+            CSP_ASSERT(cell->eager_buf != NULL);
+        }
+        pack_buf = cell->eager_buf;
+    }
+
+    CSP_CALLMPI(JUMP, PMPI_Pack(buf, count, datatype, pack_buf,
+                                (int) CSPU_offload_ch.eager.slot_size, &position, comm));
+
+    cell->pkt.eager = 1;
+    cell->pkt.packed = 1;
+    cell->pkt.isend.count = position;
+    cell->pkt.isend.g_datatype = MPI_DATATYPE_NULL;     /* ghost sends MPI_PACKED */
+    /* Set at moving to shared queue for pending cell. */
+    if (cell->type == CSP_OFFLOAD_CELL_SHM)
+        cell->pkt.isend.g_bufaddr = (MPI_Aint) pack_buf - CSPU_offload_ch.shm_base;
+
+    CSP_DBG_PRINT("OFFLOAD eager: packed %d bytes into %p of cell %p(%s)\n", position,
+                  pack_buf, cell, (cell->type == CSP_OFFLOAD_CELL_SHM ? "shm" : "pending"));
+
+  fn_exit:
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Check whether the message is pipelined. The sender splits a message not
+ * smaller than the chunk size into chunks of exactly that size followed by a
+ * shorter (possibly empty) last chunk, thus the receiver ghost recognizes the
+ * end of the message by itself, and the receive count can be larger than the
+ * send count. Only contiguous predefined datatype is pipelined, and every chunk
+ * is matched by a separate receive, thus no wildcard is allowed. */
+int CSPU_offload_check_pipeline(int count, MPI_Datatype datatype, CSPU_comm_t * ug_comm,
+                                int *pipe_flag)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int type_size = 0, is_contig = 0;
+
+    *pipe_flag = 0;
+    if (CSPU_offload_ch.bounce.buf_size == 0 ||
+        ug_comm->info_args.wildcard_used != CSP_COMM_INFO_WD_NONE)
+        return mpi_errno;
+
+    mpi_errno = CSPU_datatype_check_contig(datatype, &type_size, &is_contig);
+    CSP_CHKMPIFAIL_RETURN(mpi_errno);
+    if (is_contig && (MPI_Aint) count * type_size >= CSP_ENV.offload_pipeline_chunksz)
+        *pipe_flag = 1;
+
+    return mpi_errno;
+}
+
+/* Issue a pipelined send whose first chunk is the head cell already filled
+ * for the whole message. Every following chunk takes a cell without request,
+ * and all chunks are sent as bytes.
+ * If copy_buf is set, all chunks are pending and staged into bounce buffers at
+ * progress, thus the call returns once the first chunk is staged (if any bounce
+ * buffer is free). */
+int CSPU_offload_pipe_issue(CSP_offload_cell_t * head, const void *copy_buf,
+                            MPI_Datatype datatype)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSP_offload_pkt_t tmpl_pkt;
+    CSPU_offload_pipe_t *pipe = NULL;
+    MPI_Aint chunksz = CSP_ENV.offload_pipeline_chunksz, nbytes;
+    int type_size = 0, i;
+
+    CSP_CALLMPI(JUMP, PMPI_Type_size(datatype, &type_size));
+    nbytes = (MPI_Aint) head->pkt.isend.count * type_size;
+
+    memcpy(&tmpl_pkt, &head->pkt, sizeof(CSP_offload_pkt_t));
+
+    pipe = CSP_calloc(1, sizeof(CSPU_offload_pipe_t));
+    CSP_ASSERT(pipe != NULL);
+    pipe->buf = (const char *) copy_buf;
+    pipe->req = tmpl_pkt.req;
+    /* The last chunk is empty if the size is a multiple of chunk size. */
+    pipe->nchunks = (int) (nbytes / chunksz) + 1;
+
+    for (i = 0; i < pipe->nchunks; i++) {
+        CSP_offload_cell_t *cell = head;
+
+        if (i > 0) {
+            cell = CSPU_offload_get_cell(copy_buf != NULL);
+            memcpy(&cell->pkt, &tmpl_pkt, sizeof(CSP_offload_pkt_t));
+            cell->pkt.req = MPI_REQUEST_NULL;
+            cell->pkt.req_slot = CSP_OFFLOAD_REQ_SLOT_NULL;
+        }
+        cell->pkt.pipe = pipe;
+        cell->pkt.bounce_idx = CSP_OFFLOAD_BOUNCE_NULL;
+        cell->pkt.isend.count = (int) CSP_MIN(chunksz, nbytes - i * chunksz);
+
+        if (copy_buf) {
+            /* Offset in user buffer, replaced by the bounce buffer at staging. */
+            cell->pkt.isend.g_bufaddr = i * chunksz;
+        }
+        else {
+            cell->pkt.isend.g_bufaddr = tmpl_pkt.isend.g_bufaddr + i * chunksz;
+            cell->pkt.isend.g_datatype = MPI_BYTE;
+        }
+
+        CSPU_offload_issue(cell);
+    }
+
+    CSPU_PROF_EXT_COUNTER_INC(CSPU_offload_ch.pipe_nissued);
+    CSP_DBG_PRINT("OFFLOAD pipe: issued %d chunks of %ld bytes, req=0x%x, %s\n",
+                  pipe->nchunks, chunksz, pipe->req, copy_buf ? "staged" : "registered");
+
+    /* Stage the first chunks. */
+    if (copy_buf)
+        CSPU_offload_poll_progress();
+
+  fn_exit:
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
+
 /* Destroy offload channel.
  * This must be called after sent cwp finalize to ghost.  */
 int CSPU_offload_destroy(void)
@@ -231,8 +711,16 @@ int CSPU_offload_destroy(void)
      * User should ensure correct MPI program. */
     CSP_ASSERT(CSP_offload_pending_q_empty());
     CSP_ASSERT(pending_cell_ncreated == 0);
+    offload_pending_arena_destroy();
     CSP_ASSERT(CSP_offload_recvq_producer_empty(CSPU_offload_ch.shm_recvq.q_ptr) &&
                CSPU_offload_ch.shm_recvq.noutstanding == 0);
+    CSP_ASSERT(CSP_offload_cmplq_empty(CSPU_offload_ch.shm_cmplq_ptr) &&
+               CSPU_offload_ch.eager.ndetached == 0);
+    CSP_ASSERT(CSPU_offload_ch.bounce.buf_size == 0 ||
+               CSPU_offload_ch.bounce.nfree == CSP_OFFLOAD_PIPELINE_NBUFS);
+    CSP_ASSERT(CSPU_offload_ch.pool.nborrowed == 0);
+
+    CSPU_THREAD_DESTROY_OBJ_CS(&CSPU_offload_ch);
 
     if (CSPU_offload_ch.shm_win && CSPU_offload_ch.shm_win != MPI_WIN_NULL) {
         CSP_DBG_PRINT("OFFLOAD: free CSPU_offload_ch.shm_win 0x%x\n", CSPU_offload_ch.shm_win);
@@ -241,12 +729,37 @@ int CSPU_offload_destroy(void)
         CSPU_offload_ch.shm_win = MPI_WIN_NULL;
         CSPU_offload_ch.shm_base = 0;
         CSPU_offload_ch.shm_recvq.q_ptr = NULL;
+        CSPU_offload_ch.shm_cmplq_ptr = NULL;
+        CSPU_offload_ch.pool.ptr = NULL;
     }
 
     if (CSPU_offload_ch.bound_g_lranks_local)
         free(CSPU_offload_ch.bound_g_lranks_local);
     CSPU_offload_ch.bound_g_lranks_local = NULL;
 
+    mpi_errno = CSPU_prof_ext_counter_print(CSPU_offload_ch.pool.nissued,
+                                            "Offloading borrowed cells");
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    mpi_errno = CSPU_prof_ext_counter_print(CSPU_offload_ch.eager.nissued,
+                                            "Offloading eager copied");
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    mpi_errno = CSPU_prof_ext_counter_print(CSPU_offload_ch.pipe_nissued,
+                                            "Offloading pipelined");
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    mpi_errno = CSPU_prof_ext_counter_print(CSPU_offload_ch.bounce.nissued,
+                                            "Offloading staged chunks");
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    mpi_errno = CSPU_prof_ext_counter_print(CSPU_offload_ch.req_pool.nissued,
+                                            "Offloading pooled request");
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    mpi_errno = offload_req_pool_destroy();
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     mpi_errno = CSPU_prof_ext_counter_print(CSPU_offload_ch.shm_recvq.nissued,
                                             "Offloading SHMQ direct");
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
@@ -265,20 +778,38 @@ int CSPU_offload_init(void)
 {
     int mpi_errno = MPI_SUCCESS;
     void *baseptr = NULL;
-    MPI_Aint shm_region_size = 0, addr = 0;
-    MPI_Aint align_cell_size = 0, align_shmq_size = 0;
+    MPI_Aint shm_region_size = 0, alloc_size = 0, addr = 0;
+    MPI_Aint align_cell_size = 0, align_shmq_size = 0, align_cmplq_size = 0;
+    MPI_Aint align_slot_size = 0, align_bounce_size = 0;
     CSP_offload_cell_t *cell = NULL;
-    int i;
+    int local_rank = 0, i;
 
     /* Make sure the shared structures are aligned by cache line. */
     align_cell_size = CSP_ALIGN(sizeof(CSP_offload_cell_t), CSP_OFFLOAD_CACHE_LINE_LEN);
-    align_shmq_size = CSP_ALIGN(sizeof(CSP_offload_shmqueue_t), CSP_OFFLOAD_CACHE_LINE_LEN);
+    align_shmq_size = CSP_OFFLOAD_SHMQ_ALIGN_SZ;
+    /* Borrowed cells are also completed through my cmplq. */
+    align_cmplq_size = CSP_OFFLOAD_CMPLQ_ALIGN_SZ(CSP_ENV.offload_shmq_ncells +
+                                                  CSP_ENV.offload_node_ncells);
+    align_slot_size = CSP_OFFLOAD_EAGER_SLOT_ALIGN_SZ(CSP_ENV.offload_eager_msgsz);
+    align_bounce_size = CSP_OFFLOAD_BOUNCE_ALIGN_SZ(CSP_ENV.offload_pipeline_chunksz);
 
     /* Create shared memory region for pt2pt/collectives offload */
-    /* [shm_recvq + 64 cells] per user process. Allocate on user process's
-     * memory to ensure fast access. */
-    shm_region_size = align_shmq_size + CSP_ENV.offload_shmq_ncells * align_cell_size;
-    CSP_CALLMPI(JUMP, PMPI_Win_allocate_shared(shm_region_size, sizeof(char),
+    /* [shm_recvq + cmplq + 64 cells + 64 eager slots + 4 bounce buffers] per user
+     * process. Allocate on user process's memory to ensure fast access. */
+    shm_region_size = align_shmq_size + align_cmplq_size +
+        CSP_ENV.offload_shmq_ncells * (align_cell_size + align_slot_size) +
+        CSP_OFFLOAD_PIPELINE_NBUFS * align_bounce_size;
+
+    /* The first local user also allocates the node-wide pool. Keep the default
+     * contiguous allocation, thus the pool is at the same offset from every
+     * region on all local processes. */
+    alloc_size = shm_region_size;
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &local_rank));
+    if (local_rank == CSP_ENV.num_g && CSP_ENV.offload_node_ncells > 0)
+        alloc_size += CSP_OFFLOAD_POOL_ALIGN_SZ(CSP_ENV.offload_node_ncells) +
+            CSP_ENV.offload_node_ncells * (align_cell_size + align_slot_size);
+
+    CSP_CALLMPI(JUMP, PMPI_Win_allocate_shared(alloc_size, sizeof(char),
                                                MPI_INFO_NULL, CSP_PROC.local_comm,
                                                &baseptr, &CSPU_offload_ch.shm_win));
     CSPU_offload_ch.shm_base = (MPI_Aint) baseptr;
@@ -289,20 +820,51 @@ int CSPU_offload_init(void)
         CSP_msg_print(CSP_MSG_WARN, "The shm_recvq %p is not aligned by %d !\n",
                       CSPU_offload_ch.shm_recvq.q_ptr, CSP_OFFLOAD_CACHE_LINE_LEN);
 
-    /* Initialize local shm_recvq. */
+    CSPU_offload_ch.shm_cmplq_ptr =
+        (CSP_offload_cmplq_t *) (CSPU_offload_ch.shm_base + align_shmq_size);
+
+    /* Initialize local shm_recvq and cmplq. */
     offload_shm_recvq_init();
+    CSP_offload_cmplq_init(CSPU_offload_ch.shm_cmplq_ptr,
+                           CSP_ENV.offload_shmq_ncells + CSP_ENV.offload_node_ncells);
+
+    mpi_errno = offload_pool_init(shm_region_size, align_cell_size, align_slot_size);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     /* Ensure no ghost accesses shm_recvq before my initialization. */
     CSP_CALLMPI(JUMP, PMPI_Barrier(CSP_PROC.local_comm));
 
-    CSP_DBG_PRINT("OFFLOAD: allocated shm_recvq.q_ptr %p\n", CSPU_offload_ch.shm_recvq.q_ptr);
+    CSP_DBG_PRINT("OFFLOAD: allocated shm_recvq.q_ptr %p, shm_cmplq_ptr %p\n",
+                  CSPU_offload_ch.shm_recvq.q_ptr, CSPU_offload_ch.shm_cmplq_ptr);
 
     /* Initialize local containers */
     offload_freestk_init();
     offload_pending_q_init();
+    offload_pending_arena_init();
+    offload_req_pool_init();
+
+    /* Eager slots follow the cells. */
+    CSPU_offload_ch.eager.slot_size = align_slot_size;
+    CSPU_offload_ch.eager.cell_size = align_cell_size;
+    CSPU_offload_ch.eager.cells_base = CSPU_offload_ch.shm_base + align_shmq_size +
+        align_cmplq_size;
+    CSPU_offload_ch.eager.slots_base = (char *) baseptr + align_shmq_size + align_cmplq_size +
+        CSP_ENV.offload_shmq_ncells * align_cell_size;
+    CSPU_offload_ch.eager.ndetached = 0;
+    CSPU_offload_ch.eager.nissued = 0;
+
+    /* Bounce buffers follow the eager slots. */
+    CSPU_offload_ch.bounce.buf_size = align_bounce_size;
+    CSPU_offload_ch.bounce.base = CSPU_offload_ch.eager.slots_base +
+        CSP_ENV.offload_shmq_ncells * align_slot_size;
+    CSPU_offload_ch.bounce.nfree = 0;
+    CSPU_offload_ch.bounce.nissued = 0;
+    CSPU_offload_ch.pipe_nissued = 0;
+    for (i = 0; align_bounce_size > 0 && i < CSP_OFFLOAD_PIPELINE_NBUFS; i++)
+        CSPU_offload_ch.bounce.free_idx[CSPU_offload_ch.bounce.nfree++] = i;
 
     /* Push all free cells into local stack */
-    addr = CSPU_offload_ch.shm_base + align_shmq_size;
+    addr = CSPU_offload_ch.eager.cells_base;
     for (i = 0; i < CSP_ENV.offload_shmq_ncells; i++) {
         cell = (CSP_offload_cell_t *) addr;
         cell->type = CSP_OFFLOAD_CELL_SHM;
@@ -320,6 +882,11 @@ int CSPU_offload_init(void)
     mpi_errno = offload_set_tag_ub();
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
+    mpi_errno = offload_req_pool_create();
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    CSPU_THREAD_INIT_OBJ_CS(&CSPU_offload_ch);
+
   fn_exit:
     return mpi_errno;
   fn_fail:
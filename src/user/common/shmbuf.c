@@ -6,16 +6,74 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "cspu.h"
 
-CSPU_shmbuf_record_t *CSPU_shmbuf_list = NULL;
+CSPU_shmbuf_index_t CSPU_shmbuf_index = { NULL, 0, 0, -1 };
+
+static void shmbuf_record_insert(void *base, MPI_Aint size, MPI_Aint g_base_bound)
+{
+    CSPU_shmbuf_index_t *index = &CSPU_shmbuf_index;
+    CSPU_shmbuf_record_t *record = NULL;
+    int pos;
+
+    if (index->num == index->capacity) {
+        int capacity = index->capacity > 0 ? index->capacity * 2 : CSPU_SHMBUF_INDEX_INIT_CAPACITY;
+        index->records = realloc(index->records, capacity * sizeof(CSPU_shmbuf_record_t));
+        CSP_ASSERT(index->records != NULL);
+        index->capacity = capacity;
+    }
+
+    /* Keep records sorted by base. */
+    pos = CSPU_shmbuf_index_upper_bound(base);
+    memmove(&index->records[pos + 1], &index->records[pos],
+            (index->num - pos) * sizeof(CSPU_shmbuf_record_t));
+    index->num++;
+    index->last_hit = -1;
+
+    record = &index->records[pos];
+    record->base = base;
+    record->g_base_bound = g_base_bound;
+    record->size = size;
+
+    CSP_DBG_PRINT("SHMBUF insert record %d, base=%p, g_base_bound=0x%lx, size=0x%lx\n",
+                  pos, base, g_base_bound, size);
+}
+
+static void shmbuf_record_remove(void *base)
+{
+    CSPU_shmbuf_index_t *index = &CSPU_shmbuf_index;
+    int pos;
+
+    /* Find the record with base. Zero-size buffers may share the same base,
+     * any of them can be removed. */
+    pos = CSPU_shmbuf_index_upper_bound(base) - 1;
+    CSP_ASSERT(pos >= 0 && index->records[pos].base == base);
+
+    memmove(&index->records[pos], &index->records[pos + 1],
+            (index->num - pos - 1) * sizeof(CSPU_shmbuf_record_t));
+    index->num--;
+    index->last_hit = -1;
+
+    CSP_DBG_PRINT("SHMBUF remove base %p->record %d\n", base, pos);
+}
+
+void CSPU_shmbuf_index_destroy(void)
+{
+    if (CSPU_shmbuf_index.records)
+        free(CSPU_shmbuf_index.records);
+    CSPU_shmbuf_index.records = NULL;
+    CSPU_shmbuf_index.num = 0;
+    CSPU_shmbuf_index.capacity = 0;
+    CSPU_shmbuf_index.last_hit = -1;
+}
 
 int CSPU_shmbuf_free(MPI_Win * win, int *freed)
 {
     int mpi_errno = MPI_SUCCESS;
     CSPU_shmbuf_win_t *shmbuf_win = NULL;
     int ulrank = 0, lrank = 0;
-    MPI_Request *reqs = NULL;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
 
     *freed = 0;
 
@@ -27,34 +85,25 @@ int CSPU_shmbuf_free(MPI_Win * win, int *freed)
         CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &lrank));
 
         if (ulrank == 0) {
-            int i;
             CSP_cwp_pkt_t pkt;
             CSP_cwp_shmbuf_free_pkt_t *shmbuf_free_pkt = &pkt.u.fnc_shmbuf_free;
 
-            /* Send command to root ghost.
+            /* Issue command to local ghosts.
              * Do not mlock ghost because only one node. */
             CSP_cwp_init_pkt(CSP_CWP_FNC_SHMBUF_FREE, &pkt);
             shmbuf_free_pkt->user_local_root = lrank;
 
-            mpi_errno = CSPU_cwp_issue(&pkt);
+            /* Send the handle of window to each ghost with the command. */
+            mpi_errno = CSPU_cwp_issue_g_params(&pkt, shmbuf_win->g_win_handles);
             CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-            /* Send the handle of window to each ghost. */
-            reqs = CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Request));
-            for (i = 0; i < CSP_ENV.num_g; i++) {
-                CSP_CALLMPI(JUMP, PMPI_Isend(&shmbuf_win->g_win_handles[i], 1, MPI_AINT,
-                                             CSP_PROC.user.g_lranks[i], CSP_CWP_PARAM_TAG,
-                                             CSP_PROC.local_comm, &reqs[i]));
-
-                CSP_DBG_PRINT("SHMBUF free: sent g_win_handles[%d]=0x%lx\n", i,
-                              shmbuf_win->g_win_handles[i]);
-            }
-            CSP_CALLMPI(JUMP, PMPI_Waitall(CSP_ENV.num_g, reqs, MPI_STATUS_IGNORE));
-
             free(shmbuf_win->g_win_handles);
         }
 
-        CSPU_shmbuf_record_remove(shmbuf_win->base);
+        /* The index is looked up by offloaded calls in the channel critical section. */
+        CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+        shmbuf_record_remove(shmbuf_win->base);
+        CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
 
         mpi_errno = CSPU_remove_shmbuf_win_from_cache(*win);
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
@@ -67,8 +116,6 @@ int CSPU_shmbuf_free(MPI_Win * win, int *freed)
     }
 
   fn_exit:
-    if (reqs)
-        free(reqs);
     return mpi_errno;
   fn_fail:
     goto fn_exit;
@@ -83,8 +130,8 @@ int CSPU_shmbuf_regist(CSPU_comm_t * ug_comm, MPI_Aint size, int disp_unit, MPI_
     CSP_cwp_shmbuf_regist_pkt_t *shmbuf_regist_pkt = &pkt.u.fnc_shmbuf_regist;
     int ulrank = 0, lrank = 0;
     void **base_pp = (void **) baseptr;
-    MPI_Request *reqs = NULL;
     int i;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
 
     shmbuf_win = CSP_calloc(1, sizeof(CSPU_shmbuf_win_t));
     CSP_ASSERT(shmbuf_win != NULL);
@@ -93,22 +140,14 @@ int CSPU_shmbuf_regist(CSPU_comm_t * ug_comm, MPI_Aint size, int disp_unit, MPI_
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &lrank));
 
     if (ulrank == 0) {
-        /* Send command to root ghost.
+        /* Issue command to local ghosts.
          * Do not mlock ghost because only one node. */
         CSP_cwp_init_pkt(CSP_CWP_FNC_SHMBUF_REGIST, &pkt);
         shmbuf_regist_pkt->user_local_root = lrank;
 
-        mpi_errno = CSPU_cwp_issue(&pkt);
+        /* Send the handle of ug_comm to each ghost with the command. */
+        mpi_errno = CSPU_cwp_issue_g_params(&pkt, ug_comm->g_ugcomm_handles);
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
-
-        /* Send the handle of ug_comm to each ghost. */
-        reqs = CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Request));
-        for (i = 0; i < CSP_ENV.num_g; i++) {
-            CSP_CALLMPI(JUMP, PMPI_Isend(&ug_comm->g_ugcomm_handles[i], 1, MPI_AINT,
-                                         CSP_PROC.user.g_lranks[i], CSP_CWP_PARAM_TAG,
-                                         CSP_PROC.local_comm, &reqs[i]));
-        }
-        CSP_CALLMPI(JUMP, PMPI_Waitall(CSP_ENV.num_g, reqs, MPI_STATUS_IGNORE));
     }
 
     /* Create shared buffer window. */
@@ -139,7 +178,9 @@ int CSPU_shmbuf_regist(CSPU_comm_t * ug_comm, MPI_Aint size, int disp_unit, MPI_
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     /* Cache the address and scope, used to translate user buffer address. */
-    CSPU_shmbuf_record_append(shmbuf_win->base, size, shmbuf_win->g_base_bound);
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+    shmbuf_record_insert(shmbuf_win->base, size, shmbuf_win->g_base_bound);
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
 
     (*base_pp) = shmbuf_win->base;
     (*win) = shmbuf_win->win;
@@ -151,8 +192,6 @@ int CSPU_shmbuf_regist(CSPU_comm_t * ug_comm, MPI_Aint size, int disp_unit, MPI_
          shmbuf_win, shmbuf_win->win, shmbuf_win->base, size, disp_unit, shmbuf_win->g_base_bound);
 
   fn_exit:
-    if (reqs)
-        free(reqs);
     return mpi_errno;
   fn_fail:
     goto fn_exit;
@@ -0,0 +1,5 @@
+#
+# Copyright (C) 2016. See COPYRIGHT in top-level directory.
+#
+
+libcasper_la_SOURCES += src/user/datatype/type_free.c
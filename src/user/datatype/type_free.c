@@ -0,0 +1,36 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+int MPI_Type_free(MPI_Datatype * datatype)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED)
+        return PMPI_Type_free(datatype);
+
+    /* Invalidate the datatype committed on ghosts for message offloading. */
+    if (CSP_IS_MODE_ENABLED(PT2PT) && (*datatype) != MPI_DATATYPE_NULL) {
+        /* The datatype database is accessed by offloaded calls in the channel
+         * critical section. */
+        CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+        mpi_errno = CSPU_datatype_free_ddt(*datatype);
+        CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
+    CSP_CALLMPI(JUMP, PMPI_Type_free(datatype));
+
+  fn_exit:
+    return mpi_errno;
+  fn_fail:
+    goto fn_exit;
+}
@@ -17,10 +17,10 @@
 #include "cspu_thread.h"
 #include "cspu_errhan.h"
 #include "cspu_comm.h"
-#include "csp_offload.h"
-#include "cspu_offload.h"
 #include "csp_datatype.h"
 #include "cspu_datatype.h"
+#include "csp_offload.h"
+#include "cspu_offload.h"
 #include "cspu_shmbuf.h"
 #include "cspu_profile.h"
 
@@ -65,12 +65,107 @@ typedef struct CSPU_win_info_args {
     int epochs_used;
     CSP_async_config_t async_config;
     char win_name[MPI_MAX_OBJECT_NAME + 1];
+    size_t put_combine_size;    /* size of write-combining buffer for PUT, 0 means disabled. */
+    unsigned short shm_direct;  /* PUT/GET to intra-node targets by load/store, enabled by default. */
+    unsigned short shm_atomics; /* FOP/CAS to intra-node targets by processor atomics, require
+                                 * accumulate_ops=same_op|same_op_no_op, disabled by default. */
 } CSPU_win_info_args_t;
 
+/* Buffer used in PUT write-combining. */
+typedef struct CSPU_put_wc_buf {
+    char *buf;
+    int target_rank;            /* target of the issued operation. */
+    struct CSPU_put_wc_buf *next;
+} CSPU_put_wc_buf_t;
+
+/* Write-combining stage of PUT operations. Only one (target, window, ghost)
+ * is staged at a time, see csp_put_combine.c. */
+typedef struct CSPU_put_wc {
+    CSPU_put_wc_buf_t *staging; /* NULL if no PUT is staged. */
+    int target_rank;
+    MPI_Win *win_ptr;
+    int target_g_rank_in_ug;
+    MPI_Aint target_g_offset;
+    MPI_Datatype datatype;
+    MPI_Aint start_disp;        /* target displacement of the first block in bytes. */
+    MPI_Aint stride;            /* distance between blocks in bytes, used only when nblocks > 1. */
+    int blocklen;               /* number of elements per block. */
+    int nblocks;
+    size_t used;                /* staged bytes. */
+
+    CSPU_put_wc_buf_t *issued_bufs;     /* issued buffers waiting for completion. */
+    CSPU_put_wc_buf_t *free_bufs;       /* completed buffers can be reused. */
+} CSPU_put_wc_t;
+
+/* Internal communicators derived from a user communicator, shared by all the
+ * windows allocated on the same group of user processes (see csp_ugcomm_cache.c). */
+typedef struct CSPU_ugcomm {
+    int id;                     /* same on all user processes of the group, also used by
+                                 * ghosts to find the cached ug_comm. */
+    int ref_count;              /* number of windows using the communicators. */
+    int is_complete;            /* set once the communicators are stored. */
+    int user_nprocs;
+    int *user_wranks;           /* key, rank of every user process in world. */
+
+    MPI_Comm local_user_comm;
+    MPI_Comm user_root_comm;
+    int node_id;
+    int num_nodes;
+
+    MPI_Comm ug_comm;
+    MPI_Group ug_group;
+    MPI_Comm local_ug_comm;
+    MPI_Group local_ug_group;
+    int num_g_ranks_in_ug;
+    int *g_ranks_in_ug;
+    int *target_g_ranks_in_ug;  /* user_nprocs * CSP_ENV.num_g */
+
+    struct CSPU_ugcomm *next;
+} CSPU_ugcomm_t;
+
+/* Block of the dynamic pool segment handed out by MPI_Alloc_mem. */
+typedef struct CSPU_dyn_pool_blk {
+    MPI_Aint off;               /* offset from the segment base */
+    MPI_Aint size;
+    int is_free;
+    struct CSPU_dyn_pool_blk *prev;
+    struct CSPU_dyn_pool_blk *next;
+} CSPU_dyn_pool_blk_t;
+
+/* Node-wide shared memory pool for the memory attached to dynamic windows
+ * (see csp_dyn_pool.c). Every user process owns a segment of the pool. */
+typedef struct CSPU_dyn_pool {
+#if defined(CSP_ENABLE_THREAD_SAFE)
+    CSP_thread_cs_t cs;
+#endif
+    MPI_Win win;                /* shared window on local_comm. */
+    void *base;                 /* base of my segment. */
+    MPI_Aint base_addr;         /* address of my segment. */
+    MPI_Aint size;              /* size of my segment, 0 if the pool is disabled. */
+    MPI_Aint *g_offsets;        /* CSP_ENV.num_g, address of my segment on each ghost
+                                 * minus my base_addr. */
+    CSPU_dyn_pool_blk_t *blks;  /* all blocks in the segment ordered by offset. */
+} CSPU_dyn_pool_t;
+
+/* User buffer of MPI_Win_create remapped to a memory file shared with local
+ * ghosts (see csp_win_remap.c). */
+typedef struct CSPU_win_remap {
+    void *base;                 /* user buffer. */
+    MPI_Aint size;
+    void *map_base;             /* page aligned start of the remapped pages. */
+    MPI_Aint map_size;          /* 0 if the user buffer is empty. */
+    int fd;                     /* memory file, closed once ghosts mapped it. */
+    MPI_Aint *g_addrs;          /* CSP_ENV.num_g, address of the user buffer on every
+                                 * local ghost. */
+    struct CSPU_win_remap *next;
+} CSPU_win_remap_t;
+
 typedef struct CSPU_win_target {
     MPI_Win ug_win;             /* Do not free the window, it is freed in ug_wins */
     int disp_unit;
     MPI_Aint size;
+    MPI_Aint dyn_base;          /* address of the target's pool segment on dynamic window,
+                                 * 0 for other windows. */
 
     MPI_Aint *base_g_offsets;   /* CSP_ENV.num_g */
     int *g_ranks_in_ug;         /* CSP_ENV.num_g */
@@ -81,6 +176,8 @@ typedef struct CSPU_win_target {
     int world_rank;             /* rank in world communicator */
     int user_world_rank;        /* rank in user world communicator */
     int node_id;
+    void *shm_base;             /* base address of the target in local shared window,
+                                 * NULL if it is not on the same node or shm_direct is disabled. */
 
     int main_g_off;
 #if defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
@@ -88,6 +185,11 @@ typedef struct CSPU_win_target {
 #endif
     CSPU_target_epoch_stat_t epoch_stat;        /* indicate which access epoch is opened for the target. */
 
+    unsigned short *g_dirty_flags;      /* CSP_ENV.num_g, set when any operation is issued to that
+                                         * ghost on the lock window since the last flush/unlock. */
+    unsigned short is_dirty;    /* whether the target is in dirty_targets of window. */
+    unsigned short is_lockall_locked;   /* whether the ghosts have been locked in the
+                                         * current lazy lock_all epoch. */
 } CSPU_win_target_t;
 
 typedef struct CSPU_win {
@@ -119,6 +221,7 @@ typedef struct CSPU_win {
     MPI_Comm user_root_comm;
 
     MPI_Comm local_user_comm;
+    CSPU_ugcomm_t *ugcomm;      /* cached communicators, NULL if not cached. */
     int max_local_user_nprocs;
     int num_nodes;
     int node_id;
@@ -133,6 +236,23 @@ typedef struct CSPU_win {
     int lock_counter;
     int start_counter;
 
+    /* Track which ghosts received operations, thus flush and unlock only
+     * need to touch those ghosts. */
+    int *dirty_targets;         /* ranks of targets issued operations on lock windows. */
+    int num_dirty_targets;
+    unsigned short *g_dirty_flags_in_ug;        /* indexed by ghost rank in ug_comm, set when
+                                                 * any operation is issued to that ghost on
+                                                 * global window since the last flush. */
+    /* In lock-exist mode, lock_all only records the lock intent, the ghosts of a
+     * target are locked when the first operation is issued to that target. */
+    unsigned short is_lockall_lazy;
+    int lockall_assert;
+    int *lockall_locked_targets;        /* ranks of targets locked in the current lock_all. */
+    int num_lockall_locked_targets;
+
+    unsigned short is_shm_direct_issued;        /* set when any PUT/GET is done by load/store
+                                                 * since the last flush. */
+
     MPI_Win global_win;         /* global window used in active epochs, and lockall epoch in no-lock mode. */
 
     MPI_Group start_group;
@@ -152,15 +272,19 @@ typedef struct CSPU_win {
 #endif
 
     CSPU_win_info_args_t info_args;
+    CSPU_put_wc_t put_wc;
 
 #if defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
     int prev_g_off;
     int *g_ops_counts;          /* cnt = g_ops_counts[g_rank_in_ug] */
     unsigned long *g_bytes_counts;      /* byte = g_ops_bytes[g_rank_in_ug] */
+    double *g_op_latencies;     /* estimated completion time per operation,
+                                 * lat = g_op_latencies[g_rank_in_ug] */
 #endif
 
     /* constant flavor attribute to override real flavor when user queries. */
     int create_flavor;
+    CSPU_win_remap_t *remap;    /* remapped user buffer of MPI_Win_create, NULL otherwise. */
 
 } CSPU_win_t;
 
@@ -194,7 +318,8 @@ typedef struct CSPU_win {
  * Because we changed it at operation redirection, it would be more user-friendly
  * if we check invalid displacement value here rather than in MPI.*/
 #define CSPU_TARGET_CHECK_OP_DISP(target_disp, target) do {                       \
-        if (target_disp < 0 || target_disp * target->disp_unit > target->size) {  \
+        if (target_disp * target->disp_unit < target->dyn_base ||                 \
+            target_disp * target->disp_unit > target->dyn_base + target->size) {  \
             CSP_msg_print(CSP_MSG_ERROR, "Wrong target displacement(%ld) in %s\n",\
                           target_disp, __FUNCTION__);                             \
             mpi_errno = MPI_ERR_DISP;                                             \
@@ -319,6 +444,89 @@ extern const char *CSPU_win_epoch_stat_name[4];
  * PER-TARGET includes PSCW and LOCK.*/
 #define CSPU_WIN_GET_EPOCH_STAT_NAME(ug_win) (CSPU_win_epoch_stat_name[ug_win->epoch_stat])
 
+/* ======================================================================
+ * Operation tracking related routines.
+ * ====================================================================== */
+
+/* Mark a ghost of the target as dirty when an operation is redirected to it.
+ * Operations on global window are tracked per ghost, because a flush on that
+ * window completes all operations to the ghost no matter which target they were
+ * issued for. Operations on lock windows are tracked per target. */
+static inline void CSPU_target_set_dirty(int target_rank, int g_off, CSPU_win_t * ug_win)
+{
+    CSPU_win_target_t *target = &(ug_win->targets[target_rank]);
+    MPI_Win *win_ptr = NULL;
+
+    CSPU_TARGET_GET_EPOCH_WIN(target, ug_win, win_ptr);
+    if (win_ptr == &ug_win->global_win) {
+        ug_win->g_dirty_flags_in_ug[target->g_ranks_in_ug[g_off]] = 1;
+        return;
+    }
+
+    target->g_dirty_flags[g_off] = 1;
+    if (!target->is_dirty) {
+        target->is_dirty = 1;
+        ug_win->dirty_targets[ug_win->num_dirty_targets++] = target_rank;
+    }
+}
+
+/* Check whether any operation has been issued to a ghost of the target on the given window. */
+static inline int CSPU_target_is_dirty(CSPU_win_target_t * target, int g_off, MPI_Win * win_ptr,
+                                       CSPU_win_t * ug_win)
+{
+    if (win_ptr == &ug_win->global_win)
+        return ug_win->g_dirty_flags_in_ug[target->g_ranks_in_ug[g_off]];
+    return target->g_dirty_flags[g_off];
+}
+
+/* Clear the dirty flag of a ghost of the target once its operations are completed. */
+static inline void CSPU_target_reset_g_dirty(CSPU_win_target_t * target, int g_off,
+                                             MPI_Win * win_ptr, CSPU_win_t * ug_win)
+{
+    if (win_ptr == &ug_win->global_win)
+        ug_win->g_dirty_flags_in_ug[target->g_ranks_in_ug[g_off]] = 0;
+    else
+        target->g_dirty_flags[g_off] = 0;
+}
+
+/* Clear all dirty flags of the target on its lock window.
+ * The target is still kept in dirty list till the window-level reset. */
+static inline void CSPU_target_reset_dirty(int target_rank, CSPU_win_t * ug_win)
+{
+    memset(ug_win->targets[target_rank].g_dirty_flags, 0, sizeof(unsigned short) * CSP_ENV.num_g);
+}
+
+/* Reset every target in dirty list. It is called after operations on all lock
+ * windows are completed (i.e., FLUSH_ALL/UNLOCK_ALL in lock-exist mode). */
+static inline void CSPU_win_reset_dirty_targets(CSPU_win_t * ug_win)
+{
+    int i;
+
+    for (i = 0; i < ug_win->num_dirty_targets; i++) {
+        int target_rank = ug_win->dirty_targets[i];
+
+        CSPU_target_reset_dirty(target_rank, ug_win);
+        ug_win->targets[target_rank].is_dirty = 0;
+    }
+    ug_win->num_dirty_targets = 0;
+}
+
+/* ======================================================================
+ * Lazy lock_all related routines.
+ * ====================================================================== */
+
+extern int CSPU_win_lockall_lock_target(int target_rank, CSPU_win_t * ug_win);
+
+/* Lock the ghosts of the target if it is the first operation to that target
+ * in a lazy lock_all epoch. It must be called before any operation is issued
+ * to the target's lock window. */
+static inline int CSPU_target_check_lazy_lock(int target_rank, CSPU_win_t * ug_win)
+{
+    if (ug_win->is_lockall_lazy && !ug_win->targets[target_rank].is_lockall_locked)
+        return CSPU_win_lockall_lock_target(target_rank, ug_win);
+    return MPI_SUCCESS;
+}
+
 /* ======================================================================
  * Runtime load balancing related routine.
  * ====================================================================== */
@@ -346,7 +554,8 @@ static inline void CSPU_reset_target_opload_bytes_counting(int target_rank, CSPU
 
 static inline void CSPU_reset_target_opload(int target_rank, CSPU_win_t * ug_win)
 {
-    if (CSP_ENV.load_opt == CSP_LOAD_OPT_COUNTING) {
+    /* Feedback option counts operations issued since last completion. */
+    if (CSP_ENV.load_opt == CSP_LOAD_OPT_COUNTING || CSP_ENV.load_opt == CSP_LOAD_OPT_FEEDBACK) {
         CSPU_reset_target_opload_op_counting(target_rank, ug_win);
     }
     else if (CSP_ENV.load_opt == CSP_LOAD_BYTE_COUNTING) {
@@ -367,6 +576,43 @@ static inline void CSPU_inc_target_opload_bytes_counting(int g_rank_in_ug, int s
     CSP_DBG_PRINT("[load_opt_byte] increment ghost %d\n", g_rank_in_ug);
 }
 
+/* Weight of the latest sample in the estimated per-operation latency. */
+#define CSPU_OPLOAD_FEEDBACK_WEIGHT 0.25
+
+/* Start timing a completion call on a ghost for feedback load balancing. */
+static inline double CSPU_opload_feedback_start(void)
+{
+    return (CSP_ENV.load_opt == CSP_LOAD_OPT_FEEDBACK) ? PMPI_Wtime() : 0.0;
+}
+
+/* Update the estimated per-operation latency of a ghost once a completion call
+ * (flush or unlock) returns. Because the ghost serves all processes in the same
+ * order, the completion time also reflects the contention from other origins.
+ * It must be called before the operation counting is reset. */
+static inline void CSPU_opload_feedback_update(int g_rank_in_ug, double t_start,
+                                               CSPU_win_t * ug_win)
+{
+    int ops;
+    double lat;
+
+    if (CSP_ENV.load_opt != CSP_LOAD_OPT_FEEDBACK)
+        return;
+
+    ops = ug_win->g_ops_counts[g_rank_in_ug];
+    if (ops == 0)
+        return;
+
+    lat = (PMPI_Wtime() - t_start) / ops;
+    if (ug_win->g_op_latencies[g_rank_in_ug] == 0.0)
+        ug_win->g_op_latencies[g_rank_in_ug] = lat;
+    else
+        ug_win->g_op_latencies[g_rank_in_ug] += CSPU_OPLOAD_FEEDBACK_WEIGHT *
+            (lat - ug_win->g_op_latencies[g_rank_in_ug]);
+
+    CSP_DBG_PRINT("[load_opt_feedback] ghost %d completed %d ops, latency %.2lf us\n",
+                  g_rank_in_ug, ops, ug_win->g_op_latencies[g_rank_in_ug] * 1e6);
+}
+
 static inline int CSPU_win_grant_lock(int target_rank, CSPU_win_t * ug_win)
 {
     int mpi_errno = MPI_SUCCESS;
@@ -412,6 +658,11 @@ extern void CSPU_target_get_ghost_opload_by_byte(int target_rank, int is_order_r
                                                  int *target_g_rank_in_ug,
                                                  int *target_g_rank_idx,
                                                  MPI_Aint * target_g_offset);
+extern void CSPU_target_get_ghost_opload_by_feedback(int target_rank, int is_order_required,
+                                                     CSPU_win_t * ug_win,
+                                                     int *target_g_rank_in_ug,
+                                                     int *target_g_rank_idx,
+                                                     MPI_Aint * target_g_offset);
 
 /**
  * Get ghost with dynamic load balancing.
@@ -424,6 +675,9 @@ static inline int CSPU_target_get_ghost(int target_rank, int is_order_required,
     int main_g_off = ug_win->targets[target_rank].main_g_off;
     int g_idx = 0;
 
+    mpi_errno = CSPU_target_check_lazy_lock(target_rank, ug_win);
+    CSP_CHKMPIFAIL_RETURN(mpi_errno);
+
     /* Force lock when the first operation is issued. Note that nocheck epoch
      * does not need it because no conflicting lock.*/
     if (CSP_ENV.load_lock == CSP_LOAD_LOCK_FORCE &&
@@ -451,9 +705,10 @@ static inline int CSPU_target_get_ghost(int target_rank, int is_order_required,
         CSP_DBG_PRINT("[load_opt] use main ghost %d, off 0x%lx for target %d "
                       "(main h off %d)\n",
                       *target_g_rank_in_ug, *target_g_offset, target_rank, main_g_off);
+        CSPU_target_set_dirty(target_rank, main_g_off, ug_win);
 
         /* Need increase counters */
-        if (CSP_ENV.load_opt == CSP_LOAD_OPT_COUNTING) {
+        if (CSP_ENV.load_opt == CSP_LOAD_OPT_COUNTING || CSP_ENV.load_opt == CSP_LOAD_OPT_FEEDBACK) {
             CSPU_inc_target_opload_op_counting(*target_g_rank_in_ug, ug_win);
         }
         else if (CSP_ENV.load_opt == CSP_LOAD_BYTE_COUNTING) {
@@ -476,9 +731,88 @@ static inline int CSPU_target_get_ghost(int target_rank, int is_order_required,
         CSPU_target_get_ghost_opload_by_byte(target_rank, is_order_required, size,
                                              ug_win, target_g_rank_in_ug, &g_idx, target_g_offset);
     }
+    else if (CSP_ENV.load_opt == CSP_LOAD_OPT_FEEDBACK) {
+        CSPU_target_get_ghost_opload_by_feedback(target_rank, is_order_required, ug_win,
+                                                 target_g_rank_in_ug, &g_idx, target_g_offset);
+    }
+    CSPU_target_set_dirty(target_rank, g_idx, ug_win);
+
+    return mpi_errno;
+}
+
+/**
+ * Get ghost for accumulate-like operations by address stripe.
+ * The window segment of every target is partitioned into stripes of
+ * CSP_RUNTIME_LOAD_ACC_STRIPE bytes, and stripe i is always handled by ghost
+ * (i % num_g). Thus accumulates on the same address are always applied by the
+ * same ghost (atomicity and ordering are kept), whereas accumulates on different
+ * stripes are spread over all ghosts. The stripe is decided by the first byte of
+ * the operation, the caller should split the operation at stripe boundaries
+ * (see CSPU_acc_stripe_count). Fall back to main ghost when striping is disabled.
+ */
+static inline int CSPU_target_get_acc_ghost(int target_rank, MPI_Aint target_byte_disp,
+                                            int size, CSPU_win_t * ug_win,
+                                            int *target_g_rank_in_ug, MPI_Aint * target_g_offset)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_win_target_t *target = &(ug_win->targets[target_rank]);
+    MPI_Win *win_ptr = NULL;
+    int main_g_off = target->main_g_off;
+    int g_idx = 0;
+
+    if (CSP_ENV.load_acc_stripe == 0 || CSP_ENV.num_g == 1)
+        return CSPU_target_get_ghost(target_rank, 1, size, ug_win, target_g_rank_in_ug,
+                                     target_g_offset);
+
+    mpi_errno = CSPU_target_check_lazy_lock(target_rank, ug_win);
+    CSP_CHKMPIFAIL_RETURN(mpi_errno);
+
+    /* Non-main ghosts are locked as shared, so we cannot use them until the main
+     * lock is granted. Unlike other operations, accumulates cannot go to the main
+     * ghost in the meantime, thus force granting lock here. Note that nocheck
+     * epoch and epochs on global window do not need it because no conflicting lock. */
+    CSPU_TARGET_GET_EPOCH_WIN(target, ug_win, win_ptr);
+    if (win_ptr != &ug_win->global_win && !(target->remote_lock_assert & MPI_MODE_NOCHECK) &&
+        target->main_lock_stat != CSPU_MAIN_LOCK_GRANTED) {
+        if (target->main_lock_stat == CSPU_MAIN_LOCK_RESET) {
+            /* Lock may be delayed till the first operation, simply get 1 byte
+             * from the address that will be updated. */
+            char buf[1];
+            CSP_CALLMPI(RETURN, PMPI_Get(buf, 1, MPI_CHAR, target->g_ranks_in_ug[main_g_off],
+                                         target->base_g_offsets[main_g_off] + target_byte_disp,
+                                         1, MPI_CHAR, target->ug_win));
+        }
+        mpi_errno = CSPU_win_grant_lock(target_rank, ug_win);
+        CSP_CHKMPIFAIL_RETURN(mpi_errno);
+    }
+
+    g_idx = (int) ((target_byte_disp / CSP_ENV.load_acc_stripe) % CSP_ENV.num_g);
+    *target_g_rank_in_ug = target->g_ranks_in_ug[g_idx];
+    *target_g_offset = target->base_g_offsets[g_idx];
+    CSP_DBG_PRINT("[load_opt_stripe] use ghost %d, off 0x%lx for target %d byte_disp 0x%lx\n",
+                  *target_g_rank_in_ug, *target_g_offset, target_rank, target_byte_disp);
+    CSPU_target_set_dirty(target_rank, g_idx, ug_win);
+
+    if (CSP_ENV.load_opt == CSP_LOAD_OPT_COUNTING || CSP_ENV.load_opt == CSP_LOAD_OPT_FEEDBACK) {
+        CSPU_inc_target_opload_op_counting(*target_g_rank_in_ug, ug_win);
+    }
+    else if (CSP_ENV.load_opt == CSP_LOAD_BYTE_COUNTING) {
+        CSPU_inc_target_opload_bytes_counting(*target_g_rank_in_ug, size, ug_win);
+    }
 
     return mpi_errno;
 }
+
+/* Get the number of elements (at least one) that can be issued from the given
+ * byte displacement without crossing the stripe boundary. An element crossing
+ * the boundary belongs to the stripe where it starts. */
+static inline int CSPU_acc_stripe_count(MPI_Aint target_byte_disp, int type_size, int count)
+{
+    MPI_Aint remain = CSP_ENV.load_acc_stripe - target_byte_disp % CSP_ENV.load_acc_stripe;
+    MPI_Aint n = (remain + type_size - 1) / type_size;
+
+    return (n < count) ? (int) n : count;
+}
 #else
 /**
  * Get ghost that is statically bound with the target.
@@ -490,12 +824,35 @@ static inline int CSPU_target_get_ghost(int target_rank, int is_order_required C
     int mpi_errno = MPI_SUCCESS;
     int main_g_off = ug_win->targets[target_rank].main_g_off;
 
+    mpi_errno = CSPU_target_check_lazy_lock(target_rank, ug_win);
+    CSP_CHKMPIFAIL_RETURN(mpi_errno);
+
     *target_g_rank_in_ug = ug_win->targets[target_rank].g_ranks_in_ug[main_g_off];
     *target_g_offset = ug_win->targets[target_rank].base_g_offsets[main_g_off];
     CSP_DBG_PRINT("[opt_non] use main ghost %d, off 0x%lx for target %d\n",
                   *target_g_rank_in_ug, *target_g_offset, target_rank);
+    CSPU_target_set_dirty(target_rank, main_g_off, ug_win);
     return mpi_errno;
 }
+
+static inline double CSPU_opload_feedback_start(void)
+{
+    return 0.0;
+}
+
+static inline void CSPU_opload_feedback_update(int g_rank_in_ug CSP_ATTRIBUTE((unused)),
+                                               double t_start CSP_ATTRIBUTE((unused)),
+                                               CSPU_win_t * ug_win CSP_ATTRIBUTE((unused)))
+{
+}
+
+static inline int CSPU_target_get_acc_ghost(int target_rank, MPI_Aint target_byte_disp CSP_ATTRIBUTE((unused)),     /* arguments used only in dynamic load */
+                                            int size, CSPU_win_t * ug_win,
+                                            int *target_g_rank_in_ug, MPI_Aint * target_g_offset)
+{
+    return CSPU_target_get_ghost(target_rank, 1, size, ug_win, target_g_rank_in_ug,
+                                 target_g_offset);
+}
 #endif
 
 
@@ -503,6 +860,30 @@ static inline int CSPU_target_get_ghost(int target_rank, int is_order_required C
  * Other prototypes
  * ====================================================================== */
 
+/* Check whether the datatype is a predefined type without holes, thus data
+ * can be transferred by plain memory copy. */
+static inline int CSPU_datatype_check_contig(MPI_Datatype datatype, int *type_size,
+                                             int *is_contig)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int num_integers = 0, num_addresses = 0, num_datatypes = 0, combiner = 0;
+    MPI_Aint lb = 0, extent = 0;
+
+    (*is_contig) = 0;
+    CSP_CALLMPI(RETURN, PMPI_Type_get_envelope(datatype, &num_integers, &num_addresses,
+                                               &num_datatypes, &combiner));
+    if (combiner != MPI_COMBINER_NAMED)
+        return mpi_errno;
+
+    /* Pair types (e.g., MPI_FLOAT_INT) may contain holes. */
+    CSP_CALLMPI(RETURN, PMPI_Type_size(datatype, type_size));
+    CSP_CALLMPI(RETURN, PMPI_Type_get_extent(datatype, &lb, &extent));
+    if (lb == 0 && extent == (*type_size))
+        (*is_contig) = 1;
+
+    return mpi_errno;
+}
+
 static inline int CSPU_info_get_bool(MPI_Info info, const char *key, const char *true_str,
                                      const char *false_str, unsigned short *val_ptr)
 {
@@ -516,7 +897,7 @@ static inline int CSPU_info_get_bool(MPI_Info info, const char *key, const char
         if (!strncmp(info_value, true_str, strlen(true_str))) {
             (*val_ptr) = 1;
         }
-        else if (!strncmp(info_value, true_str, strlen(true_str))) {
+        else if (!strncmp(info_value, false_str, strlen(false_str))) {
             (*val_ptr) = 0;
         }
     }
@@ -528,8 +909,91 @@ extern int CSPU_mlock_init(void);
 extern int CSPU_mlock_destroy(void);
 
 extern int CSPU_win_bind_ghosts(CSPU_win_t * ug_win);
+
+extern int CSPU_ugcomm_cache_get(MPI_Comm user_comm, CSPU_ugcomm_t ** ugcomm, int *cached);
+extern void CSPU_ugcomm_cache_load(CSPU_win_t * ug_win);
+extern void CSPU_ugcomm_cache_store(CSPU_win_t * ug_win);
+extern int CSPU_ugcomm_cache_release(CSPU_win_t * ug_win);
+
+extern int CSPU_put_wc_stage(const void *origin_addr, int origin_count,
+                             MPI_Datatype origin_datatype, int target_rank, MPI_Aint target_disp,
+                             int target_count, MPI_Datatype target_datatype, CSPU_win_t * ug_win,
+                             int *staged);
+extern int CSPU_put_wc_drain(CSPU_win_t * ug_win);
+extern void CSPU_put_wc_complete(int target_rank, CSPU_win_t * ug_win);
+extern void CSPU_put_wc_destroy(CSPU_win_t * ug_win);
+
+/* Issue staged PUTs before synchronizing with a target (or all targets if
+ * target_rank is MPI_ANY_SOURCE). */
+static inline int CSPU_put_wc_drain_target(int target_rank, CSPU_win_t * ug_win)
+{
+    if (ug_win->put_wc.staging == NULL ||
+        (target_rank != MPI_ANY_SOURCE && ug_win->put_wc.target_rank != target_rank))
+        return MPI_SUCCESS;
+    return CSPU_put_wc_drain(ug_win);
+}
+
+extern int CSPU_win_query_shm_bases(CSPU_win_t * ug_win);
+extern int CSPU_shm_direct_put(const void *origin_addr, int origin_count,
+                               MPI_Datatype origin_datatype, int target_rank,
+                               MPI_Aint target_disp, int target_count,
+                               MPI_Datatype target_datatype, CSPU_win_t * ug_win, int *done);
+extern int CSPU_shm_direct_get(void *origin_addr, int origin_count,
+                               MPI_Datatype origin_datatype, int target_rank,
+                               MPI_Aint target_disp, int target_count,
+                               MPI_Datatype target_datatype, CSPU_win_t * ug_win, int *done);
+
+#ifdef HAVE_GCC_ATOMIC_BUILTINS
+extern int CSPU_shm_direct_fop(const void *origin_addr, void *result_addr,
+                               MPI_Datatype datatype, int target_rank, MPI_Aint target_disp,
+                               MPI_Op op, CSPU_win_t * ug_win, int *done);
+extern int CSPU_shm_direct_cas(const void *origin_addr, const void *compare_addr,
+                               void *result_addr, MPI_Datatype datatype, int target_rank,
+                               MPI_Aint target_disp, CSPU_win_t * ug_win, int *done);
+#endif
+
+/* Memory barrier for the PUT/GETs done by load/store, called at flush and unlock.
+ * It is equivalent to MPI_Win_sync on the local shared window. */
+static inline void CSPU_win_shm_direct_sync(CSPU_win_t * ug_win)
+{
+    if (ug_win->is_shm_direct_issued) {
+        OPA_read_write_barrier();
+        ug_win->is_shm_direct_issued = 0;
+    }
+}
+
 extern int CSPU_win_release(CSPU_win_t * ug_win);
 
+extern int CSPU_win_create_dynamic(MPI_Info info, MPI_Comm user_comm, MPI_Win * win);
+extern int CSPU_win_create(void *base, MPI_Aint size, int disp_unit, MPI_Info info,
+                           MPI_Comm user_comm, MPI_Win * win);
+
 extern int CSPU_datatype_init(void);
 extern int CSPU_datatype_destroy(void);
+
+extern CSPU_dyn_pool_t CSPU_dyn_pool;
+extern int CSPU_dyn_pool_init(void);
+extern int CSPU_dyn_pool_destroy(void);
+extern void *CSPU_dyn_pool_alloc(MPI_Aint size);
+extern int CSPU_dyn_pool_free(void *ptr);
+extern int CSPU_dyn_pool_attach(MPI_Win win);
+extern int CSPU_dyn_pool_detach(MPI_Win win);
+
+#define CSPU_DYN_POOL_ENABLED() (CSPU_dyn_pool.size > 0)
+
+/* Check whether the memory region is located in my pool segment. */
+static inline int CSPU_dyn_pool_contains(const void *ptr, MPI_Aint size)
+{
+    return CSPU_DYN_POOL_ENABLED() && (const char *) ptr >= (char *) CSPU_dyn_pool.base &&
+        (const char *) ptr + size <= (char *) CSPU_dyn_pool.base + CSPU_dyn_pool.size;
+}
+
+extern int CSPU_win_remap_enabled;
+extern int CSPU_win_remap_init(void);
+extern int CSPU_win_remap_destroy(void);
+extern int CSPU_win_remap(void *base, MPI_Aint size, CSPU_win_remap_t ** remap_ptr);
+extern void CSPU_win_remap_release(CSPU_win_remap_t * remap);
+extern int CSPU_win_remap_exchange(CSPU_win_t * ug_win);
+extern int CSPU_win_remap_attach(CSPU_win_remap_t * remap, MPI_Win win);
+extern int CSPU_win_remap_detach(CSPU_win_remap_t * remap, MPI_Win win);
 #endif /* CSPU_H_INCLUDED */
@@ -18,19 +18,48 @@
 #define CSPU_CWP_DBG_PRINT(str,...) do { } while (0)
 #endif
 
-/* Issue a command to the local ghost processes (blocking call).
- * It is usually called by only the local user root process, except finalize. */
-static inline int CSPU_cwp_issue(CSP_cwp_pkt_t * pkt)
-{
-    int mpi_errno = MPI_SUCCESS;
-
-    CSPU_CWP_DBG_PRINT(" send CMD %d to local ghost %d\n", pkt->cmd_type,
-                       CSP_PROC.user.g_lranks[0]);
-    CSP_CALLMPI(RETURN, PMPI_Send((char *) pkt, sizeof(CSP_cwp_pkt_t), MPI_CHAR,
-                                  CSP_PROC.user.g_lranks[0], CSP_CWP_TAG, CSP_PROC.local_comm));
-    return mpi_errno;
-}
-
+/* Command issued asynchronously but not yet written into the ring. */
+typedef struct CSPU_cwp_deferred_cmd {
+    CSP_cwp_pkt_t pkt;
+    struct CSPU_cwp_deferred_cmd *next;
+} CSPU_cwp_deferred_cmd_t;
+
+typedef struct CSPU_cwp_channel {
+    MPI_Win shm_win;            /* Shared memory window of the command ring. */
+    CSP_cwp_ring_t *ring;       /* Allocated on the first local ghost. */
+    int local_rank;             /* My rank in CSP_PROC.local_comm. */
+    CSPU_cwp_deferred_cmd_t *deferred_q;        /* Asynchronous commands issued when the ring
+                                                 * was full, written in order before any
+                                                 * later command. */
+#if defined(CSP_ENABLE_THREAD_SAFE)
+    CSP_thread_cs_t cs;         /* protects deferred_q,
+                                 * initialized only when is_thread_multiple is set. */
+#endif
+} CSPU_cwp_channel_t;
+
+extern CSPU_cwp_channel_t CSPU_cwp_ch;
+
+extern int CSPU_cwp_init(void);
+extern int CSPU_cwp_destroy(void);
+
+/* Issue a command to the local ghost processes.
+ * It is usually called by only the local user root process, except finalize.
+ * The command is written into the shared command ring and read by all local
+ * ghosts. It returns immediately unless the ring is full; then it waits with
+ * MPI progress until the ghosts release a slot. */
+extern int CSPU_cwp_issue(CSP_cwp_pkt_t * pkt);
+
+/* Issue a command with one parameter for every local ghost (g_params[i] for
+ * the ghost with local rank i). The parameters are carried in the ring slot,
+ * or sent as messages with CSP_CWP_PARAM_TAG if there are too many ghosts
+ * (see CSPG_cwp_get_g_param). */
+extern int CSPU_cwp_issue_g_params(CSP_cwp_pkt_t * pkt, MPI_Aint * g_params);
+
+/* Issue a command without waiting for any ghost (e.g., DATATYPE_FREE that
+ * has no response). It never blocks; if the ring is full, the command is
+ * deferred and written by a later issue call. Because the ghosts may be
+ * blocked in a collective call with this process, waiting here can deadlock. */
+extern int CSPU_cwp_issue_async(CSP_cwp_pkt_t * pkt);
 
 /* Broadcast parameters to all the local ghosts (blocking call).
  * It is usually called by only the local user root process after issued the header packet. */
@@ -18,10 +18,20 @@
 #define CSP_DDT_DBG_PRINT(str,...) do {} while (0)
 #endif
 
+/* Derived datatype committed on a ghost. It is freed on the ghost once the user
+ * has freed the datatype and every offloaded call using it is completed. */
+typedef struct CSPU_datatype_ddt {
+    int g_lrank;
+    MPI_Datatype g_handle;
+    int ref_count;              /* Number of shared or pending cells using it. */
+    int is_released;            /* 1 if the user has freed the datatype. */
+} CSPU_datatype_ddt_t;
+
 typedef struct CSPU_datatype_g_hash_record {
     UT_hash_handle hh;
     MPI_Datatype key;           /* Local datatype handle is the key */
     MPI_Datatype g_handle;
+    CSPU_datatype_ddt_t *ddt;   /* Only set for derived datatype. */
 } CSPU_datatype_g_hash_record_t;
 
 typedef struct CSPU_datatype_g_hash {
@@ -33,10 +43,39 @@ typedef struct CSPU_datatype_db {
 
     /* predefined datatype mapping for each ghost process */
     CSPU_datatype_g_hash_t *g_predefined_hashs;
+
+    /* derived datatype mapping for each ghost process, a datatype is committed
+     * on the ghost at first offloading and removed at MPI_Type_free. */
+    CSPU_datatype_g_hash_t *g_derived_hashs;
 } CSPU_datatype_db_t;
 
 extern CSPU_datatype_db_t CSPU_datatype_db;
 
+extern int CSPU_datatype_regist_ddt(MPI_Datatype datatype, int ghost_lrank,
+                                    MPI_Datatype * g_handle_ptr);
+extern int CSPU_datatype_free_ddt(MPI_Datatype datatype);
+extern void CSPU_datatype_ddt_free(CSPU_datatype_ddt_t * ddt);
+
+/* Hold the derived datatype for an offloaded call (or a chunk of it). */
+static inline void CSPU_datatype_ddt_hold(void *ddt)
+{
+    if (ddt)
+        ((CSPU_datatype_ddt_t *) ddt)->ref_count++;
+}
+
+/* Release the derived datatype when an offloaded call (or a chunk of it) is
+ * completed. It is freed on the ghost if the user has freed it. */
+static inline void CSPU_datatype_ddt_release(void *ddt)
+{
+    CSPU_datatype_ddt_t *d = (CSPU_datatype_ddt_t *) ddt;
+
+    if (d == NULL)
+        return;
+    CSP_DBG_ASSERT(d->ref_count > 0);
+    if (--d->ref_count == 0 && d->is_released)
+        CSPU_datatype_ddt_free(d);
+}
+
 static inline void CSPU_datatype_g_hash_add(CSPU_datatype_g_hash_t * hash, MPI_Datatype my_handle,
                                             MPI_Datatype g_handle)
 {
@@ -75,6 +114,15 @@ static inline void CSPU_datatype_g_hash_get(CSPU_datatype_g_hash_t hash, MPI_Dat
     }
 }
 
+static inline CSPU_datatype_g_hash_record_t *CSPU_datatype_g_hash_find(CSPU_datatype_g_hash_t hash,
+                                                                       MPI_Datatype my_handle)
+{
+    CSPU_datatype_g_hash_record_t *record = NULL;
+
+    HASH_FIND(hh, (hash.record), &my_handle, sizeof(MPI_Datatype), record);
+    return record;
+}
+
 static inline void CSPU_datatype_g_hash_remove(CSPU_datatype_g_hash_t * hash,
                                                MPI_Datatype my_handle)
 {
@@ -96,20 +144,42 @@ static inline int CSPU_datatype_g_hash_count(CSPU_datatype_g_hash_t hash)
     return HASH_COUNT(hash.record);
 }
 
+/* Get the datatype handle on the ghost process. For derived datatype, the
+ * offloaded call holds it in ddt_ptr, which is released at completion. */
 static inline int CSPU_datatype_get_g_handle(MPI_Datatype myhandle, int ghost_lrank,
-                                             MPI_Datatype * g_handle_ptr)
+                                             MPI_Datatype * g_handle_ptr, void **ddt_ptr)
 {
     int mpi_errno = MPI_SUCCESS;
     MPI_Datatype g_handle = MPI_DATATYPE_NULL;
     int nints, naddrs, ndtypes, combiner;
     int found = 0;
 
+    (*ddt_ptr) = NULL;
     CSP_CALLMPI(JUMP, PMPI_Type_get_envelope(myhandle, &nints, &naddrs, &ndtypes, &combiner));
 
     if (combiner == MPI_COMBINER_NAMED) {
         CSPU_datatype_g_hash_get(CSPU_datatype_db.g_predefined_hashs[ghost_lrank],
                                  myhandle, &g_handle, &found);
     }
+    else {
+        CSPU_datatype_g_hash_record_t *record = NULL;
+
+        record = CSPU_datatype_g_hash_find(CSPU_datatype_db.g_derived_hashs[ghost_lrank],
+                                           myhandle);
+
+        /* First use on this ghost, commit it on the ghost. */
+        if (record == NULL) {
+            mpi_errno = CSPU_datatype_regist_ddt(myhandle, ghost_lrank, &g_handle);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+            record = CSPU_datatype_g_hash_find(CSPU_datatype_db.g_derived_hashs[ghost_lrank],
+                                               myhandle);
+        }
+        g_handle = record->g_handle;
+        found = 1;
+
+        CSPU_datatype_ddt_hold(record->ddt);
+        (*ddt_ptr) = record->ddt;
+    }
 
     /* Must be found in one of the hashes.
      * Not sure if DATATYPE_NULL is a valid datatype on other processes,
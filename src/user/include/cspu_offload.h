@@ -18,6 +18,33 @@ typedef struct CSPU_offload_req_hash {
     CSP_offload_cell_t *record;
 } CSPU_offload_req_hash_t;
 
+/* Pre-allocated request handle for offloaded call. The handle is an inactive
+ * persistent request reserved at initialization, thus issuing and completing
+ * an offloaded call through it never enter the MPI request machinery. */
+typedef struct CSPU_offload_req_slot {
+    MPI_Request req;
+    CSP_offload_cell_t *assign_cell;    /* The cell assigned at request creation.
+                                         * A pending one is released at completion. */
+} CSPU_offload_req_slot_t;
+
+/* Send message split into chunks, each offloaded by a separate cell. The request of
+ * the first chunk is exposed to user and completes once all chunks completed.
+ * If the user buffer is not registered, every chunk is copied into a bounce
+ * buffer before moving to the shared queue. */
+typedef struct CSPU_offload_pipe {
+    const char *buf;            /* User buffer to be staged, or NULL if registered. */
+    MPI_Request req;            /* Request of the first chunk. */
+    int nchunks;
+    int ncompleted;
+} CSPU_offload_pipe_t;
+
+/* Slab of local pending cells. See pending_arena in CSP_offload_channel_t. */
+#define CSPU_OFFLOAD_PENDING_SLAB_NCELLS 64
+typedef struct CSPU_offload_pending_slab {
+    struct CSPU_offload_pending_slab *next;
+    CSP_offload_cell_t cells[CSPU_OFFLOAD_PENDING_SLAB_NCELLS];
+} CSPU_offload_pending_slab_t;
+
 /* User offload structure for pt2pt and collectives. */
 typedef struct CSP_offload_channel {
     MPI_Aint shm_base;
@@ -36,6 +63,9 @@ typedef struct CSP_offload_channel {
         int noutstanding;
     } shm_recvq;
 
+    /* Shared completion queue, enqueued by a ghost and dequeued by local user. */
+    CSP_offload_cmplq_t *shm_cmplq_ptr;
+
     /* Local stack holds free shared cells.
      * Each element is preallocated from shared memory region, thus
      * avoid copy when move from/to shm_recvq. */
@@ -44,20 +74,85 @@ typedef struct CSP_offload_channel {
         int count;              /* DEBUG only */
     } freestk;
 
+    /* Node-wide pool of shared cells, borrowed when freestk is empty and
+     * returned once the offloaded call is done. */
+    struct {
+        CSP_offload_pool_t *ptr;        /* NULL if the pool is disabled. */
+        MPI_Aint cells_base;
+        MPI_Aint cells_end;
+        char *slots_base;
+        int nborrowed;
+        int nissued;            /* DEBUG only */
+    } pool;
+
     /* Local queue holds pending cells when no free shared cell available.
-     * Each element allocates additional local memory.
-     * TODO: how to avoid copy when move pending cell to recvq ? */
+     * Elements come from pending_arena. The packet is copied into a free
+     * shared cell once available, then the pending cell is recycled. */
     struct {
         CSP_offload_cell_t *head;
         int nissued;            /* DEBUG only */
         int noutstanding;
     } pending_q;
 
+    /* Local arena of pending cells. Cells are allocated by slabs and recycled
+     * through the free list (linked by abs.next), thus a pending call does not
+     * allocate memory once enough cells are created. A recycled cell keeps its
+     * eager buffer. Slabs are freed at finalize. */
+    struct {
+        CSPU_offload_pending_slab_t *slabs;
+        CSP_offload_cell_t *free;
+        int nslabs;             /* DEBUG only */
+    } pending_arena;
+
+    /* Eager slots holding the packed payload of eager send, one for every
+     * shared cell. The request of an eager send completes at issue, and its
+     * cell is released once the ghost completed the send. A pending cell
+     * keeps the payload in a local buffer until it is moved to shared queue. */
+    struct {
+        MPI_Aint slot_size;     /* 0 if eager send is disabled. */
+        char *slots_base;
+        MPI_Aint cells_base;
+        MPI_Aint cell_size;
+        int ndetached;          /* Completed requests whose cell is still outstanding. */
+        int nissued;            /* DEBUG only */
+    } eager;
+
+    /* Bounce buffers staging the chunks of pipelined send from unregistered
+     * buffer. A buffer is reused once the ghost completed its chunk. */
+    struct {
+        MPI_Aint buf_size;      /* 0 if pipelining is disabled. */
+        char *base;
+        int free_idx[CSP_OFFLOAD_PIPELINE_NBUFS];       /* Stack of free buffer indexes. */
+        int nfree;
+        int nissued;            /* DEBUG only */
+    } bounce;
+    int pipe_nissued;           /* DEBUG only */
+
     CSPU_offload_req_hash_t req_hash;
+
+    /* Local pool of request handles. Offloaded call uses generalized request
+     * only when all handles are in use. */
+    struct {
+        CSPU_offload_req_slot_t *slots;
+        int *free_slots;        /* Stack of free slot indexes. */
+        int nfree;
+        int size;
+        int nissued;            /* DEBUG only */
+    } req_pool;
+
+#if defined(CSP_ENABLE_THREAD_SAFE)
+    CSP_thread_cs_t cs;         /* channel critical section object,
+                                 * initialized only when is_thread_multiple is set. */
+#endif
 } CSP_offload_channel_t;
 
-/* Every user process has only one channel.
- * Different ghost process may poll it (currently only the bound ghost process polls).*/
+/* Every user process has only one channel, shared by all threads.
+ * Different ghost process may poll it (currently only the bound ghost process polls).
+ * With MPI_THREAD_MULTIPLE, every access to the local structures of the channel
+ * (i.e., issue, poll, request and datatype routines) must be protected by its
+ * critical section. A cell taken by a thread is unreachable by others until it
+ * is issued, thus its payload is packed out of the critical section. The shared
+ * recvq is multi-producer safe, thus ghost side is not affected. */
 extern CSP_offload_channel_t CSPU_offload_ch;
 
 
@@ -65,8 +160,8 @@ extern int CSPU_offload_init(void);
 extern int CSPU_offload_destroy(void);
 
 /* ======================================================================
- * Request hash routines for request and cell mapping on local process
- * TODO: These routines are not thread safe. Need fix for multithreaded program.
+ * Request hash routines for request and cell mapping on local process.
+ * Caller must hold the channel critical section.
  * ====================================================================== */
 
 static inline void CSPU_offload_req_hash_replace(CSP_offload_cell_t * new,
@@ -107,8 +202,8 @@ static inline void CSPU_offload_req_hash_remove(MPI_Request req, CSP_offload_cel
 }
 
 /* ======================================================================
- * Stack routines for free cells on local process
- * TODO: These routines are not thread safe. Need fix for multithreaded program.
+ * Stack routines for free cells on local process.
+ * Caller must hold the channel critical section.
  * ====================================================================== */
 
 static inline void CSP_offload_freestk_reset_cell(CSP_offload_cell_t * cell)
@@ -146,12 +241,90 @@ static inline void CSP_offload_freestk_pop(CSP_offload_cell_t ** cell_ptr)
 }
 
 
+/* ======================================================================
+ * Node-wide pool routines for borrowing shared cells from other local users.
+ * The pool is shared by all local users, thus these routines are lock-free.
+ * ====================================================================== */
+
+static inline int CSPU_offload_pool_contain(CSP_offload_cell_t * cell)
+{
+    return CSPU_offload_ch.pool.ptr && (MPI_Aint) cell >= CSPU_offload_ch.pool.cells_base &&
+        (MPI_Aint) cell < CSPU_offload_ch.pool.cells_end;
+}
+
+static inline int CSPU_offload_pool_cell_idx(CSP_offload_cell_t * cell)
+{
+    return (int) (((MPI_Aint) cell - CSPU_offload_ch.pool.cells_base) /
+                  CSPU_offload_ch.eager.cell_size);
+}
+
+static inline void CSPU_offload_pool_borrow(CSP_offload_cell_t ** cell_ptr)
+{
+    int idx;
+
+    if (CSPU_offload_ch.pool.ptr == NULL)
+        return;
+
+    idx = CSP_offload_pool_pop(CSPU_offload_ch.pool.ptr);
+    if (idx < 0)
+        return;
+
+    /* Cell is reset before returned to the pool. */
+    (*cell_ptr) = (CSP_offload_cell_t *) (CSPU_offload_ch.pool.cells_base +
+                                          idx * CSPU_offload_ch.eager.cell_size);
+    CSPU_offload_ch.pool.nborrowed++;
+    CSPU_PROF_EXT_COUNTER_INC(CSPU_offload_ch.pool.nissued);
+
+    CSP_DBG_PRINT("OFFLOAD pool: borrowed cell %d %p, nborrowed %d\n", idx, *cell_ptr,
+                  CSPU_offload_ch.pool.nborrowed);
+}
+
+static inline void CSPU_offload_pool_return(CSP_offload_cell_t * cell)
+{
+    int idx = CSPU_offload_pool_cell_idx(cell);
+
+    CSP_offload_freestk_reset_cell(cell);
+    CSP_offload_pool_push(CSPU_offload_ch.pool.ptr, idx);
+    CSPU_offload_ch.pool.nborrowed--;
+
+    CSP_DBG_PRINT("OFFLOAD pool: returned cell %d %p, nborrowed %d\n", idx, cell,
+                  CSPU_offload_ch.pool.nborrowed);
+}
+
+/* Get a free shared cell from freestk, or borrow one from the node-wide pool
+ * if all my cells are used. cell_ptr is not updated if none is available. */
+static inline void CSPU_offload_pop_shm_cell(CSP_offload_cell_t ** cell_ptr)
+{
+    if (!CSP_offload_freestk_empty())
+        CSP_offload_freestk_pop(cell_ptr);
+    else
+        CSPU_offload_pool_borrow(cell_ptr);
+}
+
+/* Return a shared cell to freestk (or to the node-wide pool if it is borrowed)
+ * after the offloaded call is done. */
+static inline void CSPU_offload_free_shm_cell(CSP_offload_cell_t * cell)
+{
+    /* The cell is actually already completed a while, but it is reused only after
+     * put back to freestk. So it is OK to decrement counter here.*/
+    CSPU_offload_ch.shm_recvq.noutstanding--;
+
+    /* The ghost has completed the call, thus the datatype is no longer used. */
+    CSPU_datatype_ddt_release(cell->pkt.ddt);
+
+    if (CSPU_offload_pool_contain(cell)) {
+        CSPU_offload_pool_return(cell);
+        return;
+    }
+
+    CSP_offload_freestk_reset_cell(cell);
+    CSP_offload_freestk_push(cell);
+}
+
 /* ======================================================================
  * Pending queue routines for pending offload calls on local process.
  * Store local calls when no free cell.
- * TODO: These routines are not thread safe. Need fix for multithreaded program.
- * TODO: Can we create a free cell pool shared by all users on a node ? This
- * helps uneven issuing.
+ * Caller must hold the channel critical section.
  * ====================================================================== */
 
 static inline int CSP_offload_pending_q_empty(void)
@@ -183,12 +356,23 @@ static inline void CSP_offload_pending_q_dequeue(CSP_offload_cell_t ** cell_ptr)
     CSPU_offload_ch.pending_q.noutstanding--;
 }
 
-/* TODO: allocate pending cell pool. */
 extern int pending_cell_ncreated;       /* DEBUG only */
+extern void CSPU_offload_pending_arena_grow(void);
+
 static inline CSP_offload_cell_t *CSP_offload_create_pending_cell(void)
 {
     CSP_offload_cell_t *cell_ptr = NULL;
-    cell_ptr = CSP_calloc(1, sizeof(CSP_offload_cell_t));
+    void *eager_buf = NULL;
+
+    if (CSPU_offload_ch.pending_arena.free == NULL)
+        CSPU_offload_pending_arena_grow();
+
+    cell_ptr = CSPU_offload_ch.pending_arena.free;
+    CSPU_offload_ch.pending_arena.free = CSP_OFFLOAD_CELL_ABS_PT(cell_ptr).next;
+
+    eager_buf = cell_ptr->eager_buf;
+    memset(cell_ptr, 0, sizeof(CSP_offload_cell_t));
+    cell_ptr->eager_buf = eager_buf;
     cell_ptr->type = CSP_OFFLOAD_CELL_PENDING;
     pending_cell_ncreated++;
 
@@ -197,7 +381,8 @@ static inline CSP_offload_cell_t *CSP_offload_create_pending_cell(void)
 
 static inline void CSP_offload_release_pending_cell(CSP_offload_cell_t ** cell_ptr)
 {
-    free(*cell_ptr);
+    CSP_OFFLOAD_CELL_ABS_PT(*cell_ptr).next = CSPU_offload_ch.pending_arena.free;
+    CSPU_offload_ch.pending_arena.free = *cell_ptr;
     pending_cell_ncreated--;
 }
 
@@ -205,37 +390,138 @@ static inline void CSP_offload_release_pending_cell(CSP_offload_cell_t ** cell_p
  * Offload issuing routines.
  * ====================================================================== */
 extern int CSPU_offload_create_req(CSP_offload_cell_t * cell, MPI_Request * req_ptr);
+extern int CSPU_offload_complete_pooled_req(CSP_offload_cell_t * cell, MPI_Request * req_ptr,
+                                            MPI_Status * status);
+extern int CSPU_offload_req_test(MPI_Request * request, int *flag, MPI_Status * status,
+                                 int *is_offload);
+extern int CSPU_offload_req_get_status(MPI_Request request, int *flag, MPI_Status * status,
+                                       int *is_offload);
+extern int CSPU_offload_req_split(int count, MPI_Request array_of_requests[],
+                                  MPI_Request orig_reqs[]);
+extern int CSPU_offload_testany(int count, MPI_Request array_of_requests[],
+                                MPI_Request orig_reqs[], int *indx, int *flag,
+                                MPI_Status * status);
+extern int CSPU_offload_testsome(int incount, MPI_Request array_of_requests[],
+                                 MPI_Request orig_reqs[], int *outcount,
+                                 int array_of_indices[], MPI_Status array_of_statuses[]);
+extern int CSPU_offload_eager_copy(CSP_offload_cell_t * cell, const void *buf, int count,
+                                   MPI_Datatype datatype, MPI_Comm comm);
+extern int CSPU_offload_check_pipeline(int count, MPI_Datatype datatype, CSPU_comm_t * ug_comm,
+                                       int *pipe_flag);
+extern int CSPU_offload_pipe_issue(CSP_offload_cell_t * head, const void *copy_buf,
+                                   MPI_Datatype datatype);
 
 static inline int CSPU_offload_check_complete(CSP_offload_cell_t * cell)
 {
-    return OPA_load_int(&cell->pkt.complet_flag);
+    CSPU_offload_pipe_t *pipe = (CSPU_offload_pipe_t *) cell->pkt.pipe;
+
+    /* Eager send completes locally once the payload is copied. */
+    if (cell->pkt.eager)
+        return 1;
+    return OPA_load_int(&cell->pkt.complet_flag) && (!pipe || pipe->ncompleted == pipe->nchunks);
 }
 
-static inline int CSPU_offload_new_cell(CSP_offload_cell_t ** cell_ptr)
+/* A chunk completed by the ghost. Return 1 if all chunks of the message are
+ * completed, and the first chunk is returned in cell_ptr. */
+static inline int CSPU_offload_pipe_complete_chunk(CSP_offload_cell_t ** cell_ptr)
 {
-    CSP_offload_cell_t *cell = NULL, *old_record = NULL;
-    int mpi_errno = MPI_SUCCESS;
+    CSP_offload_cell_t *cell = *cell_ptr;
+    CSPU_offload_pipe_t *pipe = (CSPU_offload_pipe_t *) cell->pkt.pipe;
 
-    /* Try to get free cell */
-    CSP_offload_freestk_pop(&cell);
+    if (cell->pkt.bounce_idx != CSP_OFFLOAD_BOUNCE_NULL) {
+        CSPU_offload_ch.bounce.free_idx[CSPU_offload_ch.bounce.nfree++] = cell->pkt.bounce_idx;
+        cell->pkt.bounce_idx = CSP_OFFLOAD_BOUNCE_NULL;
+    }
+    pipe->ncompleted++;
 
-    /* Create a temporary pending cell if no free cell available */
-    if (cell == NULL) {
-        cell = CSP_offload_create_pending_cell();
-        CSP_ASSERT(cell != NULL);
+    /* Only the first chunk holds the request. */
+    if (cell->pkt.req == MPI_REQUEST_NULL)
+        CSPU_offload_free_shm_cell(cell);
+    if (pipe->ncompleted < pipe->nchunks)
+        return 0;
+
+    CSPU_offload_req_hash_get(pipe->req, cell_ptr);
+    CSP_ASSERT(*cell_ptr && OPA_load_int(&(*cell_ptr)->pkt.complet_flag));
+    return 1;
+}
+
+/* Dequeue a cell completed by the ghost and mark it completed.
+ * Return 0 if no cell is completed since last poll. */
+static inline int CSPU_offload_cmplq_dequeue(CSP_offload_cell_t ** cell_ptr)
+{
+    CSP_offload_cell_t *cell = NULL;
+
+    while (CSP_offload_cmplq_dequeue(CSPU_offload_ch.shm_base, CSPU_offload_ch.shm_cmplq_ptr,
+                                     &cell)) {
+        OPA_store_int(&cell->pkt.complet_flag, 1);
+        CSP_DBG_PRINT("OFFLOAD cmplq: dequeued cell %p, req=0x%x\n", cell, cell->pkt.req);
+
+        /* Eager send whose request is already completed, release the cell. */
+        if (cell->pkt.eager && cell->pkt.req == MPI_REQUEST_NULL) {
+            CSPU_offload_ch.eager.ndetached--;
+            CSPU_offload_free_shm_cell(cell);
+            continue;
+        }
+
+        /* Return the first chunk of a pipelined message only when all are completed. */
+        if (cell->pkt.pipe && !CSPU_offload_pipe_complete_chunk(&cell))
+            continue;
+
+        *cell_ptr = cell;
+        return 1;
     }
+    return 0;
+}
 
-    mpi_errno = CSPU_offload_create_req(cell, &cell->pkt.req);
-    CSP_CHKMPIFAIL_RETURN(mpi_errno);
+/* Mark every cell completed since last poll. It must be called before
+ * checking the completion of a cell. */
+static inline void CSPU_offload_poll_completion(void)
+{
+    CSP_offload_cell_t *cell = NULL;
 
-    CSPU_offload_req_hash_replace(cell, &old_record);
-    CSP_ASSERT(old_record == NULL);     /* Previous cell record is not correctly cleaned. */
+    while (CSPU_offload_cmplq_dequeue(&cell));
+}
 
-    *cell_ptr = cell;
+/* Get the address of the eager slot of a shared cell.
+ * The slot has the same index as the cell in the shared region (or in the
+ * node-wide pool for a borrowed cell). */
+static inline char *CSPU_offload_eager_slot(CSP_offload_cell_t * cell)
+{
+    MPI_Aint idx;
 
-    CSP_DBG_PRINT("OFFLOAD: new cell %p, %s, req=0x%x\n", cell,
-                  (cell->type == CSP_OFFLOAD_CELL_SHM ? "shm" : "pending"), cell->pkt.req);
-    return mpi_errno;
+    if (CSPU_offload_pool_contain(cell)) {
+        idx = CSPU_offload_pool_cell_idx(cell);
+        return CSPU_offload_ch.pool.slots_base + idx * CSPU_offload_ch.eager.slot_size;
+    }
+
+    idx = ((MPI_Aint) cell - CSPU_offload_ch.eager.cells_base) / CSPU_offload_ch.eager.cell_size;
+    return CSPU_offload_ch.eager.slots_base + idx * CSPU_offload_ch.eager.slot_size;
+}
+
+/* Whether the request of the cell is taken from local pool. Such request must be
+ * completed by CSPU_offload_complete_pooled_req rather than MPI.*/
+static inline int CSPU_offload_req_is_pooled(CSP_offload_cell_t * cell)
+{
+    return cell->pkt.req_slot != CSP_OFFLOAD_REQ_SLOT_NULL;
+}
+
+/* Whether the user request handle is taken from local pool. Such request is an
+ * inactive MPI request, thus cannot be freed or cancelled by MPI. */
+static inline int CSPU_offload_req_check_pooled(MPI_Request req)
+{
+    CSP_offload_cell_t *cell = NULL;
+    int is_pooled = 0;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    if (CSPU_offload_ch.req_pool.size == 0 || req == MPI_REQUEST_NULL)
+        return 0;
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+    CSPU_offload_req_hash_get(req, &cell);
+    is_pooled = (cell != NULL && CSPU_offload_req_is_pooled(cell));
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+
+    return is_pooled;
 }
 
 static inline void CSPU_offload_issue(CSP_offload_cell_t * cell)
@@ -265,6 +551,36 @@ static inline void CSPU_offload_issue(CSP_offload_cell_t * cell)
     }
 }
 
+/* Whether the cell is a chunk of pipelined send waiting for staging. */
+static inline int CSPU_offload_pipe_need_stage(CSP_offload_cell_t * cell)
+{
+    CSPU_offload_pipe_t *pipe = (CSPU_offload_pipe_t *) cell->pkt.pipe;
+    return pipe && pipe->buf && cell->pkt.bounce_idx == CSP_OFFLOAD_BOUNCE_NULL;
+}
+
+/* Copy the chunk into a free bounce buffer. isend.g_bufaddr is the offset of the
+ * chunk in the user buffer before staging. */
+static inline void CSPU_offload_pipe_stage(CSP_offload_cell_t * cell)
+{
+    CSPU_offload_pipe_t *pipe = (CSPU_offload_pipe_t *) cell->pkt.pipe;
+    CSP_offload_isend_pkt_t *isend_pkt = &cell->pkt.isend;
+    char *bounce_buf;
+    int idx;
+
+    CSP_DBG_ASSERT(CSPU_offload_ch.bounce.nfree > 0);
+    idx = CSPU_offload_ch.bounce.free_idx[--CSPU_offload_ch.bounce.nfree];
+    bounce_buf = CSPU_offload_ch.bounce.base + idx * CSPU_offload_ch.bounce.buf_size;
+
+    memcpy(bounce_buf, pipe->buf + isend_pkt->g_bufaddr, isend_pkt->count);
+    isend_pkt->g_bufaddr = (MPI_Aint) bounce_buf - CSPU_offload_ch.shm_base;
+    cell->pkt.bounce_idx = idx;
+    cell->pkt.packed = 1;
+
+    CSPU_PROF_EXT_COUNTER_INC(CSPU_offload_ch.bounce.nissued);
+    CSP_DBG_PRINT("OFFLOAD pipe: staged %d bytes into bounce %d of cell %p\n",
+                  isend_pkt->count, idx, cell);
+}
+
 static inline void CSPU_offload_poll_progress(void)
 {
     /* Try to clean up pending cells as many as we can */
@@ -273,60 +589,145 @@ static inline void CSPU_offload_poll_progress(void)
         CSP_offload_cell_t *free_c = NULL;
         CSP_offload_cell_t *old_record = NULL;
 
-        /* All shared cells are used. */
-        if (CSP_offload_freestk_empty())
+        /* Chunk of pipelined send waits for a free bounce buffer. Following
+         * pending cells also wait, otherwise they overtake the chunk. */
+        if (CSPU_offload_pipe_need_stage(CSPU_offload_ch.pending_q.head) &&
+            CSPU_offload_ch.bounce.nfree == 0)
             break;
 
         /* Try to get free cell first */
-        CSP_offload_freestk_pop(&free_c);
-        if (free_c) {
-            CSP_offload_cell_reset_rl(free_c);
+        CSPU_offload_pop_shm_cell(&free_c);
+
+        /* All shared cells are used. */
+        if (free_c == NULL)
+            break;
+
+        CSP_offload_cell_reset_rl(free_c);
 
-            /* Get local pending cell and copy */
-            CSP_offload_pending_q_dequeue(&pending_c);
-            CSP_ASSERT(pending_c != NULL);
+        /* Get local pending cell and copy */
+        CSP_offload_pending_q_dequeue(&pending_c);
+        CSP_ASSERT(pending_c != NULL);
 
-            memcpy(&free_c->pkt, &pending_c->pkt, sizeof(CSP_offload_pkt_t));
+        memcpy(&free_c->pkt, &pending_c->pkt, sizeof(CSP_offload_pkt_t));
 
-            /* Replace request hash record */
+        /* Copy eager payload into the slot of shared cell. */
+        if (free_c->pkt.eager) {
+            char *slot_buf = CSPU_offload_eager_slot(free_c);
+            memcpy(slot_buf, pending_c->eager_buf, free_c->pkt.isend.count);
+            free_c->pkt.isend.g_bufaddr = (MPI_Aint) slot_buf - CSPU_offload_ch.shm_base;
+        }
+        else if (CSPU_offload_pipe_need_stage(free_c)) {
+            CSPU_offload_pipe_stage(free_c);
+        }
+
+        /* Replace request hash record, or release pending cell if it has no
+         * request (eager send whose request is already completed, or chunk
+         * of pipelined message). */
+        if (free_c->pkt.req != MPI_REQUEST_NULL) {
             CSPU_offload_req_hash_replace(free_c, &old_record);
             CSP_DBG_ASSERT(old_record == pending_c);
-
-            /* Enqueue to shared recvq */
-            CSP_offload_recvq_enqueue(CSPU_offload_ch.shm_base,
-                                      CSPU_offload_ch.shm_recvq.q_ptr, free_c);
-            CSPU_offload_ch.shm_recvq.noutstanding++;
-            CSPU_PROF_EXT_COUNTER_INC(CSPU_offload_ch.shm_recvq.nissued);
-
-            CSP_DBG_PRINT("OFFLOAD progress: pending_c %p -> free_c %p, req=0x%x, "
-                          "pending count %d/%d, shm_recvq count %d/%d\n",
-                          pending_c, free_c, free_c->pkt.req,
-                          CSPU_offload_ch.pending_q.noutstanding, CSPU_offload_ch.pending_q.nissued,
-                          CSPU_offload_ch.shm_recvq.noutstanding,
-                          CSPU_offload_ch.shm_recvq.nissued);
-
-            /* Do not release pending cell at replace because we need to get request
-             * handler at grequest callback. Instead we release it at free. */
         }
+        else {
+            CSP_offload_release_pending_cell(&pending_c);
+        }
+
+        /* Enqueue to shared recvq */
+        CSP_offload_recvq_enqueue(CSPU_offload_ch.shm_base,
+                                  CSPU_offload_ch.shm_recvq.q_ptr, free_c);
+        CSPU_offload_ch.shm_recvq.noutstanding++;
+        CSPU_PROF_EXT_COUNTER_INC(CSPU_offload_ch.shm_recvq.nissued);
+
+        CSP_DBG_PRINT("OFFLOAD progress: pending_c %p -> free_c %p, req=0x%x, "
+                      "pending count %d/%d, shm_recvq count %d/%d\n",
+                      pending_c, free_c, free_c->pkt.req,
+                      CSPU_offload_ch.pending_q.noutstanding, CSPU_offload_ch.pending_q.nissued,
+                      CSPU_offload_ch.shm_recvq.noutstanding,
+                      CSPU_offload_ch.shm_recvq.nissued);
+
+        /* Do not release pending cell at replace because we need to get request
+         * handler at grequest callback (or pooled request completion), and the
+         * caller may still hold it. Instead we release it at free. */
     }
 }
 
+/* Get a shared cell, or a pending cell if no shared cell is available or
+ * pending_only is set. Pending cells are moved first, thus the new call never
+ * overtakes earlier pending calls. */
+static inline CSP_offload_cell_t *CSPU_offload_get_cell(int pending_only)
+{
+    CSP_offload_cell_t *cell = NULL;
+
+    CSPU_offload_poll_progress();
+    if (!pending_only && CSP_offload_pending_q_empty())
+        CSPU_offload_pop_shm_cell(&cell);
+
+    /* Create a temporary pending cell if no free cell available */
+    if (cell == NULL) {
+        cell = CSP_offload_create_pending_cell();
+        CSP_ASSERT(cell != NULL);
+    }
+    return cell;
+}
+
+static inline int CSPU_offload_new_cell(CSP_offload_cell_t ** cell_ptr, int pending_only)
+{
+    CSP_offload_cell_t *cell = NULL, *old_record = NULL;
+    int mpi_errno = MPI_SUCCESS;
+
+    cell = CSPU_offload_get_cell(pending_only);
+
+    mpi_errno = CSPU_offload_create_req(cell, &cell->pkt.req);
+    CSP_CHKMPIFAIL_RETURN(mpi_errno);
+
+    CSPU_offload_req_hash_replace(cell, &old_record);
+    CSP_ASSERT(old_record == NULL);     /* Previous cell record is not correctly cleaned. */
+
+    *cell_ptr = cell;
+
+    CSP_DBG_PRINT("OFFLOAD: new cell %p, %s, req=0x%x\n", cell,
+                  (cell->type == CSP_OFFLOAD_CELL_SHM ? "shm" : "pending"), cell->pkt.req);
+    return mpi_errno;
+}
+
+/* Wait until the ghost completed every eager send whose request is already
+ * completed. It must be called before freeing a communicator on the ghost. */
+static inline void CSPU_offload_wait_eager(void)
+{
+    int ndetached = 0;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    do {
+        CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+        CSPU_offload_poll_progress();
+        CSPU_offload_poll_completion();
+        ndetached = CSPU_offload_ch.eager.ndetached;
+        CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+    } while (ndetached > 0);
+}
+
+/* Users are evenly partitioned into contiguous ranges, the first
+ * (num_user % num_g) ghosts take one more user.
+ * See offload_bind_users on ghost side. */
 static inline int CSPU_offload_bind_ghost(int *ghost_local_rank)
 {
     int mpi_errno = MPI_SUCCESS;
     int local_rank, local_size, g_lrank = 0;
-    int np_per_ghost = 0;
+    int num_user = 0, uidx = 0, np_per_ghost = 0, np_rest = 0;
 
     CSP_CALLMPI(RETURN, PMPI_Comm_rank(CSP_PROC.local_comm, &local_rank));
     CSP_CALLMPI(RETURN, PMPI_Comm_size(CSP_PROC.local_comm, &local_size));
 
-    np_per_ghost = (local_size - CSP_ENV.num_g) / CSP_ENV.num_g;
-    if (np_per_ghost < 1)
-        np_per_ghost = 1;       /* in case user sets more ghosts than user processes */
+    num_user = local_size - CSP_ENV.num_g;
+    uidx = local_rank - CSP_ENV.num_g;
+    np_per_ghost = num_user / CSP_ENV.num_g;
+    np_rest = num_user % CSP_ENV.num_g;
 
-    g_lrank = (local_rank - CSP_ENV.num_g) / np_per_ghost;
-    if (g_lrank >= CSP_ENV.num_g)
-        g_lrank = CSP_ENV.num_g - 1;
+    /* np_per_ghost is 0 in case user sets more ghosts than user processes,
+     * then every user is bound to a separate ghost. */
+    if (uidx < np_rest * (np_per_ghost + 1))
+        g_lrank = uidx / (np_per_ghost + 1);
+    else
+        g_lrank = np_rest + (uidx - np_rest * (np_per_ghost + 1)) / np_per_ghost;
 
     (*ghost_local_rank) = g_lrank;
 
@@ -343,6 +744,7 @@ static inline void CSPU_offload_init_pkt(CSP_offload_pkt_t * pkt, CSPU_comm_t *
 {
     pkt->type = type;
     OPA_store_int(&pkt->complet_flag, 0);
+    pkt->waitall_idx = 0;
     memset(&pkt->stat, 0, sizeof(MPI_Status));
 
     pkt->ug_comm_handle = (MPI_Aint) ug_comm;
@@ -363,4 +765,22 @@ static inline int CSPU_offload_checksz(int count, MPI_Datatype datatype, CSPU_co
 
     return mpi_errno;
 }
+
+/* Check whether the message can be sent by eager copy. */
+static inline int CSPU_offload_check_eager(int count, MPI_Datatype datatype, MPI_Comm comm,
+                                           int *enabled)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int pack_sz = 0;
+
+    *enabled = 0;
+    if (CSPU_offload_ch.eager.slot_size == 0)
+        return mpi_errno;
+
+    CSP_CALLMPI(RETURN, PMPI_Pack_size(count, datatype, comm, &pack_sz));
+    if (pack_sz <= CSP_ENV.offload_eager_msgsz)
+        *enabled = 1;
+
+    return mpi_errno;
+}
 #endif /* CSPU_offload_ch_H_ */
@@ -46,16 +46,33 @@ static inline int CSPU_win_grant_local_lock(int target_rank, CSPU_win_t * ug_win
     {
         int main_g_off = ug_win->targets[target_rank].main_g_off;
         int target_g_rank_in_ug = ug_win->targets[target_rank].g_ranks_in_ug[main_g_off];
-
+        MPI_Aint grant_disp = 0;
 #ifdef CSP_ENABLE_GRANT_LOCK_HIDDEN_BYTE
         CSP_GRANT_LOCK_DATATYPE buf[1];
+
+        grant_disp = ug_win->grant_lock_g_offset;
+#else
+        char buf[1];
+#endif
+
+        /* Only the pool segments are exposed on dynamic window, thus get from
+         * the start of target's segment. */
+        if (ug_win->create_flavor == MPI_WIN_FLAVOR_DYNAMIC)
+            grant_disp = ug_win->targets[target_rank].base_g_offsets[main_g_off] +
+                ug_win->targets[target_rank].dyn_base;
+
+        /* Remapped user buffers are attached on ghosts, ghost exposes its own
+         * segment for the target with empty buffer. */
+        if (ug_win->remap)
+            grant_disp = ug_win->targets[target_rank].base_g_offsets[main_g_off];
+
+#ifdef CSP_ENABLE_GRANT_LOCK_HIDDEN_BYTE
         CSP_CALLMPI(JUMP, PMPI_Get(buf, 1, CSP_GRANT_LOCK_MPI_DATATYPE, target_g_rank_in_ug,
-                                   ug_win->grant_lock_g_offset, 1, CSP_GRANT_LOCK_MPI_DATATYPE,
-                                   ug_win->targets[target_rank].ug_win);
+                                   grant_disp, 1, CSP_GRANT_LOCK_MPI_DATATYPE,
+                                   ug_win->targets[target_rank].ug_win));
 #else
         /* Simply get 1 byte from start, it does not affect the result of other updates */
-        char buf[1];
-        CSP_CALLMPI(JUMP, PMPI_Get(buf, 1, MPI_CHAR, target_g_rank_in_ug, 0,
+        CSP_CALLMPI(JUMP, PMPI_Get(buf, 1, MPI_CHAR, target_g_rank_in_ug, grant_disp,
                                    1, MPI_CHAR, ug_win->targets[user_rank].ug_win));
 #endif
 
@@ -26,9 +26,21 @@ typedef struct CSPU_shmbuf_record {
     void *base;
     MPI_Aint g_base_bound;
     MPI_Aint size;
-    struct CSPU_shmbuf_record *next, *prev;
 } CSPU_shmbuf_record_t;
 
+/* Registered shared buffers, sorted by base address thus a user buffer can be
+ * translated by binary search at every offloaded call. Shared buffers never
+ * overlap. The last found record is cached, since consecutive messages often
+ * use the same buffer. */
+typedef struct CSPU_shmbuf_index {
+    CSPU_shmbuf_record_t *records;
+    int num;
+    int capacity;
+    int last_hit;               /* index of the last found record, -1 if none. */
+} CSPU_shmbuf_index_t;
+
+#define CSPU_SHMBUF_INDEX_INIT_CAPACITY 16
+
 #define CSP_DEFINE_SHMBUF_WIN_CACHE int SHMBUF_WIN_HANDLE_KEY = MPI_KEYVAL_INVALID
 extern int SHMBUF_WIN_HANDLE_KEY;
 
@@ -87,64 +99,56 @@ static inline int CSPU_remove_shmbuf_win_from_cache(MPI_Win win)
     return mpi_errno;
 }
 
-extern CSPU_shmbuf_record_t *CSPU_shmbuf_list;
+extern CSPU_shmbuf_index_t CSPU_shmbuf_index;
 
-static inline void CSPU_shmbuf_record_append(void *base, MPI_Aint size, MPI_Aint g_base_bound)
+static inline int CSPU_shmbuf_record_contain(CSPU_shmbuf_record_t * record, void *addr)
 {
-    CSPU_shmbuf_record_t *record = NULL;
-    record = CSP_calloc(1, sizeof(CSPU_shmbuf_record_t));
-    CSP_ASSERT(record != NULL);
-
-    record->base = base;
-    record->g_base_bound = g_base_bound;
-    record->size = size;
-
-    /* tail is internally stored at head->prev. */
-    DL_APPEND(CSPU_shmbuf_list, record);
-    CSP_DBG_PRINT("SHMBUF append record %p, base=%p, g_base_bound=0x%lx, size=0x%lx\n",
-                  record, base, g_base_bound, size);
+    /* The end address is included, thus a zero-size buffer at the end of a
+     * registered buffer can be found. */
+    return ((MPI_Aint) record->base <= (MPI_Aint) addr)
+        && ((MPI_Aint) addr <= (MPI_Aint) record->base + record->size);
 }
 
-static inline int CSPU_shmbuf_record_contain(CSPU_shmbuf_record_t * shmbase,
-                                             CSPU_shmbuf_record_t * buf)
+/* Return the position of the first record whose base is larger than addr. */
+static inline int CSPU_shmbuf_index_upper_bound(void *addr)
 {
-    int contain = ((MPI_Aint) shmbase->base <= (MPI_Aint) buf->base)
-        && ((MPI_Aint) buf->base + buf->size <= (MPI_Aint) shmbase->base + shmbase->size);
-    return contain == 1 ? 0 : 1;
+    int lo = 0, hi = CSPU_shmbuf_index.num;
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if ((MPI_Aint) CSPU_shmbuf_index.records[mid].base <= (MPI_Aint) addr)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
 }
 
 static inline void CSPU_shmbuf_record_find(void *addr, CSPU_shmbuf_record_t ** record_ptr)
 {
     CSPU_shmbuf_record_t *record = NULL;
-    CSPU_shmbuf_record_t like;
+    int idx;
 
     *record_ptr = NULL;
 
-    /* Find the record with base <= addr, addr + size <= base + size */
-    like.base = addr;
-    like.size = 0;
-    DL_SEARCH(CSPU_shmbuf_list, record, &like, CSPU_shmbuf_record_contain);
-    *record_ptr = record;
-
-    if (record) {
-        CSP_DBG_PRINT("SHMBUF found addr %p->record %p, base=%p, g_base_bound=0x%lx\n",
-                      addr, record, record->base, record->g_base_bound);
+    /* Check the last found record first. */
+    idx = CSPU_shmbuf_index.last_hit;
+    if (idx >= 0 && CSPU_shmbuf_record_contain(&CSPU_shmbuf_index.records[idx], addr)) {
+        *record_ptr = &CSPU_shmbuf_index.records[idx];
+        return;
     }
-}
-
-static inline void CSPU_shmbuf_record_remove(void *base)
-{
-    CSPU_shmbuf_record_t *record = NULL;
 
-    /* Find the record with base */
-    DL_SEARCH_SCALAR(CSPU_shmbuf_list, record, base, base);
-    CSP_ASSERT(record != NULL);
+    /* Find the record with base <= addr <= base + size. Only the last record
+     * whose base <= addr can contain it. */
+    idx = CSPU_shmbuf_index_upper_bound(addr) - 1;
+    if (idx >= 0 && CSPU_shmbuf_record_contain(&CSPU_shmbuf_index.records[idx], addr)) {
+        record = &CSPU_shmbuf_index.records[idx];
+        CSPU_shmbuf_index.last_hit = idx;
+        *record_ptr = record;
 
-    DL_DELETE(CSPU_shmbuf_list, record);
-
-    CSP_DBG_PRINT("SHMBUF remove base %p->record %p\n", base, record);
-
-    free(record);
+        CSP_DBG_PRINT("SHMBUF found addr %p->record %d, base=%p, g_base_bound=0x%lx\n",
+                      addr, idx, record->base, record->g_base_bound);
+    }
 }
 
 static inline void CSPU_shmbuf_translate_g_addr(void *addr, MPI_Aint * g_addr_ptr, int *found)
@@ -164,5 +168,6 @@ static inline void CSPU_shmbuf_translate_g_addr(void *addr, MPI_Aint * g_addr_pt
 extern int CSPU_shmbuf_regist(CSPU_comm_t * ug_comm, MPI_Aint size, int disp_unit, MPI_Info info,
                               MPI_Comm comm, void *baseptr, MPI_Win * win);
 extern int CSPU_shmbuf_free(MPI_Win * win, int *freed);
+extern void CSPU_shmbuf_index_destroy(void);
 
 #endif /* CSPU_SHMBUF_H_ */
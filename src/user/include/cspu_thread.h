@@ -13,6 +13,7 @@
 #include "csp_util.h"
 
 #if defined(CSP_ENABLE_THREAD_SAFE)
+#include <sched.h>
 #include "csp_thread.h"
 #endif
 
@@ -57,6 +58,16 @@
     }                                                               \
 } while (0)
 
+/* Release the critical section in a polling loop and give up the processor
+ * before reentering it, thus other threads waiting for it can make progress. */
+#define CSPU_THREAD_YIELD_OBJ_CS(obj_ptr)  do {                     \
+    if (CSP_PROC.user.is_thread_multiple) {                         \
+        CSPU_THREAD_EXIT_OBJ_CS(obj_ptr);                           \
+        sched_yield();                                              \
+        CSPU_THREAD_ENTER_OBJ_CS(obj_ptr);                          \
+    }                                                               \
+} while (0)
+
 #else
 /* undefined CSP_ENABLE_THREAD_SAFE */
 
@@ -65,6 +76,7 @@
 #define CSPU_THREAD_OBJ_CS_LOCAL_DCL()
 #define CSPU_THREAD_ENTER_OBJ_CS(obj_ptr)
 #define CSPU_THREAD_EXIT_OBJ_CS(obj_ptr)
+#define CSPU_THREAD_YIELD_OBJ_CS(obj_ptr)
 /* End of Per-object critical section MACROs with undefined CSP_ENABLE_THREAD_SAFE */
 #endif
 
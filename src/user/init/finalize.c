@@ -110,6 +110,7 @@ int CSPU_global_finalize(void)
 
         mpi_errno = CSPU_destroy_shmbuf_win_cache();
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        CSPU_shmbuf_index_destroy();
 
         mpi_errno = CSPU_datatype_destroy();
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
@@ -121,11 +122,20 @@ int CSPU_global_finalize(void)
     if (CSP_IS_MODE_ENABLED(RMA)) {
         mpi_errno = CSPU_destroy_win_cache();
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+        mpi_errno = CSPU_dyn_pool_destroy();
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+        mpi_errno = CSPU_win_remap_destroy();
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
 
     mpi_errno = CSPU_errhan_destroy();
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
+    mpi_errno = CSPU_cwp_destroy();
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     mpi_errno = destroy_proc();
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
@@ -188,6 +188,10 @@ int CSPU_global_init(int is_threaded)
     mpi_errno = setup_proc(is_threaded);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
+    /* Collective call with local ghosts. */
+    mpi_errno = CSPU_cwp_init();
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     if (CSP_IS_MODE_ENABLED(PT2PT)) {
         mpi_errno = CSPU_offload_init();
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
@@ -205,6 +209,13 @@ int CSPU_global_init(int is_threaded)
     if (CSP_IS_MODE_ENABLED(RMA)) {
         mpi_errno = CSPU_init_win_cache();
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+        /* Collective call with local ghosts. */
+        mpi_errno = CSPU_dyn_pool_init();
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+        mpi_errno = CSPU_win_remap_init();
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
 
     mpi_errno = CSPU_errhan_init();
@@ -6,4 +6,12 @@ libcasper_la_SOURCES += src/user/pt2pt/isend.c \
                         src/user/pt2pt/irecv.c \
                         src/user/pt2pt/test.c  \
                         src/user/pt2pt/wait.c  \
-                        src/user/pt2pt/waitall.c
\ No newline at end of file
+                        src/user/pt2pt/waitall.c \
+                        src/user/pt2pt/waitany.c \
+                        src/user/pt2pt/waitsome.c \
+                        src/user/pt2pt/testany.c \
+                        src/user/pt2pt/testall.c \
+                        src/user/pt2pt/testsome.c \
+                        src/user/pt2pt/request_get_status.c \
+                        src/user/pt2pt/request_free.c \
+                        src/user/pt2pt/cancel.c
\ No newline at end of file
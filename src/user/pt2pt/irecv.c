@@ -8,20 +8,24 @@
 #include <stdlib.h>
 #include "cspu.h"
 
+/* Only the cell operations are done in the channel critical section. */
 static inline int irecv_impl(MPI_Aint g_bufaddr, int count, MPI_Datatype datatype,
                              int src, int tag, MPI_Comm comm, MPI_Request * request,
-                             CSPU_comm_t * ug_comm)
+                             CSPU_comm_t * ug_comm, int pipe_flag)
 {
     int mpi_errno = MPI_SUCCESS;
     CSP_offload_cell_t *cell = NULL;
     CSP_offload_pkt_t *pkt = NULL;
     CSP_offload_irecv_pkt_t *irecv_pkt = NULL;
     int rank = 0, ugrank = 0;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
 
-    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_comm->comm, &rank));
-    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_comm->ug_comm, &ugrank));
+    CSP_CALLMPI(RETURN, PMPI_Comm_rank(ug_comm->comm, &rank));
+    CSP_CALLMPI(RETURN, PMPI_Comm_rank(ug_comm->ug_comm, &ugrank));
 
-    mpi_errno = CSPU_offload_new_cell(&cell);
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+
+    mpi_errno = CSPU_offload_new_cell(&cell, 0 /* pending_only */);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     pkt = &cell->pkt;
@@ -38,19 +42,26 @@ static inline int irecv_impl(MPI_Aint g_bufaddr, int count, MPI_Datatype datatyp
 
     /* Get datatype handle on the bound ghost process  */
     mpi_errno = CSPU_datatype_get_g_handle(datatype, CSPU_offload_get_ghost(),
-                                           &irecv_pkt->g_datatype);
+                                           &irecv_pkt->g_datatype, &pkt->ddt);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    CSPU_offload_issue(cell);
+    /* The ghost receives every chunk of pipelined message in order. */
+    if (pipe_flag)
+        pkt->chunksz = CSP_ENV.offload_pipeline_chunksz;
 
     (*request) = pkt->req;
 
     CSP_DBG_PRINT("OFFLOAD irecv: offload [g_bufaddr=0x%lx, count=%d, "
-                  "datatype=0x%x/0x%x, me=%d/%d, src=%d, tag=%d, comm=0x%x/0x%lx], "
-                  "req 0x%x, cell %p(%s)\n", g_bufaddr, count, datatype, irecv_pkt->g_datatype,
-                  rank, ugrank, src, tag, comm, irecv_pkt->g_ugcomm_handle, (*request),
-                  cell, (cell->type == CSP_OFFLOAD_CELL_SHM ? "shm" : "pending"));
+                  "datatype=0x%x/0x%x, me=%d/%d, src=%d, tag=%d, comm=0x%x/0x%lx, "
+                  "pipe_flag=%d], req 0x%x, cell %p(%s)\n", g_bufaddr, count, datatype,
+                  irecv_pkt->g_datatype,
+                  rank, ugrank, src, tag, comm, irecv_pkt->g_ugcomm_handle, pipe_flag,
+                  (*request), cell, (cell->type == CSP_OFFLOAD_CELL_SHM ? "shm" : "pending"));
+
+    CSPU_offload_issue(cell);
 
   fn_exit:
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
     return mpi_errno;
 
   fn_fail:
@@ -69,7 +80,7 @@ int MPI_Irecv(void *buf, int count, MPI_Datatype datatype, int src, int tag,
 {
     int mpi_errno = MPI_SUCCESS;
     CSPU_comm_t *ug_comm = NULL;
-    int buf_found_flag = 0, offsz_flag = 0;
+    int buf_found_flag = 0, offsz_flag = 0, pipe_flag = 0;
     MPI_Aint g_bufaddr = -1;
 
     /* No communicator replacement if completely disabled */
@@ -87,15 +98,22 @@ int MPI_Irecv(void *buf, int count, MPI_Datatype datatype, int src, int tag,
         return mpi_errno;
     }
 
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
     CSPU_ERRHAN_EXTOBJ_LOCAL_DCL();
     CSPU_COMM_ERRHAN_SET_EXTOBJ();
-    /* TODO: do we need thread CS here ? */
 
     CSPU_fetch_ug_comm_from_cache(comm, &ug_comm);
+
+    /* Buffer translation is shared by all threads. */
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
     /* Skip check if it is not a pre-wrapped communicator (e.g., MPI_COMM_SELF) */
     if (ug_comm) {
         CSPU_shmbuf_translate_g_addr(buf, &g_bufaddr, &buf_found_flag);
         CSPU_offload_checksz(count, datatype, ug_comm, &offsz_flag);
+
+        /* Receive in chunks if the sender may split the message. */
+        if (ug_comm->type >= CSP_COMM_ASYNC_DUP && buf_found_flag && offsz_flag)
+            CSPU_offload_check_pipeline(count, datatype, ug_comm, &pipe_flag);
     }
 
     CSP_DBG_PRINT("irecv: comm 0x%x->ug_comm=%p, buf=%p, count=%d, g_bufaddr=0x%lx, "
@@ -104,12 +122,16 @@ int MPI_Irecv(void *buf, int count, MPI_Datatype datatype, int src, int tag,
 
     if (ug_comm && ug_comm->type >= CSP_COMM_ASYNC_DUP && buf_found_flag && offsz_flag) {
         CSPU_PROF_PT2PT_COUNTER_INC(IRECV, ON);
+        CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
 
         /* Asynchronous enabled comm and registered shared buffer. */
-        mpi_errno = irecv_impl(g_bufaddr, count, datatype, src, tag, comm, request, ug_comm);
+        mpi_errno = irecv_impl(g_bufaddr, count, datatype, src, tag, comm, request, ug_comm,
+                               pipe_flag);
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
     else {
+        CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+
         /* normal comm. */
         CSPU_ERRHAN_RESET_EXTOBJ();     /* reset before calling original MPI */
         ORIG_MPI_FNC();
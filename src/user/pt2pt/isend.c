@@ -8,21 +8,21 @@
 #include <stdlib.h>
 #include "cspu.h"
 
-static inline int isend_impl(MPI_Aint g_bufaddr, int count, MPI_Datatype datatype,
-                             int dest, int tag, MPI_Comm comm, MPI_Request * request,
-                             CSPU_comm_t * ug_comm)
+/* Get a cell and fill the packet except the payload. Called in the channel
+ * critical section. */
+static inline int isend_init_cell(const void *copy_buf, MPI_Aint g_bufaddr, int count,
+                                  MPI_Datatype datatype, int dest, int tag, int rank,
+                                  int ugrank, int peer_ugrank, CSPU_comm_t * ug_comm,
+                                  int pipe_flag, CSP_offload_cell_t ** cell_ptr)
 {
     int mpi_errno = MPI_SUCCESS;
     CSP_offload_cell_t *cell = NULL;
     CSP_offload_pkt_t *pkt = NULL;
     CSP_offload_isend_pkt_t *isend_pkt = NULL;
-    int rank = 0, ugrank = 0;
 
-    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_comm->comm, &rank));
-    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_comm->ug_comm, &ugrank));
-
-    mpi_errno = CSPU_offload_new_cell(&cell);
-    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    /* Staged chunks wait in the pending queue for bounce buffers. */
+    mpi_errno = CSPU_offload_new_cell(&cell, copy_buf && pipe_flag);
+    CSP_CHKMPIFAIL_RETURN(mpi_errno);
 
     pkt = &cell->pkt;
     isend_pkt = &pkt->isend;
@@ -31,27 +31,84 @@ static inline int isend_impl(MPI_Aint g_bufaddr, int count, MPI_Datatype datatyp
     isend_pkt->rank = rank;
     isend_pkt->ugrank = ugrank;
     isend_pkt->peer_rank = dest;
-    CSP_CALLMPI(JUMP, PMPI_Group_translate_ranks(ug_comm->group, 1, &dest,
-                                                 ug_comm->ug_group, &isend_pkt->peer_ugrank));
-    isend_pkt->g_bufaddr = g_bufaddr;
-    isend_pkt->count = count;
+    isend_pkt->peer_ugrank = peer_ugrank;
     isend_pkt->g_ugcomm_handle = ug_comm->g_ugcomm_bound;
     isend_pkt->tag = tag;
 
-    /* Get datatype handle on the bound ghost process  */
-    mpi_errno = CSPU_datatype_get_g_handle(datatype, CSPU_offload_get_ghost(),
-                                           &isend_pkt->g_datatype);
+    if (copy_buf) {
+        /* Every chunk is sent as MPI_PACKED from bounce buffer, and eager
+         * payload is packed later. */
+        isend_pkt->count = count;
+        isend_pkt->g_datatype = MPI_DATATYPE_NULL;
+    }
+    else {
+        isend_pkt->g_bufaddr = g_bufaddr;
+        isend_pkt->count = count;
+
+        /* Get datatype handle on the bound ghost process  */
+        mpi_errno = CSPU_datatype_get_g_handle(datatype, CSPU_offload_get_ghost(),
+                                               &isend_pkt->g_datatype, &pkt->ddt);
+        CSP_CHKMPIFAIL_RETURN(mpi_errno);
+    }
+
+    (*cell_ptr) = cell;
+    return mpi_errno;
+}
+
+/* The payload is copied from copy_buf if it is not NULL, by eager copy
+ * (pipe_flag is 0) or staging every chunk of pipelined message. Otherwise
+ * the ghost sends from the registered buffer at g_bufaddr. Only the cell
+ * operations are done in the channel critical section. The cell is invisible
+ * to other threads until issued, thus the rank translation and the eager
+ * packing are done out of it. */
+static inline int isend_impl(const void *copy_buf, MPI_Aint g_bufaddr, int count,
+                             MPI_Datatype datatype, int dest, int tag, MPI_Comm comm,
+                             MPI_Request * request, CSPU_comm_t * ug_comm, int pipe_flag)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSP_offload_cell_t *cell = NULL;
+    int rank = 0, ugrank = 0, peer_ugrank = 0, is_eager = 0;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_comm->comm, &rank));
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_comm->ug_comm, &ugrank));
+    CSP_CALLMPI(JUMP, PMPI_Group_translate_ranks(ug_comm->group, 1, &dest,
+                                                 ug_comm->ug_group, &peer_ugrank));
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+    mpi_errno = isend_init_cell(copy_buf, g_bufaddr, count, datatype, dest, tag, rank, ugrank,
+                                peer_ugrank, ug_comm, pipe_flag, &cell);
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    CSPU_offload_issue(cell);
+    if (copy_buf && !pipe_flag) {
+        /* Copy payload into shared memory, thus the user buffer is free to reuse. */
+        mpi_errno = CSPU_offload_eager_copy(cell, copy_buf, count, datatype, comm);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        is_eager = 1;
+    }
+
+    /* The cell may be completed and reused by other threads once issued. */
+    (*request) = cell->pkt.req;
 
-    (*request) = pkt->req;
+    CSP_DBG_PRINT("OFFLOAD isend%s: offload [g_bufaddr=0x%lx, count=%d, datatype=0x%x/0x%x, "
+                  "me=%d/%d, dest=%d/%d, tag=%d, comm=0x%x/0x%lx, pipe_flag=%d], "
+                  "req 0x%x, cell %p(%s)\n", copy_buf ? "(copy)" : "", cell->pkt.isend.g_bufaddr,
+                  cell->pkt.isend.count, datatype, cell->pkt.isend.g_datatype,
+                  rank, ugrank, dest, peer_ugrank, tag, comm, cell->pkt.isend.g_ugcomm_handle,
+                  pipe_flag, (*request), cell,
+                  (cell->type == CSP_OFFLOAD_CELL_SHM ? "shm" : "pending"));
 
-    CSP_DBG_PRINT("OFFLOAD isend: offload [g_bufaddr=0x%lx, count=%d, datatype=0x%x/0x%x, "
-                  "me=%d/%d, dest=%d/%d, tag=%d, comm=0x%x/0x%lx], "
-                  "req 0x%x, cell %p(%s)\n", g_bufaddr, count, datatype, isend_pkt->g_datatype,
-                  rank, ugrank, dest, isend_pkt->peer_ugrank, tag, comm, isend_pkt->g_ugcomm_handle,
-                  (*request), cell, (cell->type == CSP_OFFLOAD_CELL_SHM ? "shm" : "pending"));
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+    if (is_eager) {
+        CSPU_PROF_EXT_COUNTER_INC(CSPU_offload_ch.eager.nissued);
+    }
+    if (pipe_flag)
+        mpi_errno = CSPU_offload_pipe_issue(cell, copy_buf, datatype);
+    else
+        CSPU_offload_issue(cell);
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
   fn_exit:
     return mpi_errno;
@@ -72,7 +129,7 @@ int MPI_Isend(const void *buf, int count, MPI_Datatype datatype, int dest, int t
 {
     int mpi_errno = MPI_SUCCESS;
     CSPU_comm_t *ug_comm = NULL;
-    int buf_found_flag = 0, offsz_flag = 0;
+    int buf_found_flag = 0, offsz_flag = 0, eager_flag = 0, pipe_flag = 0;
     MPI_Aint g_bufaddr = -1;
 
     /* No communicator replacement if completely disabled */
@@ -90,29 +147,46 @@ int MPI_Isend(const void *buf, int count, MPI_Datatype datatype, int dest, int t
         return mpi_errno;
     }
 
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
     CSPU_ERRHAN_EXTOBJ_LOCAL_DCL();
     CSPU_COMM_ERRHAN_SET_EXTOBJ();
-    /* TODO: do we need thread CS here ? */
 
     CSPU_fetch_ug_comm_from_cache(comm, &ug_comm);
+
+    /* Buffer translation is shared by all threads. */
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
     /* Skip check if it is not a pre-wrapped communicator (e.g., MPI_COMM_SELF) */
     if (ug_comm) {
         CSPU_shmbuf_translate_g_addr((void *) buf, &g_bufaddr, &buf_found_flag);
         CSPU_offload_checksz(count, datatype, ug_comm, &offsz_flag);
+
+        /* Receiver still offloads by size, thus offsz_flag must be set. Split large
+         * message into chunks (staged if the buffer is unregistered), otherwise copy
+         * unregistered buffer into shared memory if the message is small enough. */
+        if (ug_comm->type >= CSP_COMM_ASYNC_DUP && offsz_flag) {
+            CSPU_offload_check_pipeline(count, datatype, ug_comm, &pipe_flag);
+            if (!buf_found_flag && !pipe_flag)
+                CSPU_offload_check_eager(count, datatype, comm, &eager_flag);
+        }
     }
 
     CSP_DBG_PRINT("isend: comm 0x%x->ug_comm=%p, buf=%p, g_bufaddr=0x%lx, "
-                  "buf_found_flag=%d, offsz_flag=%d\n", comm, ug_comm, buf, g_bufaddr,
-                  buf_found_flag, offsz_flag);
+                  "buf_found_flag=%d, offsz_flag=%d, eager_flag=%d, pipe_flag=%d\n", comm,
+                  ug_comm, buf, g_bufaddr, buf_found_flag, offsz_flag, eager_flag, pipe_flag);
 
-    if (ug_comm && ug_comm->type >= CSP_COMM_ASYNC_DUP && buf_found_flag && offsz_flag) {
+    if (ug_comm && ug_comm->type >= CSP_COMM_ASYNC_DUP && offsz_flag &&
+        (buf_found_flag || eager_flag || pipe_flag)) {
         CSPU_PROF_PT2PT_COUNTER_INC(ISEND, ON);
+        CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
 
-        /* Asynchronous enabled comm and registered shared buffer. */
-        mpi_errno = isend_impl(g_bufaddr, count, datatype, dest, tag, comm, request, ug_comm);
+        /* Asynchronous enabled comm and registered shared buffer, or copied payload. */
+        mpi_errno = isend_impl(buf_found_flag ? NULL : buf, g_bufaddr, count, datatype, dest,
+                               tag, comm, request, ug_comm, pipe_flag);
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
     else {
+        CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+
         /* normal comm. */
         CSPU_ERRHAN_RESET_EXTOBJ();     /* reset before calling original MPI */
 
@@ -0,0 +1,27 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+int MPI_Request_free(MPI_Request * request)
+{
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT))
+        return PMPI_Request_free(request);
+
+    /* A pooled request is reused by later offloaded calls once completed,
+     * thus it cannot be released before completion. */
+    if (CSPU_offload_req_check_pooled(*request)) {
+        CSP_msg_print(CSP_MSG_ERROR, "Cannot free offloaded request 0x%x taken from "
+                      "request pool, please complete it by MPI_Test, MPI_Wait or "
+                      "MPI_Waitall, or set CSP_OFFLOAD_REQ_POOL_SIZE=0.\n", *request);
+        return MPI_ERR_REQUEST;
+    }
+
+    return PMPI_Request_free(request);
+}
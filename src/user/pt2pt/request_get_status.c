@@ -0,0 +1,34 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+int MPI_Request_get_status(MPI_Request request, int *flag, MPI_Status * status)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int is_offload = 0;
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT)) {
+        return PMPI_Request_get_status(request, flag, status);
+    }
+
+    /* Error directly handled by COMM_WORLD error handler. */
+    mpi_errno = CSPU_offload_req_get_status(request, flag, status, &is_offload);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    /* Original request. */
+    if (!is_offload)
+        CSP_CALLMPI(JUMP, PMPI_Request_get_status(request, flag, status));
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
@@ -11,7 +11,7 @@
 int MPI_Test(MPI_Request * request, int *flag, MPI_Status * status)
 {
     int mpi_errno = MPI_SUCCESS;
-    CSP_offload_cell_t *cell = NULL;
+    int is_offload = 0;
 
     /* Skip internal processing when disabled */
     if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT)) {
@@ -19,22 +19,12 @@ int MPI_Test(MPI_Request * request, int *flag, MPI_Status * status)
     }
 
     /* Error directly handled by COMM_WORLD error handler. */
-    /* TODO: do we need thread CS here ? */
+    mpi_errno = CSPU_offload_req_test(request, flag, status, &is_offload);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    CSPU_offload_poll_progress();
-
-    CSPU_offload_req_hash_get(*request, &cell);
-
-    /* Complete offload request. */
-    if (cell && cell->type == CSP_OFFLOAD_CELL_SHM && CSPU_offload_check_complete(cell)) {
-        CSP_CALLMPI(JUMP, PMPI_Grequest_complete(*request));
-        CSP_DBG_PRINT("test: completed offload cell=%p, req=0x%x\n", cell, *request);
-    }
-
-    /* The callback functions are triggered after completion :
-     * query_fn get the corresponding cell instance and generates correct status.
-     * free_fn cleans up the cell instance. */
-    CSP_CALLMPI(JUMP, PMPI_Test(request, flag, status));
+    /* Original request. */
+    if (!is_offload)
+        CSP_CALLMPI(JUMP, PMPI_Test(request, flag, status));
 
   fn_exit:
     return mpi_errno;
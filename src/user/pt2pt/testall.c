@@ -0,0 +1,107 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+/* Check whether all offload requests are completed without freeing any of
+ * them, since MPI_Testall must not complete any request if returns false. */
+static inline void testall_check_offload(int count, MPI_Request array_of_requests[],
+                                         MPI_Request orig_reqs[], int *flag)
+{
+    CSP_offload_cell_t *cell = NULL;
+    int i;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+
+    CSPU_offload_poll_completion();
+    CSPU_offload_poll_progress();
+
+    (*flag) = 1;
+    for (i = 0; i < count; i++) {
+        if (array_of_requests[i] == MPI_REQUEST_NULL || orig_reqs[i] != MPI_REQUEST_NULL)
+            continue;
+
+        CSPU_offload_req_hash_get(array_of_requests[i], &cell);
+        CSP_ASSERT(cell);
+        if (cell->type != CSP_OFFLOAD_CELL_SHM || !CSPU_offload_check_complete(cell)) {
+            (*flag) = 0;
+            break;
+        }
+    }
+
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+}
+
+int MPI_Testall(int count, MPI_Request array_of_requests[], int *flag,
+                MPI_Status array_of_statuses[])
+{
+    int mpi_errno = MPI_SUCCESS;
+    MPI_Request *orig_reqs = NULL;
+    MPI_Status *status = MPI_STATUS_IGNORE;
+    int i, is_offload = 0, cflag = 0, err_in_status = 0;
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT)) {
+        return PMPI_Testall(count, array_of_requests, flag, array_of_statuses);
+    }
+
+    /* Error directly handled by COMM_WORLD error handler. */
+    orig_reqs = CSP_calloc(count + 1, sizeof(MPI_Request));
+
+    /* Only original requests. */
+    if (CSPU_offload_req_split(count, array_of_requests, orig_reqs) == 0) {
+        CSP_CALLMPI(JUMP, PMPI_Testall(count, array_of_requests, flag, array_of_statuses));
+        goto fn_exit;
+    }
+
+    testall_check_offload(count, array_of_requests, orig_reqs, flag);
+    if (!(*flag))
+        goto fn_exit;
+
+    /* All offload requests are completed, thus the result depends only on
+     * the original requests. */
+    mpi_errno = PMPI_Testall(count, orig_reqs, flag, array_of_statuses);
+    if (mpi_errno == MPI_ERR_IN_STATUS) {
+        err_in_status = 1;
+        mpi_errno = MPI_SUCCESS;
+    }
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    if (!(*flag))
+        goto fn_exit;
+
+    /* Complete offload requests. Note that MPI already set an empty status
+     * for them. */
+    for (i = 0; i < count; i++) {
+        if (array_of_requests[i] == MPI_REQUEST_NULL || orig_reqs[i] != MPI_REQUEST_NULL) {
+            array_of_requests[i] = orig_reqs[i];
+            continue;
+        }
+
+        if (array_of_statuses != MPI_STATUSES_IGNORE)
+            status = &array_of_statuses[i];
+
+        mpi_errno = CSPU_offload_req_test(&array_of_requests[i], &cflag, status, &is_offload);
+        CSP_ASSERT(is_offload && cflag);
+        if (mpi_errno != MPI_SUCCESS) {
+            err_in_status = 1;
+            mpi_errno = MPI_SUCCESS;
+        }
+    }
+
+    if (err_in_status)
+        mpi_errno = MPI_ERR_IN_STATUS;
+
+  fn_exit:
+    if (orig_reqs)
+        free(orig_reqs);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
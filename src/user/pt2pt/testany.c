@@ -0,0 +1,80 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+/* Test the offload requests one by one, then the original requests in
+ * orig_reqs (see CSPU_offload_req_split). MPI reports completion if every
+ * original request is null or inactive, thus it is reset if any offload
+ * request is still active. */
+int CSPU_offload_testany(int count, MPI_Request array_of_requests[], MPI_Request orig_reqs[],
+                         int *indx, int *flag, MPI_Status * status)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i, is_offload = 0, nactive = 0;
+
+    (*indx) = MPI_UNDEFINED;
+    (*flag) = 0;
+
+    for (i = 0; i < count; i++) {
+        if (array_of_requests[i] == MPI_REQUEST_NULL || orig_reqs[i] != MPI_REQUEST_NULL)
+            continue;
+
+        mpi_errno = CSPU_offload_req_test(&array_of_requests[i], flag, status, &is_offload);
+        CSP_ASSERT(is_offload);
+        if (mpi_errno != MPI_SUCCESS || (*flag)) {
+            (*indx) = i;
+            goto fn_exit;
+        }
+        nactive++;
+    }
+
+    CSP_CALLMPI(JUMP, PMPI_Testany(count, orig_reqs, indx, flag, status));
+    if ((*flag) && (*indx) != MPI_UNDEFINED)
+        array_of_requests[*indx] = orig_reqs[*indx];
+    else if ((*flag) && nactive > 0)
+        (*flag) = 0;
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int MPI_Testany(int count, MPI_Request array_of_requests[], int *indx, int *flag,
+                MPI_Status * status)
+{
+    int mpi_errno = MPI_SUCCESS;
+    MPI_Request *orig_reqs = NULL;
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT)) {
+        return PMPI_Testany(count, array_of_requests, indx, flag, status);
+    }
+
+    /* Error directly handled by COMM_WORLD error handler. */
+    orig_reqs = CSP_calloc(count + 1, sizeof(MPI_Request));
+
+    /* Only original requests. */
+    if (CSPU_offload_req_split(count, array_of_requests, orig_reqs) == 0) {
+        CSP_CALLMPI(JUMP, PMPI_Testany(count, array_of_requests, indx, flag, status));
+        goto fn_exit;
+    }
+
+    mpi_errno = CSPU_offload_testany(count, array_of_requests, orig_reqs, indx, flag, status);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+  fn_exit:
+    if (orig_reqs)
+        free(orig_reqs);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
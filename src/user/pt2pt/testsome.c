@@ -0,0 +1,101 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+/* Test the original requests in orig_reqs (see CSPU_offload_req_split), then
+ * the offload requests one by one. Completed offload requests are appended
+ * after the original ones. Return MPI_ERR_IN_STATUS if any completed request
+ * failed. */
+int CSPU_offload_testsome(int incount, MPI_Request array_of_requests[], MPI_Request orig_reqs[],
+                          int *outcount, int array_of_indices[], MPI_Status array_of_statuses[])
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i, flag = 0, is_offload = 0, nactive = 0, ncompleted = 0, err_in_status = 0;
+    MPI_Status *status = MPI_STATUS_IGNORE;
+
+    mpi_errno = PMPI_Testsome(incount, orig_reqs, outcount, array_of_indices, array_of_statuses);
+    if (mpi_errno == MPI_ERR_IN_STATUS) {
+        err_in_status = 1;
+        mpi_errno = MPI_SUCCESS;
+    }
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    if ((*outcount) != MPI_UNDEFINED) {
+        ncompleted = (*outcount);
+        nactive = (*outcount);
+        for (i = 0; i < ncompleted; i++)
+            array_of_requests[array_of_indices[i]] = orig_reqs[array_of_indices[i]];
+    }
+
+    for (i = 0; i < incount; i++) {
+        if (array_of_requests[i] == MPI_REQUEST_NULL || orig_reqs[i] != MPI_REQUEST_NULL)
+            continue;
+
+        if (array_of_statuses != MPI_STATUSES_IGNORE)
+            status = &array_of_statuses[ncompleted];
+
+        flag = 0;
+        mpi_errno = CSPU_offload_req_test(&array_of_requests[i], &flag, status, &is_offload);
+        CSP_ASSERT(is_offload);
+        if (mpi_errno != MPI_SUCCESS) {
+            err_in_status = 1;
+            mpi_errno = MPI_SUCCESS;
+        }
+        if (flag)
+            array_of_indices[ncompleted++] = i;
+        nactive++;
+    }
+
+    /* MPI_UNDEFINED only if every request is null or inactive. */
+    (*outcount) = (nactive > 0) ? ncompleted : MPI_UNDEFINED;
+
+    if (err_in_status)
+        mpi_errno = MPI_ERR_IN_STATUS;
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int MPI_Testsome(int incount, MPI_Request array_of_requests[], int *outcount,
+                 int array_of_indices[], MPI_Status array_of_statuses[])
+{
+    int mpi_errno = MPI_SUCCESS;
+    MPI_Request *orig_reqs = NULL;
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT)) {
+        return PMPI_Testsome(incount, array_of_requests, outcount, array_of_indices,
+                             array_of_statuses);
+    }
+
+    /* Error directly handled by COMM_WORLD error handler. */
+    orig_reqs = CSP_calloc(incount + 1, sizeof(MPI_Request));
+
+    /* Only original requests. */
+    if (CSPU_offload_req_split(incount, array_of_requests, orig_reqs) == 0) {
+        CSP_CALLMPI(JUMP, PMPI_Testsome(incount, array_of_requests, outcount, array_of_indices,
+                                        array_of_statuses));
+        goto fn_exit;
+    }
+
+    mpi_errno = CSPU_offload_testsome(incount, array_of_requests, orig_reqs, outcount,
+                                      array_of_indices, array_of_statuses);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+  fn_exit:
+    if (orig_reqs)
+        free(orig_reqs);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
@@ -8,27 +8,53 @@
 #include <stdlib.h>
 #include "cspu.h"
 
-int MPI_Wait(MPI_Request * request, MPI_Status * status)
+/* Reload the cell if it is still locally pending, or if other threads may have
+ * issued it to the shared queue while the critical section was released. */
+#define OFFLOAD_WAIT_RELOAD_CELL(request, cell) do {                                \
+    if (CSP_PROC.user.is_thread_multiple || (cell)->type == CSP_OFFLOAD_CELL_PENDING) \
+        CSPU_offload_req_hash_get(*(request), &(cell));                             \
+    CSP_ASSERT(cell);                                                               \
+} while (0)
+
+/* Wait for an offloaded request. Return 0 in is_offload if it is an original
+ * request, which is waited by the caller without holding the channel critical
+ * section. The critical section is released and the processor is yielded
+ * between polls, thus other threads can issue or complete offloaded calls. */
+static inline int offload_wait(MPI_Request * request, MPI_Status * status, int *is_offload)
 {
     int mpi_errno = MPI_SUCCESS;
     CSP_offload_cell_t *cell = NULL;
     int flag = 0;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
 
-    /* Skip internal processing when disabled */
-    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT)) {
-        return PMPI_Wait(request, status);
-    }
-
-    /* Error directly handled by COMM_WORLD error handler. */
-    /* TODO: do we need thread CS here ? */
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
 
     CSPU_offload_req_hash_get(*request, &cell);
 
     /* Original request or already completed. */
+    *is_offload = (cell != NULL);
     if (!cell)
-        return PMPI_Wait(request, status);
+        goto fn_exit;
+
+    /* Pooled request is completed locally without calling MPI. */
+    if (CSPU_offload_req_is_pooled(cell)) {
+        CSPU_offload_poll_completion();
+        while (cell->type != CSP_OFFLOAD_CELL_SHM || !CSPU_offload_check_complete(cell)) {
+            CSPU_offload_poll_progress();
+
+            CSPU_THREAD_YIELD_OBJ_CS(&CSPU_offload_ch);
+
+            OFFLOAD_WAIT_RELOAD_CELL(request, cell);
+            CSPU_offload_poll_completion();
+        }
+
+        CSP_DBG_PRINT("Wait: completed pooled offload cell=%p, req=0x%x\n", cell, *request);
+        mpi_errno = CSPU_offload_complete_pooled_req(cell, request, status);
+        goto fn_exit;
+    }
 
     do {
+        CSPU_offload_poll_completion();
         if (cell->type == CSP_OFFLOAD_CELL_SHM && CSPU_offload_check_complete(cell)) {
             /* Complete offload request. */
             CSP_CALLMPI(JUMP, PMPI_Grequest_complete(*request));
@@ -40,17 +66,44 @@ int MPI_Wait(MPI_Request * request, MPI_Status * status)
 
         /* Poll progress if not completed yet. */
         CSPU_offload_poll_progress();
-
-        /* Reload if still locally pending. */
-        if (cell->type == CSP_OFFLOAD_CELL_PENDING)
-            CSPU_offload_req_hash_get(*request, &cell);
-        CSP_ASSERT(cell);
+        OFFLOAD_WAIT_RELOAD_CELL(request, cell);
 
         /* The callback functions are triggered after completion :
          * query_fn get the corresponding cell instance and generates correct status.
-         * free_fn cleans up the cell instance. */
+         * free_fn cleans up the cell instance, thus must be called in critical section. */
         CSP_CALLMPI(JUMP, PMPI_Test(request, &flag, status));
-    } while (!flag);
+        if (flag)
+            break;
+
+        CSPU_THREAD_YIELD_OBJ_CS(&CSPU_offload_ch);
+        OFFLOAD_WAIT_RELOAD_CELL(request, cell);
+    } while (1);
+
+  fn_exit:
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int MPI_Wait(MPI_Request * request, MPI_Status * status)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int is_offload = 0;
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT)) {
+        return PMPI_Wait(request, status);
+    }
+
+    /* Error directly handled by COMM_WORLD error handler. */
+    mpi_errno = offload_wait(request, status, &is_offload);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    /* Original request or already completed. */
+    if (!is_offload)
+        return PMPI_Wait(request, status);
 
   fn_exit:
     return mpi_errno;
@@ -9,88 +9,134 @@
 #include <stdlib.h>
 #include "cspu.h"
 
-static inline int waitall_pending_impl(CSP_offload_cell_t ** cells, int count,
-                                       MPI_Request array_of_requests[],
-                                       MPI_Status array_of_statuses[])
+/* Status of the i-th request passed to offload request completion. */
+#define CSPU_WAITALL_STATUS(array_of_statuses, i)  \
+    ((array_of_statuses) == MPI_STATUSES_IGNORE ? MPI_STATUS_IGNORE : &(array_of_statuses)[i])
+
+/* Complete an offload request whose cell is completed. Pooled request is
+ * completed locally. Generalized request is completed and freed immediately,
+ * thus its shared cell can be reused by pending cells at next poll. */
+static inline int waitall_complete_offload(CSP_offload_cell_t * cell, MPI_Request * request,
+                                           MPI_Status * status, int *err_in_status)
 {
     int mpi_errno = MPI_SUCCESS;
-    int i, ncompleted = 0, ngcompleted = 0, *skip_flags = NULL;
-    int some_count = 0, *some_indices = NULL;
-    MPI_Status *some_statuses = NULL;
-
-    skip_flags = CSP_calloc(count, sizeof(int));
-    some_indices = CSP_calloc(count, sizeof(int));
-    if (array_of_statuses != MPI_STATUSES_IGNORE)
-        some_statuses = CSP_calloc(count, sizeof(MPI_Status));
-    else
-        some_statuses = MPI_STATUSES_IGNORE;
-
-    do {
-        for (i = 0; i < count; i++) {
-            /* Skip any original or completed offload request. */
-            if (skip_flags[i])
-                continue;
 
-            if (cells[i] == NULL) {
-                skip_flags[i] = 1;
-                ngcompleted++;  /* increment for original request in order to break from loop. */
-            }
-            /* Complete offload request. */
-            else if (cells[i]->type == CSP_OFFLOAD_CELL_SHM &&
-                     CSPU_offload_check_complete(cells[i])) {
-                CSP_CALLMPI(JUMP, PMPI_Grequest_complete(array_of_requests[i]));
-                CSP_DBG_PRINT("Waitall: completed offload cells[%d]=%p, reqs[%d]=0x%x\n", i,
-                              cells[i], i, array_of_requests[i]);
-                skip_flags[i] = 1;
-                ngcompleted++;
-            }
-
-            /* Polls offload progress if pending cell exists.
-             * Because the progress always tries to transfer as many pending
-             * cells as it can, we do not expect empty polling. */
-            if (cells[i]->type == CSP_OFFLOAD_CELL_PENDING) {
-                CSPU_offload_poll_progress();
-
-                /* Reload pending cell. */
-                CSPU_offload_req_hash_get(array_of_requests[i], &cells[i]);
-                CSP_ASSERT(cells[i]);
-            }
+    CSP_DBG_PRINT("Waitall: completed offload cell=%p, req=0x%x\n", cell, *request);
+
+    if (CSPU_offload_req_is_pooled(cell)) {
+        if (CSPU_offload_complete_pooled_req(cell, request, status) != MPI_SUCCESS)
+            (*err_in_status) = 1;
+        return mpi_errno;
+    }
+
+    /* The callback functions are triggered after completion :
+     * query_fn get the corresponding cell instance and generates correct status.
+     * free_fn cleans up the cell instance. */
+    CSP_CALLMPI(RETURN, PMPI_Grequest_complete(*request));
+    CSP_CALLMPI(RETURN, PMPI_Wait(request, status));
+    return mpi_errno;
+}
+
+/* Other threads may dequeue the completion of my requests when polling the
+ * channel, thus rescan the requests not completed yet. */
+static inline int waitall_rescan_offload(int count, MPI_Request array_of_requests[],
+                                         MPI_Status array_of_statuses[],
+                                         CSP_offload_cell_t ** cells, int *ncompleted,
+                                         int *err_in_status)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (cells[i] == NULL || array_of_requests[i] == MPI_REQUEST_NULL)
+            continue;
+
+        /* Reload since a pending cell may be issued by other threads. */
+        CSPU_offload_req_hash_get(array_of_requests[i], &cells[i]);
+        CSP_ASSERT(cells[i]);
+        if (cells[i]->type == CSP_OFFLOAD_CELL_SHM && CSPU_offload_check_complete(cells[i])) {
+            mpi_errno = waitall_complete_offload(cells[i], &array_of_requests[i],
+                                                 CSPU_WAITALL_STATUS(array_of_statuses, i),
+                                                 err_in_status);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+            (*ncompleted)++;
+        }
+    }
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Complete all offload requests, and set the cell of every offload request in
+ * cells (NULL for original request). The channel critical section is released
+ * between polls, thus other threads can issue or complete offloaded calls. */
+static inline int waitall_offload(int count, MPI_Request array_of_requests[],
+                                  MPI_Status array_of_statuses[], CSP_offload_cell_t ** cells,
+                                  int *noffload_ptr, int *err_in_status)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSP_offload_cell_t *cell = NULL;
+    int i, idx, noffload = 0, ncompleted = 0;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_offload_ch);
+
+    /* Complete the offload requests already completed at previous polls, and
+     * mark the cell of others with its index. Thus every cell dequeued from the
+     * completion queue is directly mapped to the request without scanning. */
+    CSPU_offload_poll_completion();
+    for (i = 0; i < count; i++) {
+        CSPU_offload_req_hash_get(array_of_requests[i], &cells[i]);
+        if (cells[i] == NULL)
+            continue;
+
+        noffload++;
+        if (cells[i]->type == CSP_OFFLOAD_CELL_SHM && CSPU_offload_check_complete(cells[i])) {
+            mpi_errno = waitall_complete_offload(cells[i], &array_of_requests[i],
+                                                 CSPU_WAITALL_STATUS(array_of_statuses, i),
+                                                 err_in_status);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+            ncompleted++;
         }
+        else {
+            /* A pending cell passes the index to its shared cell at progress. */
+            cells[i]->pkt.waitall_idx = i + 1;
+        }
+    }
+
+    while (ncompleted < noffload) {
+        /* Moves pending cells to the shared queue once free cells are available. */
+        CSPU_offload_poll_progress();
 
-        if (ncompleted != ngcompleted) {
-            /* The callback functions are triggered after completion :
-             * query_fn get the corresponding cell instance and generates correct status.
-             * free_fn cleans up the cell instance.
-             * Note that PMPI_Testall may release requests only after all requests
-             * are completed. Instead, PMPI_Testsome can release completed request at
-             * every poll. It guarantees every completed request becomes inactive,
-             * thus is ignored at next poll.*/
-            CSP_CALLMPI(JUMP,
-                        PMPI_Testsome(count, array_of_requests, &some_count, some_indices,
-                                      some_statuses));
-
-            /* Should already left by checking ncompleted. */
-            CSP_DBG_ASSERT(some_count != MPI_UNDEFINED);
-
-            if (some_count > 0) {
-                if (array_of_statuses != MPI_STATUS_IGNORE) {
-                    for (i = 0; i < some_count; i++)
-                        memcpy(&array_of_statuses[some_indices[i]], &some_statuses[i],
-                               sizeof(MPI_Status));
-                }
-                ncompleted += some_count;
-            }
+        while (CSPU_offload_cmplq_dequeue(&cell)) {
+            idx = cell->pkt.waitall_idx - 1;
+
+            /* Completed cell of another request. */
+            if (idx < 0 || idx >= count || array_of_requests[idx] != cell->pkt.req)
+                continue;
+
+            mpi_errno = waitall_complete_offload(cell, &array_of_requests[idx],
+                                                 CSPU_WAITALL_STATUS(array_of_statuses, idx),
+                                                 err_in_status);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+            ncompleted++;
         }
-    } while (ncompleted < count);
 
+        if (CSP_PROC.user.is_thread_multiple && ncompleted < noffload) {
+            CSPU_THREAD_YIELD_OBJ_CS(&CSPU_offload_ch);
+
+            mpi_errno = waitall_rescan_offload(count, array_of_requests, array_of_statuses,
+                                               cells, &ncompleted, err_in_status);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        }
+    }
 
   fn_exit:
-    if (some_indices)
-        free(some_indices);
-    if (some_statuses && some_statuses != MPI_STATUSES_IGNORE)
-        free(some_statuses);
-    if (skip_flags)
-        free(skip_flags);
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_offload_ch);
+    (*noffload_ptr) = noffload;
     return mpi_errno;
 
   fn_fail:
@@ -101,7 +147,7 @@ int MPI_Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_
 {
     int mpi_errno = MPI_SUCCESS;
     CSP_offload_cell_t **cells = NULL;
-    int i, ngcompleted = 0, *skip_flags = NULL;
+    int i, noffload = 0, err_in_status = 0;
 
     /* Skip internal processing when disabled */
     if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT)) {
@@ -109,51 +155,33 @@ int MPI_Waitall(int count, MPI_Request array_of_requests[], MPI_Status array_of_
     }
 
     /* Error directly handled by COMM_WORLD error handler. */
-    /* TODO: do we need thread CS here ? */
-
     cells = CSP_calloc(count, sizeof(CSP_offload_cell_t *));
-    skip_flags = CSP_calloc(count, sizeof(int));
 
-    for (i = 0; i < count; i++)
-        CSPU_offload_req_hash_get(array_of_requests[i], &cells[i]);
+    mpi_errno = waitall_offload(count, array_of_requests, array_of_statuses, cells,
+                                &noffload, &err_in_status);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    if (CSPU_offload_ch.pending_q.noutstanding > 0) {
-        /* Slow path */
-        mpi_errno = waitall_pending_impl(cells, count, array_of_requests, array_of_statuses);
-        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    /* Only original requests. */
+    if (noffload == 0) {
+        CSP_CALLMPI(JUMP, PMPI_Waitall(count, array_of_requests, array_of_statuses));
         goto fn_exit;
     }
 
-    /* Fast path if no pending cells. */
-    do {
-        for (i = 0; i < count; i++) {
-            /* Skip any original or completed offload request. */
-            if (skip_flags[i])
-                continue;
-
-            if (cells[i] == NULL) {
-                skip_flags[i] = 1;
-                ngcompleted++;  /* increment for original request in order to break from loop. */
-            }
-            /* Complete offload request. */
-            else if (cells[i]->type == CSP_OFFLOAD_CELL_SHM &&
-                     CSPU_offload_check_complete(cells[i])) {
-                CSP_CALLMPI(JUMP, PMPI_Grequest_complete(array_of_requests[i]));
-                CSP_DBG_PRINT("Waitall: completed offload cells[%d]=%p, reqs[%d]=0x%x\n", i,
-                              cells[i], i, array_of_requests[i]);
-                skip_flags[i] = 1;
-                ngcompleted++;
-            }
-        }
-    } while (ngcompleted < count);
+    /* Complete original requests. Every offload request is already freed, but
+     * we cannot call PMPI_Waitall because it resets their statuses. */
+    for (i = 0; i < count && noffload < count; i++) {
+        if (cells[i] != NULL)
+            continue;
+        CSP_CALLMPI(JUMP, PMPI_Wait(&array_of_requests[i],
+                                    CSPU_WAITALL_STATUS(array_of_statuses, i)));
+    }
 
-    CSP_CALLMPI(JUMP, PMPI_Waitall(count, array_of_requests, array_of_statuses));
+    if (err_in_status)
+        mpi_errno = MPI_ERR_IN_STATUS;
 
   fn_exit:
     if (cells)
         free(cells);
-    if (skip_flags)
-        free(skip_flags);
     return mpi_errno;
 
   fn_fail:
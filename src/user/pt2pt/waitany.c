@@ -0,0 +1,46 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+int MPI_Waitany(int count, MPI_Request array_of_requests[], int *indx, MPI_Status * status)
+{
+    int mpi_errno = MPI_SUCCESS;
+    MPI_Request *orig_reqs = NULL;
+    int flag = 0;
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT)) {
+        return PMPI_Waitany(count, array_of_requests, indx, status);
+    }
+
+    /* Error directly handled by COMM_WORLD error handler. */
+    orig_reqs = CSP_calloc(count + 1, sizeof(MPI_Request));
+
+    /* Only original requests. */
+    if (CSPU_offload_req_split(count, array_of_requests, orig_reqs) == 0) {
+        CSP_CALLMPI(JUMP, PMPI_Waitany(count, array_of_requests, indx, status));
+        goto fn_exit;
+    }
+
+    /* Offload requests are completed only by polling the offload channel,
+     * thus we cannot block in MPI. */
+    do {
+        mpi_errno = CSPU_offload_testany(count, array_of_requests, orig_reqs, indx, &flag,
+                                         status);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    } while (!flag);
+
+  fn_exit:
+    if (orig_reqs)
+        free(orig_reqs);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
@@ -0,0 +1,48 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+int MPI_Waitsome(int incount, MPI_Request array_of_requests[], int *outcount,
+                 int array_of_indices[], MPI_Status array_of_statuses[])
+{
+    int mpi_errno = MPI_SUCCESS;
+    MPI_Request *orig_reqs = NULL;
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(PT2PT)) {
+        return PMPI_Waitsome(incount, array_of_requests, outcount, array_of_indices,
+                             array_of_statuses);
+    }
+
+    /* Error directly handled by COMM_WORLD error handler. */
+    orig_reqs = CSP_calloc(incount + 1, sizeof(MPI_Request));
+
+    /* Only original requests. */
+    if (CSPU_offload_req_split(incount, array_of_requests, orig_reqs) == 0) {
+        CSP_CALLMPI(JUMP, PMPI_Waitsome(incount, array_of_requests, outcount, array_of_indices,
+                                        array_of_statuses));
+        goto fn_exit;
+    }
+
+    /* Offload requests are completed only by polling the offload channel,
+     * thus we cannot block in MPI. */
+    do {
+        mpi_errno = CSPU_offload_testsome(incount, array_of_requests, orig_reqs, outcount,
+                                          array_of_indices, array_of_statuses);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    } while ((*outcount) == 0);
+
+  fn_exit:
+    if (orig_reqs)
+        free(orig_reqs);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
@@ -5,6 +5,9 @@
 libcasper_la_SOURCES += src/user/rma/win_allocate.c \
                         src/user/rma/win_create.c \
                         src/user/rma/win_create_dynamic.c \
+                        src/user/rma/win_attach.c \
+                        src/user/rma/alloc_mem.c \
+                        src/user/rma/free_mem.c \
                         src/user/rma/win_allocate_shared.c \
                         src/user/rma/win_free.c \
                         src/user/rma/put.c \
@@ -34,4 +37,9 @@ libcasper_la_SOURCES += src/user/rma/win_allocate.c \
                         src/user/rma/win_complete.c	\
                         src/user/rma/win_get_attr.c	\
                         src/user/rma/csp_get_ghost.c	\
-                        src/user/rma/csp_bind_ghost.c
+                        src/user/rma/csp_bind_ghost.c	\
+                        src/user/rma/csp_put_combine.c	\
+                        src/user/rma/csp_shm_direct.c	\
+                        src/user/rma/csp_ugcomm_cache.c	\
+                        src/user/rma/csp_dyn_pool.c	\
+                        src/user/rma/csp_win_remap.c
@@ -43,13 +43,56 @@ static int accumulate_impl(const void *origin_addr, int origin_count,
     CSPU_TARGET_GET_EPOCH_WIN(target, ug_win, win_ptr);
 
 #if defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
+    /* Split the operation at address stripe boundaries, so that every piece is
+     * applied by the ghost owning that stripe. Only the same predefined contiguous
+     * type on both sides is split, other operations are bound by the first byte. */
+    if (CSP_ENV.load_acc_stripe > 0 && origin_datatype == target_datatype &&
+        origin_count == target_count) {
+        int type_size = 0, is_contig = 0;
+
+        mpi_errno = CSPU_datatype_check_contig(target_datatype, &type_size, &is_contig);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+        if (is_contig && type_size > 0) {
+            MPI_Aint target_byte_disp = target->disp_unit * target_disp;
+            const char *origin_ptr = (const char *) origin_addr;
+            int count = origin_count;
+
+            while (count > 0) {
+                int n = CSPU_acc_stripe_count(target_byte_disp, type_size, count);
+
+                mpi_errno = CSPU_target_get_acc_ghost(target_rank, target_byte_disp,
+                                                      n * type_size, ug_win,
+                                                      &target_g_rank_in_ug, &target_g_offset);
+                CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+                ug_target_disp = target_g_offset + target_byte_disp;
+                CSP_CALLMPI(JUMP, PMPI_Accumulate(origin_ptr, n, origin_datatype,
+                                                  target_g_rank_in_ug, ug_target_disp,
+                                                  n, target_datatype, op, *win_ptr));
+
+                CSP_DBG_PRINT("CASPER Accumulate (stripe piece %d) to (ghost %d, win 0x%x [%s]) "
+                              "instead of target %d, 0x%lx(0x%lx + 0x%lx)\n", n,
+                              target_g_rank_in_ug, *win_ptr,
+                              CSPU_TARGET_GET_EPOCH_STAT_NAME(target, ug_win),
+                              target_rank, ug_target_disp, target_g_offset, target_byte_disp);
+
+                origin_ptr += (MPI_Aint) n *type_size;
+                target_byte_disp += (MPI_Aint) n *type_size;
+                count -= n;
+            }
+            goto fn_exit;
+        }
+    }
+
     if (CSP_ENV.load_opt == CSP_LOAD_BYTE_COUNTING) {
         CSP_CALLMPI(JUMP, PMPI_Type_size(origin_datatype, &data_size));
         data_size *= origin_count;
     }
 #endif
-    mpi_errno = CSPU_target_get_ghost(target_rank, 1, data_size, ug_win,
-                                      &target_g_rank_in_ug, &target_g_offset);
+    mpi_errno = CSPU_target_get_acc_ghost(target_rank, target->disp_unit * target_disp,
+                                          data_size, ug_win, &target_g_rank_in_ug,
+                                          &target_g_offset);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     ug_target_disp = target_g_offset + target->disp_unit * target_disp;
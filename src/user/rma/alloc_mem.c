@@ -0,0 +1,31 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+int MPI_Alloc_mem(MPI_Aint size, MPI_Info info, void *baseptr)
+{
+    void *ptr = NULL;
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(RMA) || !CSPU_DYN_POOL_ENABLED() || size < 0)
+        return PMPI_Alloc_mem(size, info, baseptr);
+
+    /* Allocate from the dynamic pool, thus the memory can be attached to
+     * dynamic windows with asynchronous progress. */
+    ptr = CSPU_dyn_pool_alloc(size);
+    if (ptr == NULL) {
+        CSP_msg_print(CSP_MSG_WARN, "dynamic pool is exhausted, allocate %ld bytes by MPI. "
+                      "Please increase CSP_DYNAMIC_POOL_SIZE if it is attached to "
+                      "dynamic windows.\n", (long) size);
+        return PMPI_Alloc_mem(size, info, baseptr);
+    }
+
+    *(void **) baseptr = ptr;
+    return MPI_SUCCESS;
+}
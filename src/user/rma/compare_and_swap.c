@@ -34,6 +34,18 @@ static int compare_and_swap_impl(const void *origin_addr, const void *compare_ad
 
     /* Should not do local RMA in accumulate because of atomicity issue */
 
+#ifdef HAVE_GCC_ATOMIC_BUILTINS
+    /* Unless user allows processor atomics on intra-node target. */
+    if (target->shm_base != NULL && ug_win->info_args.shm_atomics) {
+        int done = 0;
+        mpi_errno = CSPU_shm_direct_cas(origin_addr, compare_addr, result_addr, datatype,
+                                        target_rank, target_disp, ug_win, &done);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        if (done)
+            goto fn_exit;
+    }
+#endif
+
     /* Redirect operation to ghost process.
      * (See discussion of optimization for intra-node operations in csp.h.) */
 
@@ -44,8 +56,9 @@ static int compare_and_swap_impl(const void *origin_addr, const void *compare_ad
         CSP_CALLMPI(JUMP, PMPI_Type_size(datatype, &data_size));
     }
 #endif
-    mpi_errno = CSPU_target_get_ghost(target_rank, 1, data_size, ug_win,
-                                      &target_g_rank_in_ug, &target_g_offset);
+    mpi_errno = CSPU_target_get_acc_ghost(target_rank, target->disp_unit * target_disp,
+                                          data_size, ug_win, &target_g_rank_in_ug,
+                                          &target_g_offset);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     ug_target_disp = target_g_offset + target->disp_unit * target_disp;
@@ -0,0 +1,211 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+/* Shared memory pool for dynamic windows.
+ *
+ * Operations on a dynamic window address the target by absolute address, thus
+ * ghosts can access the memory attached by users only if it is mapped in the
+ * ghosts' address space. The pool is a shared window allocated on every node
+ * at initialization, each user process owns a segment of CSP_DYNAMIC_POOL_SIZE
+ * bytes which is handed out by MPI_Alloc_mem and attached by MPI_Win_attach.
+ *
+ * Ghosts attach all local segments to their internal dynamic windows when a
+ * dynamic window is created, thus no further command is needed at attach time.
+ * The address of my segment on every ghost is exchanged at initialization, and
+ * the difference to my own address is used as the base_g_offsets of dynamic
+ * windows, so that the redirection path translates target addresses exactly as
+ * the displacement of allocated windows. */
+
+#define CSPU_DYN_POOL_ALIGN 64
+
+CSPU_dyn_pool_t CSPU_dyn_pool;
+
+int CSPU_dyn_pool_init(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int local_nprocs = 0, r_disp_unit = 0, i;
+    MPI_Aint r_size = 0;
+    void *r_base = NULL;
+    MPI_Aint *addrs = NULL, *g_addrs = NULL;
+    CSPU_dyn_pool_blk_t *blk = NULL;
+
+    if (CSP_ENV.dyn_pool_size == 0)
+        goto fn_exit;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_size(CSP_PROC.local_comm, &local_nprocs));
+
+    /* Ghosts pass size 0. */
+    CSP_CALLMPI(JUMP, PMPI_Win_allocate_shared(CSP_ENV.dyn_pool_size, 1, MPI_INFO_NULL,
+                                               CSP_PROC.local_comm, &CSPU_dyn_pool.base,
+                                               &CSPU_dyn_pool.win));
+    CSP_CALLMPI(JUMP, PMPI_Get_address(CSPU_dyn_pool.base, &CSPU_dyn_pool.base_addr));
+
+    /* Exchange the address of every segment seen by every local process,
+     * thus g_addrs[x] is the address of my segment on local process x. */
+    addrs = CSP_calloc(local_nprocs, sizeof(MPI_Aint));
+    g_addrs = CSP_calloc(local_nprocs, sizeof(MPI_Aint));
+    for (i = 0; i < local_nprocs; i++) {
+        CSP_CALLMPI(JUMP, PMPI_Win_shared_query(CSPU_dyn_pool.win, i, &r_size, &r_disp_unit,
+                                                &r_base));
+        if (r_size > 0)
+            CSP_CALLMPI(JUMP, PMPI_Get_address(r_base, &addrs[i]));
+    }
+    CSP_CALLMPI(JUMP, PMPI_Alltoall(addrs, 1, MPI_AINT, g_addrs, 1, MPI_AINT,
+                                    CSP_PROC.local_comm));
+
+    CSPU_dyn_pool.g_offsets = CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Aint));
+    for (i = 0; i < CSP_ENV.num_g; i++) {
+        CSPU_dyn_pool.g_offsets[i] = g_addrs[CSP_PROC.user.g_lranks[i]] - CSPU_dyn_pool.base_addr;
+        CSP_DBG_PRINT("dyn_pool: base %p, g_offsets[%d] 0x%lx\n", CSPU_dyn_pool.base, i,
+                      CSPU_dyn_pool.g_offsets[i]);
+    }
+
+    blk = CSP_calloc(1, sizeof(CSPU_dyn_pool_blk_t));
+    blk->off = 0;
+    blk->size = CSP_ENV.dyn_pool_size;
+    blk->is_free = 1;
+    DL_APPEND(CSPU_dyn_pool.blks, blk);
+
+    CSPU_THREAD_INIT_OBJ_CS(&CSPU_dyn_pool);
+    CSPU_dyn_pool.size = CSP_ENV.dyn_pool_size;
+
+  fn_exit:
+    if (addrs)
+        free(addrs);
+    if (g_addrs)
+        free(g_addrs);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int CSPU_dyn_pool_destroy(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_dyn_pool_blk_t *blk = NULL, *tmp = NULL;
+
+    if (CSP_ENV.dyn_pool_size == 0)
+        goto fn_exit;
+
+    DL_FOREACH_SAFE(CSPU_dyn_pool.blks, blk, tmp) {
+        DL_DELETE(CSPU_dyn_pool.blks, blk);
+        free(blk);
+    }
+    if (CSPU_dyn_pool.g_offsets)
+        free(CSPU_dyn_pool.g_offsets);
+    CSPU_dyn_pool.g_offsets = NULL;
+
+    if (CSPU_dyn_pool.size > 0) {
+        CSPU_THREAD_DESTROY_OBJ_CS(&CSPU_dyn_pool);
+    }
+    CSPU_dyn_pool.size = 0;
+
+    if (CSPU_dyn_pool.win && CSPU_dyn_pool.win != MPI_WIN_NULL)
+        CSP_CALLMPI(JUMP, PMPI_Win_free(&CSPU_dyn_pool.win));
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Allocate memory from my pool segment (first fit). Return NULL if no
+ * sufficient free space. */
+void *CSPU_dyn_pool_alloc(MPI_Aint size)
+{
+    CSPU_dyn_pool_blk_t *blk = NULL, *rest = NULL;
+    void *ptr = NULL;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    size = (MPI_Aint) CSP_ALIGN(CSP_MAX(size, 1), CSPU_DYN_POOL_ALIGN);
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_dyn_pool);
+    DL_FOREACH(CSPU_dyn_pool.blks, blk) {
+        if (blk->is_free && blk->size >= size)
+            break;
+    }
+
+    if (blk) {
+        if (blk->size > size) {
+            rest = CSP_calloc(1, sizeof(CSPU_dyn_pool_blk_t));
+            rest->off = blk->off + size;
+            rest->size = blk->size - size;
+            rest->is_free = 1;
+            DL_APPEND_ELEM(CSPU_dyn_pool.blks, blk, rest);
+            blk->size = size;
+        }
+        blk->is_free = 0;
+        ptr = (char *) CSPU_dyn_pool.base + blk->off;
+    }
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_dyn_pool);
+
+    CSP_DBG_PRINT("dyn_pool: alloc %ld bytes at %p\n", size, ptr);
+    return ptr;
+}
+
+/* Return the memory to my pool segment and merge it with free neighbors. */
+int CSPU_dyn_pool_free(void *ptr)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_dyn_pool_blk_t *blk = NULL, *nb = NULL;
+    MPI_Aint off = (char *) ptr - (char *) CSPU_dyn_pool.base;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    CSPU_THREAD_ENTER_OBJ_CS(&CSPU_dyn_pool);
+    DL_FOREACH(CSPU_dyn_pool.blks, blk) {
+        if (blk->off == off)
+            break;
+    }
+
+    if (blk == NULL || blk->is_free) {
+        CSP_msg_print(CSP_MSG_ERROR, "Wrong memory %p to free in dynamic pool\n", ptr);
+        mpi_errno = MPI_ERR_ARG;
+        goto fn_exit;
+    }
+    blk->is_free = 1;
+
+    nb = blk->next;
+    if (nb && nb->is_free) {
+        blk->size += nb->size;
+        DL_DELETE(CSPU_dyn_pool.blks, nb);
+        free(nb);
+    }
+
+    /* prev of the head points to the tail. */
+    nb = (blk != CSPU_dyn_pool.blks) ? blk->prev : NULL;
+    if (nb && nb->is_free) {
+        nb->size += blk->size;
+        DL_DELETE(CSPU_dyn_pool.blks, blk);
+        free(blk);
+    }
+
+    CSP_DBG_PRINT("dyn_pool: free %p\n", ptr);
+
+  fn_exit:
+    CSPU_THREAD_EXIT_OBJ_CS(&CSPU_dyn_pool);
+    return mpi_errno;
+}
+
+/* Attach my whole segment to an internal dynamic window. */
+int CSPU_dyn_pool_attach(MPI_Win win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSP_CALLMPI(NOSTMT, PMPI_Win_attach(win, CSPU_dyn_pool.base, CSPU_dyn_pool.size));
+    return mpi_errno;
+}
+
+int CSPU_dyn_pool_detach(MPI_Win win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSP_CALLMPI(NOSTMT, PMPI_Win_detach(win, CSPU_dyn_pool.base));
+    return mpi_errno;
+}
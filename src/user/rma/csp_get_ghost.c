@@ -76,4 +76,44 @@ void CSPU_target_get_ghost_opload_by_byte(int target_rank, int is_order_required
 
     return;
 }
+
+void CSPU_target_get_ghost_opload_by_feedback(int target_rank, int is_order_required,
+                                              CSPU_win_t * ug_win, int *target_g_rank_in_ug,
+                                              int *target_g_rank_idx, MPI_Aint * target_g_offset)
+{
+    int idx, g_rank, min_idx;
+    double cost, min_cost;
+
+    /* Choose the ghost who is expected to complete the new operation earliest,
+     * i.e., the lowest value of observed per-operation latency multiplied by the
+     * number of pending operations. A ghost which has not been measured yet has
+     * zero latency, thus it is tried first. Ties are broken by operation counting. */
+    g_rank = ug_win->targets[target_rank].g_ranks_in_ug[0];
+    min_cost = ug_win->g_op_latencies[g_rank] * (ug_win->g_ops_counts[g_rank] + 1);
+    min_idx = 0;
+
+    for (idx = 1; idx < CSP_ENV.num_g; idx++) {
+        int min_g_rank = ug_win->targets[target_rank].g_ranks_in_ug[min_idx];
+
+        g_rank = ug_win->targets[target_rank].g_ranks_in_ug[idx];
+        cost = ug_win->g_op_latencies[g_rank] * (ug_win->g_ops_counts[g_rank] + 1);
+        if (cost < min_cost || (cost == min_cost &&
+                                ug_win->g_ops_counts[g_rank] < ug_win->g_ops_counts[min_g_rank])) {
+            min_cost = cost;
+            min_idx = idx;
+        }
+    }
+
+    *target_g_rank_in_ug = ug_win->targets[target_rank].g_ranks_in_ug[min_idx];
+    *target_g_offset = ug_win->targets[target_rank].base_g_offsets[min_idx];
+    *target_g_rank_idx = min_idx;
+
+    CSP_DBG_PRINT("[load_opt_feedback] choose lowest cost ghost %d, off 0x%lx for target %d\n",
+                  *target_g_rank_in_ug, *target_g_offset, target_rank);
+
+    /* Count the number of pending operations issued to every ghost */
+    CSPU_inc_target_opload_op_counting(*target_g_rank_in_ug, ug_win);
+
+    return;
+}
 #endif
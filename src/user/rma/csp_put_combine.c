@@ -0,0 +1,237 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cspu.h"
+
+/* Write-combining of small PUT operations.
+ *
+ * When the window is allocated with info put_combine_size=<bytes>, a PUT of
+ * predefined type is copied into a staging buffer instead of being issued
+ * immediately. Later PUTs to the same target on the same window are merged
+ * into the buffer if they either continue the contiguous region, or extend a
+ * constant-stride pattern of equal-sized blocks. The staged PUTs are issued as
+ * a single contiguous or hvector-typed PUT to the ghost process when the next
+ * PUT cannot be merged, or at any flush/unlock/fence/complete.
+ *
+ * An issued buffer can be reused only after the operation is locally completed,
+ * thus it is kept in issued list and recycled at the next flush/unlock. */
+
+#ifdef CSPU_PUT_WC_DEBUG
+#define CSPU_PUT_WC_DBG_PRINT(str,...) do { \
+    fprintf(stdout, "[CSPU-PUTWC][%d]"str, CSP_PROC.wrank, ## __VA_ARGS__); \
+    fflush(stdout); \
+    } while (0)
+#else
+#define CSPU_PUT_WC_DBG_PRINT(str,...) do { } while (0)
+#endif
+
+static inline CSPU_put_wc_buf_t *put_wc_alloc_buf(CSPU_win_t * ug_win)
+{
+    CSPU_put_wc_buf_t *wc_buf = NULL;
+
+    /* Reuse a completed buffer if any. */
+    if (ug_win->put_wc.free_bufs != NULL) {
+        wc_buf = ug_win->put_wc.free_bufs;
+        LL_DELETE(ug_win->put_wc.free_bufs, wc_buf);
+        wc_buf->next = NULL;
+        return wc_buf;
+    }
+
+    wc_buf = CSP_calloc(1, sizeof(CSPU_put_wc_buf_t) + ug_win->info_args.put_combine_size);
+    if (wc_buf)
+        wc_buf->buf = (char *) wc_buf + sizeof(CSPU_put_wc_buf_t);
+    return wc_buf;
+}
+
+/* Issue the staged PUTs as a single operation to the ghost process. */
+int CSPU_put_wc_drain(CSPU_win_t * ug_win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_put_wc_t *wc = &ug_win->put_wc;
+    CSPU_win_target_t *target = NULL;
+    MPI_Datatype vtype = MPI_DATATYPE_NULL;
+    MPI_Aint ug_target_disp = 0;
+    int k;
+
+    if (wc->staging == NULL)
+        goto fn_exit;
+
+    target = &(ug_win->targets[wc->target_rank]);
+    ug_target_disp = wc->target_g_offset + wc->start_disp;
+
+    if (wc->nblocks == 1) {
+        CSP_CALLMPI(JUMP, PMPI_Put(wc->staging->buf, wc->blocklen, wc->datatype,
+                                   wc->target_g_rank_in_ug, ug_target_disp, wc->blocklen,
+                                   wc->datatype, *wc->win_ptr));
+    }
+    else {
+        CSP_CALLMPI(JUMP, PMPI_Type_create_hvector(wc->nblocks, wc->blocklen, wc->stride,
+                                                   wc->datatype, &vtype));
+        CSP_CALLMPI(JUMP, PMPI_Type_commit(&vtype));
+        CSP_CALLMPI(JUMP, PMPI_Put(wc->staging->buf, wc->nblocks * wc->blocklen, wc->datatype,
+                                   wc->target_g_rank_in_ug, ug_target_disp, 1, vtype,
+                                   *wc->win_ptr));
+    }
+
+    CSPU_PUT_WC_DBG_PRINT(" drain %d block(s) x %d, stride %ld, %ld bytes to (ghost %d, "
+                          "win 0x%x) instead of target %d, 0x%lx\n", wc->nblocks, wc->blocklen,
+                          wc->stride, (long) wc->used, wc->target_g_rank_in_ug, *wc->win_ptr,
+                          wc->target_rank, ug_target_disp);
+
+    /* The ghost may have been flushed by another target who shares the same
+     * ghost, thus mark it again. */
+    for (k = 0; k < CSP_ENV.num_g; k++) {
+        if (target->g_ranks_in_ug[k] == wc->target_g_rank_in_ug) {
+            CSPU_target_set_dirty(wc->target_rank, k, ug_win);
+            break;
+        }
+    }
+
+    wc->staging->target_rank = wc->target_rank;
+    LL_APPEND(wc->issued_bufs, wc->staging);
+    wc->staging = NULL;
+    wc->nblocks = 0;
+    wc->used = 0;
+
+  fn_exit:
+    if (vtype != MPI_DATATYPE_NULL)
+        PMPI_Type_free(&vtype);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Recycle the issued buffers of a target (or all targets if target_rank is
+ * MPI_ANY_SOURCE) after the operations are (locally) completed. */
+void CSPU_put_wc_complete(int target_rank, CSPU_win_t * ug_win)
+{
+    CSPU_put_wc_buf_t *wc_buf = NULL, *tmp = NULL;
+
+    LL_FOREACH_SAFE(ug_win->put_wc.issued_bufs, wc_buf, tmp) {
+        if (target_rank == MPI_ANY_SOURCE || wc_buf->target_rank == target_rank) {
+            LL_DELETE(ug_win->put_wc.issued_bufs, wc_buf);
+            LL_PREPEND(ug_win->put_wc.free_bufs, wc_buf);
+        }
+    }
+}
+
+/* Try to stage a PUT operation. The caller should issue the PUT as usual if
+ * it is not staged (i.e., *staged is 0). */
+int CSPU_put_wc_stage(const void *origin_addr, int origin_count, MPI_Datatype origin_datatype,
+                      int target_rank, MPI_Aint target_disp, int target_count,
+                      MPI_Datatype target_datatype, CSPU_win_t * ug_win, int *staged)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_put_wc_t *wc = &ug_win->put_wc;
+    CSPU_win_target_t *target = NULL;
+    MPI_Win *win_ptr = NULL;
+    MPI_Aint disp = 0, blk_size = 0, target_g_offset = 0;
+    size_t data_size = 0;
+    int type_size = 0, combinable = 0, target_g_rank_in_ug = -1;
+
+    (*staged) = 0;
+
+    if (origin_datatype != target_datatype || origin_count != target_count || origin_count <= 0)
+        goto fn_exit;
+
+    mpi_errno = CSPU_datatype_check_contig(origin_datatype, &type_size, &combinable);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    data_size = (size_t) type_size * origin_count;
+    if (!combinable || data_size == 0 || data_size > ug_win->info_args.put_combine_size)
+        goto fn_exit;
+
+    target = &(ug_win->targets[target_rank]);
+    CSPU_TARGET_GET_EPOCH_WIN(target, ug_win, win_ptr);
+    disp = target->disp_unit * target_disp;
+
+    /* Merge into current staging buffer. */
+    if (wc->staging != NULL && wc->target_rank == target_rank && wc->win_ptr == win_ptr &&
+        wc->datatype == origin_datatype &&
+        wc->used + data_size <= ug_win->info_args.put_combine_size) {
+        blk_size = (MPI_Aint) wc->blocklen * type_size;
+
+        if (wc->nblocks == 1 && disp == wc->start_disp + blk_size) {
+            /* continue the contiguous region */
+            wc->blocklen += origin_count;
+            (*staged) = 1;
+        }
+        else if (wc->nblocks == 1 && origin_count == wc->blocklen &&
+                 disp > wc->start_disp + blk_size) {
+            /* the second block defines the stride */
+            wc->stride = disp - wc->start_disp;
+            wc->nblocks = 2;
+            (*staged) = 1;
+        }
+        else if (wc->nblocks > 1 && origin_count == wc->blocklen &&
+                 disp == wc->start_disp + wc->nblocks * wc->stride) {
+            wc->nblocks++;
+            (*staged) = 1;
+        }
+
+        if (*staged) {
+            memcpy(wc->staging->buf + wc->used, origin_addr, data_size);
+            wc->used += data_size;
+            goto fn_exit;
+        }
+    }
+
+    /* Cannot merge, issue the staged ones and start a new buffer. */
+    mpi_errno = CSPU_put_wc_drain(ug_win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    mpi_errno = CSPU_target_get_ghost(target_rank, 0, data_size, ug_win,
+                                      &target_g_rank_in_ug, &target_g_offset);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    wc->staging = put_wc_alloc_buf(ug_win);
+    if (wc->staging == NULL)
+        goto fn_exit;   /* simply issue it without combining */
+
+    wc->target_g_rank_in_ug = target_g_rank_in_ug;
+    wc->target_g_offset = target_g_offset;
+    wc->target_rank = target_rank;
+    wc->win_ptr = win_ptr;
+    wc->datatype = origin_datatype;
+    wc->start_disp = disp;
+    wc->stride = 0;
+    wc->blocklen = origin_count;
+    wc->nblocks = 1;
+
+    memcpy(wc->staging->buf, origin_addr, data_size);
+    wc->used = data_size;
+    (*staged) = 1;
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Free all buffers at window free. */
+void CSPU_put_wc_destroy(CSPU_win_t * ug_win)
+{
+    CSPU_put_wc_buf_t *wc_buf = NULL, *tmp = NULL;
+
+    if (ug_win->put_wc.staging) {
+        free(ug_win->put_wc.staging);
+        ug_win->put_wc.staging = NULL;
+    }
+
+    LL_FOREACH_SAFE(ug_win->put_wc.issued_bufs, wc_buf, tmp) {
+        LL_DELETE(ug_win->put_wc.issued_bufs, wc_buf);
+        free(wc_buf);
+    }
+    LL_FOREACH_SAFE(ug_win->put_wc.free_bufs, wc_buf, tmp) {
+        LL_DELETE(ug_win->put_wc.free_bufs, wc_buf);
+        free(wc_buf);
+    }
+}
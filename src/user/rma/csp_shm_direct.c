@@ -0,0 +1,343 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "cspu.h"
+
+/* Direct load/store for PUT/GET to intra-node targets.
+ *
+ * The user buffers of all processes on the same node are allocated in the local
+ * shared window, thus a PUT/GET to an intra-node target can be done by memory copy
+ * instead of redirecting it to the ghost process. We only do it when the access
+ * epoch guarantees no concurrent exclusive lock on the target, i.e., fence, PSCW,
+ * lockall in no-lock mode, or lock/lockall with MPI_MODE_NOCHECK. Otherwise the
+ * lock has to be granted by the ghost before accessing the target memory.
+ *
+ * Note that this is different with the discussion of intra-node optimization in
+ * csp.h, no MPI operation is issued on the shared window. */
+
+/* Get the base address of every intra-node target in local shared window.
+ * Called once at window allocation. */
+int CSPU_win_query_shm_bases(CSPU_win_t * ug_win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int user_nprocs = 0, i;
+    int *world_ranks = NULL, *local_ug_ranks = NULL;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_size(ug_win->user_comm, &user_nprocs));
+
+    world_ranks = CSP_calloc(user_nprocs, sizeof(int));
+    local_ug_ranks = CSP_calloc(user_nprocs, sizeof(int));
+
+    for (i = 0; i < user_nprocs; i++)
+        world_ranks[i] = ug_win->targets[i].world_rank;
+
+    CSP_CALLMPI(JUMP, PMPI_Group_translate_ranks(CSP_PROC.wgroup, user_nprocs, world_ranks,
+                                                 ug_win->local_ug_group, local_ug_ranks));
+
+    for (i = 0; i < user_nprocs; i++) {
+        MPI_Aint size = 0;
+        int disp_unit = 0;
+        void *base = NULL;
+
+        ug_win->targets[i].shm_base = NULL;
+        if (local_ug_ranks[i] == MPI_UNDEFINED || ug_win->targets[i].size == 0)
+            continue;
+
+        CSP_CALLMPI(JUMP, PMPI_Win_shared_query(ug_win->local_ug_win, local_ug_ranks[i],
+                                                &size, &disp_unit, &base));
+        ug_win->targets[i].shm_base = base;
+
+        CSP_DBG_PRINT("\t targets[%d].shm_base = %p (local_ug_rank %d)\n", i, base,
+                      local_ug_ranks[i]);
+    }
+
+  fn_exit:
+    if (world_ranks)
+        free(world_ranks);
+    if (local_ug_ranks)
+        free(local_ug_ranks);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Check whether the target memory can be accessed by load/store in current epoch. */
+static inline int shm_direct_check_epoch(CSPU_win_target_t * target, CSPU_win_t * ug_win)
+{
+    switch (ug_win->epoch_stat) {
+    case CSPU_WIN_EPOCH_FENCE:
+        return 1;
+    case CSPU_WIN_EPOCH_LOCK_ALL:
+        /* No exclusive lock can be issued in no-lock mode. */
+        if (!(ug_win->info_args.epochs_used & CSP_EPOCH_LOCK))
+            return 1;
+        return (target->remote_lock_assert & MPI_MODE_NOCHECK) != 0;
+    case CSPU_WIN_EPOCH_PER_TARGET:
+        /* Start has already waited for the post of the target. */
+        if (target->epoch_stat == CSPU_TARGET_EPOCH_PSCW)
+            return 1;
+        if (target->epoch_stat == CSPU_TARGET_EPOCH_LOCK)
+            return (target->remote_lock_assert & MPI_MODE_NOCHECK) != 0;
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+/* Check whether the operation can be done by load/store. Return the target address
+ * and the size of data if yes. */
+static inline int shm_direct_check_op(int origin_count, MPI_Datatype origin_datatype,
+                                      int target_rank, MPI_Aint target_disp,
+                                      int target_count, MPI_Datatype target_datatype,
+                                      CSPU_win_t * ug_win, char **target_addr,
+                                      size_t * data_size, int *allowed)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_win_target_t *target = &(ug_win->targets[target_rank]);
+    int type_size = 0, is_contig = 0;
+
+    (*allowed) = 0;
+
+    if (target->shm_base == NULL || !shm_direct_check_epoch(target, ug_win))
+        return mpi_errno;
+
+    if (origin_datatype != target_datatype || origin_count != target_count)
+        return mpi_errno;
+
+    mpi_errno = CSPU_datatype_check_contig(origin_datatype, &type_size, &is_contig);
+    if (mpi_errno != MPI_SUCCESS || !is_contig)
+        return mpi_errno;
+
+    (*target_addr) = (char *) target->shm_base + target->disp_unit * target_disp;
+    (*data_size) = (size_t) type_size * origin_count;
+    (*allowed) = 1;
+    return mpi_errno;
+}
+
+int CSPU_shm_direct_put(const void *origin_addr, int origin_count, MPI_Datatype origin_datatype,
+                        int target_rank, MPI_Aint target_disp, int target_count,
+                        MPI_Datatype target_datatype, CSPU_win_t * ug_win, int *done)
+{
+    int mpi_errno = MPI_SUCCESS;
+    char *target_addr = NULL;
+    size_t data_size = 0;
+    int allowed = 0;
+
+    (*done) = 0;
+    mpi_errno = shm_direct_check_op(origin_count, origin_datatype, target_rank, target_disp,
+                                    target_count, target_datatype, ug_win, &target_addr,
+                                    &data_size, &allowed);
+    if (mpi_errno != MPI_SUCCESS || !allowed)
+        return mpi_errno;
+
+    memcpy(target_addr, origin_addr, data_size);
+    ug_win->is_shm_direct_issued = 1;
+    (*done) = 1;
+
+    CSP_DBG_PRINT("CASPER Put to target %d by store, addr %p, %ld bytes\n",
+                  target_rank, target_addr, (long) data_size);
+    return mpi_errno;
+}
+
+int CSPU_shm_direct_get(void *origin_addr, int origin_count, MPI_Datatype origin_datatype,
+                        int target_rank, MPI_Aint target_disp, int target_count,
+                        MPI_Datatype target_datatype, CSPU_win_t * ug_win, int *done)
+{
+    int mpi_errno = MPI_SUCCESS;
+    char *target_addr = NULL;
+    size_t data_size = 0;
+    int allowed = 0;
+
+    (*done) = 0;
+    mpi_errno = shm_direct_check_op(origin_count, origin_datatype, target_rank, target_disp,
+                                    target_count, target_datatype, ug_win, &target_addr,
+                                    &data_size, &allowed);
+    if (mpi_errno != MPI_SUCCESS || !allowed)
+        return mpi_errno;
+
+    /* Ensure stores done by other processes before the epoch are visible. */
+    OPA_read_barrier();
+    memcpy(origin_addr, target_addr, data_size);
+    ug_win->is_shm_direct_issued = 1;
+    (*done) = 1;
+
+    CSP_DBG_PRINT("CASPER Get from target %d by load, addr %p, %ld bytes\n",
+                  target_rank, target_addr, (long) data_size);
+    return mpi_errno;
+}
+
+#ifdef HAVE_GCC_ATOMIC_BUILTINS
+/* Processor atomics for FETCH_AND_OP and COMPARE_AND_SWAP to intra-node targets.
+ *
+ * It is enabled only when user sets both accumulate_ops=same_op|same_op_no_op and
+ * shm_atomics=true, and all processes of the window are on the same node (see
+ * win_allocate). The hint asserts that every concurrent atomic operation on the
+ * same location is a FETCH_AND_OP or COMPARE_AND_SWAP issued by intra-node process
+ * in an epoch allowing direct access, or that the MPI library applies atomic
+ * operations by processor atomics as well. Because the operation is not atomic
+ * with any other operation handled by ghost process.
+ *
+ * Only integer types with 1/2/4/8 bytes are supported. SUM, bitwise operations,
+ * REPLACE and NO_OP do not rely on signedness, thus we only distinguish the size. */
+
+static inline int shm_atomic_check_datatype(MPI_Datatype datatype)
+{
+    if (datatype == MPI_INT || datatype == MPI_UNSIGNED || datatype == MPI_LONG ||
+        datatype == MPI_UNSIGNED_LONG || datatype == MPI_LONG_LONG ||
+        datatype == MPI_UNSIGNED_LONG_LONG || datatype == MPI_SHORT ||
+        datatype == MPI_UNSIGNED_SHORT || datatype == MPI_SIGNED_CHAR ||
+        datatype == MPI_UNSIGNED_CHAR || datatype == MPI_INT8_T || datatype == MPI_INT16_T ||
+        datatype == MPI_INT32_T || datatype == MPI_INT64_T || datatype == MPI_UINT8_T ||
+        datatype == MPI_UINT16_T || datatype == MPI_UINT32_T || datatype == MPI_UINT64_T ||
+        datatype == MPI_AINT)
+        return 1;
+    return 0;
+}
+
+static inline int shm_atomic_check_op(MPI_Op op)
+{
+    return (op == MPI_SUM || op == MPI_BAND || op == MPI_BOR || op == MPI_BXOR ||
+            op == MPI_REPLACE || op == MPI_NO_OP);
+}
+
+#define SHM_ATOMIC_FOP(type, origin_addr, result_addr, target_addr, op) do {        \
+    type *ptr_ = (type *) (target_addr);                                             \
+    type val_ = *(const type *) (origin_addr), res_ = 0;                             \
+    if (op == MPI_SUM)                                                               \
+        res_ = __atomic_fetch_add(ptr_, val_, __ATOMIC_SEQ_CST);                     \
+    else if (op == MPI_BAND)                                                         \
+        res_ = __atomic_fetch_and(ptr_, val_, __ATOMIC_SEQ_CST);                     \
+    else if (op == MPI_BOR)                                                          \
+        res_ = __atomic_fetch_or(ptr_, val_, __ATOMIC_SEQ_CST);                      \
+    else if (op == MPI_BXOR)                                                         \
+        res_ = __atomic_fetch_xor(ptr_, val_, __ATOMIC_SEQ_CST);                     \
+    else if (op == MPI_REPLACE)                                                      \
+        res_ = __atomic_exchange_n(ptr_, val_, __ATOMIC_SEQ_CST);                    \
+    else /* MPI_NO_OP */                                                             \
+        res_ = __atomic_load_n(ptr_, __ATOMIC_SEQ_CST);                              \
+    *(type *) (result_addr) = res_;                                                  \
+} while (0)
+
+#define SHM_ATOMIC_CAS(type, origin_addr, compare_addr, result_addr, target_addr) do { \
+    type exp_ = *(const type *) (compare_addr);                                         \
+    __atomic_compare_exchange_n((type *) (target_addr), &exp_,                          \
+                                *(const type *) (origin_addr), 0,                       \
+                                __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);                    \
+    *(type *) (result_addr) = exp_;  /* old value on both success and failure */        \
+} while (0)
+
+/* Check whether the atomic operation can be done by processor atomics.
+ * Return the target address and the size of data if yes. */
+static inline int shm_atomic_check_op_target(MPI_Datatype datatype, int target_rank,
+                                             MPI_Aint target_disp, CSPU_win_t * ug_win,
+                                             char **target_addr, int *type_size, int *allowed)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_win_target_t *target = &(ug_win->targets[target_rank]);
+
+    (*allowed) = 0;
+
+    if (!ug_win->info_args.shm_atomics || target->shm_base == NULL ||
+        !shm_direct_check_epoch(target, ug_win) || !shm_atomic_check_datatype(datatype))
+        return mpi_errno;
+
+    CSP_CALLMPI(RETURN, PMPI_Type_size(datatype, type_size));
+    (*target_addr) = (char *) target->shm_base + target->disp_unit * target_disp;
+
+    /* Processor atomics require natural alignment. */
+    if (((uintptr_t) (*target_addr)) % (*type_size) != 0)
+        return mpi_errno;
+
+    (*allowed) = 1;
+    return mpi_errno;
+}
+
+int CSPU_shm_direct_fop(const void *origin_addr, void *result_addr, MPI_Datatype datatype,
+                        int target_rank, MPI_Aint target_disp, MPI_Op op,
+                        CSPU_win_t * ug_win, int *done)
+{
+    int mpi_errno = MPI_SUCCESS;
+    char *target_addr = NULL;
+    int type_size = 0, allowed = 0;
+
+    (*done) = 0;
+    if (!shm_atomic_check_op(op))
+        return mpi_errno;
+
+    mpi_errno = shm_atomic_check_op_target(datatype, target_rank, target_disp, ug_win,
+                                           &target_addr, &type_size, &allowed);
+    if (mpi_errno != MPI_SUCCESS || !allowed)
+        return mpi_errno;
+
+    switch (type_size) {
+    case 1:
+        SHM_ATOMIC_FOP(uint8_t, origin_addr, result_addr, target_addr, op);
+        break;
+    case 2:
+        SHM_ATOMIC_FOP(uint16_t, origin_addr, result_addr, target_addr, op);
+        break;
+    case 4:
+        SHM_ATOMIC_FOP(uint32_t, origin_addr, result_addr, target_addr, op);
+        break;
+    case 8:
+        SHM_ATOMIC_FOP(uint64_t, origin_addr, result_addr, target_addr, op);
+        break;
+    default:
+        return mpi_errno;
+    }
+
+    ug_win->is_shm_direct_issued = 1;
+    (*done) = 1;
+
+    CSP_DBG_PRINT("CASPER Fetch_and_op to target %d by processor atomics, addr %p\n",
+                  target_rank, target_addr);
+    return mpi_errno;
+}
+
+int CSPU_shm_direct_cas(const void *origin_addr, const void *compare_addr, void *result_addr,
+                        MPI_Datatype datatype, int target_rank, MPI_Aint target_disp,
+                        CSPU_win_t * ug_win, int *done)
+{
+    int mpi_errno = MPI_SUCCESS;
+    char *target_addr = NULL;
+    int type_size = 0, allowed = 0;
+
+    (*done) = 0;
+    mpi_errno = shm_atomic_check_op_target(datatype, target_rank, target_disp, ug_win,
+                                           &target_addr, &type_size, &allowed);
+    if (mpi_errno != MPI_SUCCESS || !allowed)
+        return mpi_errno;
+
+    switch (type_size) {
+    case 1:
+        SHM_ATOMIC_CAS(uint8_t, origin_addr, compare_addr, result_addr, target_addr);
+        break;
+    case 2:
+        SHM_ATOMIC_CAS(uint16_t, origin_addr, compare_addr, result_addr, target_addr);
+        break;
+    case 4:
+        SHM_ATOMIC_CAS(uint32_t, origin_addr, compare_addr, result_addr, target_addr);
+        break;
+    case 8:
+        SHM_ATOMIC_CAS(uint64_t, origin_addr, compare_addr, result_addr, target_addr);
+        break;
+    default:
+        return mpi_errno;
+    }
+
+    ug_win->is_shm_direct_issued = 1;
+    (*done) = 1;
+
+    CSP_DBG_PRINT("CASPER Compare_and_swap to target %d by processor atomics, addr %p\n",
+                  target_rank, target_addr);
+    return mpi_errno;
+}
+#endif /* HAVE_GCC_ATOMIC_BUILTINS */
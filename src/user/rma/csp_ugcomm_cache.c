@@ -0,0 +1,219 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cspu.h"
+
+/* Cache of internal communicators for window allocation.
+ *
+ * Every window allocated on a non-world user communicator needs a set of
+ * internal communicators (local_user_comm, user_root_comm, ug_comm and
+ * local_ug_comm) and the translated ghost ranks. Creating them requires several
+ * collective calls including comm_create_group on COMM_WORLD together with the
+ * ghosts, which dominates the cost of window allocation. Applications often
+ * allocate many windows on the same communicator (e.g., Global Arrays), thus
+ * we share them between all the windows allocated on the same group of user
+ * processes. Ghosts keep the same cache indexed by (user_local_root, id).
+ *
+ * The entry is found by the world ranks of user processes, and the id is agreed
+ * on all user processes in order to ensure every process (and every ghost) makes
+ * the same decision. Communicators are freed when the last window is freed.
+ *
+ * The cache is disabled in thread-safe mode, because windows allocated on
+ * different communicators by concurrent threads could mismatch collective calls
+ * on the shared communicators. */
+
+static CSPU_ugcomm_t *ugcomm_list = NULL;
+static int ugcomm_next_id = 1;
+
+static CSPU_ugcomm_t *ugcomm_find(int user_nprocs, int *user_wranks)
+{
+    CSPU_ugcomm_t *ugcomm = NULL;
+
+    LL_FOREACH(ugcomm_list, ugcomm) {
+        if (ugcomm->is_complete && ugcomm->user_nprocs == user_nprocs &&
+            !memcmp(ugcomm->user_wranks, user_wranks, sizeof(int) * user_nprocs))
+            break;
+    }
+    return ugcomm;
+}
+
+static int ugcomm_free(CSPU_ugcomm_t * ugcomm)
+{
+    int mpi_errno = MPI_SUCCESS;
+
+    if (ugcomm->is_complete) {
+        CSP_CALLMPI(JUMP, PMPI_Comm_free(&ugcomm->local_ug_comm));
+        CSP_CALLMPI(JUMP, PMPI_Comm_free(&ugcomm->ug_comm));
+        CSP_CALLMPI(JUMP, PMPI_Comm_free(&ugcomm->local_user_comm));
+        CSP_CALLMPI(JUMP, PMPI_Comm_free(&ugcomm->user_root_comm));
+        CSP_CALLMPI(JUMP, PMPI_Group_free(&ugcomm->local_ug_group));
+        CSP_CALLMPI(JUMP, PMPI_Group_free(&ugcomm->ug_group));
+    }
+
+  fn_exit:
+    LL_DELETE(ugcomm_list, ugcomm);
+    if (ugcomm->user_wranks)
+        free(ugcomm->user_wranks);
+    if (ugcomm->g_ranks_in_ug)
+        free(ugcomm->g_ranks_in_ug);
+    if (ugcomm->target_g_ranks_in_ug)
+        free(ugcomm->target_g_ranks_in_ug);
+    free(ugcomm);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Get the cached communicators for a user communicator (collective call).
+ * If not cached, a new empty entry is returned and *cached is set to 0, the
+ * caller should store the communicators into it once they are created. */
+int CSPU_ugcomm_cache_get(MPI_Comm user_comm, CSPU_ugcomm_t ** ugcomm_ptr, int *cached)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_ugcomm_t *ugcomm = NULL;
+    MPI_Group user_group = MPI_GROUP_NULL;
+    int *user_ranks = NULL, *user_wranks = NULL;
+    int user_nprocs, i;
+    int local_ids[3], ids[3];
+
+    (*ugcomm_ptr) = NULL;
+    (*cached) = 0;
+
+#if defined(CSP_ENABLE_THREAD_SAFE)
+    goto fn_exit;
+#endif
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_size(user_comm, &user_nprocs));
+    CSP_CALLMPI(JUMP, PMPI_Comm_group(user_comm, &user_group));
+
+    user_ranks = CSP_calloc(user_nprocs, sizeof(int));
+    user_wranks = CSP_calloc(user_nprocs, sizeof(int));
+    for (i = 0; i < user_nprocs; i++)
+        user_ranks[i] = i;
+    CSP_CALLMPI(JUMP, PMPI_Group_translate_ranks(user_group, user_nprocs, user_ranks,
+                                                 CSP_PROC.wgroup, user_wranks));
+
+    /* Agree on the entry id, thus all processes either reuse the same entry,
+     * or create a new one with the same id.
+     * [0]: max of local id, [1]: max of -(local id), [2]: next available id.*/
+    ugcomm = ugcomm_find(user_nprocs, user_wranks);
+    local_ids[0] = ugcomm ? ugcomm->id : 0;
+    local_ids[1] = -local_ids[0];
+    local_ids[2] = ugcomm_next_id;
+    CSP_CALLMPI(JUMP, PMPI_Allreduce(local_ids, ids, 3, MPI_INT, MPI_MAX, user_comm));
+
+    if (ids[0] > 0 && ids[0] == -ids[1]) {
+        ugcomm->ref_count++;
+        (*cached) = 1;
+        CSP_DBG_PRINT("ugcomm cache: reuse entry %d, ref_count %d\n", ugcomm->id,
+                      ugcomm->ref_count);
+    }
+    else {
+        ugcomm = CSP_calloc(1, sizeof(CSPU_ugcomm_t));
+        ugcomm->id = ids[2];
+        ugcomm->ref_count = 1;
+        ugcomm->user_nprocs = user_nprocs;
+        ugcomm->user_wranks = user_wranks;
+        user_wranks = NULL;
+        LL_PREPEND(ugcomm_list, ugcomm);
+        ugcomm_next_id = ids[2] + 1;
+        CSP_DBG_PRINT("ugcomm cache: new entry %d\n", ugcomm->id);
+    }
+    (*ugcomm_ptr) = ugcomm;
+
+  fn_exit:
+    if (user_group != MPI_GROUP_NULL)
+        PMPI_Group_free(&user_group);
+    if (user_ranks)
+        free(user_ranks);
+    if (user_wranks)
+        free(user_wranks);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Load the cached ug communicators and ghost ranks into the window. The user
+ * level communicators are loaded at the beginning of win_allocate. */
+void CSPU_ugcomm_cache_load(CSPU_win_t * ug_win)
+{
+    CSPU_ugcomm_t *ugcomm = ug_win->ugcomm;
+    int i;
+
+    ug_win->ug_comm = ugcomm->ug_comm;
+    ug_win->ug_group = ugcomm->ug_group;
+    ug_win->local_ug_comm = ugcomm->local_ug_comm;
+    ug_win->local_ug_group = ugcomm->local_ug_group;
+    ug_win->num_g_ranks_in_ug = ugcomm->num_g_ranks_in_ug;
+
+    memcpy(ug_win->g_ranks_in_ug, ugcomm->g_ranks_in_ug,
+           sizeof(int) * ugcomm->num_g_ranks_in_ug);
+    for (i = 0; i < ugcomm->user_nprocs; i++)
+        memcpy(ug_win->targets[i].g_ranks_in_ug,
+               &ugcomm->target_g_ranks_in_ug[i * CSP_ENV.num_g], sizeof(int) * CSP_ENV.num_g);
+}
+
+/* Store the newly created communicators and ghost ranks of the window. */
+void CSPU_ugcomm_cache_store(CSPU_win_t * ug_win)
+{
+    CSPU_ugcomm_t *ugcomm = ug_win->ugcomm;
+    int i;
+
+    ugcomm->local_user_comm = ug_win->local_user_comm;
+    ugcomm->user_root_comm = ug_win->user_root_comm;
+    ugcomm->node_id = ug_win->node_id;
+    ugcomm->num_nodes = ug_win->num_nodes;
+    ugcomm->ug_comm = ug_win->ug_comm;
+    ugcomm->ug_group = ug_win->ug_group;
+    ugcomm->local_ug_comm = ug_win->local_ug_comm;
+    ugcomm->local_ug_group = ug_win->local_ug_group;
+    ugcomm->num_g_ranks_in_ug = ug_win->num_g_ranks_in_ug;
+
+    ugcomm->g_ranks_in_ug = CSP_calloc(ugcomm->num_g_ranks_in_ug, sizeof(int));
+    memcpy(ugcomm->g_ranks_in_ug, ug_win->g_ranks_in_ug, sizeof(int) * ugcomm->num_g_ranks_in_ug);
+    ugcomm->target_g_ranks_in_ug = CSP_calloc(ugcomm->user_nprocs * CSP_ENV.num_g, sizeof(int));
+    for (i = 0; i < ugcomm->user_nprocs; i++)
+        memcpy(&ugcomm->target_g_ranks_in_ug[i * CSP_ENV.num_g],
+               ug_win->targets[i].g_ranks_in_ug, sizeof(int) * CSP_ENV.num_g);
+
+    ugcomm->is_complete = 1;
+}
+
+/* Release the cached communicators used by the window, and free them if it
+ * is the last window. The communicators are detached from the window, thus
+ * will not be freed again in window release. */
+int CSPU_ugcomm_cache_release(CSPU_win_t * ug_win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_ugcomm_t *ugcomm = ug_win->ugcomm;
+
+    if (ugcomm == NULL)
+        return mpi_errno;
+
+    /* Incomplete entry (failure in win_allocate), the window still owns
+     * the communicators. */
+    if (ugcomm->is_complete) {
+        ug_win->local_user_comm = MPI_COMM_NULL;
+        ug_win->user_root_comm = MPI_COMM_NULL;
+        ug_win->ug_comm = MPI_COMM_NULL;
+        ug_win->ug_group = MPI_GROUP_NULL;
+        ug_win->local_ug_comm = MPI_COMM_NULL;
+        ug_win->local_ug_group = MPI_GROUP_NULL;
+    }
+    ug_win->ugcomm = NULL;
+
+    ugcomm->ref_count--;
+    if (ugcomm->ref_count == 0 || !ugcomm->is_complete) {
+        CSP_DBG_PRINT("ugcomm cache: free entry %d\n", ugcomm->id);
+        mpi_errno = ugcomm_free(ugcomm);
+    }
+    return mpi_errno;
+}
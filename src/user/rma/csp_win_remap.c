@@ -0,0 +1,368 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "cspu.h"
+
+/* Asynchronous progress on windows created by MPI_Win_create.
+ *
+ * The memory passed to MPI_Win_create is private to the user process, thus
+ * ghosts cannot access it and operations cannot be redirected. When
+ * CSP_WIN_CREATE_REMAP is on, the pages holding the user buffer are remapped
+ * once at window creation to a memory file (memfd) at the same address, after
+ * copying their content, hence the user keeps using the same buffer. Local
+ * ghosts open the file through /proc/<pid>/fd/<fd>, map it into their address
+ * space and attach it to internal dynamic windows. Operations are redirected
+ * by using the address of the user buffer on ghosts as base_g_offsets.
+ *
+ * Opening the file of another process requires the same ptrace permission as
+ * cross memory attach (process_vm_readv), which is probed at initialization.
+ * If any ghost is denied (e.g., restricted ptrace_scope), or the remap fails
+ * on any user process, the window is created by the original MPI call without
+ * asynchronous progress.
+ *
+ * Because the pages are copied before being replaced, any write to them in
+ * between would be lost. Thus only a buffer exclusively owning its pages is
+ * remapped, i.e., page-aligned start and size in an anonymous mapping which is
+ * not the stack of the calling thread (see win_remap_check_pages). Buffers on
+ * the stack of other threads cannot be detected and must not be used.
+ *
+ * At window free, the pages are replaced by private anonymous pages holding
+ * the same content, thus the buffer is plain private memory again and the
+ * memory file is released. */
+
+int CSPU_win_remap_enabled = 0;
+
+static struct {
+#if defined(CSP_ENABLE_THREAD_SAFE)
+    CSP_thread_cs_t cs;
+#endif
+    CSPU_win_remap_t *list;     /* remapped buffers of all active windows. */
+} remaps;
+
+/* Probe whether every ghost can open the memory file of local users
+ * (collective call with local ghosts). */
+int CSPU_win_remap_init(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int local_nprocs = 0, user_world_rank = 0, fd = -1, is_ok = 1, is_all_ok = 0;
+    MPI_Aint probe[2];
+    MPI_Aint *probes = NULL;
+
+    if (!CSP_ENV.win_create_remap)
+        goto fn_exit;
+
+#ifdef HAVE_MEMFD_CREATE
+    fd = memfd_create("casper-probe", MFD_CLOEXEC);
+#endif
+    if (fd < 0)
+        is_ok = 0;
+
+    /* Ghosts open /proc/<pid>/fd/<fd> of every local user. */
+    CSP_CALLMPI(JUMP, PMPI_Comm_size(CSP_PROC.local_comm, &local_nprocs));
+    probes = CSP_calloc(local_nprocs * 2, sizeof(MPI_Aint));
+    probe[0] = (MPI_Aint) getpid();
+    probe[1] = (MPI_Aint) fd;
+    CSP_CALLMPI(JUMP, PMPI_Allgather(probe, 2, MPI_AINT, probes, 2, MPI_AINT,
+                                     CSP_PROC.local_comm));
+
+    CSP_CALLMPI(JUMP, PMPI_Allreduce(&is_ok, &is_all_ok, 1, MPI_INT, MPI_MIN, CSP_PROC.wcomm));
+    CSPU_win_remap_enabled = is_all_ok;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_COMM_USER_WORLD, &user_world_rank));
+    if (CSPU_win_remap_enabled) {
+        CSPU_THREAD_INIT_OBJ_CS(&remaps);
+    }
+    else if (user_world_rank == 0) {
+        CSP_msg_print(CSP_MSG_WARN, "CSP_WIN_CREATE_REMAP is disabled, memory file is not "
+                      "supported or ghosts cannot access local processes\n");
+    }
+
+  fn_exit:
+    if (fd >= 0)
+        close(fd);
+    if (probes)
+        free(probes);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+int CSPU_win_remap_destroy(void)
+{
+    int mpi_errno = MPI_SUCCESS;
+
+    if (CSPU_win_remap_enabled) {
+        CSPU_THREAD_DESTROY_OBJ_CS(&remaps);
+    }
+    CSPU_win_remap_enabled = 0;
+    return mpi_errno;
+
+#if defined(CSP_ENABLE_THREAD_SAFE)
+  fn_fail:
+    /* Only destroying the critical section can fail. */
+    return mpi_errno;
+#endif
+}
+
+/* Check whether the pages [map_base, map_base + map_size) belong to a single
+ * anonymous mapping (heap or anonymous mmap) which does not hold the stack of
+ * the calling thread. Return 1 if they can be remapped, otherwise 0. */
+static int win_remap_check_pages(void *map_base, MPI_Aint map_size)
+{
+    FILE *maps = NULL;
+    char line[512];
+    unsigned long start = 0, end = 0, addr = (unsigned long) map_base;
+    int stack_var = 0, path_off, is_ok = 0;
+    unsigned long stack_addr = (unsigned long) &stack_var;
+    char *path = NULL;
+
+    maps = fopen("/proc/self/maps", "r");
+    if (maps == NULL)
+        return 0;
+
+    while (fgets(line, sizeof(line), maps)) {
+        path_off = 0;
+        if (sscanf(line, "%lx-%lx %*s %*s %*s %*s %n", &start, &end, &path_off) < 2 ||
+            path_off == 0)
+            continue;
+        if (addr < start || addr >= end)
+            continue;
+
+        path = line + path_off;
+        path[strcspn(path, "\n")] = '\0';
+
+        /* Must be anonymous memory not shared with a file or the stack. */
+        is_ok = (addr + map_size <= end) && (path[0] == '\0' || !strcmp(path, "[heap]")) &&
+            (stack_addr < start || stack_addr >= end);
+        break;
+    }
+    fclose(maps);
+
+    return is_ok;
+}
+
+/* Remap the pages holding the user buffer to a memory file (local call).
+ * Set *remap_ptr to NULL if it cannot be remapped. */
+int CSPU_win_remap(void *base, MPI_Aint size, CSPU_win_remap_t ** remap_ptr)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_win_remap_t *remap = NULL, *r = NULL;
+    MPI_Aint page_size = (MPI_Aint) sysconf(_SC_PAGESIZE), map_size = 0;
+    void *tmp_map = MAP_FAILED;
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    (*remap_ptr) = NULL;
+
+    remap = CSP_calloc(1, sizeof(CSPU_win_remap_t));
+    remap->base = base;
+    remap->size = size;
+    remap->fd = -1;
+    remap->g_addrs = CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Aint));
+
+    /* Nothing to share, ghosts only expose their own segment. */
+    if (size == 0 || base == NULL) {
+        (*remap_ptr) = remap;
+        return mpi_errno;
+    }
+
+    /* Other data sharing the pages of the buffer may be written between
+     * the copy and the remap, thus the buffer must own the whole pages. */
+    if (((MPI_Aint) base & (page_size - 1)) || (size & (page_size - 1)) ||
+        !win_remap_check_pages(base, size)) {
+        CSP_DBG_PRINT("remap: buffer %p size %ld does not own its pages\n", base, size);
+        free(remap->g_addrs);
+        free(remap);
+        return mpi_errno;
+    }
+
+    remap->map_base = base;
+    remap->map_size = size;
+    map_size = remap->map_size;
+
+    CSPU_THREAD_ENTER_OBJ_CS(&remaps);
+
+    /* The pages of another active window cannot be remapped again, otherwise
+     * ghosts keep accessing the old file. */
+    LL_FOREACH(remaps.list, r) {
+        if ((char *) remap->map_base < (char *) r->map_base + r->map_size &&
+            (char *) r->map_base < (char *) remap->map_base + remap->map_size) {
+            CSP_DBG_PRINT("remap: %p overlaps window buffer %p\n", base, r->base);
+            goto fn_fail;
+        }
+    }
+
+#ifdef HAVE_MEMFD_CREATE
+    remap->fd = memfd_create("casper-win", MFD_CLOEXEC);
+#endif
+    if (remap->fd < 0 || ftruncate(remap->fd, remap->map_size) != 0)
+        goto fn_fail;
+
+    /* Copy current content through a temporary mapping, then replace the
+     * original pages at the same address. */
+    tmp_map = mmap(NULL, remap->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, remap->fd, 0);
+    if (tmp_map == MAP_FAILED)
+        goto fn_fail;
+    memcpy(tmp_map, remap->map_base, remap->map_size);
+
+    if (mmap(remap->map_base, remap->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+             remap->fd, 0) == MAP_FAILED)
+        goto fn_fail;
+
+    LL_PREPEND(remaps.list, remap);
+    (*remap_ptr) = remap;
+    CSP_DBG_PRINT("remap: buffer %p size %ld, pages %p size %ld, fd %d\n", base, size,
+                  remap->map_base, remap->map_size, remap->fd);
+
+  fn_exit:
+    CSPU_THREAD_EXIT_OBJ_CS(&remaps);
+    if (tmp_map != MAP_FAILED)
+        munmap(tmp_map, map_size);
+    return mpi_errno;
+
+  fn_fail:
+    /* Not an error, the window is created without asynchronous progress. */
+    CSP_DBG_PRINT("remap: failed to remap buffer %p size %ld\n", base, size);
+    if (remap->fd >= 0)
+        close(remap->fd);
+    free(remap->g_addrs);
+    free(remap);
+    remap = NULL;
+    goto fn_exit;
+}
+
+/* Copy the remapped pages into new private anonymous pages and move them to
+ * the same address, thus the user buffer is no longer backed by the memory
+ * file. The shared pages are kept if it fails, their content is still valid. */
+static void win_remap_restore_private(CSPU_win_remap_t * remap)
+{
+    void *tmp_map = MAP_FAILED;
+
+    tmp_map = mmap(NULL, remap->map_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (tmp_map == MAP_FAILED)
+        goto fn_fail;
+    memcpy(tmp_map, remap->map_base, remap->map_size);
+
+    /* Atomically replace the shared pages, no copy back is needed. */
+    if (mremap(tmp_map, remap->map_size, remap->map_size, MREMAP_MAYMOVE | MREMAP_FIXED,
+               remap->map_base) == MAP_FAILED)
+        goto fn_fail;
+
+    CSP_DBG_PRINT("remap: restored private pages %p size %ld\n", remap->map_base,
+                  remap->map_size);
+    return;
+
+  fn_fail:
+    CSP_DBG_PRINT("remap: failed to restore private pages %p size %ld\n", remap->map_base,
+                  remap->map_size);
+    if (tmp_map != MAP_FAILED)
+        munmap(tmp_map, remap->map_size);
+}
+
+/* Release the remapped buffer at window free (local call). Ghosts must have
+ * freed the window, thus no one else accesses the pages. */
+void CSPU_win_remap_release(CSPU_win_remap_t * remap)
+{
+    CSPU_THREAD_OBJ_CS_LOCAL_DCL();
+
+    if (remap->map_size > 0) {
+        CSPU_THREAD_ENTER_OBJ_CS(&remaps);
+        LL_DELETE(remaps.list, remap);
+        CSPU_THREAD_EXIT_OBJ_CS(&remaps);
+
+        win_remap_restore_private(remap);
+    }
+
+    if (remap->fd >= 0)
+        close(remap->fd);
+    if (remap->g_addrs)
+        free(remap->g_addrs);
+    free(remap);
+}
+
+/* Let local ghosts map my buffer and receive its address on every ghost
+ * (collective call on local_ug_comm). */
+int CSPU_win_remap_exchange(CSPU_win_t * ug_win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_win_remap_t *remap = ug_win->remap;
+    int local_ug_nprocs = 0, user_rank = 0, i;
+    MPI_Aint map_info[4];
+    MPI_Aint *map_infos = NULL, *zeros = NULL, *g_addrs = NULL;
+    int *g_ranks_in_local_ug = NULL;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_size(ug_win->local_ug_comm, &local_ug_nprocs));
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_win->user_comm, &user_rank));
+
+    /* [0]: pid, [1]: fd, [2]: size of mapped pages, [3]: offset of the buffer. */
+    map_info[0] = (MPI_Aint) getpid();
+    map_info[1] = (MPI_Aint) remap->fd;
+    map_info[2] = remap->map_size;
+    map_info[3] = (char *) remap->base - (char *) remap->map_base;
+
+    map_infos = CSP_calloc(local_ug_nprocs * 4, sizeof(MPI_Aint));
+    CSP_CALLMPI(JUMP, PMPI_Allgather(map_info, 4, MPI_AINT, map_infos, 4, MPI_AINT,
+                                     ug_win->local_ug_comm));
+
+    /* Every ghost sends back the address of my buffer in its address space. */
+    zeros = CSP_calloc(local_ug_nprocs, sizeof(MPI_Aint));
+    g_addrs = CSP_calloc(local_ug_nprocs, sizeof(MPI_Aint));
+    CSP_CALLMPI(JUMP, PMPI_Alltoall(zeros, 1, MPI_AINT, g_addrs, 1, MPI_AINT,
+                                    ug_win->local_ug_comm));
+
+    g_ranks_in_local_ug = CSP_calloc(CSP_ENV.num_g, sizeof(int));
+    CSP_CALLMPI(JUMP, PMPI_Group_translate_ranks(ug_win->ug_group, CSP_ENV.num_g,
+                                                 ug_win->targets[user_rank].g_ranks_in_ug,
+                                                 ug_win->local_ug_group, g_ranks_in_local_ug));
+    for (i = 0; i < CSP_ENV.num_g; i++) {
+        remap->g_addrs[i] = g_addrs[g_ranks_in_local_ug[i]];
+        CSP_DBG_PRINT("remap: buffer %p on ghost %d is 0x%lx\n", remap->base, i,
+                      remap->g_addrs[i]);
+    }
+
+    /* Ghosts hold their own mapping now. */
+    if (remap->fd >= 0)
+        close(remap->fd);
+    remap->fd = -1;
+
+  fn_exit:
+    if (map_infos)
+        free(map_infos);
+    if (zeros)
+        free(zeros);
+    if (g_addrs)
+        free(g_addrs);
+    if (g_ranks_in_local_ug)
+        free(g_ranks_in_local_ug);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Attach my buffer to an internal dynamic window. */
+int CSPU_win_remap_attach(CSPU_win_remap_t * remap, MPI_Win win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    if (remap->size > 0)
+        CSP_CALLMPI(NOSTMT, PMPI_Win_attach(win, remap->base, remap->size));
+    return mpi_errno;
+}
+
+int CSPU_win_remap_detach(CSPU_win_remap_t * remap, MPI_Win win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    if (remap->size > 0)
+        CSP_CALLMPI(NOSTMT, PMPI_Win_detach(win, remap->base));
+    return mpi_errno;
+}
@@ -35,6 +35,18 @@ static int fetch_and_op_impl(const void *origin_addr, void *result_addr,
 
     /* Should not do local RMA in accumulate because of atomicity issue */
 
+#ifdef HAVE_GCC_ATOMIC_BUILTINS
+    /* Unless user allows processor atomics on intra-node target. */
+    if (target->shm_base != NULL && ug_win->info_args.shm_atomics) {
+        int done = 0;
+        mpi_errno = CSPU_shm_direct_fop(origin_addr, result_addr, datatype, target_rank,
+                                        target_disp, op, ug_win, &done);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        if (done)
+            goto fn_exit;
+    }
+#endif
+
     /* Redirect operation to ghost process.
      * (See discussion of optimization for intra-node operations in csp.h.) */
 
@@ -45,8 +57,9 @@ static int fetch_and_op_impl(const void *origin_addr, void *result_addr,
         CSP_CALLMPI(JUMP, PMPI_Type_size(datatype, &data_size));
     }
 #endif
-    mpi_errno = CSPU_target_get_ghost(target_rank, 1, data_size, ug_win,
-                                      &target_g_rank_in_ug, &target_g_offset);
+    mpi_errno = CSPU_target_get_acc_ghost(target_rank, target->disp_unit * target_disp,
+                                          data_size, ug_win, &target_g_rank_in_ug,
+                                          &target_g_offset);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     ug_target_disp = target_g_offset + target->disp_unit * target_disp;
@@ -0,0 +1,21 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+int MPI_Free_mem(void *base)
+{
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(RMA))
+        return PMPI_Free_mem(base);
+
+    if (CSPU_dyn_pool_contains(base, 0))
+        return CSPU_dyn_pool_free(base);
+
+    return PMPI_Free_mem(base);
+}
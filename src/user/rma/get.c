@@ -56,6 +56,17 @@ static int get_impl(void *origin_addr, int origin_count,
     CSPU_TARGET_CHECK_OP_EPOCH(target, ug_win);
     CSPU_TARGET_CHECK_OP_DISP(target_disp, target);
 
+    /* Access intra-node target by load if the epoch allows it. */
+    if (target->shm_base != NULL && ug_win->info_args.shm_direct) {
+        int done = 0;
+        mpi_errno = CSPU_shm_direct_get(origin_addr, origin_count, origin_datatype,
+                                        target_rank, target_disp, target_count,
+                                        target_datatype, ug_win, &done);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        if (done)
+            goto fn_exit;
+    }
+
 #ifdef CSP_ENABLE_LOCAL_RMA_OP_OPT
     if (target_rank == rank && ug_win->is_self_locked) {
         mpi_errno = get_shared_impl(origin_addr, origin_count,
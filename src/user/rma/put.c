@@ -56,6 +56,17 @@ static int put_impl(const void *origin_addr, int origin_count,
     CSPU_TARGET_CHECK_OP_EPOCH(target, ug_win);
     CSPU_TARGET_CHECK_OP_DISP(target_disp, target);
 
+    /* Access intra-node target by store if the epoch allows it. */
+    if (target->shm_base != NULL && ug_win->info_args.shm_direct) {
+        int done = 0;
+        mpi_errno = CSPU_shm_direct_put(origin_addr, origin_count, origin_datatype,
+                                        target_rank, target_disp, target_count,
+                                        target_datatype, ug_win, &done);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        if (done)
+            goto fn_exit;
+    }
+
 #ifdef CSP_ENABLE_LOCAL_RMA_OP_OPT
     if (target_rank == rank && ug_win->is_self_locked) {
         mpi_errno = put_shared_impl(origin_addr, origin_count,
@@ -73,6 +84,17 @@ static int put_impl(const void *origin_addr, int origin_count,
         MPI_Aint target_g_offset = 0;
         MPI_Win *win_ptr = NULL;
 
+        /* Stage small PUT for write-combining if user enabled it on this window. */
+        if (ug_win->info_args.put_combine_size > 0) {
+            int staged = 0;
+            mpi_errno = CSPU_put_wc_stage(origin_addr, origin_count, origin_datatype,
+                                          target_rank, target_disp, target_count,
+                                          target_datatype, ug_win, &staged);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+            if (staged)
+                goto fn_exit;
+        }
+
         CSPU_TARGET_GET_EPOCH_WIN(target, ug_win, win_ptr);
 
 #if defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
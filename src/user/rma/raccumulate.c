@@ -73,8 +73,9 @@ static int raccumulate_impl(const void *origin_addr, int origin_count,
         data_size *= origin_count;
     }
 #endif
-    mpi_errno = CSPU_target_get_ghost(target_rank, 1, data_size, ug_win,
-                                      &target_g_rank_in_ug, &target_g_offset);
+    mpi_errno = CSPU_target_get_acc_ghost(target_rank, target->disp_unit * target_disp,
+                                          data_size, ug_win, &target_g_rank_in_ug,
+                                          &target_g_offset);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     ug_target_disp = target_g_offset + target->disp_unit * target_disp;
@@ -38,6 +38,9 @@ static int read_win_info(MPI_Info info, CSPU_win_t * ug_win)
     ug_win->info_args.epochs_used = CSP_EPOCH_LOCK_ALL | CSP_EPOCH_LOCK |
         CSP_EPOCH_PSCW | CSP_EPOCH_FENCE;
     ug_win->info_args.async_config = CSP_ENV.async_config;      /* default */
+    ug_win->info_args.put_combine_size = 0;     /* disabled by default */
+    ug_win->info_args.shm_direct = 1;   /* enabled by default */
+    ug_win->info_args.shm_atomics = 0;  /* disabled by default */
 
     if (info != MPI_INFO_NULL) {
         int info_flag = 0;
@@ -109,10 +112,48 @@ static int read_win_info(MPI_Info info, CSPU_win_t * ug_win)
         if (info_flag == 1) {
             strncpy(ug_win->info_args.win_name, info_value, MPI_MAX_OBJECT_NAME);
         }
+
+        /* Check if user wants to combine small PUTs (maximum size in bytes). */
+        memset(info_value, 0, sizeof(info_value));
+        CSP_CALLMPI(JUMP, PMPI_Info_get(info, "put_combine_size", MPI_MAX_INFO_VAL,
+                                        info_value, &info_flag));
+
+        if (info_flag == 1) {
+            int put_combine_size = atoi(info_value);
+            if (put_combine_size > 0)
+                ug_win->info_args.put_combine_size = (size_t) put_combine_size;
+        }
+
+        /* Check if user wants to disable load/store for intra-node PUT/GET. */
+        mpi_errno = CSPU_info_get_bool(info, "shm_direct", "true", "false",
+                                       &ug_win->info_args.shm_direct);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+#ifdef HAVE_GCC_ATOMIC_BUILTINS
+        /* Check if user allows processor atomics for intra-node FOP/CAS. It is
+         * valid only when every accumulate-like operation on a location uses
+         * the same op (see csp_shm_direct.c). */
+        mpi_errno = CSPU_info_get_bool(info, "shm_atomics", "true", "false",
+                                       &ug_win->info_args.shm_atomics);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+        if (ug_win->info_args.shm_atomics) {
+            memset(info_value, 0, sizeof(info_value));
+            CSP_CALLMPI(JUMP, PMPI_Info_get(info, "accumulate_ops", MPI_MAX_INFO_VAL,
+                                            info_value, &info_flag));
+
+            /* same_op is a prefix of same_op_no_op. */
+            if (info_flag == 0 || strncmp(info_value, "same_op", strlen("same_op")))
+                ug_win->info_args.shm_atomics = 0;
+        }
+#endif
     }
 
-    CSP_DBG_PRINT("no_local_load_store %d, epochs_used=%s|%s|%s|%s\n",
+    CSP_DBG_PRINT("no_local_load_store %d, put_combine_size %ld, shm_direct %d, "
+                  "shm_atomics %d, epochs_used=%s|%s|%s|%s\n",
                   ug_win->info_args.no_local_load_store,
+                  (long) ug_win->info_args.put_combine_size, ug_win->info_args.shm_direct,
+                  ug_win->info_args.shm_atomics,
                   ((ug_win->info_args.epochs_used & CSP_EPOCH_LOCK_ALL) ? "lockall" : ""),
                   ((ug_win->info_args.epochs_used & CSP_EPOCH_LOCK) ? "lock" : ""),
                   ((ug_win->info_args.epochs_used & CSP_EPOCH_PSCW) ? "pscw" : ""),
@@ -147,13 +188,18 @@ static inline int ugwin_print_info(CSPU_win_t * ug_win)
         CSP_strjoin(strs, nstrs, "|", 64, &epochs_joined_str[0]);
 
         CSP_msg_print(CSP_MSG_CONFIG_WIN, "CASPER win : 0x%lx (%s) "
-                      "no_local_load_store = %s, epochs_used = %s, async_config = %s, count of windows = %d\n",
+                      "no_local_load_store = %s, epochs_used = %s, async_config = %s, "
+                      "put_combine_size = %ld, shm_direct = %s, shm_atomics = %s, "
+                      "count of windows = %d\n",
                       (unsigned long) ug_win->win,
                       (strlen(ug_win->info_args.win_name) >
                        0 ? ug_win->info_args.win_name : "anonym"),
                       (ug_win->info_args.no_local_load_store ? "TRUE" : "FALSE"),
                       epochs_joined_str,
                       ((ug_win->info_args.async_config == CSP_ASYNC_CONFIG_ON) ? "on" : "off"),
+                      (long) ug_win->info_args.put_combine_size,
+                      (ug_win->info_args.shm_direct ? "TRUE" : "FALSE"),
+                      (ug_win->info_args.shm_atomics ? "TRUE" : "FALSE"),
                       (ug_win->num_ug_wins > 0 ? ug_win->num_ug_wins : 1 /* global win */));
     }
     return mpi_errno;
@@ -248,13 +294,17 @@ static int issue_ghost_cmd(int user_nprocs, MPI_Info info, CSPU_win_t * ug_win)
     winalloc_pkt->epochs_used = ug_win->info_args.epochs_used;
     winalloc_pkt->max_local_user_nprocs = ug_win->max_local_user_nprocs;
     winalloc_pkt->is_u_world = (ug_win->user_comm == CSP_COMM_USER_WORLD) ? 1 : 0;
+    winalloc_pkt->ugcomm_id = ug_win->ugcomm ? ug_win->ugcomm->id : 0;
+    winalloc_pkt->is_ugcomm_cached = (ug_win->ugcomm && ug_win->ugcomm->is_complete) ? 1 : 0;
+    winalloc_pkt->is_dynamic = (ug_win->create_flavor == MPI_WIN_FLAVOR_DYNAMIC) ? 1 : 0;
+    winalloc_pkt->is_remapped = ug_win->remap ? 1 : 0;
 
     mpi_errno = CSP_info_deserialize(info, &info_keyvals, &npairs);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     winalloc_pkt->info_npairs = npairs;
 
-    /* Only send start request to root ghost. */
+    /* Only the user root issues start request to local ghosts. */
     mpi_errno = CSPU_cwp_issue(&pkt);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
@@ -391,8 +441,13 @@ static int create_communicators(CSPU_win_t * ug_win)
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_win->local_user_comm, &user_local_rank));
     ug_win->num_g_ranks_in_ug = CSP_ENV.num_g * ug_win->num_nodes;
 
+    if (ug_win->ugcomm && ug_win->ugcomm->is_complete) {
+        /* Reuse cached communicators, the ghosts do the same. */
+        CSPU_ugcomm_cache_load(ug_win);
+        CSP_DBG_PRINT("reuse cached ug_comm (id %d)\n", ug_win->ugcomm->id);
+    }
     /* Optimization for user world communicator */
-    if (ug_win->user_comm == CSP_COMM_USER_WORLD) {
+    else if (ug_win->user_comm == CSP_COMM_USER_WORLD) {
 
         /* Create communicators
          *  local_ug_comm: including local USER and Ghost processes
@@ -485,6 +540,9 @@ static int create_communicators(CSPU_win_t * ug_win)
         for (i = 0; i < user_nprocs; i++)
             memcpy(ug_win->targets[i].g_ranks_in_ug, &gp_ranks_in_ug[i * CSP_ENV.num_g],
                    sizeof(int) * CSP_ENV.num_g);
+
+        if (ug_win->ugcomm)
+            CSPU_ugcomm_cache_store(ug_win);
     }
 
 #ifdef CSP_DEBUG
@@ -564,6 +622,16 @@ static int gather_base_offsets(CSPU_win_t * ug_win)
 
     for (j = 0; j < CSP_ENV.num_g; j++) {
         base_g_offsets[user_rank * CSP_ENV.num_g + j] = tmp_u_offsets;
+
+        /* Dynamic window is addressed by absolute address, ghosts translate it
+         * by the address of my pool segment in their address space. */
+        if (ug_win->create_flavor == MPI_WIN_FLAVOR_DYNAMIC)
+            base_g_offsets[user_rank * CSP_ENV.num_g + j] = CSPU_dyn_pool.g_offsets[j];
+
+        /* Remapped buffer is attached on ghosts, thus addressed by its address
+         * in ghosts' address space. */
+        if (ug_win->remap)
+            base_g_offsets[user_rank * CSP_ENV.num_g + j] = ug_win->remap->g_addrs[j];
     }
 
     CSP_DBG_PRINT("[%d] local base_g_offset 0x%lx\n", user_rank, tmp_u_offsets);
@@ -622,10 +690,22 @@ static int alloc_shared_window(MPI_Aint size, int disp_unit, MPI_Info info, CSPU
      * first level in CASPER. */
     CSPU_WIN_ERRHAN_SET_INTERN(ug_win->local_ug_win);
 
+    /* Let local ghosts map the remapped buffer. */
+    if (ug_win->remap) {
+        mpi_errno = CSPU_win_remap_exchange(ug_win);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
     /* Gather user offsets on corresponding ghost processes */
     mpi_errno = gather_base_offsets(ug_win);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
+    /* Get the address of intra-node targets for load/store. */
+    if (ug_win->info_args.shm_direct || ug_win->info_args.shm_atomics) {
+        mpi_errno = CSPU_win_query_shm_bases(ug_win);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+
   fn_exit:
     /* Only release local variables. local_ug_win is released at the end of win_alloc. */
     if (shared_info && shared_info != MPI_INFO_NULL)
@@ -636,6 +716,37 @@ static int alloc_shared_window(MPI_Aint size, int disp_unit, MPI_Info info, CSPU
     goto fn_exit;
 }
 
+/* Create an internal window on the user buffer. For dynamic window, the
+ * window exposes my whole pool segment which is also attached on ghosts.
+ * The remapped buffer of MPI_Win_create is exposed in the same way, because
+ * ghosts map it at different addresses. */
+static int create_ug_window(MPI_Aint size, int disp_unit, MPI_Info info, CSPU_win_t * ug_win,
+                            MPI_Win * win_ptr)
+{
+    int mpi_errno = MPI_SUCCESS;
+
+    if (ug_win->create_flavor == MPI_WIN_FLAVOR_DYNAMIC) {
+        CSP_CALLMPI(JUMP, PMPI_Win_create_dynamic(info, ug_win->ug_comm, win_ptr));
+        mpi_errno = CSPU_dyn_pool_attach(*win_ptr);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+    else if (ug_win->remap) {
+        CSP_CALLMPI(JUMP, PMPI_Win_create_dynamic(info, ug_win->ug_comm, win_ptr));
+        mpi_errno = CSPU_win_remap_attach(ug_win->remap, *win_ptr);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+    }
+    else {
+        CSP_CALLMPI(JUMP, PMPI_Win_create(ug_win->base, size, disp_unit, info,
+                                          ug_win->ug_comm, win_ptr));
+    }
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
 static int create_lock_windows(MPI_Aint size, int disp_unit, MPI_Info info, CSPU_win_t * ug_win)
 {
     int mpi_errno = MPI_SUCCESS;
@@ -648,8 +759,8 @@ static int create_lock_windows(MPI_Aint size, int disp_unit, MPI_Info info, CSPU
     ug_win->num_ug_wins = ug_win->max_local_user_nprocs;
     ug_win->ug_wins = CSP_calloc(ug_win->num_ug_wins, sizeof(MPI_Win));
     for (i = 0; i < ug_win->num_ug_wins; i++) {
-        CSP_CALLMPI(JUMP, PMPI_Win_create(ug_win->base, size, disp_unit, info,
-                                          ug_win->ug_comm, &ug_win->ug_wins[i]));
+        mpi_errno = create_ug_window(size, disp_unit, info, ug_win, &ug_win->ug_wins[i]);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
         /* Set RETURN error handler for all internal windows.
          * Thus any error happened on them will be returned and handled by the
@@ -692,55 +803,115 @@ static int check_valid_input(MPI_Aint size, int disp_unit)
     goto fn_exit;
 }
 
-int MPI_Win_allocate(MPI_Aint size, int disp_unit, MPI_Info info,
-                     MPI_Comm user_comm, void *baseptr, MPI_Win * win)
+/* State of a window allocation. The start stage ends with the gather of user
+ * information, or directly as done if asynchronous progress is turned off. */
+typedef enum {
+    CSPU_WIN_ALLOC_GATHER,      /* user information gathered */
+    CSPU_WIN_ALLOC_DONE
+} CSPU_win_alloc_stage_t;
+
+typedef struct CSPU_win_alloc {
+    MPI_Aint size;
+    int disp_unit;
+    MPI_Info info;
+    MPI_Comm user_comm;
+    void **base_pp;
+    MPI_Win *win_ptr;
+    int is_dynamic;             /* MPI_Win_create_dynamic, size and base_pp are unused. */
+    int is_create;              /* MPI_Win_create on user buffer create_base. */
+    void *create_base;
+
+    CSPU_win_t *ug_win;
+    MPI_Aint *tmp_gather_buf;
+    CSPU_win_alloc_stage_t stage;
+} CSPU_win_alloc_t;
+
+/* Start allocating casper window, return after the gather of user
+ * information. */
+static int win_allocate_start(CSPU_win_alloc_t * alloc)
 {
     int mpi_errno = MPI_SUCCESS;
-    int ug_rank, ug_nprocs, user_nprocs, user_rank, user_world_rank, world_rank,
-        user_local_rank, user_local_nprocs, ug_local_rank, ug_local_nprocs;
+    int user_nprocs, user_rank, user_world_rank, world_rank, user_local_rank, user_local_nprocs;
     CSPU_win_t *ug_win = NULL;
-    int i;
-    void **base_pp = (void **) baseptr;
+    MPI_Comm user_comm = alloc->user_comm;
     MPI_Aint *tmp_gather_buf = NULL;
     int tmp_bcast_buf[2];
-
-    /* Skip internal processing when disabled */
-    if (CSP_IS_DISABLED)
-        return PMPI_Win_allocate(size, disp_unit, info, user_comm, baseptr, win);
-
-    if (CSP_IS_MODE_DISABLED(RMA)) {
-        if (user_comm == MPI_COMM_WORLD)
-            user_comm = CSP_COMM_USER_WORLD;
-        return PMPI_Win_allocate(size, disp_unit, info, user_comm, baseptr, win);
-    }
-
-    CSPU_ERRHAN_EXTOBJ_LOCAL_DCL();
-    CSPU_COMM_ERRHAN_SET_EXTOBJ();
+    int i;
 
     ug_win = CSP_calloc(1, sizeof(CSPU_win_t));
-
-    if (user_comm == MPI_COMM_WORLD)
-        user_comm = CSP_COMM_USER_WORLD;
+    alloc->ug_win = ug_win;
     ug_win->user_comm = user_comm;
 
     /* Read window configuration */
-    mpi_errno = read_win_info(info, ug_win);
+    mpi_errno = read_win_info(alloc->info, ug_win);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     /* If user turns off asynchronous redirection, simply return normal window; */
     if (ug_win->info_args.async_config == CSP_ASYNC_CONFIG_OFF) {
         CSPU_ERRHAN_RESET_EXTOBJ();     /* reset before calling original MPI */
-        CSP_CALLMPI(NOSTMT, PMPI_Win_allocate(size, disp_unit, info, user_comm, baseptr, win));
-        CSP_DBG_PRINT("User turns off async in win_allocate, return normal win 0x%x\n", *win);
+        if (alloc->is_dynamic) {
+            CSP_CALLMPI(NOSTMT, PMPI_Win_create_dynamic(alloc->info, user_comm, alloc->win_ptr));
+        }
+        else if (alloc->is_create) {
+            CSP_CALLMPI(NOSTMT, PMPI_Win_create(alloc->create_base, alloc->size, alloc->disp_unit,
+                                                alloc->info, user_comm, alloc->win_ptr));
+        }
+        else {
+            CSP_CALLMPI(NOSTMT, PMPI_Win_allocate(alloc->size, alloc->disp_unit, alloc->info,
+                                                  user_comm, alloc->base_pp, alloc->win_ptr));
+        }
+        CSP_DBG_PRINT("User turns off async in win_allocate, return normal win 0x%x\n",
+                      *alloc->win_ptr);
+
+        ugwin_print_info(ug_win);
+        CSPU_win_release(ug_win);
+        alloc->ug_win = NULL;
+        alloc->stage = CSPU_WIN_ALLOC_DONE;
+        goto fn_exit;
+    }
+
+    /* Remap the user buffer of MPI_Win_create to share with ghosts. Every user
+     * process must succeed, otherwise simply return normal window. */
+    if (alloc->is_create) {
+        int is_remapped = 0, is_all_remapped = 0;
+
+        mpi_errno = CSPU_win_remap(alloc->create_base, alloc->size, &ug_win->remap);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-        goto fn_noasync;
+        is_remapped = ug_win->remap ? 1 : 0;
+        CSP_CALLMPI(JUMP, PMPI_Allreduce(&is_remapped, &is_all_remapped, 1, MPI_INT, MPI_MIN,
+                                         user_comm));
+        if (!is_all_remapped) {
+            CSPU_ERRHAN_RESET_EXTOBJ(); /* reset before calling original MPI */
+            CSP_CALLMPI(NOSTMT, PMPI_Win_create(alloc->create_base, alloc->size,
+                                                alloc->disp_unit, alloc->info, user_comm,
+                                                alloc->win_ptr));
+            CSP_msg_print(CSP_MSG_WARN, "called MPI_Win_create, user buffer cannot be "
+                          "remapped, no asynchronous progress on win 0x%x\n", *alloc->win_ptr);
+
+            CSPU_win_release(ug_win);
+            alloc->ug_win = NULL;
+            alloc->stage = CSPU_WIN_ALLOC_DONE;
+            goto fn_exit;
+        }
     }
 
     /* Start allocating casper window */
+    ug_win->create_flavor = alloc->is_dynamic ? MPI_WIN_FLAVOR_DYNAMIC : MPI_WIN_FLAVOR_ALLOCATE;
+    if (alloc->is_create)
+        ug_win->create_flavor = MPI_WIN_FLAVOR_CREATE;
+
+    /* Load/store cannot be done on dynamic window because the attached regions
+     * are unknown on origin processes. User buffers of MPI_Win_create are not
+     * in the local shared window either. */
+    if (alloc->is_dynamic || ug_win->remap) {
+        ug_win->info_args.shm_direct = 0;
+        ug_win->info_args.shm_atomics = 0;
+    }
 
     /* Check any invalid input which can only be checked by MPI calls after ghost joined.
      * TODO: how to interrupt ghost win_allocate if MPI error reported on user side ?*/
-    mpi_errno = check_valid_input(size, disp_unit);
+    mpi_errno = check_valid_input(alloc->size, alloc->disp_unit);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
     /* Initialize basic communicators and information. */
@@ -754,6 +925,21 @@ int MPI_Win_allocate(MPI_Aint size, int disp_unit, MPI_Info info,
         ug_win->user_comm = user_comm;
     }
     else {
+        int cached = 0;
+
+        /* Reuse the communicators created for a previous window on the same
+         * group of user processes. */
+        mpi_errno = CSPU_ugcomm_cache_get(user_comm, &ug_win->ugcomm, &cached);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+        if (cached) {
+            ug_win->local_user_comm = ug_win->ugcomm->local_user_comm;
+            ug_win->user_root_comm = ug_win->ugcomm->user_root_comm;
+            ug_win->node_id = ug_win->ugcomm->node_id;
+            ug_win->num_nodes = ug_win->ugcomm->num_nodes;
+            goto user_comm_created;
+        }
+
         CSP_CALLMPI(JUMP, PMPI_Comm_split_type(user_comm, MPI_COMM_TYPE_SHARED, 0,
                                                MPI_INFO_NULL, &ug_win->local_user_comm));
 
@@ -777,6 +963,14 @@ int MPI_Win_allocate(MPI_Aint size, int disp_unit, MPI_Info info,
         ug_win->num_nodes = tmp_bcast_buf[1];
     }
 
+  user_comm_created:
+    /* Processor atomics are atomic only with the operations done by processes
+     * on the same node, but a process on another node has to go through the
+     * ghost. num_nodes is the same on all processes, thus every process makes
+     * the same decision. */
+    if (ug_win->num_nodes > 1)
+        ug_win->info_args.shm_atomics = 0;
+
     CSP_CALLMPI(JUMP, PMPI_Comm_group(user_comm, &ug_win->user_group));
     CSP_CALLMPI(JUMP, PMPI_Comm_size(user_comm, &user_nprocs));
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(user_comm, &user_rank));
@@ -790,28 +984,68 @@ int MPI_Win_allocate(MPI_Aint size, int disp_unit, MPI_Info info,
     for (i = 0; i < user_nprocs; i++) {
         ug_win->targets[i].base_g_offsets = CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Aint));
         ug_win->targets[i].g_ranks_in_ug = CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Aint));
+        ug_win->targets[i].g_dirty_flags = CSP_calloc(CSP_ENV.num_g, sizeof(unsigned short));
     }
+    ug_win->dirty_targets = CSP_calloc(user_nprocs, sizeof(int));
+    ug_win->lockall_locked_targets = CSP_calloc(user_nprocs, sizeof(int));
 
     /* Gather users' disp_unit, size, ranks and node_id */
-    tmp_gather_buf = CSP_calloc(user_nprocs * 7, sizeof(MPI_Aint));
-    tmp_gather_buf[7 * user_rank] = (MPI_Aint) disp_unit;
-    tmp_gather_buf[7 * user_rank + 1] = size;   /* MPI_Aint, size in bytes */
-    tmp_gather_buf[7 * user_rank + 2] = (MPI_Aint) user_local_rank;
-    tmp_gather_buf[7 * user_rank + 3] = (MPI_Aint) world_rank;
-    tmp_gather_buf[7 * user_rank + 4] = (MPI_Aint) user_world_rank;
-    tmp_gather_buf[7 * user_rank + 5] = (MPI_Aint) ug_win->node_id;
-    tmp_gather_buf[7 * user_rank + 6] = (MPI_Aint) user_local_nprocs;
+    tmp_gather_buf = CSP_calloc(user_nprocs * 8, sizeof(MPI_Aint));
+    alloc->tmp_gather_buf = tmp_gather_buf;
+    tmp_gather_buf[8 * user_rank] = (MPI_Aint) alloc->disp_unit;
+    tmp_gather_buf[8 * user_rank + 1] = alloc->size;    /* MPI_Aint, size in bytes */
+    tmp_gather_buf[8 * user_rank + 2] = (MPI_Aint) user_local_rank;
+    tmp_gather_buf[8 * user_rank + 3] = (MPI_Aint) world_rank;
+    tmp_gather_buf[8 * user_rank + 4] = (MPI_Aint) user_world_rank;
+    tmp_gather_buf[8 * user_rank + 5] = (MPI_Aint) ug_win->node_id;
+    tmp_gather_buf[8 * user_rank + 6] = (MPI_Aint) user_local_nprocs;
+    tmp_gather_buf[8 * user_rank + 7] = 0;
+
+    /* Operations on dynamic window are checked against the pool segment. */
+    if (alloc->is_dynamic) {
+        tmp_gather_buf[8 * user_rank + 1] = CSPU_dyn_pool.size;
+        tmp_gather_buf[8 * user_rank + 7] = CSPU_dyn_pool.base_addr;
+    }
 
     CSP_CALLMPI(JUMP, PMPI_Allgather(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
-                                     tmp_gather_buf, 7, MPI_AINT, user_comm));
+                                     tmp_gather_buf, 8, MPI_AINT, user_comm));
+    alloc->stage = CSPU_WIN_ALLOC_GATHER;
+
+  fn_exit:
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
+
+/* Complete allocating casper window after the gather of user information is
+ * completed. It involves ghosts and all user processes. */
+static int win_allocate_finish(CSPU_win_alloc_t * alloc)
+{
+    int mpi_errno = MPI_SUCCESS;
+    int ug_rank, ug_nprocs, user_nprocs, user_rank, user_local_rank, user_local_nprocs,
+        ug_local_rank, ug_local_nprocs;
+    CSPU_win_t *ug_win = alloc->ug_win;
+    MPI_Aint *tmp_gather_buf = alloc->tmp_gather_buf;
+    MPI_Aint size = alloc->size;
+    int disp_unit = alloc->disp_unit;
+    MPI_Info info = alloc->info;
+    int i;
+
+    CSP_CALLMPI(JUMP, PMPI_Comm_size(ug_win->user_comm, &user_nprocs));
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_win->user_comm, &user_rank));
+    CSP_CALLMPI(JUMP, PMPI_Comm_size(ug_win->local_user_comm, &user_local_nprocs));
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_win->local_user_comm, &user_local_rank));
+
     for (i = 0; i < user_nprocs; i++) {
-        ug_win->targets[i].disp_unit = (int) tmp_gather_buf[7 * i];
-        ug_win->targets[i].size = tmp_gather_buf[7 * i + 1];
-        ug_win->targets[i].local_user_rank = (int) tmp_gather_buf[7 * i + 2];
-        ug_win->targets[i].world_rank = (int) tmp_gather_buf[7 * i + 3];
-        ug_win->targets[i].user_world_rank = (int) tmp_gather_buf[7 * i + 4];
-        ug_win->targets[i].node_id = (int) tmp_gather_buf[7 * i + 5];
-        ug_win->targets[i].local_user_nprocs = (int) tmp_gather_buf[7 * i + 6];
+        ug_win->targets[i].disp_unit = (int) tmp_gather_buf[8 * i];
+        ug_win->targets[i].size = tmp_gather_buf[8 * i + 1];
+        ug_win->targets[i].local_user_rank = (int) tmp_gather_buf[8 * i + 2];
+        ug_win->targets[i].world_rank = (int) tmp_gather_buf[8 * i + 3];
+        ug_win->targets[i].user_world_rank = (int) tmp_gather_buf[8 * i + 4];
+        ug_win->targets[i].node_id = (int) tmp_gather_buf[8 * i + 5];
+        ug_win->targets[i].local_user_nprocs = (int) tmp_gather_buf[8 * i + 6];
+        ug_win->targets[i].dyn_base = tmp_gather_buf[8 * i + 7];
 
         /* Calculate the maximum number of processes per node */
         ug_win->max_local_user_nprocs = CSP_MAX(ug_win->max_local_user_nprocs,
@@ -861,15 +1095,25 @@ int MPI_Win_allocate(MPI_Aint size, int disp_unit, MPI_Info info,
     CSP_DBG_PRINT(" Created ug_comm: %d/%d, local_ug_comm: %d/%d\n",
                   ug_rank, ug_nprocs, ug_local_rank, ug_local_nprocs);
 
+    ug_win->g_dirty_flags_in_ug = CSP_calloc(ug_nprocs, sizeof(unsigned short));
+
 #if defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
     ug_win->g_ops_counts = CSP_calloc(ug_nprocs, sizeof(int));
     ug_win->g_bytes_counts = CSP_calloc(ug_nprocs, sizeof(unsigned long));
+    ug_win->g_op_latencies = CSP_calloc(ug_nprocs, sizeof(double));
 #endif
 
-    /* Allocate local shared window */
-    mpi_errno = alloc_shared_window(size, disp_unit, info, ug_win);
+    /* Allocate local shared window.
+     * The memory of dynamic window is attached from the pool, thus no buffer
+     * is allocated, but the window is still created for ghosts. */
+    mpi_errno = alloc_shared_window((alloc->is_dynamic || ug_win->remap) ? 0 : size,
+                                    disp_unit, info, ug_win);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
+    /* User window of MPI_Win_create is still on the user buffer. */
+    if (ug_win->remap)
+        ug_win->base = ug_win->remap->base;
+
     /* Bind window to main ghost process */
     mpi_errno = CSPU_win_bind_ghosts(ug_win);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
@@ -885,8 +1129,8 @@ int MPI_Win_allocate(MPI_Aint size, int disp_unit, MPI_Info info,
     if ((ug_win->info_args.epochs_used & CSP_EPOCH_FENCE) ||
         (ug_win->info_args.epochs_used & CSP_EPOCH_PSCW) ||
         (ug_win->info_args.epochs_used == CSP_EPOCH_LOCK_ALL)) {
-        CSP_CALLMPI(JUMP, PMPI_Win_create(ug_win->base, size, disp_unit, info,
-                                          ug_win->ug_comm, &ug_win->global_win));
+        mpi_errno = create_ug_window(size, disp_unit, info, ug_win, &ug_win->global_win);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
         /* Set RETURN error handler for all internal windows.
          * Thus any error happened on them will be returned and handled by the
@@ -912,14 +1156,18 @@ int MPI_Win_allocate(MPI_Aint size, int disp_unit, MPI_Info info,
     ug_win->is_self_locked = 0;
 
     /* - Only expose user window in order to hide ghosts in all non-wrapped window functions */
-    CSP_CALLMPI(JUMP, PMPI_Win_create(ug_win->base, size, disp_unit, info,
-                                      ug_win->user_comm, &ug_win->win));
+    if (alloc->is_dynamic) {
+        CSP_CALLMPI(JUMP, PMPI_Win_create_dynamic(info, ug_win->user_comm, &ug_win->win));
+    }
+    else {
+        CSP_CALLMPI(JUMP, PMPI_Win_create(ug_win->base, size, disp_unit, info,
+                                          ug_win->user_comm, &ug_win->win));
+    }
 
     CSP_DBG_PRINT("[%d] Created window 0x%x\n", user_rank, ug_win->win);
 
-    ug_win->create_flavor = MPI_WIN_FLAVOR_ALLOCATE;
-    *win = ug_win->win;
-    *base_pp = ug_win->base;
+    *alloc->win_ptr = ug_win->win;
+    *alloc->base_pp = ug_win->base;
 
     /* Gather the handle of ghosts' win. */
     if (user_local_rank == 0) {
@@ -936,28 +1184,175 @@ int MPI_Win_allocate(MPI_Aint size, int disp_unit, MPI_Info info,
 
     ugwin_print_info(ug_win);
 
+
+    alloc->stage = CSPU_WIN_ALLOC_DONE;
+
   fn_exit:
-    if (tmp_gather_buf)
-        free(tmp_gather_buf);
+    return mpi_errno;
+
+  fn_fail:
+    goto fn_exit;
+}
 
+/* Release the allocation state. The window is released only on failure. */
+static void win_allocate_cleanup(CSPU_win_alloc_t * alloc, int mpi_errno)
+{
+    if (mpi_errno != MPI_SUCCESS) {
+        /* Caching is the last possible error, so we do not need remove
+         * cache here. */
+        CSPU_win_release(alloc->ug_win);
+        alloc->ug_win = NULL;
+
+        *alloc->win_ptr = MPI_WIN_NULL;
+        *alloc->base_pp = NULL;
+    }
+
+    if (alloc->tmp_gather_buf)
+        free(alloc->tmp_gather_buf);
+    alloc->tmp_gather_buf = NULL;
+}
+
+int MPI_Win_allocate(MPI_Aint size, int disp_unit, MPI_Info info,
+                     MPI_Comm user_comm, void *baseptr, MPI_Win * win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_win_alloc_t alloc;
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED)
+        return PMPI_Win_allocate(size, disp_unit, info, user_comm, baseptr, win);
+
+    if (CSP_IS_MODE_DISABLED(RMA)) {
+        if (user_comm == MPI_COMM_WORLD)
+            user_comm = CSP_COMM_USER_WORLD;
+        return PMPI_Win_allocate(size, disp_unit, info, user_comm, baseptr, win);
+    }
+
+    CSPU_ERRHAN_EXTOBJ_LOCAL_DCL();
+    CSPU_COMM_ERRHAN_SET_EXTOBJ();
+
+    if (user_comm == MPI_COMM_WORLD)
+        user_comm = CSP_COMM_USER_WORLD;
+
+    memset(&alloc, 0, sizeof(alloc));
+    alloc.size = size;
+    alloc.disp_unit = disp_unit;
+    alloc.info = info;
+    alloc.user_comm = user_comm;
+    alloc.base_pp = (void **) baseptr;
+    alloc.win_ptr = win;
+
+    mpi_errno = win_allocate_start(&alloc);
+
+    /* Async is turned off, error is handled by original MPI. */
+    if (alloc.stage == CSPU_WIN_ALLOC_DONE)
+        goto fn_exit;
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    mpi_errno = win_allocate_finish(&alloc);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    win_allocate_cleanup(&alloc, mpi_errno);
+
+  fn_exit:
     CSPU_ERRHAN_RESET_EXTOBJ(); /* reset before return */
     return mpi_errno;
 
-  fn_noasync:
-    ugwin_print_info(ug_win);
+  fn_fail:
+    win_allocate_cleanup(&alloc, mpi_errno);
 
-    CSPU_win_release(ug_win);
+    CSPU_ERRHAN_RESET_EXTOBJ(); /* reset before error handling */
+    CSPU_COMM_ERRHANLDING(user_comm, &mpi_errno);
     goto fn_exit;
+}
+
+/* Create casper window for MPI_Win_create_dynamic (see win_create_dynamic.c).
+ * It goes through the same steps as window allocation, but every internal
+ * window is a dynamic window exposing the pool segments, and the user window
+ * is a normal dynamic window. */
+int CSPU_win_create_dynamic(MPI_Info info, MPI_Comm user_comm, MPI_Win * win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_win_alloc_t alloc;
+    void *base = NULL;
+
+    CSPU_ERRHAN_EXTOBJ_LOCAL_DCL();
+    CSPU_COMM_ERRHAN_SET_EXTOBJ();
+
+    memset(&alloc, 0, sizeof(alloc));
+    alloc.size = 0;
+    alloc.disp_unit = 1;
+    alloc.info = info;
+    alloc.user_comm = user_comm;
+    alloc.base_pp = &base;
+    alloc.win_ptr = win;
+    alloc.is_dynamic = 1;
+
+    mpi_errno = win_allocate_start(&alloc);
+
+    /* Async is turned off, error is handled by original MPI. */
+    if (alloc.stage == CSPU_WIN_ALLOC_DONE)
+        goto fn_exit;
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    mpi_errno = win_allocate_finish(&alloc);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    win_allocate_cleanup(&alloc, mpi_errno);
+
+  fn_exit:
+    CSPU_ERRHAN_RESET_EXTOBJ(); /* reset before return */
+    return mpi_errno;
 
   fn_fail:
+    win_allocate_cleanup(&alloc, mpi_errno);
 
-    /* Caching is the last possible error, so we do not need remove
-     * cache here. */
+    CSPU_ERRHAN_RESET_EXTOBJ(); /* reset before error handling */
+    CSPU_COMM_ERRHANLDING(user_comm, &mpi_errno);
+    goto fn_exit;
+}
 
-    CSPU_win_release(ug_win);
+/* Create window on user buffer with asynchronous progress, the buffer is
+ * remapped to be shared with local ghosts (see csp_win_remap.c). Return normal
+ * window if the remap fails on any user process. */
+int CSPU_win_create(void *base, MPI_Aint size, int disp_unit, MPI_Info info,
+                    MPI_Comm user_comm, MPI_Win * win)
+{
+    int mpi_errno = MPI_SUCCESS;
+    CSPU_win_alloc_t alloc;
+    void *base_pp = NULL;
 
-    *win = MPI_WIN_NULL;
-    *base_pp = NULL;
+    CSPU_ERRHAN_EXTOBJ_LOCAL_DCL();
+    CSPU_COMM_ERRHAN_SET_EXTOBJ();
+
+    memset(&alloc, 0, sizeof(alloc));
+    alloc.size = size;
+    alloc.disp_unit = disp_unit;
+    alloc.info = info;
+    alloc.user_comm = user_comm;
+    alloc.base_pp = &base_pp;
+    alloc.win_ptr = win;
+    alloc.is_create = 1;
+    alloc.create_base = base;
+
+    mpi_errno = win_allocate_start(&alloc);
+
+    /* Async is turned off, error is handled by original MPI. */
+    if (alloc.stage == CSPU_WIN_ALLOC_DONE)
+        goto fn_exit;
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    mpi_errno = win_allocate_finish(&alloc);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
+    win_allocate_cleanup(&alloc, mpi_errno);
+
+  fn_exit:
+    CSPU_ERRHAN_RESET_EXTOBJ(); /* reset before return */
+    return mpi_errno;
+
+  fn_fail:
+    win_allocate_cleanup(&alloc, mpi_errno);
 
     CSPU_ERRHAN_RESET_EXTOBJ(); /* reset before error handling */
     CSPU_COMM_ERRHANLDING(user_comm, &mpi_errno);
@@ -0,0 +1,54 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cspu.h"
+
+int MPI_Win_attach(MPI_Win win, void *base, MPI_Aint size)
+{
+    CSPU_win_t *ug_win;
+    int mpi_errno = MPI_SUCCESS;
+
+    /* Skip internal processing when disabled */
+    if (CSP_IS_DISABLED || CSP_IS_MODE_DISABLED(RMA))
+        return PMPI_Win_attach(win, base, size);
+
+    CSPU_ERRHAN_EXTOBJ_LOCAL_DCL();
+    CSPU_WIN_ERRHAN_SET_EXTOBJ();
+
+    CSPU_fetch_ug_win_from_cache(win, &ug_win);
+
+    if (ug_win == NULL) {
+        /* normal window */
+        CSPU_ERRHAN_RESET_EXTOBJ();     /* reset before calling original MPI */
+        return PMPI_Win_attach(win, base, size);
+    }
+
+    /* Ghosts can only access the memory in the dynamic pool, which is already
+     * attached to every internal window at window creation. Thus we only need
+     * check the region here. */
+    if (!CSPU_dyn_pool_contains(base, size)) {
+        CSP_msg_print(CSP_MSG_ERROR, "Attached memory %p (size %ld) is not allocated by "
+                      "MPI_Alloc_mem, or exceeds CSP_DYNAMIC_POOL_SIZE. Please set info "
+                      "async_config=off at window creation to disable asynchronous progress.\n",
+                      base, (long) size);
+        mpi_errno = MPI_ERR_ARG;
+        goto fn_fail;
+    }
+
+    CSP_CALLMPI(JUMP, PMPI_Win_attach(ug_win->win, base, size));
+    CSP_DBG_PRINT("attach %p (size %ld) to win 0x%x\n", base, (long) size, win);
+
+  fn_exit:
+    CSPU_ERRHAN_RESET_EXTOBJ(); /* reset before return */
+    return mpi_errno;
+
+  fn_fail:
+    CSPU_ERRHAN_RESET_EXTOBJ(); /* reset before error handling */
+    CSPU_WIN_ERRHANLDING(win, &mpi_errno);
+    goto fn_exit;
+}
@@ -20,11 +20,17 @@ int MPI_Win_create(void *base, MPI_Aint size, int disp_unit, MPI_Info info,
     if (comm == MPI_COMM_WORLD)
         comm = CSP_COMM_USER_WORLD;
 
+    /* Asynchronous progress is only supported when the user buffer can be
+     * remapped to be shared with ghosts. */
+    if (CSP_IS_MODE_ENABLED(RMA) && CSPU_win_remap_enabled)
+        return CSPU_win_create(base, size, disp_unit, info, comm, win);
+
     CSP_CALLMPI(NOSTMT, PMPI_Win_create(base, size, disp_unit, info, comm, win));
 
     if (CSP_IS_MODE_ENABLED(RMA)) {
         CSP_msg_print(CSP_MSG_WARN, "called MPI_Win_create, "
-                      "no asynchronous progress on win 0x%x\n", *win);
+                      "no asynchronous progress on win 0x%x (CSP_WIN_CREATE_REMAP is off)\n",
+                      *win);
     }
     return mpi_errno;
 }
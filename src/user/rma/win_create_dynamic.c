@@ -18,11 +18,18 @@ int MPI_Win_create_dynamic(MPI_Info info, MPI_Comm comm, MPI_Win * win)
 
     if (comm == MPI_COMM_WORLD)
         comm = CSP_COMM_USER_WORLD;
+
+    /* Asynchronous progress is only supported when the attached memory can be
+     * allocated from the dynamic pool, which is visible to ghosts. */
+    if (CSP_IS_MODE_ENABLED(RMA) && CSPU_DYN_POOL_ENABLED())
+        return CSPU_win_create_dynamic(info, comm, win);
+
     CSP_CALLMPI(NOSTMT, PMPI_Win_create_dynamic(info, comm, win));
 
     if (CSP_IS_MODE_ENABLED(RMA)) {
         CSP_msg_print(CSP_MSG_WARN, "called MPI_Win_create_dynamic, "
-                      "no asynchronous progress on win 0x%x\n", *win);
+                      "no asynchronous progress on win 0x%x (CSP_DYNAMIC_POOL_SIZE is not set)\n",
+                      *win);
     }
     return mpi_errno;
 }
@@ -18,8 +18,8 @@ int CSPU_win_target_flush(int target_rank, CSPU_win_t * ug_win)
     MPI_Win *win_ptr = NULL;
     int user_rank;
     int target_g_rank_in_ug;
-    int main_g_off CSP_ATTRIBUTE((unused));
-    int k CSP_ATTRIBUTE((unused));
+    int k;
+    double t_start CSP_ATTRIBUTE((unused));
 
     target = &(ug_win->targets[target_rank]);
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_win->user_comm, &user_rank));
@@ -29,30 +29,28 @@ int CSPU_win_target_flush(int target_rank, CSPU_win_t * ug_win)
     CSPU_TARGET_GET_EPOCH_WIN(target, ug_win, win_ptr);
     CSP_ASSERT(win_ptr != NULL);
 
-#if !defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
-    /* RMA operations are only issued to the main ghost, so we only flush it. */
-    /* TODO: track op issuing, only flush the ghosts which received ops. */
-    main_g_off = target->main_g_off;
-    target_g_rank_in_ug = target->g_ranks_in_ug[main_g_off];
-
-    CSP_DBG_PRINT(" flush(ghost(%d), %s 0x%x), instead of target rank %d\n",
-                  target_g_rank_in_ug, CSPU_GET_WIN_TYPE(*win_ptr, ug_win), *win_ptr, target_rank);
+    CSPU_win_shm_direct_sync(ug_win);
+    mpi_errno = CSPU_put_wc_drain_target(target_rank, ug_win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    CSP_CALLMPI(JUMP, PMPI_Win_flush(target_g_rank_in_ug, *win_ptr));
-#else
-    /* RMA operations may be distributed to all ghosts, so we should
-     * flush all ghosts on all windows. Consider flush does nothing if no
-     * operations on that target in most MPI implementation, simpler code is better */
+    /* RMA operations are issued to the main ghost, or distributed to all ghosts
+     * in runtime load balancing. Only flush the ghosts which received operations. */
     for (k = 0; k < CSP_ENV.num_g; k++) {
+        if (!CSPU_target_is_dirty(target, k, win_ptr, ug_win))
+            continue;
+
         target_g_rank_in_ug = target->g_ranks_in_ug[k];
 
         CSP_DBG_PRINT(" flush(ghost(%d), %s 0x%x), instead of target rank %d\n",
                       target_g_rank_in_ug, CSPU_GET_WIN_TYPE(*win_ptr, ug_win), *win_ptr,
                       target_rank);
 
+        t_start = CSPU_opload_feedback_start();
         CSP_CALLMPI(JUMP, PMPI_Win_flush(target_g_rank_in_ug, *win_ptr));
+        CSPU_opload_feedback_update(target_g_rank_in_ug, t_start, ug_win);
+        CSPU_target_reset_g_dirty(target, k, win_ptr, ug_win);
     }
-#endif /*end of CSP_ENABLE_RUNTIME_LOAD_OPT */
+    CSPU_put_wc_complete(target_rank, ug_win);
 
     if (user_rank == target_rank && ug_win->is_self_locked) {
         mpi_errno = CSPU_win_flush_self(ug_win);
@@ -119,9 +117,14 @@ int MPI_Win_flush(int target_rank, MPI_Win win)
     CSPU_TARGET_GET_EPOCH_WIN(target, ug_win, win_ptr);
     CSP_ASSERT(win_ptr != NULL);
 
+    CSPU_win_shm_direct_sync(ug_win);
+    mpi_errno = CSPU_put_wc_drain_target(target_rank, ug_win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     CSP_DBG_PRINT(" flush_all(%s 0x%x), instead of target rank %d\n",
                   CSPU_GET_WIN_TYPE(*win_ptr, ug_win), *win_ptr, target_rank);
     CSP_CALLMPI(JUMP, PMPI_Win_flush_all(*win_ptr));
+    CSPU_put_wc_complete(target_rank, ug_win);
 #else
     mpi_errno = CSPU_win_target_flush(target_rank, ug_win);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
@@ -15,17 +15,28 @@ int CSPU_win_global_flush_all(CSPU_win_t * ug_win)
 {
     int mpi_errno = MPI_SUCCESS;
     int i CSP_ATTRIBUTE((unused));
+    double t_start CSP_ATTRIBUTE((unused));
+
+    CSPU_win_shm_direct_sync(ug_win);
+    mpi_errno = CSPU_put_wc_drain_target(MPI_ANY_SOURCE, ug_win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
 #ifdef CSP_ENABLE_SYNC_ALL_OPT
     CSP_DBG_PRINT(" flush_all(global_win 0x%x)\n", ug_win->global_win);
     CSP_CALLMPI(JUMP, PMPI_Win_flush_all(ug_win->global_win));
 #else
-    /* Flush every ghost once in the single window.
-     * TODO: track op issuing, only flush the ghosts which receive ops. */
+    /* Flush every ghost which received operations once in the single window. */
     for (i = 0; i < ug_win->num_g_ranks_in_ug; i++) {
-        CSP_DBG_PRINT(" flush(ghost %d, global_win 0x%x)\n", ug_win->g_ranks_in_ug[i],
-                      ug_win->global_win);
-        CSP_CALLMPI(JUMP, PMPI_Win_flush(ug_win->g_ranks_in_ug[i], ug_win->global_win));
+        int g_rank_in_ug = ug_win->g_ranks_in_ug[i];
+
+        if (!ug_win->g_dirty_flags_in_ug[g_rank_in_ug])
+            continue;
+
+        CSP_DBG_PRINT(" flush(ghost %d, global_win 0x%x)\n", g_rank_in_ug, ug_win->global_win);
+        t_start = CSPU_opload_feedback_start();
+        CSP_CALLMPI(JUMP, PMPI_Win_flush(g_rank_in_ug, ug_win->global_win));
+        CSPU_opload_feedback_update(g_rank_in_ug, t_start, ug_win);
+        ug_win->g_dirty_flags_in_ug[g_rank_in_ug] = 0;
     }
 
     if (ug_win->is_self_locked) {
@@ -33,6 +44,7 @@ int CSPU_win_global_flush_all(CSPU_win_t * ug_win)
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
 #endif
+    CSPU_put_wc_complete(MPI_ANY_SOURCE, ug_win);
 
   fn_exit:
     return mpi_errno;
@@ -45,7 +57,7 @@ int MPI_Win_flush_all(MPI_Win win)
 {
     CSPU_win_t *ug_win;
     int mpi_errno = MPI_SUCCESS;
-    int user_nprocs;
+    int user_nprocs, user_rank CSP_ATTRIBUTE((unused));
     int i;
 
     /* Skip internal processing when disabled */
@@ -82,6 +94,7 @@ int MPI_Win_flush_all(MPI_Win win)
 
     CSP_ASSERT(ug_win->start_counter == 0 && ug_win->lock_counter == 0);
     CSP_CALLMPI(JUMP, PMPI_Comm_size(ug_win->user_comm, &user_nprocs));
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_win->user_comm, &user_rank));
 
     if (!(ug_win->info_args.epochs_used & CSP_EPOCH_LOCK)) {
         /* In no-lock epoch, single window is shared by multiple targets. */
@@ -90,18 +103,31 @@ int MPI_Win_flush_all(MPI_Win win)
     }
     else {
         /* In lock-exist epoch, separate windows are bound with targets. */
+        CSPU_win_shm_direct_sync(ug_win);
 
 #ifdef CSP_ENABLE_SYNC_ALL_OPT
+        mpi_errno = CSPU_put_wc_drain_target(MPI_ANY_SOURCE, ug_win);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
         for (i = 0; i < ug_win->num_ug_wins; i++) {
             CSP_DBG_PRINT(" flush_all(ug_win 0x%x)\n", ug_win->ug_wins[i]);
             CSP_CALLMPI(JUMP, PMPI_Win_flush_all(ug_win->ug_wins[i]));
         }
+        CSPU_put_wc_complete(MPI_ANY_SOURCE, ug_win);
 #else
-        for (i = 0; i < user_nprocs; i++) {
-            mpi_errno = CSPU_win_target_flush(i, ug_win);
+        /* Only flush the targets which received operations. */
+        for (i = 0; i < ug_win->num_dirty_targets; i++) {
+            mpi_errno = CSPU_win_target_flush(ug_win->dirty_targets[i], ug_win);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        }
+
+        /* Flush self if it is not touched by any operation. */
+        if (ug_win->is_self_locked && !ug_win->targets[user_rank].is_dirty) {
+            mpi_errno = CSPU_win_flush_self(ug_win);
             CSP_CHKMPIFAIL_JUMP(mpi_errno);
         }
 #endif /*end of CSP_ENABLE_SYNC_ALL_OPT */
+        CSPU_win_reset_dirty_targets(ug_win);
     }
 
 #if defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
@@ -17,8 +17,8 @@ int CSPU_win_target_flush_local(int target_rank, CSPU_win_t * ug_win)
     CSPU_win_target_t *target = NULL;
     MPI_Win *win_ptr = NULL;
     int user_rank;
-    int main_g_off CSP_ATTRIBUTE((unused)), target_g_rank_in_ug CSP_ATTRIBUTE((unused));
-    int k CSP_ATTRIBUTE((unused));
+    int target_g_rank_in_ug;
+    int k;
 
     target = &(ug_win->targets[target_rank]);
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_win->user_comm, &user_rank));
@@ -28,29 +28,24 @@ int CSPU_win_target_flush_local(int target_rank, CSPU_win_t * ug_win)
     CSPU_TARGET_GET_EPOCH_WIN(target, ug_win, win_ptr);
     CSP_ASSERT(win_ptr != NULL);
 
-#if !defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
-    /* RMA operations are only issued to the main ghost, so we only flush it. */
-    /* TODO: track op issuing, only flush the ghosts which received ops. */
-    main_g_off = target->main_g_off;
-    target_g_rank_in_ug = target->g_ranks_in_ug[main_g_off];
-
-    CSP_DBG_PRINT(" flush_local(ghost(%d), %s 0x%x), instead of target rank %d\n",
-                  target_g_rank_in_ug, CSPU_GET_WIN_TYPE(*win_ptr, ug_win), *win_ptr, target_rank);
+    mpi_errno = CSPU_put_wc_drain_target(target_rank, ug_win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    CSP_CALLMPI(JUMP, PMPI_Win_flush_local(target_g_rank_in_ug, *win_ptr));
-#else
-    /* RMA operations may be distributed to all ghosts, so we should
-     * flush all ghosts on all windows. */
+    /* Only locally flush the ghosts which received operations. Local completion
+     * does not complete them at target, thus dirty flags are kept for the next flush. */
     for (k = 0; k < CSP_ENV.num_g; k++) {
+        if (!CSPU_target_is_dirty(target, k, win_ptr, ug_win))
+            continue;
+
         target_g_rank_in_ug = target->g_ranks_in_ug[k];
 
-        CSP_DBG_PRINT(" flush(ghost(%d), %s 0x%x), instead of target rank %d\n",
+        CSP_DBG_PRINT(" flush_local(ghost(%d), %s 0x%x), instead of target rank %d\n",
                       target_g_rank_in_ug, CSPU_GET_WIN_TYPE(*win_ptr, ug_win), *win_ptr,
                       target_rank);
 
         CSP_CALLMPI(JUMP, PMPI_Win_flush_local(target_g_rank_in_ug, *win_ptr));
     }
-#endif /*end of CSP_ENABLE_RUNTIME_LOAD_OPT */
+    CSPU_put_wc_complete(target_rank, ug_win);
 
     if (user_rank == target_rank && ug_win->is_self_locked) {
         mpi_errno = CSPU_win_flush_local_self(ug_win);
@@ -116,9 +111,13 @@ int MPI_Win_flush_local(int target_rank, MPI_Win win)
     CSPU_TARGET_GET_EPOCH_WIN(target, ug_win, win_ptr);
     CSP_ASSERT(win_ptr != NULL);
 
+    mpi_errno = CSPU_put_wc_drain_target(target_rank, ug_win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     CSP_DBG_PRINT(" flush_local_all(%s 0x%x), instead of target rank %d\n",
                   CSPU_GET_WIN_TYPE(*win_ptr, ug_win), *win_ptr, target_rank);
     CSP_CALLMPI(JUMP, PMPI_Win_flush_local_all(*win_ptr));
+    CSPU_put_wc_complete(target_rank, ug_win);
 #else
     mpi_errno = CSPU_win_target_flush_local(target_rank, ug_win);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
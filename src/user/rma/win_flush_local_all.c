@@ -14,16 +14,23 @@ static int win_global_flush_local_all(CSPU_win_t * ug_win)
     int mpi_errno = MPI_SUCCESS;
     int i CSP_ATTRIBUTE((unused));
 
+    mpi_errno = CSPU_put_wc_drain_target(MPI_ANY_SOURCE, ug_win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
 #ifdef CSP_ENABLE_SYNC_ALL_OPT
     CSP_DBG_PRINT(" flush_local_all(global_win 0x%x)\n", ug_win->global_win);
     CSP_CALLMPI(JUMP, PMPI_Win_flush_local_all(ug_win->global_win));
 #else
-    /* Flush every ghost once in the single window.
-     * TODO: track op issuing, only flush the ghosts which receive ops. */
+    /* Locally flush every ghost which received operations once in the single window. */
     for (i = 0; i < ug_win->num_g_ranks_in_ug; i++) {
-        CSP_DBG_PRINT(" flush_local(ghost %d, global_win 0x%x)\n", ug_win->g_ranks_in_ug[i],
+        int g_rank_in_ug = ug_win->g_ranks_in_ug[i];
+
+        if (!ug_win->g_dirty_flags_in_ug[g_rank_in_ug])
+            continue;
+
+        CSP_DBG_PRINT(" flush_local(ghost %d, global_win 0x%x)\n", g_rank_in_ug,
                       ug_win->global_win);
-        CSP_CALLMPI(JUMP, PMPI_Win_flush_local(ug_win->g_ranks_in_ug[i], ug_win->global_win));
+        CSP_CALLMPI(JUMP, PMPI_Win_flush_local(g_rank_in_ug, ug_win->global_win));
     }
 
     if (ug_win->is_self_locked) {
@@ -31,6 +38,7 @@ static int win_global_flush_local_all(CSPU_win_t * ug_win)
         CSP_CHKMPIFAIL_JUMP(mpi_errno);
     }
 #endif
+    CSPU_put_wc_complete(MPI_ANY_SOURCE, ug_win);
 
   fn_exit:
     return mpi_errno;
@@ -43,7 +51,7 @@ int MPI_Win_flush_local_all(MPI_Win win)
 {
     CSPU_win_t *ug_win;
     int mpi_errno = MPI_SUCCESS;
-    int user_nprocs;
+    int user_nprocs, user_rank CSP_ATTRIBUTE((unused));
     int i CSP_ATTRIBUTE((unused));
 
     /* Skip internal processing when disabled */
@@ -79,6 +87,7 @@ int MPI_Win_flush_local_all(MPI_Win win)
 
     CSP_ASSERT(ug_win->start_counter == 0 && ug_win->lock_counter == 0);
     CSP_CALLMPI(JUMP, PMPI_Comm_size(ug_win->user_comm, &user_nprocs));
+    CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_win->user_comm, &user_rank));
 
     if (!(ug_win->info_args.epochs_used & CSP_EPOCH_LOCK)) {
         /* In no-lock epoch, single window is shared by multiple targets. */
@@ -88,13 +97,23 @@ int MPI_Win_flush_local_all(MPI_Win win)
     else {
         /* In lock-exist epoch, separate windows are bound with targets. */
 #ifdef CSP_ENABLE_SYNC_ALL_OPT
+        mpi_errno = CSPU_put_wc_drain_target(MPI_ANY_SOURCE, ug_win);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
         for (i = 0; i < ug_win->num_ug_wins; i++) {
             CSP_DBG_PRINT(" flush_local_all(ug_win 0x%x)\n", ug_win->ug_wins[i]);
             CSP_CALLMPI(JUMP, PMPI_Win_flush_local_all(ug_win->ug_wins[i]));
         }
+        CSPU_put_wc_complete(MPI_ANY_SOURCE, ug_win);
 #else
-        for (i = 0; i < user_nprocs; i++) {
-            mpi_errno = CSPU_win_target_flush_local(i, ug_win);
+        /* Only locally flush the targets which received operations. */
+        for (i = 0; i < ug_win->num_dirty_targets; i++) {
+            mpi_errno = CSPU_win_target_flush_local(ug_win->dirty_targets[i], ug_win);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        }
+
+        if (ug_win->is_self_locked && !ug_win->targets[user_rank].is_dirty) {
+            mpi_errno = CSPU_win_flush_local_self(ug_win);
             CSP_CHKMPIFAIL_JUMP(mpi_errno);
         }
 #endif /*end of CSP_ENABLE_SYNC_ALL_OPT */
@@ -22,6 +22,9 @@ int CSPU_win_release(CSPU_win_t * ug_win)
 
     CSP_CALLMPI(JUMP, PMPI_Comm_size(ug_win->user_comm, &user_nprocs));
 
+    /* Free write-combining buffers. */
+    CSPU_put_wc_destroy(ug_win);
+
     /* Free windows. */
 
     /* Free ug_win before local_ug_win, because all the incoming operations
@@ -34,6 +37,14 @@ int CSPU_win_release(CSPU_win_t * ug_win)
         CSP_DBG_PRINT("\t free ug windows\n");
         for (i = 0; i < ug_win->num_ug_wins; i++) {
             if (ug_win->ug_wins[i] && ug_win->ug_wins[i] != MPI_WIN_NULL) {
+                if (ug_win->create_flavor == MPI_WIN_FLAVOR_DYNAMIC) {
+                    mpi_errno = CSPU_dyn_pool_detach(ug_win->ug_wins[i]);
+                    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+                }
+                else if (ug_win->remap) {
+                    mpi_errno = CSPU_win_remap_detach(ug_win->remap, ug_win->ug_wins[i]);
+                    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+                }
                 CSP_CALLMPI(JUMP, PMPI_Win_free(&ug_win->ug_wins[i]));
             }
         }
@@ -41,6 +52,14 @@ int CSPU_win_release(CSPU_win_t * ug_win)
 
     if (ug_win->global_win && ug_win->global_win != MPI_WIN_NULL) {
         CSP_DBG_PRINT("\t free global window\n");
+        if (ug_win->create_flavor == MPI_WIN_FLAVOR_DYNAMIC) {
+            mpi_errno = CSPU_dyn_pool_detach(ug_win->global_win);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        }
+        else if (ug_win->remap) {
+            mpi_errno = CSPU_win_remap_detach(ug_win->remap, ug_win->global_win);
+            CSP_CHKMPIFAIL_JUMP(mpi_errno);
+        }
         CSP_CALLMPI(JUMP, PMPI_Win_free(&ug_win->global_win));
     }
 
@@ -60,6 +79,11 @@ int CSPU_win_release(CSPU_win_t * ug_win)
         CSP_CALLMPI(JUMP, PMPI_Win_free(&ug_win->local_ug_win));
     }
 
+    /* Release cached communicators, they are freed only by the last window
+     * using them. */
+    mpi_errno = CSPU_ugcomm_cache_release(ug_win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     /* Free communicators.
      * ug_win->user_comm is created by user, will be freed by user. */
     if (ug_win->local_ug_comm && ug_win->local_ug_comm != MPI_COMM_NULL
@@ -106,6 +130,8 @@ int CSPU_win_release(CSPU_win_t * ug_win)
         free(ug_win->g_ops_counts);
     if (ug_win->g_bytes_counts)
         free(ug_win->g_bytes_counts);
+    if (ug_win->g_op_latencies)
+        free(ug_win->g_op_latencies);
 #endif
 
     if (ug_win->targets) {
@@ -114,15 +140,25 @@ int CSPU_win_release(CSPU_win_t * ug_win)
                 free(ug_win->targets[i].base_g_offsets);
             if (ug_win->targets[i].g_ranks_in_ug)
                 free(ug_win->targets[i].g_ranks_in_ug);
+            if (ug_win->targets[i].g_dirty_flags)
+                free(ug_win->targets[i].g_dirty_flags);
         }
         free(ug_win->targets);
     }
+    if (ug_win->dirty_targets)
+        free(ug_win->dirty_targets);
+    if (ug_win->lockall_locked_targets)
+        free(ug_win->lockall_locked_targets);
+    if (ug_win->g_dirty_flags_in_ug)
+        free(ug_win->g_dirty_flags_in_ug);
     if (ug_win->g_ranks_in_ug)
         free(ug_win->g_ranks_in_ug);
     if (ug_win->g_win_handles)
         free(ug_win->g_win_handles);
     if (ug_win->ug_wins)
         free(ug_win->ug_wins);
+    if (ug_win->remap)
+        CSPU_win_remap_release(ug_win->remap);
 
     /* Destroy per window critical section.
      * Do nothing if it is not initialized (e.g., failure in win_allocate). */
@@ -144,12 +180,14 @@ static int issue_ghost_cmd(CSPU_win_t * ug_win)
     int mpi_errno = MPI_SUCCESS;
     CSP_cwp_pkt_t pkt;
     CSP_cwp_fnc_winfree_pkt_t *winfree_pkt = &pkt.u.fnc_winfree;
-    MPI_Request *reqs = NULL;
-    MPI_Status *stats = NULL;
+    MPI_Aint *g_params = NULL;
     int i, user_local_rank = 0;
 
-    reqs = CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Request));
-    stats = CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Status));
+    /* Ghosts cannot fetch the corresponding window without handlers so that
+     * the handle of target ghost win is sent with the command. */
+    g_params = CSP_calloc(CSP_ENV.num_g, sizeof(MPI_Aint));
+    for (i = 0; i < CSP_ENV.num_g; i++)
+        g_params[i] = (MPI_Aint) ug_win->g_win_handles[i];
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(CSP_PROC.local_comm, &user_local_rank));
 
     /* Ensure all user roots have arrived before start lock. */
@@ -159,29 +197,16 @@ static int issue_ghost_cmd(CSPU_win_t * ug_win)
     mpi_errno = CSPU_mlock_acquire(ug_win->user_root_comm);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    /* send command to root ghost. */
+    /* issue command to local ghosts. */
     CSP_cwp_init_pkt(CSP_CWP_FNC_WIN_FREE, &pkt);
     winfree_pkt->user_local_root = user_local_rank;
 
-    mpi_errno = CSPU_cwp_issue(&pkt);
+    mpi_errno = CSPU_cwp_issue_g_params(&pkt, g_params);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
 
-    /* send the handle of target ghost win.
-     * Note that ghosts cannot fetch the corresponding window without handlers
-     * so that only global communicator can be used here.*/
-    for (i = 0; i < CSP_ENV.num_g; i++) {
-        CSP_CALLMPI(JUMP, PMPI_Isend(&ug_win->g_win_handles[i], 1, MPI_UNSIGNED_LONG,
-                                     CSP_PROC.user.g_lranks[i], CSP_CWP_PARAM_TAG,
-                                     CSP_PROC.local_comm, &reqs[i]));
-    }
-
-    CSP_CALLMPI(JUMP, PMPI_Waitall(CSP_ENV.num_g, reqs, stats));
-
   fn_exit:
-    if (reqs)
-        free(reqs);
-    if (stats)
-        free(stats);
+    if (g_params)
+        free(g_params);
     return mpi_errno;
 
   fn_fail:
@@ -9,11 +9,27 @@
 #include "cspu.h"
 #include "cspu_rma_sync.h"
 
+/* Lock ghost processes for a given target in a lazy lock_all epoch.
+ * It is called on the first operation to the target (see CSPU_target_check_lazy_lock). */
+int CSPU_win_lockall_lock_target(int target_rank, CSPU_win_t * ug_win)
+{
+    int mpi_errno = MPI_SUCCESS;
+
+    CSP_DBG_PRINT(" lazy lock_all: lock target %d\n", target_rank);
+
+    mpi_errno = CSPU_win_target_lock(MPI_LOCK_SHARED, ug_win->lockall_assert, target_rank, ug_win);
+    CSP_CHKMPIFAIL_RETURN(mpi_errno);
+
+    ug_win->targets[target_rank].is_lockall_locked = 1;
+    ug_win->lockall_locked_targets[ug_win->num_lockall_locked_targets++] = target_rank;
+    return mpi_errno;
+}
+
 int MPI_Win_lock_all(int assert, MPI_Win win)
 {
     CSPU_win_t *ug_win;
     int mpi_errno = MPI_SUCCESS;
-    int user_nprocs;
+    int user_nprocs, user_rank CSP_ATTRIBUTE((unused));
     int i;
 
     /* Skip internal processing when disabled */
@@ -86,8 +102,17 @@ int MPI_Win_lock_all(int assert, MPI_Win win)
         }
         ug_win->is_self_locked = 1;
 #else
-        for (i = 0; i < user_nprocs; i++) {
-            mpi_errno = CSPU_win_target_lock(MPI_LOCK_SHARED, assert, i, ug_win);
+        /* Only record the lock intent, ghosts of a target are locked on the first
+         * operation to that target. Thus a lock_all epoch accessing only a few
+         * targets does not need nprocs * num_g lock calls. Local target is still
+         * locked here, because local load/store requires it before return. */
+        ug_win->lockall_assert = assert;
+        ug_win->num_lockall_locked_targets = 0;
+        ug_win->is_lockall_lazy = 1;
+
+        if (!ug_win->info_args.no_local_load_store) {
+            CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_win->user_comm, &user_rank));
+            mpi_errno = CSPU_win_lockall_lock_target(user_rank, ug_win);
             CSP_CHKMPIFAIL_JUMP(mpi_errno);
         }
 #endif
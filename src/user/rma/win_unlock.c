@@ -18,19 +18,30 @@ int CSPU_win_target_unlock(int target_rank, CSPU_win_t * ug_win)
     CSPU_win_target_t *target = NULL;
     int k;
     int user_rank;
+    double t_start CSP_ATTRIBUTE((unused));
 
     target = &(ug_win->targets[target_rank]);
     CSP_CALLMPI(JUMP, PMPI_Comm_rank(ug_win->user_comm, &user_rank));
 
+    CSPU_win_shm_direct_sync(ug_win);
+    mpi_errno = CSPU_put_wc_drain_target(target_rank, ug_win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     /* Unlock every ghost on every window for each target. */
     for (k = 0; k < CSP_ENV.num_g; k++) {
         int target_g_rank_in_ug = target->g_ranks_in_ug[k];
 
         CSP_DBG_PRINT(" unlock(ghost(%d), ug_win 0x%x), instead of "
                       "target rank %d\n", target_g_rank_in_ug, target->ug_win, target_rank);
+        t_start = CSPU_opload_feedback_start();
         CSP_CALLMPI(JUMP, PMPI_Win_unlock(target_g_rank_in_ug, target->ug_win));
+        CSPU_opload_feedback_update(target_g_rank_in_ug, t_start, ug_win);
     }
 
+    /* All operations on the target are completed by unlock. */
+    CSPU_target_reset_dirty(target_rank, ug_win);
+    CSPU_put_wc_complete(target_rank, ug_win);
+
     /* If target is itself, we need also release the lock of local rank  */
     if (user_rank == target_rank && ug_win->is_self_locked) {
         mpi_errno = CSPU_win_unlock_self(ug_win);
@@ -102,9 +113,14 @@ int MPI_Win_unlock(int target_rank, MPI_Win win)
     target->remote_lock_assert = 0;
 
 #ifdef CSP_ENABLE_SYNC_ALL_OPT
+    CSPU_win_shm_direct_sync(ug_win);
+    mpi_errno = CSPU_put_wc_drain_target(target_rank, ug_win);
+    CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
     CSP_DBG_PRINT(" unlock_all(ug_win 0x%x), instead of target rank %d\n",
                   target->ug_win, target_rank);
     CSP_CALLMPI(JUMP, PMPI_Win_unlock_all(target->ug_win));
+    CSPU_put_wc_complete(target_rank, ug_win);
 #else
     mpi_errno = CSPU_win_target_unlock(target_rank, ug_win);
     CSP_CHKMPIFAIL_JUMP(mpi_errno);
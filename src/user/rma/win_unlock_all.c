@@ -70,17 +70,29 @@ int MPI_Win_unlock_all(MPI_Win win)
         /* In lock-exist epoch, separate windows are bound with targets. */
 
 #ifdef CSP_ENABLE_SYNC_ALL_OPT
+        CSPU_win_shm_direct_sync(ug_win);
+        mpi_errno = CSPU_put_wc_drain_target(MPI_ANY_SOURCE, ug_win);
+        CSP_CHKMPIFAIL_JUMP(mpi_errno);
+
         for (i = 0; i < ug_win->num_ug_wins; i++) {
             CSP_DBG_PRINT(" unlock_all(ug_win 0x%x)\n", ug_win->ug_wins[i]);
             CSP_CALLMPI(JUMP, PMPI_Win_unlock_all(ug_win->ug_wins[i]));
         }
+        CSPU_put_wc_complete(MPI_ANY_SOURCE, ug_win);
 
 #else
-        for (i = 0; i < user_nprocs; i++) {
-            mpi_errno = CSPU_win_target_unlock(i, ug_win);
+        /* Only unlock the targets locked on the first operation in this epoch. */
+        for (i = 0; i < ug_win->num_lockall_locked_targets; i++) {
+            int target_rank = ug_win->lockall_locked_targets[i];
+
+            mpi_errno = CSPU_win_target_unlock(target_rank, ug_win);
             CSP_CHKMPIFAIL_JUMP(mpi_errno);
+            ug_win->targets[target_rank].is_lockall_locked = 0;
         }
+        ug_win->num_lockall_locked_targets = 0;
+        ug_win->is_lockall_lazy = 0;
 #endif
+        CSPU_win_reset_dirty_targets(ug_win);
     }
 
 #if defined(CSP_ENABLE_RUNTIME_LOAD_OPT)
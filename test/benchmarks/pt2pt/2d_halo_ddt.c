@@ -10,7 +10,9 @@
 #include <assert.h>
 #include "mpi.h"
 
-/* This benchmark evaluates 2D halo exchange with cart and derived datatype.*/
+/* This benchmark evaluates 2D halo exchange with cart and derived datatype.
+ * It also sets info hints to enable Casper message offloading, the vector
+ * datatype is committed on the ghost process at first use. */
 
 #define DEFAULT_ITERS  (1024)
 #define DEFAULT_DIM    (1024)
@@ -45,8 +47,10 @@ int main(int argc, char **argv)
     int dims[2] = { 0, 0 }, periods[2] = {
     1, 1};
     int north, south, east, west;
-    double *inbuf, *outbuf, *tmp;
-    MPI_Comm comm;
+    double *inbuf, *outbuf, *tmp, *winbuf = NULL;
+    MPI_Comm comm, shm_comm;
+    MPI_Win shm_win;
+    MPI_Aint buf_sz = 0;
     MPI_Request req[8];
     MPI_Datatype type;
 
@@ -72,17 +76,30 @@ int main(int argc, char **argv)
         }
     }
 
-    inbuf = (double *) malloc((dim + 2) * (dim + 2) * sizeof(double));
-    outbuf = (double *) malloc((dim + 2) * (dim + 2) * sizeof(double));
+    /* Allocate and register shared buffer. */
+    MPI_Info info = MPI_INFO_NULL;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, (char *) "shmbuf_regist", (char *) "true");
+
+    buf_sz = (dim + 2) * (dim + 2);
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, comm_rank, info, &shm_comm);
+    MPI_Win_allocate_shared(buf_sz * sizeof(double) * 2, 1, MPI_INFO_NULL,
+                            shm_comm, &winbuf, &shm_win);
+    MPI_Info_free(&info);
+
+    inbuf = winbuf;
+    outbuf = winbuf + buf_sz;
+    memset(winbuf, 0, buf_sz * sizeof(double) * 2);
 
     MPI_Type_vector(dim, 1, dim + 2, MPI_DOUBLE, &type);
     MPI_Type_commit(&type);
 
     MPI_Dims_create(comm_size, 2, dims);
 
-    MPI_Info info = MPI_INFO_NULL;
+    /* Enable asynchronous progress. */
     MPI_Info_create(&info);
     MPI_Info_set(info, (char *) "wildcard_used", (char *) "none");
+    MPI_Info_set(info, (char *) "datatype_used", (char *) "derived");
     MPI_Comm_set_info(MPI_COMM_WORLD, info);
     MPI_Info_free(&info);
 
@@ -147,8 +164,8 @@ int main(int argc, char **argv)
 #endif
     }
 
-    free(inbuf);
-    free(outbuf);
+    MPI_Win_free(&shm_win);
+    MPI_Comm_free(&shm_comm);
 
     MPI_Comm_free(&comm);
     MPI_Type_free(&type);
@@ -9,11 +9,16 @@
 #include <string.h>
 #include "mpi.h"
 
-/* This benchmark evaluates overhead of various communicator creation functions.*/
+/* This benchmark evaluates overhead of various communicator creation functions.
+ * With --ngroups N (N > 1), it also evaluates concurrent creation, where the
+ * processes are split into N interleaved groups and every group duplicates
+ * its own communicator at the same time, thus contending on the node-wide
+ * lock of ghost processes.*/
 
 #define DEFAULT_ITERS  (1024)
 
 static int iters = DEFAULT_ITERS;
+static int ngroups = 1;
 static MPI_Comm *comm;
 static int comm_rank, comm_size;
 static char testname[128] = { 0 };
@@ -22,6 +27,7 @@ static void usage(void)
 {
     printf("./a.out\n");
     printf("     --iters [iterations; default %d]\n", DEFAULT_ITERS);
+    printf("     --ngroups [number of concurrently creating groups; default 1]\n");
     exit(1);
 }
 
@@ -92,6 +98,31 @@ static void run_create(void)
         printf("%s comm_create: %.3f us\n", testname, 1e6 * (end - start) / iters);
 }
 
+static void run_dup_groups(void)
+{
+    double start, end, local_time, max_time;
+    int i;
+    MPI_Comm group_comm = MPI_COMM_NULL;
+
+    MPI_Comm_split(MPI_COMM_WORLD, comm_rank % ngroups, comm_rank, &group_comm);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    start = MPI_Wtime();
+    for (i = 0; i < iters; i++)
+        MPI_Comm_dup(group_comm, &comm[i]);
+    end = MPI_Wtime();
+
+    local_time = end - start;
+    MPI_Reduce(&local_time, &max_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (comm_rank == 0)
+        printf("%s comm_dup_%dgroups: %.3f us\n", testname, ngroups, 1e6 * max_time / iters);
+
+    for (i = 0; i < iters; i++)
+        MPI_Comm_free(&comm[i]);
+    MPI_Comm_free(&group_comm);
+}
+
 static void run_free(const char *creat_type)
 {
     double start, end, local_time, avg_time;
@@ -126,6 +157,11 @@ int main(int argc, char **argv)
             ++argv;
             iters = atoi(*argv);
         }
+        else if (!strcmp(*argv, "--ngroups")) {
+            --argc;
+            ++argv;
+            ngroups = atoi(*argv);
+        }
         else {
             usage();
         }
@@ -156,6 +192,9 @@ int main(int argc, char **argv)
     run_dup();
     run_free("comm_dup");
 
+    if (ngroups > 1 && ngroups <= comm_size)
+        run_dup_groups();
+
     free(comm);
 
     MPI_Finalize();
@@ -0,0 +1,164 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2017 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mpi.h"
+
+/* This benchmark evaluates the posting time of offloaded MPI_Isend and
+ * MPI_Irecv against the number of registered shared buffers, which includes
+ * the translation of user buffer address. Every process registers 1, 2, 4 ...
+ * max_nbufs shared buffers, and posts a batch of messages either on the same
+ * buffer or rotating over all registered buffers. The first half of processes
+ * send to the second half.*/
+
+#define DEFAULT_ITERS  (100)
+#define DEFAULT_MAX_NBUFS  (1024)
+#define NREQS  (64)
+#define BUF_SIZE  (64)
+#define BUF_STRIDE  (7)         /* distance of buffers used by consecutive messages */
+
+static int iters = DEFAULT_ITERS;
+static int max_nbufs = DEFAULT_MAX_NBUFS;
+static MPI_Comm comm_world = MPI_COMM_NULL, shm_comm = MPI_COMM_NULL;
+static MPI_Win *wins = NULL;
+static int **bufs = NULL;
+static int nbufs = 0;
+static int comm_rank, comm_size;
+static char testname[128] = { 0 };
+
+static void usage(void)
+{
+    printf("./a.out\n");
+    printf("     --iters [iterations; default %d]\n", DEFAULT_ITERS);
+    printf("     --max_nbufs [maximum number of registered buffers; default %d]\n",
+           DEFAULT_MAX_NBUFS);
+    exit(1);
+}
+
+static void set_testname(void)
+{
+    char *val = getenv("TEST_NAME");
+    if (val && strlen(val) > 0) {
+        strncpy(testname, val, 128);
+    }
+}
+
+static void regist_bufs(int num)
+{
+    for (; nbufs < num; nbufs++)
+        MPI_Win_allocate_shared(sizeof(int) * BUF_SIZE, sizeof(int), MPI_INFO_NULL, shm_comm,
+                                &bufs[nbufs], &wins[nbufs]);
+}
+
+static double run_post(int peer, int is_sender, int rotate)
+{
+    double start, post_time = 0.0, sum_time = 0.0;
+    MPI_Request reqs[NREQS];
+    int i, x, idx = 0;
+
+    for (x = 0; x < iters; x++) {
+        start = MPI_Wtime();
+        for (i = 0; i < NREQS; i++) {
+            if (rotate)
+                idx = (idx + BUF_STRIDE) % nbufs;
+            if (is_sender)
+                MPI_Isend(bufs[idx], BUF_SIZE, MPI_INT, peer, i, comm_world, &reqs[i]);
+            else
+                MPI_Irecv(bufs[idx], BUF_SIZE, MPI_INT, peer, i, comm_world, &reqs[i]);
+        }
+        post_time += MPI_Wtime() - start;
+        MPI_Waitall(NREQS, reqs, MPI_STATUSES_IGNORE);
+    }
+
+    post_time /= (iters * NREQS);
+    MPI_Reduce(&post_time, &sum_time, 1, MPI_DOUBLE, MPI_SUM, 0, comm_world);
+    return sum_time / comm_size;
+}
+
+int main(int argc, char **argv)
+{
+    int i, num, peer, is_sender;
+    double same_time, rotate_time;
+    MPI_Info info = MPI_INFO_NULL;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &comm_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--iters")) {
+            if (++i >= argc)
+                usage();
+            iters = atoi(argv[i]);
+        }
+        else if (!strcmp(argv[i], "--max_nbufs")) {
+            if (++i >= argc)
+                usage();
+            max_nbufs = atoi(argv[i]);
+        }
+        else {
+            usage();
+        }
+    }
+
+    if (comm_size < 2 || comm_size % 2) {
+        if (comm_rank == 0)
+            fprintf(stderr, "Please run using power of two number of processes\n");
+        goto exit;
+    }
+
+    set_testname();
+
+    MPI_Info_create(&info);
+    /* Register as shared buffer in Casper. */
+    MPI_Info_set(info, (char *) "shmbuf_regist", (char *) "true");
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, comm_rank, info, &shm_comm);
+
+    MPI_Info_set(info, (char *) "shmbuf_regist", (char *) "false");
+    MPI_Info_set(info, (char *) "wildcard_used", (char *) "none");
+    MPI_Info_set(info, (char *) "datatype_used", (char *) "predefined");
+    MPI_Info_set(info, (char *) "offload_min_msgsz", (char *) "0");
+    MPI_Comm_dup_with_info(MPI_COMM_WORLD, info, &comm_world);
+
+    wins = calloc(max_nbufs, sizeof(MPI_Win));
+    bufs = calloc(max_nbufs, sizeof(int *));
+
+    is_sender = comm_rank < comm_size / 2;
+    peer = is_sender ? comm_rank + comm_size / 2 : comm_rank - comm_size / 2;
+
+    if (comm_rank == 0)
+        printf("%s %s, %s, %s\n", testname, "# nbufs", "same_buf post (us)",
+               "rotate_buf post (us)");
+
+    for (num = 1; num <= max_nbufs; num *= 2) {
+        regist_bufs(num);
+
+        same_time = run_post(peer, is_sender, 0);
+        rotate_time = run_post(peer, is_sender, 1);
+
+        if (comm_rank == 0)
+            printf("%s %d, %.3f, %.3f\n", testname, nbufs, 1e6 * same_time, 1e6 * rotate_time);
+    }
+
+  exit:
+    for (i = 0; i < nbufs; i++)
+        MPI_Win_free(&wins[i]);
+    if (wins)
+        free(wins);
+    if (bufs)
+        free(bufs);
+    if (info != MPI_INFO_NULL)
+        MPI_Info_free(&info);
+    if (comm_world != MPI_COMM_NULL)
+        MPI_Comm_free(&comm_world);
+    if (shm_comm != MPI_COMM_NULL)
+        MPI_Comm_free(&shm_comm);
+
+    MPI_Finalize();
+    return 0;
+}
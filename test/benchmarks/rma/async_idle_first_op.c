@@ -0,0 +1,134 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <mpi.h>
+
+/* This benchmark evaluates the latency of the first operation after an idle
+ * period using 2 processes, which reflects the wakeup delay of idle backoff on
+ * ghost processes (see CSP_GHOST_IDLE_SLEEP). For every idle time, both
+ * processes stay idle (busy wait without MPI call), then rank 0 performs
+ * accumulate-flush to rank 1 for NOP times while rank 1 is still computing.
+ * The time of the first accumulate-flush and the average time of following
+ * ones are reported. Run with different CSP_GHOST_IDLE_SLEEP to compare. */
+
+#define SIZE 4
+#define DEFAULT_MIN_IDLE 1      /* us */
+#define DEFAULT_MAX_IDLE 100000 /* us */
+#define COMP_TIME 1000  /* us, computing on rank 1 after idle */
+#define NOP 10
+#define ITER 10
+
+#ifdef ENABLE_CSP
+#include <casper.h>
+int CSP_NUM_G = 1;
+#endif
+
+MPI_Win win = MPI_WIN_NULL;
+double *winbuf = NULL, locbuf[SIZE];
+int rank, nprocs;
+
+static void usleep_by_count(unsigned long us)
+{
+    double start = MPI_Wtime() * 1000 * 1000;
+    while (MPI_Wtime() * 1000 * 1000 - start < us);
+    return;
+}
+
+static void run_test(int idle_time)
+{
+    int i, x;
+    double t0, t_first = 0.0, t_rest = 0.0;
+
+    for (x = 0; x < ITER; x++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        usleep_by_count(idle_time);
+
+        if (rank == 0) {
+            t0 = MPI_Wtime();
+            MPI_Accumulate(locbuf, SIZE, MPI_DOUBLE, 1, 0, SIZE, MPI_DOUBLE, MPI_SUM, win);
+            MPI_Win_flush(1, win);
+            t_first += MPI_Wtime() - t0;
+
+            t0 = MPI_Wtime();
+            for (i = 1; i < NOP; i++) {
+                MPI_Accumulate(locbuf, SIZE, MPI_DOUBLE, 1, 0, SIZE, MPI_DOUBLE, MPI_SUM, win);
+                MPI_Win_flush(1, win);
+            }
+            t_rest += MPI_Wtime() - t0;
+        }
+        else {
+            /* Operations are handled only by asynchronous progress. */
+            usleep_by_count(COMP_TIME);
+        }
+    }
+
+    if (rank == 0) {
+        fprintf(stdout, "%s: idle_time %d nprocs %d first_op %.2lf following_op %.2lf\n",
+#ifdef ENABLE_CSP
+                "casper",
+#else
+                "orig",
+#endif
+                idle_time, nprocs, t_first / ITER * 1000 * 1000,
+                t_rest / (ITER * (NOP - 1)) * 1000 * 1000);
+        fflush(stdout);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int i, time;
+    int min_time = DEFAULT_MIN_IDLE, max_time = DEFAULT_MAX_IDLE, iter_time = 10;
+    MPI_Info win_info = MPI_INFO_NULL;
+
+    MPI_Init(&argc, &argv);
+
+    if (argc >= 4) {
+        min_time = atoi(argv[1]);
+        max_time = atoi(argv[2]);
+        iter_time = atoi(argv[3]);
+    }
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#ifdef ENABLE_CSP
+    CSP_ghost_size(&CSP_NUM_G);
+#endif
+
+    if (2 != nprocs) {
+        if (rank == 0)
+            fprintf(stderr, "Please run using 2 processes\n");
+        goto exit;
+    }
+
+    for (i = 0; i < SIZE; i++)
+        locbuf[i] = (i + 1) * 0.5;
+
+    MPI_Info_create(&win_info);
+    MPI_Info_set(win_info, (char *) "epochs_used", (char *) "lockall");
+
+    MPI_Win_allocate(sizeof(double) * SIZE, sizeof(double), win_info, MPI_COMM_WORLD,
+                     &winbuf, &win);
+    MPI_Win_lock_all(0, win);
+
+    for (time = min_time; time <= max_time; time *= iter_time)
+        run_test(time);
+
+    MPI_Win_unlock_all(win);
+
+  exit:
+    if (win != MPI_WIN_NULL)
+        MPI_Win_free(&win);
+    if (win_info != MPI_INFO_NULL)
+        MPI_Info_free(&win_info);
+
+    MPI_Finalize();
+
+    return 0;
+}
@@ -0,0 +1,233 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <mpi.h>
+
+/* This benchmark compares asynchronous progress on window created by
+ * MPI_Win_create with the window allocated by MPI_Win_allocate using 2 processes.
+ * Rank 0 performs lockall-accumulate-flush-unlockall, and rank 1 performs
+ * compute(busy wait)-test(poll MPI progress). The window creation time is also
+ * reported, which includes remapping the user buffer in Casper
+ * (CSP_WIN_CREATE_REMAP is set to on if not specified).*/
+
+#define SIZE 4
+#define SLEEP_TIME 100  //us
+
+//#define DEBUG
+#define ITER 10000
+#define WIN_ITER 10
+
+#ifdef DEBUG
+#define debug_printf(str,...) {fprintf(stdout, str, ## __VA_ARGS__);fflush(stdout);}
+#else
+#define debug_printf(str,...) {}
+#endif
+
+#ifdef ENABLE_CSP
+#include <casper.h>
+int CSP_NUM_G = 1;
+#endif
+
+MPI_Win win;
+double *winbuf, locbuf[SIZE];
+int rank, nprocs;
+int NOP = 1;
+
+static void usleep_by_count(unsigned long us)
+{
+    double start = MPI_Wtime() * 1000 * 1000;
+    while (MPI_Wtime() * 1000 * 1000 - start < us);
+    return;
+}
+
+static int create_win(int is_create, MPI_Info win_info)
+{
+    if (is_create) {
+        /* Only a buffer exclusively owning its pages can be remapped, thus
+         * allocate a whole page. */
+        long page_size = sysconf(_SC_PAGESIZE);
+        if (posix_memalign((void **) &winbuf, page_size, page_size))
+            return 1;
+        MPI_Win_create(winbuf, page_size, sizeof(double), win_info, MPI_COMM_WORLD, &win);
+    }
+    else {
+        MPI_Win_allocate(sizeof(double) * SIZE, sizeof(double), win_info, MPI_COMM_WORLD,
+                         &winbuf, &win);
+    }
+    return 0;
+}
+
+static void free_win(int is_create)
+{
+    MPI_Win_free(&win);
+    if (is_create)
+        free(winbuf);
+}
+
+static int run_test(int time, const char *win_name)
+{
+    int i, x, errs = 0;
+    int dst, src;
+    double t0, t_total = 0.0;
+    MPI_Request request;
+    MPI_Status status;
+    int buf[1];
+    int flag = 0;
+
+    if (rank == 0) {
+        dst = 1;
+        buf[0] = 99;
+        MPI_Win_lock_all(0, win);
+    }
+    else {
+        src = 0;
+        buf[0] = 0;
+        MPI_Irecv(buf, 1, MPI_INT, src, 0, MPI_COMM_WORLD, &request);
+    }
+
+    t0 = MPI_Wtime();
+    for (x = 0; x < ITER; x++) {
+
+        // rank 0 does RMA communication
+        if (rank == 0) {
+            for (i = 0; i < NOP; i++)
+                MPI_Accumulate(&locbuf[0], 1, MPI_DOUBLE, dst, 0, 1, MPI_DOUBLE, MPI_SUM, win);
+            MPI_Win_flush_all(win);
+        }
+        // rank 1 does sleep and test
+        else {
+            usleep_by_count(time);
+            MPI_Test(&request, &flag, &status);
+        }
+    }
+
+    t_total += MPI_Wtime() - t0;
+    t_total /= ITER;
+
+    if (rank == 0) {
+        MPI_Win_unlock_all(win);
+        MPI_Send(buf, 1, MPI_INT, dst, 0, MPI_COMM_WORLD);
+    }
+    else {
+        if (!flag)
+            MPI_Wait(&request, &status);
+        if (buf[0] != 99) {
+            fprintf(stderr, "[%d]error: recv data %d != %d\n", rank, buf[0], 99);
+            return errs;
+        }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    if (rank == 0) {
+#ifdef ENABLE_CSP
+        fprintf(stdout,
+                "casper: %s comp_size %d num_op %d nprocs %d total_time %.2lf\n",
+                win_name, time, NOP, nprocs, t_total * 1000 * 1000);
+#else
+        fprintf(stdout,
+                "orig: %s comp_size %d num_op %d nprocs %d total_time %.2lf\n",
+                win_name, time, NOP, nprocs, t_total * 1000 * 1000);
+#endif
+    }
+
+    return errs;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, x, is_create;
+    int min_time = SLEEP_TIME, max_time = SLEEP_TIME, iter_time = 2, time;
+    MPI_Info win_info = MPI_INFO_NULL;
+    double t0, t_win = 0.0;
+    const char *win_names[2] = { "win_allocate", "win_create" };
+
+#ifdef ENABLE_CSP
+    setenv("CSP_WIN_CREATE_REMAP", "on", 0);
+#endif
+
+    MPI_Init(&argc, &argv);
+    debug_printf("[%d]init done\n", rank);
+
+    if (argc >= 4) {
+        min_time = atoi(argv[1]);
+        max_time = atoi(argv[2]);
+        iter_time = atoi(argv[3]);
+    }
+    if (argc >= 5) {
+        NOP = atoi(argv[4]);
+    }
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+#ifdef ENABLE_CSP
+    CSP_ghost_size(&CSP_NUM_G);
+#endif
+
+    debug_printf("[%d]comm_size done\n", rank);
+
+    if (2 != nprocs) {
+        if (rank == 0)
+            fprintf(stderr, "Please run using 2 processes\n");
+        goto exit;
+    }
+
+    for (i = 0; i < SIZE; i++) {
+        locbuf[i] = (i + 1) * 0.5;
+    }
+
+    MPI_Info_create(&win_info);
+    MPI_Info_set(win_info, (char *) "epochs_used", (char *) "lockall");
+
+    for (is_create = 0; is_create < 2; is_create++) {
+        /* window creation overhead */
+        t_win = 0.0;
+        for (x = 0; x < WIN_ITER; x++) {
+            MPI_Barrier(MPI_COMM_WORLD);
+            t0 = MPI_Wtime();
+            if (create_win(is_create, win_info))
+                goto exit;
+            t_win += MPI_Wtime() - t0;
+            if (x < WIN_ITER - 1)
+                free_win(is_create);
+        }
+
+        if (rank == 0) {
+            fprintf(stdout, "%s: %s nprocs %d create_time %.2lf\n",
+#ifdef ENABLE_CSP
+                    "casper",
+#else
+                    "orig",
+#endif
+                    win_names[is_create], nprocs, t_win / WIN_ITER * 1000 * 1000);
+        }
+
+        /* reset window */
+        MPI_Win_lock_all(0, win);
+        winbuf[0] = 0.0;
+        MPI_Win_unlock_all(win);
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        debug_printf("[%d]%s done\n", rank, win_names[is_create]);
+
+        for (time = min_time; time <= max_time; time *= iter_time) {
+            run_test(time, win_names[is_create]);
+        }
+
+        free_win(is_create);
+    }
+
+  exit:
+    if (win_info != MPI_INFO_NULL)
+        MPI_Info_free(&win_info);
+
+    MPI_Finalize();
+
+    return 0;
+}
@@ -10,7 +10,10 @@
 #include <mpi.h>
 
 /* This benchmark measures the overhead of win_allocate with different
- * epochs_used info.*/
+ * epochs_used info, on COMM_WORLD and on a duplicated communicator. The
+ * duplicated communicator does not take the fast path of COMM_WORLD, thus
+ * shows the cost of internal communicator creation (only the first window
+ * creates them when they are cached in CASPER).*/
 
 #define ITER 100
 int rank, nprocs;
@@ -18,7 +21,10 @@ double *winbuf[ITER];
 MPI_Win win[ITER];
 int size = 16;
 
-static void run_test(const char *info)
+#define NUM_INFOS 5
+const char *infos[NUM_INFOS] = { "", "lock", "lockall", "fence", "pscw" };
+
+static void run_test(const char *info, MPI_Comm comm, const char *comm_name)
 {
     int x;
     double t0, t1, t_alloc, t_free;
@@ -31,7 +37,7 @@ static void run_test(const char *info)
     for (x = 0; x < ITER; x++) {
         /* size in byte */
         MPI_Win_allocate(sizeof(double) * size, sizeof(double), win_info,
-                         MPI_COMM_WORLD, &winbuf[x], &win[x]);
+                         comm, &winbuf[x], &win[x]);
     }
     t1 = MPI_Wtime();
     t_alloc = (t1 - t0) / ITER;
@@ -42,8 +48,8 @@ static void run_test(const char *info)
     t_free = (MPI_Wtime() - t1) / ITER;
 
     if (rank == 0)
-        fprintf(stdout, "nproc %d size %d info %s allocate %lf free %lf\n", nprocs, size, info,
-                t_alloc, t_free);
+        fprintf(stdout, "nproc %d size %d comm %s info %s allocate %lf free %lf\n", nprocs,
+                size, comm_name, info, t_alloc, t_free);
 
     if (win_info != MPI_INFO_NULL)
         MPI_Info_free(&win_info);
@@ -51,6 +57,9 @@ static void run_test(const char *info)
 
 int main(int argc, char *argv[])
 {
+    MPI_Comm dup_comm = MPI_COMM_NULL;
+    int i;
+
     MPI_Init(&argc, &argv);
 
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
@@ -70,20 +79,17 @@ int main(int argc, char *argv[])
         goto exit;
     }
 
-    MPI_Barrier(MPI_COMM_WORLD);
-    run_test("");
+    MPI_Comm_dup(MPI_COMM_WORLD, &dup_comm);
 
-    MPI_Barrier(MPI_COMM_WORLD);
-    run_test("lock");
+    for (i = 0; i < NUM_INFOS; i++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        run_test(infos[i], MPI_COMM_WORLD, "world");
 
-    MPI_Barrier(MPI_COMM_WORLD);
-    run_test("lockall");
-
-    MPI_Barrier(MPI_COMM_WORLD);
-    run_test("fence");
+        MPI_Barrier(MPI_COMM_WORLD);
+        run_test(infos[i], dup_comm, "dup");
+    }
 
-    MPI_Barrier(MPI_COMM_WORLD);
-    run_test("pscw");
+    MPI_Comm_free(&dup_comm);
 
   exit:
     MPI_Finalize();
@@ -0,0 +1,180 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <mpi.h>
+#include "ctest.h"
+
+/*
+ * This test checks fetch_and_op and compare_and_swap on a shared counter with
+ * shm_atomics and accumulate_ops=same_op hints. Every process updates the counter
+ * located on the root of its node, thus all atomic operations are intra-node.
+ */
+
+#define NUM_OPS 100
+#define CHECK
+#define OUTPUT_FAIL_DETAIL
+
+long *winbuf = NULL;
+long *results = NULL;
+int rank, nprocs, local_rank, local_nprocs, root_rank;
+MPI_Win win = MPI_WIN_NULL;
+MPI_Comm local_comm = MPI_COMM_NULL;
+
+static void reset_winbuf(void)
+{
+    MPI_Win_lock(MPI_LOCK_EXCLUSIVE, rank, 0, win);
+    winbuf[0] = 0;
+    winbuf[1] = 0;
+    MPI_Win_unlock(rank, win);
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+static int compare_long(const void *a, const void *b)
+{
+    long x = *(const long *) a, y = *(const long *) b;
+    return (x > y) - (x < y);
+}
+
+/* Every fetched value must be unique and in [0, NUM_OPS * local_nprocs). */
+static int check_results(long *all_results)
+{
+    int i, errs = 0;
+
+    qsort(all_results, NUM_OPS * local_nprocs, sizeof(long), compare_long);
+    for (i = 0; i < NUM_OPS * local_nprocs; i++) {
+        if (all_results[i] != i) {
+            fprintf(stderr, "[%d] all_results[%d] %ld != %d\n", rank, i, all_results[i], i);
+            errs++;
+        }
+    }
+    return errs;
+}
+
+/* Fetch and increment a counter (i.e., NWChem nxtval). */
+static int run_test1(void)
+{
+    int i, errs = 0, errs_total = 0;
+    long one = 1;
+    long *all_results = NULL;
+
+    reset_winbuf();
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+    for (i = 0; i < NUM_OPS; i++) {
+        MPI_Fetch_and_op(&one, &results[i], MPI_LONG, root_rank, 0, MPI_SUM, win);
+        MPI_Win_flush(root_rank, win);
+    }
+    MPI_Win_unlock_all(win);
+
+    if (local_rank == 0)
+        all_results = calloc(NUM_OPS * local_nprocs, sizeof(long));
+    MPI_Gather(results, NUM_OPS, MPI_LONG, all_results, NUM_OPS, MPI_LONG, 0, local_comm);
+
+    if (local_rank == 0) {
+        errs += check_results(all_results);
+        free(all_results);
+    }
+
+    MPI_Allreduce(&errs, &errs_total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return errs_total;
+}
+
+/* Increment a counter by compare_and_swap loop. */
+static int run_test2(void)
+{
+    int i, errs = 0, errs_total = 0;
+    long *all_results = NULL;
+
+    reset_winbuf();
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+    for (i = 0; i < NUM_OPS; i++) {
+        long old = 0, new = 1, res = -1;
+
+        while (1) {
+            MPI_Compare_and_swap(&new, &old, &res, MPI_LONG, root_rank, 1, win);
+            MPI_Win_flush(root_rank, win);
+            if (res == old)
+                break;
+            old = res;
+            new = old + 1;
+        }
+        results[i] = old;
+    }
+    MPI_Win_unlock_all(win);
+
+    if (local_rank == 0)
+        all_results = calloc(NUM_OPS * local_nprocs, sizeof(long));
+    MPI_Gather(results, NUM_OPS, MPI_LONG, all_results, NUM_OPS, MPI_LONG, 0, local_comm);
+
+    if (local_rank == 0) {
+        errs += check_results(all_results);
+        free(all_results);
+    }
+
+    MPI_Allreduce(&errs, &errs_total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return errs_total;
+}
+
+int main(int argc, char *argv[])
+{
+    int errs = 0;
+    MPI_Info info = MPI_INFO_NULL;
+
+    MPI_Init(&argc, &argv);
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (nprocs < 2) {
+        fprintf(stderr, "Please run using at least 2 processes\n");
+        goto exit;
+    }
+
+    /* The counter is located on the root of each node. */
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &local_comm);
+    MPI_Comm_rank(local_comm, &local_rank);
+    MPI_Comm_size(local_comm, &local_nprocs);
+    root_rank = rank;
+    MPI_Bcast(&root_rank, 1, MPI_INT, 0, local_comm);
+
+    results = calloc(NUM_OPS, sizeof(long));
+
+    MPI_Info_create(&info);
+    MPI_Info_set(info, (char *) "accumulate_ops", (char *) "same_op");
+    MPI_Info_set(info, (char *) "shm_atomics", (char *) "true");
+
+    MPI_Win_allocate(sizeof(long) * 2, sizeof(long), info, MPI_COMM_WORLD, &winbuf, &win);
+
+    errs = run_test1();
+    if (errs)
+        goto exit;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    errs = run_test2();
+    if (errs)
+        goto exit;
+
+  exit:
+    if (rank == 0)
+        CTEST_report_result(errs);
+
+    if (info != MPI_INFO_NULL)
+        MPI_Info_free(&info);
+    if (win != MPI_WIN_NULL)
+        MPI_Win_free(&win);
+    if (local_comm != MPI_COMM_NULL)
+        MPI_Comm_free(&local_comm);
+    if (results)
+        free(results);
+
+    MPI_Finalize();
+
+    return 0;
+}
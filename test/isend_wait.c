@@ -13,8 +13,19 @@
 
 /*
  * This test checks single-way isend and irecv with wait.
+ * With USE_EAGER, the send buffer is not registered and messages are copied
+ * into shared memory by Casper (CSP_OFFLOAD_EAGER_MSGSZ), thus the sender
+ * overwrites the buffer immediately after wait. USE_PIPELINE is similar, but
+ * every message is split into chunks staged through bounce buffers
+ * (CSP_OFFLOAD_PIPELINE_CHUNKSZ). With USE_RECV_LARGER, the receive count is
+ * larger than the send count, and the message size is a multiple of the chunk
+ * size, thus the receiver ghost ends at the sender's empty last chunk.
  */
 
+#if defined(USE_EAGER) || defined(USE_PIPELINE)
+#define USE_UNREGIST_SBUF
+#endif
+
 #define NUM_OPS 10
 #ifdef TEST_LMSG
 #define COUNT 10000     /* count of double */
@@ -22,6 +33,12 @@
 #define COUNT 100       /* count of double */
 #endif
 
+#ifdef USE_RECV_LARGER
+#define RECV_COUNT (COUNT + COUNT / 2)
+#else
+#define RECV_COUNT COUNT
+#endif
+
 double *sbuf = NULL, *rbuf = NULL;
 int rank, nprocs;
 MPI_Win sbuf_win = MPI_WIN_NULL, rbuf_win = MPI_WIN_NULL;
@@ -77,7 +94,7 @@ static int run_test(void)
                 /* tag is ignored */
                 MPI_Irecv(&rbuf[i * COUNT], COUNT, MPI_DOUBLE, MPI_ANY_SOURCE, 0, comm_world, &req);
 #else
-                MPI_Irecv(&rbuf[i * COUNT], COUNT, MPI_DOUBLE, peer, i, comm_world, &req);
+                MPI_Irecv(&rbuf[i * COUNT], RECV_COUNT, MPI_DOUBLE, peer, i, comm_world, &req);
 #endif
                 stat.MPI_ERROR = MPI_SUCCESS;
                 MPI_Wait(&req, &stat);
@@ -105,7 +122,15 @@ static int run_test(void)
                 MPI_Isend(&sbuf[i * COUNT], COUNT, MPI_DOUBLE, peer, i, comm_world, &req);
 #endif
                 MPI_Wait(&req, &stat);
+#ifdef USE_UNREGIST_SBUF
+                for (c = 0; c < COUNT; c++)
+                    sbuf[i * COUNT + c] = -1.0;
+#endif
             }
+#ifdef USE_UNREGIST_SBUF
+            for (c = 0; c < NUM_OPS * COUNT; c++)
+                sbuf[c] = 1.0 * c + rank;
+#endif
         }
     }
 
@@ -119,6 +144,18 @@ int main(int argc, char *argv[])
     MPI_Info info = MPI_INFO_NULL;
     MPI_Comm shm_comm = MPI_COMM_NULL;
 
+#ifdef USE_EAGER
+    /* Enable eager copy if it is not set. */
+    setenv("CSP_OFFLOAD_EAGER_MSGSZ", "65536", 0);
+#endif
+#if defined(USE_PIPELINE) && defined(USE_RECV_LARGER)
+    /* Every message is exactly 5 chunks. */
+    setenv("CSP_OFFLOAD_PIPELINE_CHUNKSZ", "16000", 0);
+#elif defined(USE_PIPELINE)
+    /* Enable pipelining with chunks smaller than a message if it is not set. */
+    setenv("CSP_OFFLOAD_PIPELINE_CHUNKSZ", "16384", 0);
+#endif
+
     MPI_Init(&argc, &argv);
 
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
@@ -135,10 +172,15 @@ int main(int argc, char *argv[])
     MPI_Info_set(info, (char *) "shmbuf_regist", (char *) "true");
     MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, info, &shm_comm);
 
+#ifdef USE_UNREGIST_SBUF
+    sbuf = malloc(sizeof(double) * NUM_OPS * COUNT);
+#else
     MPI_Win_allocate_shared(sizeof(double) * NUM_OPS * COUNT, sizeof(double),
                             MPI_INFO_NULL, shm_comm, &sbuf, &sbuf_win);
-    MPI_Win_allocate_shared(sizeof(double) * NUM_OPS * COUNT, sizeof(double),
-                            MPI_INFO_NULL, shm_comm, &rbuf, &rbuf_win);
+#endif
+    /* The last receive may exceed the messages. */
+    MPI_Win_allocate_shared(sizeof(double) * (NUM_OPS * COUNT + RECV_COUNT - COUNT),
+                            sizeof(double), MPI_INFO_NULL, shm_comm, &rbuf, &rbuf_win);
 
     for (i = 0; i < NUM_OPS * COUNT; i++) {
         sbuf[i] = 1.0 * i + rank;
@@ -163,7 +205,7 @@ int main(int argc, char *argv[])
 #   endif
 #endif
 
-#ifdef USE_OFFLOAD_MIN_MSGSZ
+#if defined(USE_OFFLOAD_MIN_MSGSZ) || defined(USE_EAGER)
     if (info != MPI_INFO_NULL)
         MPI_Info_set(info, (char *) "offload_min_msgsz", (char *) "1");
 #endif
@@ -190,6 +232,10 @@ int main(int argc, char *argv[])
         MPI_Info_free(&info);
     if (sbuf_win != MPI_WIN_NULL)
         MPI_Win_free(&sbuf_win);
+#ifdef USE_UNREGIST_SBUF
+    if (sbuf)
+        free(sbuf);
+#endif
     if (rbuf_win != MPI_WIN_NULL)
         MPI_Win_free(&rbuf_win);
     if (shm_comm != MPI_COMM_NULL)
@@ -0,0 +1,183 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mpi.h>
+#include "ctest.h"
+
+/*
+ * This test checks round-trip isend and irecv with derived datatypes
+ * (datatype_used=derived). Every iteration creates vector, subarray and
+ * nested struct datatypes, exchanges a column of a 2D array with each of them,
+ * and frees them at the end (or before the messages complete in odd
+ * iterations), thus the datatype handles may be reused by following iterations.
+ */
+
+#define DIM 16  /* DIM x DIM array of double */
+#define NUM_TYPES 3
+
+double *sbuf = NULL, *rbuf = NULL;
+int rank, nprocs;
+MPI_Win sbuf_win = MPI_WIN_NULL, rbuf_win = MPI_WIN_NULL;
+MPI_Comm comm_world = MPI_COMM_NULL;
+int ITER = 10;
+
+#define ind(x,y)  ((x) * DIM + (y))
+
+/* Create datatypes selecting column col, col + 1 and col + 2 of the array
+ * respectively. */
+static void create_types(int col, MPI_Datatype types[NUM_TYPES])
+{
+    int sizes[2] = { DIM, DIM }, subsizes[2] = { DIM, 1 }, starts[2] = { 0, 0 };
+    int blens[2] = { 1, DIM - 1 };
+    MPI_Aint displs[2] = { 0, sizeof(double) * DIM };
+    MPI_Datatype elem_type = MPI_DATATYPE_NULL, row_type = MPI_DATATYPE_NULL;
+    MPI_Datatype struct_types[2];
+
+    MPI_Type_vector(DIM, 1, DIM, MPI_DOUBLE, &types[0]);
+
+    starts[1] = col + 1;
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C, MPI_DOUBLE, &types[1]);
+
+    /* first row by MPI_DOUBLE, other rows by a nested resized datatype. */
+    MPI_Type_contiguous(1, MPI_DOUBLE, &elem_type);
+    MPI_Type_create_resized(elem_type, 0, sizeof(double) * DIM, &row_type);
+    struct_types[0] = MPI_DOUBLE;
+    struct_types[1] = row_type;
+    MPI_Type_create_struct(2, blens, displs, struct_types, &types[2]);
+
+    /* Inner datatypes can be freed before use. */
+    MPI_Type_free(&elem_type);
+    MPI_Type_free(&row_type);
+
+    MPI_Type_commit(&types[0]);
+    MPI_Type_commit(&types[1]);
+    MPI_Type_commit(&types[2]);
+}
+
+static int check_rbuf(int peer, int col, int x)
+{
+    int r, c, errs = 0;
+
+    for (r = 0; r < DIM; r++) {
+        for (c = 0; c < DIM; c++) {
+            double exp = -1.0;
+            if (c >= col && c < col + NUM_TYPES)
+                exp = 1.0 * ind(r, c) + peer + x;
+
+            if (CTEST_double_diff(rbuf[ind(r, c)], exp)) {
+                fprintf(stderr, "[%d] iter %d rbuf[%d][%d] %.1lf != %.1lf\n",
+                        rank, x, r, c, rbuf[ind(r, c)], exp);
+                fflush(stderr);
+                errs++;
+            }
+        }
+    }
+    return errs;
+}
+
+static int run_test(void)
+{
+    int i, x, errs = 0, errs_total = 0;
+    int peer, col;
+    MPI_Request reqs[NUM_TYPES * 2];
+    MPI_Datatype types[NUM_TYPES];
+
+    if (rank % 2)
+        peer = (rank - 1 + nprocs) % nprocs;
+    else
+        peer = (rank + 1) % nprocs;
+
+    for (x = 0; x < ITER; x++) {
+        col = x % (DIM - NUM_TYPES);
+
+        for (i = 0; i < DIM * DIM; i++) {
+            sbuf[i] = 1.0 * i + rank + x;
+            rbuf[i] = -1.0;
+        }
+        create_types(col, types);
+
+        MPI_Irecv(&rbuf[col], 1, types[0], peer, 0, comm_world, &reqs[0]);
+        MPI_Irecv(rbuf, 1, types[1], peer, 1, comm_world, &reqs[1]);
+        MPI_Irecv(&rbuf[col + 2], 1, types[2], peer, 2, comm_world, &reqs[2]);
+
+        MPI_Isend(&sbuf[col], 1, types[0], peer, 0, comm_world, &reqs[3]);
+        MPI_Isend(sbuf, 1, types[1], peer, 1, comm_world, &reqs[4]);
+        MPI_Isend(&sbuf[col + 2], 1, types[2], peer, 2, comm_world, &reqs[5]);
+
+        /* Datatypes can be freed while the messages are still outstanding. */
+        for (i = 0; x % 2 && i < NUM_TYPES; i++)
+            MPI_Type_free(&types[i]);
+
+        MPI_Waitall(NUM_TYPES * 2, reqs, MPI_STATUSES_IGNORE);
+
+        errs += check_rbuf(peer, col, x);
+
+        for (i = 0; !(x % 2) && i < NUM_TYPES; i++)
+            MPI_Type_free(&types[i]);
+    }
+
+    MPI_Allreduce(&errs, &errs_total, 1, MPI_INT, MPI_SUM, comm_world);
+    return errs_total;
+}
+
+int main(int argc, char *argv[])
+{
+    int errs = 0;
+    MPI_Info info = MPI_INFO_NULL;
+    MPI_Comm shm_comm = MPI_COMM_NULL;
+
+    MPI_Init(&argc, &argv);
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (nprocs < 2 || nprocs % 2) {
+        fprintf(stderr, "Please run using power of two number of processes\n");
+        goto exit;
+    }
+
+    MPI_Info_create(&info);
+
+    /* Register as shared buffer in Casper. */
+    MPI_Info_set(info, (char *) "shmbuf_regist", (char *) "true");
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, info, &shm_comm);
+
+    MPI_Win_allocate_shared(sizeof(double) * DIM * DIM, sizeof(double),
+                            MPI_INFO_NULL, shm_comm, &sbuf, &sbuf_win);
+    MPI_Win_allocate_shared(sizeof(double) * DIM * DIM, sizeof(double),
+                            MPI_INFO_NULL, shm_comm, &rbuf, &rbuf_win);
+
+    MPI_Info_set(info, (char *) "wildcard_used", (char *) "none");
+    MPI_Info_set(info, (char *) "datatype_used", (char *) "derived");
+    MPI_Info_set(info, (char *) "offload_min_msgsz", (char *) "1");
+    MPI_Comm_dup_with_info(MPI_COMM_WORLD, info, &comm_world);
+
+    MPI_Barrier(comm_world);
+    errs = run_test();
+
+  exit:
+    if (rank == 0)
+        CTEST_report_result(errs);
+
+    if (info != MPI_INFO_NULL)
+        MPI_Info_free(&info);
+    if (sbuf_win != MPI_WIN_NULL)
+        MPI_Win_free(&sbuf_win);
+    if (rbuf_win != MPI_WIN_NULL)
+        MPI_Win_free(&rbuf_win);
+    if (shm_comm != MPI_COMM_NULL)
+        MPI_Comm_free(&shm_comm);
+    if (comm_world != MPI_COMM_NULL)
+        MPI_Comm_free(&comm_world);
+
+    MPI_Finalize();
+
+    return 0;
+}
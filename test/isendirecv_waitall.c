@@ -13,6 +13,12 @@
 
 /*
  * This test checks round-trip isend and irecv with waitall.
+ * With TEST_SMALL_REQ_POOL, only a part of offloaded calls get pooled requests,
+ * thus pooled and generalized requests are mixed in waitall.
+ * With TEST_NODE_POOL, every process reserves only a few cells and borrows others
+ * from the node-wide pool, thus local, borrowed and pending cells are mixed.
+ * With USE_WAITANY, USE_WAITSOME or USE_TESTALL, the requests are completed
+ * by MPI_Waitany, MPI_Waitsome or MPI_Testall instead.
  */
 
 #ifdef TEST_LMSG
@@ -53,6 +59,39 @@ static int check_stat(MPI_Status stat, int peer, int tag)
     return errs;
 }
 
+static void complete_all(int count, MPI_Request * reqs, MPI_Status * stats)
+{
+#if defined(USE_WAITANY)
+    int i, idx = 0;
+    MPI_Status stat;
+
+    for (i = 0; i < count; i++) {
+        MPI_Waitany(count, reqs, &idx, &stat);
+        stats[idx] = stat;
+    }
+#elif defined(USE_WAITSOME)
+    int i, ncompleted = 0, outcount = 0;
+    int *indices = malloc(count * sizeof(int));
+    MPI_Status *tmp_stats = malloc(count * sizeof(MPI_Status));
+
+    while (ncompleted < count) {
+        MPI_Waitsome(count, reqs, &outcount, indices, tmp_stats);
+        for (i = 0; i < outcount; i++)
+            stats[indices[i]] = tmp_stats[i];
+        ncompleted += outcount;
+    }
+    free(indices);
+    free(tmp_stats);
+#elif defined(USE_TESTALL)
+    int flag = 0;
+
+    while (!flag)
+        MPI_Testall(count, reqs, &flag, stats);
+#else
+    MPI_Waitall(count, reqs, stats);
+#endif
+}
+
 static int run_test(void)
 {
     int i, x, c, errs = 0, errs_total = 0;
@@ -73,7 +112,7 @@ static int run_test(void)
         }
 
         memset(stats, 0, sizeof(stats));
-        MPI_Waitall(NUM_OPS * 2, reqs, stats);
+        complete_all(NUM_OPS * 2, reqs, stats);
 
         /* check completed receive */
         for (i = 0; i < NUM_OPS; i++) {
@@ -101,6 +140,14 @@ int main(int argc, char *argv[])
     MPI_Info info = MPI_INFO_NULL;
     MPI_Comm shm_comm = MPI_COMM_NULL;
 
+#ifdef TEST_SMALL_REQ_POOL
+    setenv("CSP_OFFLOAD_REQ_POOL_SIZE", "16", 1);
+#endif
+#ifdef TEST_NODE_POOL
+    setenv("CSP_OFFLOAD_SHMQ_NCELLS", "8", 1);
+    setenv("CSP_OFFLOAD_NODE_NCELLS", "128", 1);
+#endif
+
     MPI_Init(&argc, &argv);
 
     MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
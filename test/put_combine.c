@@ -0,0 +1,222 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <mpi.h>
+#include "ctest.h"
+
+/*
+ * This test checks small PUTs with write-combining enabled (put_combine_size info).
+ * It issues contiguous and strided PUTs that can be combined, and interleaved
+ * PUTs that break combining, then checks the result after flush/flush_all/unlock.
+ */
+
+#define NUM_OPS 16
+#define STRIDE 3
+#define CHECK
+#define OUTPUT_FAIL_DETAIL
+
+double *winbuf = NULL;
+double *locbuf = NULL;
+int rank, nprocs;
+MPI_Win win = MPI_WIN_NULL;
+int ITER = 2;
+
+static void reset_winbuf(void)
+{
+    int i;
+
+    MPI_Win_lock_all(0, win);
+    for (i = 0; i < NUM_OPS * STRIDE; i++) {
+        winbuf[i] = 0.0;
+    }
+    MPI_Win_sync(win);
+    MPI_Win_unlock_all(win);
+    MPI_Barrier(MPI_COMM_WORLD);
+}
+
+static int check_winbuf(int stride, int x)
+{
+    int i, errs = 0;
+
+    for (i = 0; i < NUM_OPS; i++) {
+        double exp = 1.0 * rank + i * nprocs + x;
+        if (CTEST_double_diff(winbuf[i * stride], exp)) {
+            fprintf(stderr, "[%d] winbuf[%d] %.1lf != %.1lf\n", rank, i * stride,
+                    winbuf[i * stride], exp);
+            errs++;
+        }
+    }
+    return errs;
+}
+
+static void update_locbuf(int x)
+{
+    int i;
+    for (i = 0; i < NUM_OPS * nprocs; i++) {
+        locbuf[i] = 1.0 * i + x;
+    }
+}
+
+/* Contiguous PUTs to each target, completed by flush. */
+static int run_test1(void)
+{
+    int i, x, errs = 0, errs_total = 0;
+    int dst;
+
+    reset_winbuf();
+    MPI_Win_lock_all(0, win);
+
+    for (x = 0; x < ITER; x++) {
+        update_locbuf(x);
+        for (dst = 0; dst < nprocs; dst++) {
+            for (i = 0; i < NUM_OPS; i++) {
+                MPI_Put(&locbuf[dst + i * nprocs], 1, MPI_DOUBLE, dst, i, 1, MPI_DOUBLE, win);
+            }
+            MPI_Win_flush(dst, win);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+        MPI_Win_sync(win);
+
+        errs += check_winbuf(1, x);
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    MPI_Win_unlock_all(win);
+
+    MPI_Allreduce(&errs, &errs_total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return errs_total;
+}
+
+/* Strided PUTs interleaved among targets, completed by flush_all. */
+static int run_test2(void)
+{
+    int i, x, errs = 0, errs_total = 0;
+    int dst;
+
+    reset_winbuf();
+    MPI_Win_lock_all(0, win);
+
+    for (x = 0; x < ITER; x++) {
+        update_locbuf(x);
+
+        /* first half goes target by target, thus can be combined */
+        for (dst = 0; dst < nprocs; dst++) {
+            for (i = 0; i < NUM_OPS / 2; i++) {
+                MPI_Put(&locbuf[dst + i * nprocs], 1, MPI_DOUBLE, dst, i * STRIDE, 1,
+                        MPI_DOUBLE, win);
+            }
+        }
+
+        /* second half interleaves targets, thus breaks combining */
+        for (i = NUM_OPS / 2; i < NUM_OPS; i++) {
+            for (dst = 0; dst < nprocs; dst++) {
+                MPI_Put(&locbuf[dst + i * nprocs], 1, MPI_DOUBLE, dst, i * STRIDE, 1,
+                        MPI_DOUBLE, win);
+            }
+        }
+        MPI_Win_flush_all(win);
+        MPI_Barrier(MPI_COMM_WORLD);
+        MPI_Win_sync(win);
+
+        errs += check_winbuf(STRIDE, x);
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    MPI_Win_unlock_all(win);
+
+    MPI_Allreduce(&errs, &errs_total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return errs_total;
+}
+
+/* Contiguous PUTs completed by unlock. */
+static int run_test3(void)
+{
+    int i, x, errs = 0, errs_total = 0;
+    int dst;
+
+    reset_winbuf();
+
+    for (x = 0; x < ITER; x++) {
+        update_locbuf(x);
+        for (dst = 0; dst < nprocs; dst++) {
+            MPI_Win_lock(MPI_LOCK_SHARED, dst, 0, win);
+            for (i = 0; i < NUM_OPS; i++) {
+                MPI_Put(&locbuf[dst + i * nprocs], 1, MPI_DOUBLE, dst, i, 1, MPI_DOUBLE, win);
+            }
+            MPI_Win_unlock(dst, win);
+        }
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        MPI_Win_lock(MPI_LOCK_SHARED, rank, 0, win);
+        errs += check_winbuf(1, x);
+        MPI_Win_unlock(rank, win);
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    MPI_Allreduce(&errs, &errs_total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return errs_total;
+}
+
+int main(int argc, char *argv[])
+{
+    int errs = 0;
+    MPI_Info info = MPI_INFO_NULL;
+
+    MPI_Init(&argc, &argv);
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (nprocs < 2) {
+        fprintf(stderr, "Please run using at least 2 processes\n");
+        goto exit;
+    }
+
+    locbuf = calloc(NUM_OPS * nprocs, sizeof(double));
+
+    MPI_Info_create(&info);
+    MPI_Info_set(info, (char *) "put_combine_size", (char *) "64");
+
+    /* size in byte */
+    MPI_Win_allocate(sizeof(double) * NUM_OPS * STRIDE, sizeof(double), info,
+                     MPI_COMM_WORLD, &winbuf, &win);
+
+    /*
+     * P0: 0 + [0:NOPS-1] * nprocs + x
+     * P1: 1 + [0:NOPS-1] * nprocs + x
+     * ...
+     */
+
+    errs = run_test1();
+    if (errs)
+        goto exit;
+
+    errs = run_test2();
+    if (errs)
+        goto exit;
+
+    errs = run_test3();
+    if (errs)
+        goto exit;
+
+  exit:
+    if (rank == 0)
+        CTEST_report_result(errs);
+
+    if (info != MPI_INFO_NULL)
+        MPI_Info_free(&info);
+    if (win != MPI_WIN_NULL)
+        MPI_Win_free(&win);
+    if (locbuf)
+        free(locbuf);
+
+    MPI_Finalize();
+
+    return 0;
+}
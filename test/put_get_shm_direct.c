@@ -0,0 +1,172 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <mpi.h>
+#include "ctest.h"
+
+/*
+ * This test checks put/get in the epochs which allow intra-node targets to be
+ * accessed by load/store (fence and lockall with MPI_MODE_NOCHECK).
+ */
+
+#define NUM_OPS 5
+#define CHECK
+#define OUTPUT_FAIL_DETAIL
+
+double *winbuf = NULL;
+double *locbuf = NULL;
+double *checkbuf = NULL;
+int rank, nprocs;
+MPI_Win win = MPI_WIN_NULL;
+int ITER = 2;
+
+static int check_checkbuf(int x)
+{
+    int i, dst, errs = 0;
+
+    /* every target holds rank + i * nprocs + x */
+    for (dst = 0; dst < nprocs; dst++) {
+        for (i = 0; i < NUM_OPS; i++) {
+            double exp = 1.0 * dst + i * nprocs + x;
+            if (CTEST_double_diff(checkbuf[dst * NUM_OPS + i], exp)) {
+                fprintf(stderr, "[%d] checkbuf[%d] (target %d) %.1lf != %.1lf\n", rank,
+                        dst * NUM_OPS + i, dst, checkbuf[dst * NUM_OPS + i], exp);
+                errs++;
+            }
+        }
+    }
+    return errs;
+}
+
+static void update_locbuf(int x)
+{
+    int i;
+    for (i = 0; i < NUM_OPS * nprocs; i++) {
+        locbuf[i] = 1.0 * i + x;
+    }
+}
+
+/* Put in one fence epoch, get in the next one. */
+static int run_test1(void)
+{
+    int i, x, errs = 0, errs_total = 0;
+    int dst;
+
+    for (x = 0; x < ITER; x++) {
+        update_locbuf(x);
+
+        MPI_Win_fence(0, win);
+        for (dst = 0; dst < nprocs; dst++) {
+            for (i = 0; i < NUM_OPS; i++) {
+                MPI_Put(&locbuf[dst + i * nprocs], 1, MPI_DOUBLE, dst, i, 1, MPI_DOUBLE, win);
+            }
+        }
+        MPI_Win_fence(0, win);
+
+        for (dst = 0; dst < nprocs; dst++) {
+            MPI_Get(&checkbuf[dst * NUM_OPS], NUM_OPS, MPI_DOUBLE, dst, 0, NUM_OPS,
+                    MPI_DOUBLE, win);
+        }
+        MPI_Win_fence(0, win);
+
+        errs += check_checkbuf(x);
+    }
+
+    MPI_Allreduce(&errs, &errs_total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return errs_total;
+}
+
+/* Put and get in a lockall epoch with MPI_MODE_NOCHECK. */
+static int run_test2(void)
+{
+    int i, x, errs = 0, errs_total = 0;
+    int dst;
+
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win);
+
+    for (x = 0; x < ITER; x++) {
+        update_locbuf(x);
+
+        for (dst = 0; dst < nprocs; dst++) {
+            for (i = 0; i < NUM_OPS; i++) {
+                MPI_Put(&locbuf[dst + i * nprocs], 1, MPI_DOUBLE, dst, i, 1, MPI_DOUBLE, win);
+            }
+        }
+        MPI_Win_flush_all(win);
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        for (dst = 0; dst < nprocs; dst++) {
+            MPI_Get(&checkbuf[dst * NUM_OPS], NUM_OPS, MPI_DOUBLE, dst, 0, NUM_OPS,
+                    MPI_DOUBLE, win);
+        }
+        MPI_Win_flush_all(win);
+
+        errs += check_checkbuf(x);
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    MPI_Win_unlock_all(win);
+
+    MPI_Allreduce(&errs, &errs_total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return errs_total;
+}
+
+int main(int argc, char *argv[])
+{
+    int errs = 0;
+    MPI_Info info = MPI_INFO_NULL;
+
+    MPI_Init(&argc, &argv);
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (nprocs < 2) {
+        fprintf(stderr, "Please run using at least 2 processes\n");
+        goto exit;
+    }
+
+    locbuf = calloc(NUM_OPS * nprocs, sizeof(double));
+    checkbuf = calloc(NUM_OPS * nprocs, sizeof(double));
+
+#ifdef TEST_SHM_DIRECT_OFF
+    MPI_Info_create(&info);
+    MPI_Info_set(info, (char *) "shm_direct", (char *) "false");
+#endif
+
+    /* size in byte */
+    MPI_Win_allocate(sizeof(double) * NUM_OPS, sizeof(double), info, MPI_COMM_WORLD, &winbuf,
+                     &win);
+
+    errs = run_test1();
+    if (errs)
+        goto exit;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    errs = run_test2();
+    if (errs)
+        goto exit;
+
+  exit:
+    if (rank == 0)
+        CTEST_report_result(errs);
+
+    if (info != MPI_INFO_NULL)
+        MPI_Info_free(&info);
+    if (win != MPI_WIN_NULL)
+        MPI_Win_free(&win);
+    if (locbuf)
+        free(locbuf);
+    if (checkbuf)
+        free(checkbuf);
+
+    MPI_Finalize();
+
+    return 0;
+}
@@ -0,0 +1,191 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <mpi.h>
+#include <pthread.h>
+#include "ctest.h"
+
+/* [THREAD_MULTIPLE TEST]
+ * This test checks offloaded isend and irecv with MPI_THREAD_MULTIPLE safety.
+ *
+ * All threads exchange messages with the peer rank on the same offloading
+ * enabled communicator, distinguished by tag. Every thread uses a separate
+ * segment of the registered shared buffers, and completes its requests by
+ * MPI_Wait, MPI_Test and MPI_Waitall in turn. Thus multiple threads issue to
+ * and complete from the same offload channel concurrently.*/
+
+#define NUM_OPS 8
+#define NREQS 16
+#define NTHREADS 4
+#define ITER 20
+
+static int err;
+static CTEST_atomic_var_t atomic_err;
+static pthread_t threads[NTHREADS];
+static CTEST_thread_tid_arg_t thread_args[NTHREADS];
+
+static MPI_Comm comm_world = MPI_COMM_NULL;
+static MPI_Win sbuf_win = MPI_WIN_NULL, rbuf_win = MPI_WIN_NULL;
+static int *sbuf = NULL, *rbuf = NULL;
+static int rank, nprocs, peer;
+
+#ifdef DEBUG
+#define debug_printf(str,...) {fprintf(stdout, str, ## __VA_ARGS__);fflush(stdout);}
+#else
+#define debug_printf(str,...) {}
+#endif
+
+#define BUF_OFF(tid, r) (((tid) * NREQS + (r)) * NUM_OPS)
+
+static void complete_reqs(MPI_Request * reqs, int x)
+{
+    int i, flag = 0;
+
+    switch (x % 3) {
+    case 0:
+        for (i = 0; i < NREQS * 2; i++)
+            MPI_Wait(&reqs[i], MPI_STATUS_IGNORE);
+        break;
+    case 1:
+        for (i = 0; i < NREQS * 2; i++) {
+            do {
+                MPI_Test(&reqs[i], &flag, MPI_STATUS_IGNORE);
+            } while (!flag);
+        }
+        break;
+    default:
+        MPI_Waitall(NREQS * 2, reqs, MPI_STATUSES_IGNORE);
+        break;
+    }
+}
+
+/* Every thread exchanges messages on its buffer segments
+ * (multiple threads access the same communicator). */
+static void *run_test(void *arg)
+{
+    CTEST_thread_tid_arg_t *my_arg = (CTEST_thread_tid_arg_t *) arg;
+    int tid = my_arg->tid;
+    int i, r, x, check_err = 0;
+    MPI_Request reqs[NREQS * 2];
+
+    debug_printf("rank %d thread %d start\n", rank, tid);
+
+    for (x = 0; x < ITER; x++) {
+        for (r = 0; r < NREQS; r++) {
+            for (i = 0; i < NUM_OPS; i++) {
+                sbuf[BUF_OFF(tid, r) + i] = rank * 100000 + tid * 10000 + x * 100 + r + i;
+                rbuf[BUF_OFF(tid, r) + i] = -1;
+            }
+        }
+
+        for (r = 0; r < NREQS; r++) {
+            MPI_Irecv(&rbuf[BUF_OFF(tid, r)], NUM_OPS, MPI_INT, peer, tid * NREQS + r,
+                      comm_world, &reqs[r]);
+            MPI_Isend(&sbuf[BUF_OFF(tid, r)], NUM_OPS, MPI_INT, peer, tid * NREQS + r,
+                      comm_world, &reqs[NREQS + r]);
+        }
+
+        complete_reqs(reqs, x + tid);
+
+        for (r = 0; r < NREQS; r++) {
+            for (i = 0; i < NUM_OPS; i++) {
+                int exp = peer * 100000 + tid * 10000 + x * 100 + r + i;
+                if (rbuf[BUF_OFF(tid, r) + i] != exp) {
+                    fprintf(stderr, "[%d] tid %d, iter %d, rbuf[%d][%d] %d != %d\n",
+                            rank, tid, x, r, i, rbuf[BUF_OFF(tid, r) + i], exp);
+                    check_err++;
+                }
+            }
+        }
+    }
+
+    CTEST_ATOMIC_VAR_ADD(atomic_err, int, check_err);
+    debug_printf("rank %d thread %d test done, check_err=%d\n", rank, tid, check_err);
+
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    int provided = 0;
+    int perrs, errs_total = 0;
+    int i;
+    MPI_Info info = MPI_INFO_NULL;
+    MPI_Comm shm_comm = MPI_COMM_NULL;
+
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+    if (provided != MPI_THREAD_MULTIPLE) {
+        fprintf(stdout, "This test requires MPI_THREAD_MULTIPLE, but %d\n", provided);
+        fflush(stdout);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (nprocs < 2 || nprocs % 2) {
+        fprintf(stderr, "Please run using power of two number of processes\n");
+        goto exit;
+    }
+    peer = (rank % 2) ? rank - 1 : rank + 1;
+
+    MPI_Info_create(&info);
+
+    /* Register as shared buffer in Casper. */
+    MPI_Info_set(info, (char *) "shmbuf_regist", (char *) "true");
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, info, &shm_comm);
+
+    MPI_Win_allocate_shared(sizeof(int) * NUM_OPS * NREQS * NTHREADS, sizeof(int),
+                            MPI_INFO_NULL, shm_comm, &sbuf, &sbuf_win);
+    MPI_Win_allocate_shared(sizeof(int) * NUM_OPS * NREQS * NTHREADS, sizeof(int),
+                            MPI_INFO_NULL, shm_comm, &rbuf, &rbuf_win);
+
+    MPI_Info_set(info, (char *) "wildcard_used", (char *) "none");
+    MPI_Info_set(info, (char *) "datatype_used", (char *) "predefined");
+    MPI_Info_set(info, (char *) "offload_min_msgsz", (char *) "1");
+    MPI_Comm_dup_with_info(MPI_COMM_WORLD, info, &comm_world);
+
+    CTEST_ATOMIC_VAR_INIT(atomic_err, &err);
+    MPI_Barrier(comm_world);
+
+    for (i = 0; i < NTHREADS; i++) {
+        thread_args[i].tid = i;
+        CTEST_create_thread(&threads[i], &run_test, &thread_args[i]);
+    }
+
+    for (i = 0; i < NTHREADS; i++)
+        pthread_join(threads[i], 0);
+
+    CTEST_ATOMIC_VAR_READ(atomic_err, int, perrs);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Reduce(&perrs, &errs_total, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    CTEST_ATOMIC_VAR_DESTROY(atomic_err);
+
+  exit:
+    if (rank == 0)
+        CTEST_report_result(errs_total);
+
+    if (info != MPI_INFO_NULL)
+        MPI_Info_free(&info);
+    if (sbuf_win != MPI_WIN_NULL)
+        MPI_Win_free(&sbuf_win);
+    if (rbuf_win != MPI_WIN_NULL)
+        MPI_Win_free(&rbuf_win);
+    if (shm_comm != MPI_COMM_NULL)
+        MPI_Comm_free(&shm_comm);
+    if (comm_world != MPI_COMM_NULL)
+        MPI_Comm_free(&comm_world);
+
+    MPI_Finalize();
+
+    return 0;
+}
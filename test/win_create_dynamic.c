@@ -0,0 +1,124 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <mpi.h>
+#include "ctest.h"
+
+/*
+ * This test checks dynamic window with CASPER. The attached memory is
+ * allocated by MPI_Alloc_mem from the dynamic pool (CSP_DYNAMIC_POOL_SIZE),
+ * and accessed by PUT and ACC with the absolute address of the target.
+ */
+
+#define NUM_OPS 5
+#define NUM_ATTACH 2
+#define CHECK
+#define OUTPUT_FAIL_DETAIL
+
+double *winbuf[NUM_ATTACH];
+double locbuf[NUM_OPS];
+MPI_Aint *target_addrs = NULL;
+int rank, nprocs;
+MPI_Win win = MPI_WIN_NULL;
+int ITER = 10;
+
+static int run_test(int x)
+{
+    int i, k, dst, src, errs = 0, errs_total = 0;
+
+    for (i = 0; i < NUM_OPS; i++) {
+        locbuf[i] = 1.0 * (rank + 1) * (i + 1);
+        winbuf[x][i] = 0.0;
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    /* PUT to rank + 1, then ACC to rank + 1 for ITER times. */
+    dst = (rank + 1) % nprocs;
+    src = (rank + nprocs - 1) % nprocs;
+
+    MPI_Win_lock_all(0, win);
+    MPI_Put(locbuf, NUM_OPS, MPI_DOUBLE, dst, target_addrs[dst * NUM_ATTACH + x],
+            NUM_OPS, MPI_DOUBLE, win);
+    MPI_Win_flush(dst, win);
+    for (k = 0; k < ITER; k++) {
+        MPI_Accumulate(locbuf, NUM_OPS, MPI_DOUBLE, dst, target_addrs[dst * NUM_ATTACH + x],
+                       NUM_OPS, MPI_DOUBLE, MPI_SUM, win);
+    }
+    MPI_Win_flush(dst, win);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_sync(win);
+
+    for (i = 0; i < NUM_OPS; i++) {
+        double exp = 1.0 * (src + 1) * (i + 1) * (ITER + 1);
+        if (CTEST_double_diff(winbuf[x][i], exp)) {
+            fprintf(stderr, "[%d] region %d winbuf[%d] %.1lf != %.1lf\n", rank, x, i,
+                    winbuf[x][i], exp);
+            errs++;
+        }
+    }
+    MPI_Win_unlock_all(win);
+
+    MPI_Allreduce(&errs, &errs_total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return errs_total;
+}
+
+int main(int argc, char *argv[])
+{
+    int x, errs = 0;
+    MPI_Aint addrs[NUM_ATTACH];
+
+    /* Enable asynchronous progress on dynamic window if it is not set. */
+    setenv("CSP_DYNAMIC_POOL_SIZE", "1048576", 0);
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (nprocs < 2) {
+        fprintf(stderr, "Please run using at least 2 processes\n");
+        goto exit;
+    }
+
+    MPI_Win_create_dynamic(MPI_INFO_NULL, MPI_COMM_WORLD, &win);
+
+    for (x = 0; x < NUM_ATTACH; x++) {
+        MPI_Alloc_mem(sizeof(double) * NUM_OPS, MPI_INFO_NULL, &winbuf[x]);
+        MPI_Win_attach(win, winbuf[x], sizeof(double) * NUM_OPS);
+        MPI_Get_address(winbuf[x], &addrs[x]);
+    }
+
+    target_addrs = calloc(nprocs * NUM_ATTACH, sizeof(MPI_Aint));
+    MPI_Allgather(addrs, NUM_ATTACH, MPI_AINT, target_addrs, NUM_ATTACH, MPI_AINT,
+                  MPI_COMM_WORLD);
+
+    for (x = 0; x < NUM_ATTACH; x++) {
+        errs = run_test(x);
+        if (errs)
+            break;
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    for (x = 0; x < NUM_ATTACH; x++) {
+        MPI_Win_detach(win, winbuf[x]);
+        MPI_Free_mem(winbuf[x]);
+    }
+
+  exit:
+    if (rank == 0)
+        CTEST_report_result(errs);
+
+    if (win != MPI_WIN_NULL)
+        MPI_Win_free(&win);
+    if (target_addrs)
+        free(target_addrs);
+
+    MPI_Finalize();
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+/* -*- Mode: C; c-basic-offset:4 ; -*- */
+/*
+ * (C) 2016 by Argonne National Laboratory.
+ *     See COPYRIGHT in top-level directory.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <mpi.h>
+#include "ctest.h"
+
+/*
+ * This test checks MPI_Win_create with CASPER (CSP_WIN_CREATE_REMAP). The first
+ * window is created on a page-aligned buffer owning whole pages, thus it is
+ * remapped. A second window is created on the same buffer, which cannot be
+ * remapped again thus falls back to the original MPI. A third window is created
+ * on a buffer sharing pages with other data, which falls back to the original
+ * MPI and the data must be kept. All windows are accessed by PUT and ACC.
+ */
+
+#define NUM_OPS 5
+#define NUM_GUARDS 8
+#define CHECK
+#define OUTPUT_FAIL_DETAIL
+
+double *membuf = NULL, *pagebuf = NULL, *winbuf = NULL;
+double locbuf[NUM_OPS];
+int rank, nprocs;
+int ITER = 10;
+
+static int run_test(MPI_Win win, int x)
+{
+    int i, k, dst, src, errs = 0, errs_total = 0;
+
+    for (i = 0; i < NUM_OPS; i++) {
+        locbuf[i] = 1.0 * (rank + 1) * (i + 1) + x;
+        winbuf[i] = 0.0;
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    /* PUT to rank + 1, then ACC to rank + 1 for ITER times. */
+    dst = (rank + 1) % nprocs;
+    src = (rank + nprocs - 1) % nprocs;
+
+    MPI_Win_lock_all(0, win);
+    MPI_Put(locbuf, NUM_OPS, MPI_DOUBLE, dst, 0, NUM_OPS, MPI_DOUBLE, win);
+    MPI_Win_flush(dst, win);
+    for (k = 0; k < ITER; k++) {
+        MPI_Accumulate(locbuf, NUM_OPS, MPI_DOUBLE, dst, 0, NUM_OPS, MPI_DOUBLE, MPI_SUM, win);
+    }
+    MPI_Win_flush(dst, win);
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_sync(win);
+
+    for (i = 0; i < NUM_OPS; i++) {
+        double exp = (1.0 * (src + 1) * (i + 1) + x) * (ITER + 1);
+        if (CTEST_double_diff(winbuf[i], exp)) {
+            fprintf(stderr, "[%d] win %d winbuf[%d] %.1lf != %.1lf\n", rank, x, i, winbuf[i], exp);
+            errs++;
+        }
+    }
+    MPI_Win_unlock_all(win);
+
+    MPI_Allreduce(&errs, &errs_total, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+    return errs_total;
+}
+
+/* Data located in front of and behind the window buffer. */
+static int check_guards(void)
+{
+    int i, errs = 0;
+
+    for (i = 0; i < NUM_GUARDS; i++) {
+        if (CTEST_double_diff(membuf[i], -1.0 * i) ||
+            CTEST_double_diff(membuf[NUM_GUARDS + NUM_OPS + i], -2.0 * i)) {
+            fprintf(stderr, "[%d] guard %d is modified\n", rank, i);
+            errs++;
+        }
+    }
+    return errs;
+}
+
+int main(int argc, char *argv[])
+{
+    int i, errs = 0;
+    long page_size = sysconf(_SC_PAGESIZE);
+    MPI_Win win = MPI_WIN_NULL, win2 = MPI_WIN_NULL, win3 = MPI_WIN_NULL;
+
+    /* Enable asynchronous progress on win_create window if it is not set. */
+    setenv("CSP_WIN_CREATE_REMAP", "on", 0);
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (nprocs < 2) {
+        fprintf(stderr, "Please run using at least 2 processes\n");
+        goto exit;
+    }
+
+    if (posix_memalign((void **) &pagebuf, page_size, page_size)) {
+        fprintf(stderr, "[%d] cannot allocate page-aligned buffer\n", rank);
+        MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    winbuf = pagebuf;
+
+    MPI_Win_create(winbuf, page_size, sizeof(double), MPI_INFO_NULL, MPI_COMM_WORLD, &win);
+    errs = run_test(win, 0);
+    if (errs)
+        goto exit;
+
+    /* Overlapped with the active window. */
+    MPI_Win_create(winbuf, sizeof(double) * NUM_OPS, sizeof(double), MPI_INFO_NULL,
+                   MPI_COMM_WORLD, &win2);
+    errs = run_test(win2, 1);
+    if (errs)
+        goto exit;
+
+    errs = run_test(win, 2);
+    if (errs)
+        goto exit;
+
+    /* Sharing pages with other data. */
+    membuf = malloc(sizeof(double) * (NUM_OPS + NUM_GUARDS * 2));
+    for (i = 0; i < NUM_GUARDS; i++) {
+        membuf[i] = -1.0 * i;
+        membuf[NUM_GUARDS + NUM_OPS + i] = -2.0 * i;
+    }
+    winbuf = &membuf[NUM_GUARDS];
+
+    MPI_Win_create(winbuf, sizeof(double) * NUM_OPS, sizeof(double), MPI_INFO_NULL,
+                   MPI_COMM_WORLD, &win3);
+    errs = run_test(win3, 3);
+    if (errs)
+        goto exit;
+
+    errs = check_guards();
+    MPI_Allreduce(MPI_IN_PLACE, &errs, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD);
+
+  exit:
+    if (rank == 0)
+        CTEST_report_result(errs);
+
+    if (win3 != MPI_WIN_NULL)
+        MPI_Win_free(&win3);
+    if (win2 != MPI_WIN_NULL)
+        MPI_Win_free(&win2);
+    if (win != MPI_WIN_NULL)
+        MPI_Win_free(&win);
+    if (membuf)
+        free(membuf);
+    if (pagebuf)
+        free(pagebuf);
+
+    MPI_Finalize();
+
+    return 0;
+}